@@ -18,6 +18,7 @@
 #define DIVISOR "  |  "
 #define DIVISOR_LENGTH 5
 #define EXIT_CODE -99
+#define LOAD_BATCH 1000   // tuples inserted by one RelationManager::insertTuples()
 
 // DATABASE_FOLDER is given by makefile.inc file.
 // If your compiler complains about DATABASE_FOLDER, explicitly define DATABASE_FOLDER here
@@ -198,6 +199,8 @@ RC CLI::process(const string input)
 
     ////////////////////////////////////////////
     // create table <tableName> (col1=type1, col2=type2, ...)
+    // create pax table <tableName> (col1=type1, col2=type2, ...)
+    // create compact table <tableName> (col1=type1, col2=type2, ...)
     // create index <columnName> on <tableName>
     // create catalog
     ////////////////////////////////////////////
@@ -211,6 +214,20 @@ RC CLI::process(const string input)
 
         if (type.compare("table") == 0) // if type equals table, then create table
           code = createTable();
+        else if (type.compare("pax") == 0) { // pax table, attributes are stored in column minipages
+          tokenizer = next();
+          if (tokenizer == NULL || !expect(tokenizer, "table"))
+            code = error ("I expect <table>");
+          else
+            code = createTable(PAGE_PAX);
+        }
+        else if (type.compare("compact") == 0) { // records without headers, state kept in the slots
+          tokenizer = next();
+          if (tokenizer == NULL || !expect(tokenizer, "table"))
+            code = error ("I expect <table>");
+          else
+            code = createTable(PAGE_COMPACT);
+        }
         else if (type.compare("index") == 0) // else if type equals index, then create index
           code = createIndex();
         else if (type.compare("catalog") == 0) // else if type equals catalog, then create the catalog
@@ -261,6 +278,20 @@ RC CLI::process(const string input)
       code = load();
     }
 
+    ////////////////////////////////////////////
+    // vacuum <tableName>
+    ////////////////////////////////////////////
+    else if (expect(tokenizer, "vacuum")) {
+      code = vacuum();
+    }
+
+    ////////////////////////////////////////////
+    // migrate <tableName>
+    ////////////////////////////////////////////
+    else if (expect(tokenizer, "migrate")) {
+      code = migrate();
+    }
+
     ////////////////////////////////////////////
     // print <tableName>
     // print attributes <tableName>
@@ -817,7 +848,7 @@ string CLI::fullyQualify(const string attribute, const string tableName) {
 ///////////////////////////////////
 //===============================//
 
-RC CLI::createTable()
+RC CLI::createTable(PageFormat format)
 {
   char * tokenizer = next();
   if (tokenizer == NULL) {
@@ -868,13 +899,14 @@ RC CLI::createTable()
   //    std::cout << ' ' << it->length;
   //  cout << endl;
 
-  RC ret = rm->createTable(name, table_attrs);
+  RC ret = rm->createTable(name, table_attrs, -1, format);
   if (ret != 0)
     return ret;
 
   // add table to cli catalogs
   string file_url = string(DATABASE_FOLDER) + '/' + name;
-  ret = this->addTableToCatalog(name, file_url, "heap");
+  string type = format == PAGE_PAX ? "pax" : (format == PAGE_COMPACT ? "compact" : "heap");
+  ret = this->addTableToCatalog(name, file_url, type);
   if (ret != 0)
     return ret;
 
@@ -1223,6 +1255,8 @@ RC CLI::load()
 
   string line, token;
   char * tokenizer;
+  // tuples are inserted LOAD_BATCH at a time
+  vector<string> tuples;
   while (ifs.good()) {
     getline(ifs, line);
     if (line.compare("") == 0)
@@ -1276,8 +1310,12 @@ RC CLI::load()
       if (keyIndex == attributes.size())
         keyIndex = 0;
     }
-    if (this->insertTupleToDB(tableName, attributes, buffer, indexMap) != 0) {
-      return error("error while inserting tuple");
+    tuples.push_back(string((char *)buffer, offset));
+    if (tuples.size() == LOAD_BATCH) {
+      if (this->insertTuplesToDB(tableName, tuples) != 0) {
+        return error("error while inserting tuple");
+      }
+      tuples.clear();
     }
 
     delete [] a;
@@ -1285,6 +1323,9 @@ RC CLI::load()
     // for (std::vector<Attribute>::iterator it = attrs.begin() ; it != attrs.end(); ++it)
     // totalLength += it->length;
   }
+  if (!tuples.empty() && this->insertTuplesToDB(tableName, tuples) != 0) {
+    return error("error while inserting tuple");
+  }
   // clear up indexMap
   for (auto it=indexMap.begin(); it != indexMap.end(); ++it) {
     free (it->second);
@@ -1296,6 +1337,38 @@ RC CLI::load()
   return 0;
 }
 
+// compact pages of the table, slot numbers are kept
+RC CLI::vacuum()
+{
+  char * tokenizer = next();
+  if (tokenizer == NULL)
+    return error ("I expect <tableName> to be vacuumed");
+
+  string tableName = string(tokenizer);
+  unsigned reclaimed = 0;
+  if (rm->vacuumTable(tableName, reclaimed) != 0)
+    return error ("error CLI::vacuum in rm->vacuumTable");
+
+  cout << reclaimed << " bytes reclaimed in " << tableName << endl;
+  return 0;
+}
+
+// rewrite pages of the table without record headers, RIDs are kept
+RC CLI::migrate()
+{
+  char * tokenizer = next();
+  if (tokenizer == NULL)
+    return error ("I expect <tableName> to be migrated");
+
+  string tableName = string(tokenizer);
+  unsigned unconverted = 0;
+  if (rm->migrateTable(tableName, unconverted) != 0)
+    return error ("error CLI::migrate in rm->migrateTable");
+
+  cout << tableName << " migrated, " << unconverted << " pages left unconverted" << endl;
+  return 0;
+}
+
 RC CLI::insertTuple() {
   char * token = next();
   if (!expect(token, "into"))
@@ -1406,6 +1479,19 @@ RC CLI::insertTupleToDB(const string tableName, const vector<Attribute> attribut
   return 0;
 }
 
+RC CLI::insertTuplesToDB(const string tableName, const vector<string> &tuples) {
+  vector<const void *> data;
+  vector<RID> rids;
+  for (const string &tuple : tuples)
+    data.push_back(tuple.data());
+
+  // insert data to given table
+  if (rm->insertTuples(tableName, data, rids) != 0)
+    return error("error CLI::load in rm->insertTuples");
+
+  return 0;
+}
+
 RC CLI::printAttributes()
 {
   char * tokenizer = next();
@@ -1516,6 +1602,8 @@ RC CLI::help(const string input)
 {
   if (input.compare("create") == 0) {
     cout << "\tcreate table <tableName> (col1 = type1, col2 = type2, ...): creates table with given properties" << endl;
+    cout << "\tcreate pax table <tableName> (col1 = type1, col2 = type2, ...): creates table storing each column contiguously in its pages" << endl;
+    cout << "\tcreate compact table <tableName> (col1 = type1, col2 = type2, ...): creates table whose records have no header, more fit a page" << endl;
     cout << "\tcreate index <columnName> on <tableName>: creates index for <columnName> in table <tableName>" << endl;
     cout << "\tcreate catalog" << endl;
   }
@@ -1541,6 +1629,12 @@ RC CLI::help(const string input)
     cout << "\tload <tableName> \"fileName\"";
     cout << ": loads given filName to given table" << endl;
   }
+  else if (input.compare("vacuum") == 0) {
+    cout << "\tvacuum <tableName>: compacts pages of tableName, space of deleted tuples is reclaimed" << endl;
+  }
+  else if (input.compare("migrate") == 0) {
+    cout << "\tmigrate <tableName>: rewrites pages of tableName as of create compact table, RIDs are kept" << endl;
+  }
   else if (input.compare("help") == 0) {
     cout << "\thelp <commandName>: print help for given command" << endl;
     cout << "\thelp: show help for all commands" << endl;
@@ -1576,6 +1670,8 @@ RC CLI::help(const string input)
     help("print");
     help("insert");
     help("load");
+    help("vacuum");
+    help("migrate");
     help("help");
     help("query");
     help("quit");
@@ -43,7 +43,7 @@ protected:
 
 private:
   // cli parsers
-  RC createTable();
+  RC createTable(PageFormat format = PAGE_SLOTTED_FIELDS);
   RC createIndex();
   RC createCatalog();
   RC dropTable();
@@ -53,6 +53,8 @@ private:
   RC insertTuple();
   RC dropAttribute();
   RC load();
+  RC vacuum();
+  RC migrate();
   RC printTable(const string tableName);
   RC printAttributes();
   RC printIndex();
@@ -104,6 +106,7 @@ private:
   RC printOutputBuffer(vector<string> &buffer, uint mod);
   RC updateOutputBuffer(vector<string> &buffer, void *data, vector<Attribute> &attrs);
   RC insertTupleToDB(const string tableName, const vector<Attribute> attributes, const void *data, unordered_map<int, void *> indexMap);
+  RC insertTuplesToDB(const string tableName, const vector<string> &tuples);
   RC getAttribute(const string name, const vector<Attribute> pool, Attribute &attr);
 
   RelationManager * rm;
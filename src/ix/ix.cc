@@ -4,21 +4,18 @@
  *                  IndexManager                    *
  ****************************************************/
 IndexManager *IndexManager::_index_manager = 0;
+static once_flag indexManagerOnce;
 
 IndexManager *IndexManager::instance()
 {
-    if (!_index_manager)
-        _index_manager = new IndexManager();
-
+    // first caller may be any thread
+    call_once(indexManagerOnce, []() { _index_manager = new IndexManager(); });
     return _index_manager;
 }
 
 IndexManager::IndexManager()
+    : _pfm(PagedFileManager::instance())
 {
-    if (!_pfm)
-    {
-        _pfm = PagedFileManager::instance();
-    }
 }
 
 IndexManager::~IndexManager()
@@ -59,6 +56,16 @@ RC IndexManager::openFile(const string &fileName, IXFileHandle &ixfileHandle)
     return 0;
 }
 
+RC IndexManager::openFile(const string &fileName, IXFileHandle &ixfileHandle, IOBackend backend)
+{
+    if (ixfileHandle.fileName.size() > 0)
+    {
+        return -1;
+    }
+    ixfileHandle = IXFileHandle(fileName, backend);
+    return assertIXFileHandle(ixfileHandle);
+}
+
 RC IndexManager::closeFile(IXFileHandle &ixfileHandle)
 {
     if (assertIXFileHandle(ixfileHandle) != 0)
@@ -317,9 +324,15 @@ void IX_ScanIterator::getNextLeafPage()
         return;
     }
 
-    ixfileHandle->readPage(next, buffer);
+    const char *page = nullptr;
+    if (ixfileHandle->viewPage(next, page) != 0)
+    {
+        cerr << "view leaf page failed" << endl;
+        exit(-1);
+    }
     // all leaf pages in the scan iterator have no need to know their parent, since we only go next
-    LeafPage lp(buffer, attr.type);
+    LeafPage lp(page, attr.type);
+    ixfileHandle->releasePage(next);
     if (toGetFirst && lowKey)
     {
         toGetFirst = false;
@@ -330,6 +343,11 @@ void IX_ScanIterator::getNextLeafPage()
         lp.cloneRangeAll(entries);
     }
     next = lp.nextPn;
+    // read the next leaf while the entries of this one are consumed
+    if (next != 0)
+    {
+        ixfileHandle->prefetchPage(next);
+    }
 }
 
 RC IX_ScanIterator::close()
@@ -371,6 +389,23 @@ IXFileHandle::IXFileHandle(string fileName)
     }
 }
 
+IXFileHandle::IXFileHandle(string fileName, IOBackend backend)
+    : tree(nullptr),
+      _pfm(PagedFileManager::instance()),
+      fileName(fileName),
+      ixReadPageCounter(0),
+      ixWritePageCounter(0),
+      ixAppendPageCounter(0)
+{
+    if (_pfm->openFile(fileName, _fileHandle, backend) != 0)
+    {
+        this->fileName = "";
+        return;
+    }
+    // B+ tree descents jump around the file
+    _fileHandle.advise(ACCESS_RANDOM);
+}
+
 IXFileHandle::~IXFileHandle()
 {
     if (tree)
@@ -400,7 +435,7 @@ void IXFileHandle::rebuidTree(AttrType type)
 
 RC IXFileHandle::writePage(PageNum pageNum, char *data)
 {
-    ixWritePageCounter++;
+    __atomic_add_fetch(&ixWritePageCounter, 1, __ATOMIC_RELAXED);
     return _fileHandle.writePage(pageNum, data);
 }
 
@@ -412,7 +447,7 @@ RC IXFileHandle::appendPage(char *data)
 
 RC IXFileHandle::appendPage(char *data, PageNum &pageNum)
 {
-    ixAppendPageCounter++;
+    __atomic_add_fetch(&ixAppendPageCounter, 1, __ATOMIC_RELAXED);
     if (_fileHandle.appendPage(data) != 0)
     {
         cerr << "append page in index file handle failed." << endl;
@@ -425,10 +460,41 @@ RC IXFileHandle::appendPage(char *data, PageNum &pageNum)
 
 RC IXFileHandle::readPage(PageNum pageNum, char *data)
 {
-    ixReadPageCounter++;
+    __atomic_add_fetch(&ixReadPageCounter, 1, __ATOMIC_RELAXED);
     return _fileHandle.readPage(pageNum, data);
 }
 
+RC IXFileHandle::pinPage(PageNum pageNum, char *&data)
+{
+    __atomic_add_fetch(&ixReadPageCounter, 1, __ATOMIC_RELAXED);
+    return _fileHandle.pinPage(pageNum, data);
+}
+
+RC IXFileHandle::unpinPage(PageNum pageNum, bool dirty)
+{
+    if (dirty)
+    {
+        __atomic_add_fetch(&ixWritePageCounter, 1, __ATOMIC_RELAXED);
+    }
+    return _fileHandle.unpinPage(pageNum, dirty);
+}
+
+RC IXFileHandle::viewPage(PageNum pageNum, const char *&data)
+{
+    __atomic_add_fetch(&ixReadPageCounter, 1, __ATOMIC_RELAXED);
+    return _fileHandle.viewPage(pageNum, data);
+}
+
+RC IXFileHandle::releasePage(PageNum pageNum)
+{
+    return _fileHandle.releasePage(pageNum);
+}
+
+RC IXFileHandle::prefetchPage(PageNum pageNum)
+{
+    return _fileHandle.prefetchPage(pageNum);
+}
+
 unsigned IXFileHandle::getNumberOfPages()
 {
     return _fileHandle.getNumberOfPages();
@@ -436,9 +502,9 @@ unsigned IXFileHandle::getNumberOfPages()
 
 RC IXFileHandle::collectCounterValues(unsigned &readPageCount, unsigned &writePageCount, unsigned &appendPageCount)
 {
-    readPageCount = ixReadPageCounter;
-    writePageCount = ixWritePageCounter;
-    appendPageCount = ixAppendPageCounter;
+    readPageCount = __atomic_load_n(&ixReadPageCounter, __ATOMIC_RELAXED);
+    writePageCount = __atomic_load_n(&ixWritePageCounter, __ATOMIC_RELAXED);
+    appendPageCount = __atomic_load_n(&ixAppendPageCounter, __ATOMIC_RELAXED);
     return 0;
 }
 
@@ -462,20 +528,23 @@ BTree::BTree(IXFileHandle *fileHandle, AttrType attrType)
     }
 
     // if file isn't empty, read meta page
-    _fileHandle->readPage(0, buffer);
-    MetaPage meta(buffer);
+    char *frame = nullptr;
+    _fileHandle->pinPage(0, frame);
+    MetaPage meta(frame);
+    _fileHandle->unpinPage(0);
     rootPn = meta.rootPn;
 
     // read root node
-    _fileHandle->readPage(rootPn, buffer);
+    _fileHandle->pinPage(rootPn, frame);
     if (meta.rootIsLeaf)
     {
-        root = new LeafPage(buffer, attrType);
+        root = new LeafPage(frame, attrType);
     }
     else
     {
-        root = new InternalPage(buffer, attrType);
+        root = new InternalPage(frame, attrType);
     }
+    _fileHandle->unpinPage(rootPn);
 }
 
 BTree::~BTree()
@@ -739,18 +808,21 @@ PageNum BTree::getBeginLeaf()
         return rootPn;
     }
     PageNum nodePn = rootPn;
+    const char *frame = nullptr;
     while (true)
     {
-        _fileHandle->readPage(nodePn, buffer);
+        _fileHandle->viewPage(nodePn, frame);
 
         // find if is leaf or not
         int isLeafBuffer = 0;
-        memcpy(&isLeafBuffer, buffer, sizeof(int));
+        memcpy(&isLeafBuffer, frame, sizeof(int));
         if (isLeafBuffer == 1)
         {
+            _fileHandle->releasePage(nodePn);
             return nodePn;
         }
-        InternalPage ip(buffer, attrType);
+        InternalPage ip(frame, attrType);
+        _fileHandle->releasePage(nodePn);
         if (ip.entries.size() < 2)
         {
             cerr << "empty internal page found?" << endl;
@@ -774,19 +846,22 @@ PageNum BTree::findExactLeafPage(char *key)
     }
 
     PageNum pn = rootPn;
+    const char *frame = nullptr;
     while (true)
     {
-        _fileHandle->readPage(pn, buffer);
+        _fileHandle->viewPage(pn, frame);
 
         // find if is leaf or not
         int isLeafBuffer = 0;
-        memcpy(&isLeafBuffer, buffer, sizeof(int));
+        memcpy(&isLeafBuffer, frame, sizeof(int));
         if (isLeafBuffer == 1)
         {
             // cerr << "return " << pn << endl;
+            _fileHandle->releasePage(pn);
             return pn;
         }
-        InternalPage ip(buffer, attrType);
+        InternalPage ip(frame, attrType);
+        _fileHandle->releasePage(pn);
         if (ip.entries.size() < 2)
         {
             cerr << "empty internal page found?" << endl;
@@ -887,7 +962,7 @@ NodePage::NodePage(PageNum parentPn, AttrType attrType, unsigned size, int isLea
 {
 }
 
-unsigned NodePage::getVCSizeWithHead(char *data)
+unsigned NodePage::getVCSizeWithHead(const char *data)
 {
     unsigned s = 0;
     memcpy(&s, data, sizeof(unsigned));
@@ -908,10 +983,10 @@ InternalPage::InternalPage(AttrType attrType, PageNum parentPn)
     : NodePage(parentPn, attrType, INTERNAL_PAGE_HEADER_SIZE, 0)
 {
 }
-InternalPage::InternalPage(char *rawData, AttrType attrType)
+InternalPage::InternalPage(const char *rawData, AttrType attrType)
     : NodePage(parentPn, attrType, 0, 0)
 {
-    char *start = rawData;
+    const char *start = rawData;
     unsigned entriesNum = 0;
     char keyBuffer[PAGE_SIZE];
     PageNum pnBuffer = 0;
@@ -1137,10 +1212,10 @@ LeafPage::LeafPage(AttrType attrType, PageNum parentPn)
       nextPn(0)
 {
 }
-LeafPage::LeafPage(char *rawData, AttrType attrType)
+LeafPage::LeafPage(const char *rawData, AttrType attrType)
     : NodePage(0, attrType, 0, 1)
 {
-    char *start = rawData;
+    const char *start = rawData;
     unsigned entriesNum = 0;
     char keyBuffer[PAGE_SIZE];
     RID ridBuffer = {0, 0};
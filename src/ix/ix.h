@@ -44,6 +44,7 @@ class IndexManager
 
     // Open an index and return an ixfileHandle.
     RC openFile(const string &fileName, IXFileHandle &ixfileHandle);
+    RC openFile(const string &fileName, IXFileHandle &ixfileHandle, IOBackend backend);
 
     // Close an ixfileHandle for an index.
     RC closeFile(IXFileHandle &ixfileHandle);
@@ -118,12 +119,14 @@ class IXFileHandle
     PagedFileManager *_pfm;
     string fileName;
 
+    // updated with __atomic builtins only, as the counters of FileHandle
     unsigned ixReadPageCounter;
     unsigned ixWritePageCounter;
     unsigned ixAppendPageCounter;
 
     IXFileHandle();
     IXFileHandle(string fileName);
+    IXFileHandle(string fileName, IOBackend backend);
     ~IXFileHandle();
 
     BTree *getTree(AttrType type);
@@ -133,6 +136,14 @@ class IXFileHandle
     RC appendPage(char *data);
     RC appendPage(char *data, PageNum &pageNum);
     RC readPage(PageNum pageNum, char *data);
+    // frame of the page in buffer pool, must unpinPage() after using
+    RC pinPage(PageNum pageNum, char *&data);
+    RC unpinPage(PageNum pageNum, bool dirty = false);
+    // read only view of the page, see FileHandle::viewPage()
+    RC viewPage(PageNum pageNum, const char *&data);
+    RC releasePage(PageNum pageNum);
+    // see FileHandle::prefetchPage()
+    RC prefetchPage(PageNum pageNum);
     unsigned getNumberOfPages();
     RC collectCounterValues(unsigned &readPageCount, unsigned &writePageCount, unsigned &appendPageCount);
     RC closeFile();
@@ -216,7 +227,7 @@ class NodePage
     virtual RC getRawData(char *data) = 0;
     virtual string toString(bool withMeta = false) = 0;
 
-    unsigned getVCSizeWithHead(char *data);
+    unsigned getVCSizeWithHead(const char *data);
 };
 
 /****************************************************
@@ -242,7 +253,7 @@ class InternalPage : public NodePage
     vector<InternalEntry *> entries;
 
     InternalPage(AttrType attrType, PageNum parentPn);
-    InternalPage(char *rawData, AttrType attrType);
+    InternalPage(const char *rawData, AttrType attrType);
     ~InternalPage();
 
     void initFirstEntry(PageNum left, char *midKey, PageNum right);
@@ -278,7 +289,7 @@ class LeafPage : public NodePage
     PageNum nextPn;
 
     LeafPage(AttrType attrType, PageNum parentPn);
-    LeafPage(char *rawData, AttrType attrType);
+    LeafPage(const char *rawData, AttrType attrType);
     ~LeafPage();
 
     // after insert, the size may over PAGE_SIZE, the caller should take care of it
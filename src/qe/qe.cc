@@ -2,84 +2,56 @@
 
 Filter::Filter(Iterator *input, const Condition &condition)
     : input(input),
-      condition(condition)
+      condition(condition),
+      lhsAttr(0)
 {
     getAttributes(attrs);
-}
-
-RC Filter::getNextTuple(void *data)
-{
-    if (input->getNextTuple(data) == -1)
-    {
-        return -1;
-    }
+    fixedRecord = FixedRecord<false>(attrs);
     if (condition.op == NO_OP)
     {
-        return 0;
+        return;
     }
-    Record record(attrs, static_cast<const char *>(data));
-    // cerr << record.toString(attrs) << endl;
-    // return -1;
-    record.getAttribute(attrs, condition.lhsAttr, buffer);
-    int res = compareTo(condition.rhsValue.type, buffer, static_cast<char *>(condition.rhsValue.data));
-    // cerr << record.toString(attrs) << endl;
-    // cerr << "result = " << res << endl;
-    switch (condition.op)
-    {
-    case EQ_OP:
+    for (; lhsAttr < attrs.size(); lhsAttr++)
     {
-        if (res == 0)
+        if (attrs[lhsAttr].name == condition.lhsAttr)
         {
-            return 0;
+            break;
         }
-        break;
     }
-    case LT_OP:
+    if (lhsAttr == attrs.size())
     {
-        if (res < 0)
-        {
-            return 0;
-        }
-        break;
+        cerr << "Condition attribute not found." << endl;
+        exit(-1);
     }
-    case LE_OP:
+    predicate.reset(Predicate::compile(condition.rhsValue.type, condition.op, condition.rhsValue.data));
+}
+
+RC Filter::getNextTuple(void *data)
+{
+    while (input->getNextTuple(data) != -1)
     {
-        if (res <= 0)
+        if (!predicate)
         {
             return 0;
         }
-        break;
-    }
-    case GT_OP:
-    {
-        if (res > 0)
+        const char *tuple = static_cast<const char *>(data);
+        const char *attr = nullptr;
+        if (fixedRecord.applies(tuple))
         {
-            return 0;
+            attr = fixedRecord.view(tuple, lhsAttr);
         }
-        break;
-    }
-    case GE_OP:
-    {
-        if (res >= 0)
+        else
         {
-            return 0;
+            Record record(tuple, Record::getRecordSize(attrs, data));
+            attr = record.viewAttribute(attrs, lhsAttr);
         }
-        break;
-    }
-    case NE_OP:
-    {
-        if (res != 0)
+        // null meets no condition
+        if (attr && predicate->eval(attr))
         {
             return 0;
         }
-        break;
     }
-    case NO_OP:
-    {
-        return 0;
-    }
-    }
-    return getNextTuple(data);
+    return -1;
 }
 
 void Filter::getAttributes(vector<Attribute> &attrs) const
@@ -87,80 +59,23 @@ void Filter::getAttributes(vector<Attribute> &attrs) const
     return input->getAttributes(attrs);
 }
 
-int Filter::compareTo(AttrType type, char *value, char *thatVal)
-{
-    switch (type)
-    {
-    case TypeInt:
-    {
-        int int_this = 0, int_that = 0;
-        memcpy(&int_this, value, sizeof(int));
-        memcpy(&int_that, thatVal, sizeof(int));
-        // cerr << "comparing " << int_this << " ? " << int_that << endl;
-        return int_this - int_that;
-    }
-    case TypeReal:
-    {
-        float f_this = 0, f_that = 0;
-        memcpy(&f_this, value, sizeof(float));
-        memcpy(&f_that, thatVal, sizeof(float));
-        // cerr << "comparing " << f_this << " ? " << f_that << endl;
-        if (f_this - f_that < 0.001 && f_that - f_this < 0.001)
-        {
-            return 0;
-        }
-        return ((f_this - f_that) < 0.0 ? -1 : 1);
-    }
-    case TypeVarChar:
-    {
-        unsigned size = Utils::getVCSizeWithHead(value);
-        unsigned thatSize = Utils::getVCSizeWithHead(thatVal);
-
-        // empty string
-        if (size == sizeof(unsigned))
-        {
-            return thatSize == sizeof(unsigned) ? 0 : -1;
-        }
-        if (thatSize == sizeof(unsigned))
-        {
-            return 1;
-        }
-
-        // + '\0'
-        char _c[size - sizeof(unsigned) + 1];
-        memcpy(_c, value + sizeof(unsigned), size - sizeof(unsigned));
-        _c[size - sizeof(unsigned)] = '\0';
-        string _s(_c);
-
-        char _c_that[thatSize - sizeof(unsigned) + 1];
-        memcpy(_c_that, thatVal + sizeof(unsigned), thatSize - sizeof(unsigned));
-        _c_that[thatSize - sizeof(unsigned)] = '\0';
-        string _s_that(_c_that);
-
-        // cerr << "comparing \"" << _s << "\" ? \"" << _s_that << "\"" << endl;
-        return _s.compare(_s_that);
-    }
-    }
-    return 0;
-}
-
 Project::Project(Iterator *input, const vector<string> &attrNames)
     : input(input),
       attrNames(attrNames)
 {
-    vector<Attribute> ori;
-    input->getAttributes(ori);
+    input->getAttributes(inputAttrs);
     for (unsigned i = 0; i < attrNames.size(); i++)
     {
-        for (unsigned j = 0; j < ori.size(); j++)
+        for (unsigned j = 0; j < inputAttrs.size(); j++)
         {
-            if (ori[j].name == attrNames[i])
+            if (inputAttrs[j].name == attrNames[i])
             {
-                this->attrs.push_back(ori[j]);
-                cerr << "project attr push back " << ori[j].name << endl;
+                this->attrs.push_back(inputAttrs[j]);
             }
         }
     }
+    Record::getAttributeIndexes(inputAttrs, attrNames, projectedAttrs);
+    fixedRecord = FixedRecord<false>(inputAttrs);
 }
 
 Project::~Project()
@@ -173,13 +88,17 @@ RC Project::getNextTuple(void *data)
     {
         return -1;
     }
-    vector<Attribute> ori;
-    input->getAttributes(ori);
-    Record rec(ori, static_cast<char*>(data));
-    // cerr << "Projecting: " << rec.toString(ori) << endl;
-    rec.attributeProjectCompress(ori, attrNames, static_cast<char*>(data));
-    // Record rec2(ori, static_cast<char*>(data));
-    // cerr << "After Projecting: " << rec2.toString(ori) << endl;
+    if (fixedRecord.applies(static_cast<char*>(data)))
+    {
+        fixedRecord.projectCompress(static_cast<char*>(data), projectedAttrs, attrNames.size(), static_cast<char*>(data));
+        return 0;
+    }
+    // projected in place, Record is only a view
+    unsigned size = Record::getRecordSize(inputAttrs, data);
+    char tuple[size];
+    memcpy(tuple, data, size);
+    Record rec(tuple, size);
+    rec.attributeProjectCompress(inputAttrs, attrNames, static_cast<char*>(data));
     return 0;
 }
 
@@ -199,6 +118,7 @@ Aggregate::Aggregate(Iterator *input, Attribute aggAttr, AggregateOp op)
 {
     firstOne = true;
     isFinished = false;
+    compare = Predicate::getComparator(aggAttr.type);
 }
 
 RC Aggregate::getNextTuple(void *data)
@@ -216,7 +136,7 @@ RC Aggregate::getNextTuple(void *data)
 
     while (input->getNextTuple(data) != -1)
     {
-        Record rec(ori, static_cast<char *>(data));
+        Record rec(static_cast<char *>(data), Record::getRecordSize(ori, data));
         size = rec.getAttribute(ori, aggAttr.name, buf);
         cerr << (*(float *)buf) << ", ";
         if (size != 4)
@@ -233,7 +153,7 @@ RC Aggregate::getNextTuple(void *data)
             }
             else
             {
-                if (compareTo(aggAttr.type, buf, max) > 0)
+                if (compare(buf, max) > 0)
                 {
                     memcpy(max, buf, size);
                     size = maxSize;
@@ -263,60 +183,3 @@ void Aggregate::getAttributes(vector<Attribute> &attrs) const
     ret.name += ")";
     attrs.push_back(ret);
 }
-
-int Aggregate::compareTo(AttrType type, char *value, char *thatVal)
-{
-    switch (type)
-    {
-    case TypeInt:
-    {
-        int int_this = 0, int_that = 0;
-        memcpy(&int_this, value, sizeof(int));
-        memcpy(&int_that, thatVal, sizeof(int));
-        // cerr << "comparing " << int_this << " ? " << int_that << endl;
-        return int_this - int_that;
-    }
-    case TypeReal:
-    {
-        float f_this = 0, f_that = 0;
-        memcpy(&f_this, value, sizeof(float));
-        memcpy(&f_that, thatVal, sizeof(float));
-        // cerr << "comparing " << f_this << " ? " << f_that << endl;
-        if (f_this - f_that < 0.001 && f_that - f_this < 0.001)
-        {
-            return 0;
-        }
-        return ((f_this - f_that) < 0.0 ? -1 : 1);
-    }
-    case TypeVarChar:
-    {
-        unsigned size = Utils::getVCSizeWithHead(value);
-        unsigned thatSize = Utils::getVCSizeWithHead(thatVal);
-
-        // empty string
-        if (size == sizeof(unsigned))
-        {
-            return thatSize == sizeof(unsigned) ? 0 : -1;
-        }
-        if (thatSize == sizeof(unsigned))
-        {
-            return 1;
-        }
-
-        // + '\0'
-        char _c[size - sizeof(unsigned) + 1];
-        memcpy(_c, value + sizeof(unsigned), size - sizeof(unsigned));
-        _c[size - sizeof(unsigned)] = '\0';
-        string _s(_c);
-
-        char _c_that[thatSize - sizeof(unsigned) + 1];
-        memcpy(_c_that, thatVal + sizeof(unsigned), thatSize - sizeof(unsigned));
-        _c_that[thatSize - sizeof(unsigned)] = '\0';
-        string _s_that(_c_that);
-
-        // cerr << "comparing \"" << _s << "\" ? \"" << _s_that << "\"" << endl;
-        return _s.compare(_s_that);
-    }
-    }
-    return 0;
-}
\ No newline at end of file
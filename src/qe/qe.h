@@ -8,6 +8,7 @@
 #include "../ix/ix.h"
 
 #define QE_EOF (-1)  // end of the index scan
+#define INDEX_SCAN_BATCH 64  // RIDs taken from the index before their tuples are read
 
 using namespace std;
 
@@ -91,6 +92,12 @@ class TableScan : public Iterator
             return iter->getNextTuple(rid, data);
         };
 
+        // tuples packed one after another, data must hold maxRows * iter->getMaxRowSize() bytes
+        RC getNextBatch(RID *rids, void *data, unsigned maxRows, unsigned &rows)
+        {
+            return iter->getNextBatch(rids, data, maxRows, rows);
+        };
+
         void getAttributes(vector<Attribute> &attrs) const
         {
             attrs.clear();
@@ -125,6 +132,12 @@ class IndexScan : public Iterator
         vector<Attribute> attrs;
         char key[PAGE_SIZE];
         RID rid;
+        // tuples of a batch of RIDs, read by RelationManager::readTuples() in page order
+        vector<RID> rids;
+        vector<RC> rcs;
+        vector<char> rows;
+        vector<void *> rowData;
+        unsigned next;
 
         IndexScan(RelationManager &rm, const string &tableName, const string &attrName, const char *alias = NULL):rm(rm)
         {
@@ -136,6 +149,19 @@ class IndexScan : public Iterator
             // Get Attributes from RM
             rm.getAttributes(tableName, attrs);
 
+            // room for INDEX_SCAN_BATCH tuples of the largest size
+            unsigned rowSize = (attrs.size() + 7) / 8;
+            for(unsigned i = 0; i < attrs.size(); ++i)
+            {
+                rowSize += attrs[i].type == TypeVarChar ? sizeof(unsigned) + attrs[i].length : 4;
+            }
+            rows.resize(INDEX_SCAN_BATCH * rowSize);
+            for(unsigned i = 0; i < INDEX_SCAN_BATCH; ++i)
+            {
+                rowData.push_back(rows.data() + i * rowSize);
+            }
+            next = 0;
+
             // Call rm indexScan to get iterator
             iter = new RM_IndexScanIterator();
             rm.indexScan(tableName, attrName, NULL, NULL, true, true, *iter);
@@ -155,16 +181,52 @@ class IndexScan : public Iterator
             iter = new RM_IndexScanIterator();
             rm.indexScan(tableName, attrName, lowKey, highKey, lowKeyInclusive,
                            highKeyInclusive, *iter);
+            rids.clear();
+            next = 0;
         };
 
         RC getNextTuple(void *data)
         {
-            int rc = iter->getNextEntry(rid, key);
-            if(rc == 0)
+            // RIDs left out by the index, e.g. of deleted tuples, are skipped
+            while(true)
+            {
+                if(next == rids.size())
+                {
+                    int rc = fetch();
+                    if(rc != 0)
+                    {
+                        return rc;
+                    }
+                }
+                unsigned i = next++;
+                if(rcs[i] == 0)
+                {
+                    rid = rids[i];
+                    memcpy(data, rowData[i], Record::getRecordSize(attrs, rowData[i]));
+                    return 0;
+                }
+            }
+        };
+
+        // the next INDEX_SCAN_BATCH entries of the index and their tuples
+        RC fetch()
+        {
+            rids.clear();
+            next = 0;
+            while(rids.size() < INDEX_SCAN_BATCH && iter->getNextEntry(rid, key) == 0)
+            {
+                rids.push_back(rid);
+            }
+            if(rids.empty())
+            {
+                return QE_EOF;
+            }
+            if(rm.readTuples(tableName, rids, rowData, rcs) != 0)
             {
-                rc = rm.readTuple(tableName.c_str(), rid, data);
+                rids.clear();
+                return -1;
             }
-            return rc;
+            return 0;
         };
 
         void getAttributes(vector<Attribute> &attrs) const
@@ -196,7 +258,11 @@ class Filter : public Iterator {
         Iterator *input;
         Condition condition;
         vector<Attribute> attrs;
-        char buffer[PAGE_SIZE];
+        // index of condition.lhsAttr in attrs
+        unsigned lhsAttr;
+        shared_ptr<Predicate> predicate;
+        // tuples with no null of all fixed-width attrs are read at fixed offsets
+        FixedRecord<false> fixedRecord;
         
         Filter(Iterator *input,               // Iterator of input R
                const Condition &condition     // Selection condition
@@ -204,7 +270,6 @@ class Filter : public Iterator {
         ~Filter(){};
 
         RC getNextTuple(void *data);
-        int compareTo(AttrType type, char *value, char *thatVal);
         // For attribute in vector<Attribute>, name it as rel.attr
         void getAttributes(vector<Attribute> &attrs) const;
 };
@@ -216,6 +281,10 @@ class Project : public Iterator {
         Iterator *input;
         vector<string> attrNames;
         vector<Attribute> attrs;
+        // attributes of input, and indexes of attrNames in them, ascending
+        vector<Attribute> inputAttrs;
+        vector<unsigned> projectedAttrs;
+        FixedRecord<false> fixedRecord;
 
         Project(Iterator *input,                    // Iterator of input R
               const vector<string> &attrNames);     // vector containing attribute names
@@ -281,6 +350,7 @@ class Aggregate : public Iterator {
         AggregateOp op;
         bool firstOne;
         bool isFinished;
+        AttrComparator compare;
         // Mandatory
         // Basic aggregation
         Aggregate(Iterator *input,          // Iterator of input R
@@ -302,7 +372,6 @@ class Aggregate : public Iterator {
         // E.g. Relation=rel, attribute=attr, aggregateOp=MAX
         // output attrname = "MAX(rel.attr)"
         void getAttributes(vector<Attribute> &attrs) const;
-        int compareTo(AttrType type, char *value, char *thatVal);
 };
 
 #endif
@@ -0,0 +1,136 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <stdlib.h>
+#include <string.h>
+
+#include "qe.h"
+
+using namespace std;
+
+// tuples of Int and Real attributes from memory, stub.a2 is null in every seventh one
+class StubIterator : public Iterator
+{
+	vector<Attribute> attrs;
+	unsigned next;
+	unsigned tupleNum;
+
+  public:
+	StubIterator(unsigned tupleNum) : next(0), tupleNum(tupleNum)
+	{
+		for (unsigned i = 0; i < 4; i++)
+		{
+			attrs.push_back(Attribute{"stub.a" + to_string(i), i == 1 ? TypeReal : TypeInt, 4});
+		}
+	}
+
+	RC getNextTuple(void *data)
+	{
+		if (next == tupleNum)
+		{
+			return QE_EOF;
+		}
+		prepareTuple(next++, static_cast<char *>(data));
+		return 0;
+	}
+
+	void getAttributes(vector<Attribute> &attrs) const
+	{
+		attrs = this->attrs;
+	}
+
+	// i-th tuple, stub.a0 is i; return its size
+	static unsigned prepareTuple(unsigned i, char *tuple)
+	{
+		int values[4] = {(int)i, 0, (int)i * 10, -(int)i};
+		float real = i * 0.5f;
+		memcpy(&values[1], &real, sizeof(float));
+		tuple[0] = i % 7 == 0 ? 0x20 : 0;
+		unsigned offset = 1;
+		for (unsigned attr = 0; attr < 4; attr++)
+		{
+			if (attr == 2 && i % 7 == 0)
+			{
+				continue;
+			}
+			memcpy(tuple + offset, &values[attr], sizeof(int));
+			offset += sizeof(int);
+		}
+		return offset;
+	}
+};
+
+// tuples with no null take the fixed offsets, the others Record; both return what the input gave
+static void testFilter(unsigned tupleNum)
+{
+	StubIterator input(tupleNum);
+	int value = 500;
+	Condition condition;
+	condition.lhsAttr = "stub.a2";
+	condition.op = GE_OP;
+	condition.bRhsIsAttr = false;
+	condition.rhsValue.type = TypeInt;
+	condition.rhsValue.data = &value;
+	Filter filter(&input, condition);
+
+	char data[PAGE_SIZE], expected[PAGE_SIZE];
+	unsigned count = 0;
+	while (filter.getNextTuple(data) != QE_EOF)
+	{
+		int i = 0;
+		memcpy(&i, data + 1, sizeof(int));
+		assert(i % 7 != 0 && i * 10 >= value && "Filter should return matching tuples, a null should match nothing.");
+		unsigned size = StubIterator::prepareTuple(i, expected);
+		assert(memcmp(data, expected, size) == 0 && "Filter should return the tuple as given.");
+		count++;
+	}
+	unsigned matching = 0;
+	for (unsigned i = 0; i < tupleNum; i++)
+	{
+		matching += i % 7 != 0 && i * 10 >= (unsigned)value;
+	}
+	assert(count == matching && "Filter should return all matching tuples.");
+}
+
+// projected in place at fixed offsets the same as by Record, names of attrNames in any order
+static void testProject(unsigned tupleNum, const vector<string> &attrNames)
+{
+	StubIterator input(tupleNum);
+	vector<Attribute> attrs;
+	input.getAttributes(attrs);
+	Project project(&input, attrNames);
+
+	char data[PAGE_SIZE], tuple[PAGE_SIZE], expected[PAGE_SIZE];
+	unsigned count = 0;
+	while (project.getNextTuple(data) != QE_EOF)
+	{
+		unsigned size = StubIterator::prepareTuple(count, tuple);
+		size = Record(tuple, size).attributeProjectCompress(attrs, attrNames, expected);
+		assert(memcmp(data, expected, size) == 0 && "Project should give the same as Record.");
+		count++;
+	}
+	assert(count == tupleNum && "Project should return all tuples.");
+}
+
+int QETest_Fixed()
+{
+	// Functions tested
+	// 1. Filter over Int and Real tuples, the condition attribute read at its fixed offset
+	// 2. Project of runs and single attributes compacted in place
+	// 3. Tuples with a null are left to Record
+	cerr << endl << "***** In QE Test Case Fixed *****" << endl;
+
+	testFilter(300);
+	testProject(300, vector<string>{"stub.a3", "stub.a0"});
+	testProject(300, vector<string>{"stub.a1", "stub.a2", "stub.a3"});
+	testProject(300, vector<string>{"stub.a2"});
+
+	cerr << "QE Test Case Fixed Finished! The result will be examined." << endl << endl;
+
+	return 0;
+}
+
+int main()
+{
+	return QETest_Fixed();
+}
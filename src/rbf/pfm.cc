@@ -1,5 +1,14 @@
 #include "pfm.h"
 
+#include <cstdlib>
+#include <cerrno>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <climits>
+#include <algorithm>
+
 /****************************************************
  *                      Utils                       *
  ****************************************************/
@@ -33,6 +42,10 @@ unsigned Utils::getVCSizeWithHead(const char *data)
 {
     unsigned s = 0;
     memcpy(&s, data, sizeof(unsigned));
+    if (s & VC_OVERFLOW_FLAG)
+    {
+        return sizeof(unsigned) + sizeof(PageNum);
+    }
     return s + sizeof(unsigned);
 }
 
@@ -66,16 +79,17 @@ unsigned Utils::makeNullIndicator(const bool ni[], const unsigned len, void *dat
  ****************************************************/
 
 PagedFileManager *PagedFileManager::_pf_manager = 0;
+static once_flag pfManagerOnce;
 
 PagedFileManager *PagedFileManager::instance()
 {
-    if (!_pf_manager)
-        _pf_manager = new PagedFileManager();
-
+    // first caller may be any thread
+    call_once(pfManagerOnce, []() { _pf_manager = new PagedFileManager(); });
     return _pf_manager;
 }
 
 PagedFileManager::PagedFileManager()
+    : flushEveryOps(0), flushEveryMs(0)
 {
 }
 
@@ -91,32 +105,1155 @@ RC PagedFileManager::createFile(const string &fileName)
     {
         return -1;
     }
-    fputs("", newFile);
-    fflush(newFile);
-    fclose(newFile);
+    fputs("", newFile);
+    fflush(newFile);
+    fclose(newFile);
+    return 0;
+}
+
+RC PagedFileManager::destroyFile(const string &fileName)
+{
+    BufferPoolManager::instance()->discardFile(fileName);
+    return remove(fileName.c_str());
+}
+
+RC PagedFileManager::openFile(const string &fileName, FileHandle &fileHandle)
+{
+    return openFile(fileName, fileHandle, IO_POSIX);
+}
+
+// [read, write, append counters][page count][directory count] of a version 1 file, whose size they match:
+// the 1st directory page, the data pages, then the other directory pages
+static bool readV1Header(FileIO *io, uint32_t v1[FILEHEADER_V1_LEN])
+{
+    if (io->size() < FILEHEADER_V1_SIZE || io->read(0, FILEHEADER_V1_SIZE, v1) != 0)
+    {
+        return false;
+    }
+    uint64_t pageCount = v1[3], dirCount = v1[4];
+    return dirCount == max((uint64_t)1, (pageCount + DIR_PAGE_LEN - 1) / DIR_PAGE_LEN) &&
+           io->size() == FILEHEADER_V1_SIZE + (pageCount + dirCount) * PAGE_SIZE;
+}
+
+// widen the header of a version 1 file to header of PFM_VERSION, the pages are moved behind it.
+// The file is rewritten in place from its end, it must not be in use
+static RC upgradeHeader(FileIO *io, const uint32_t v1[FILEHEADER_V1_LEN], FileHeader &header)
+{
+    size_t shift = FILEHEADER_SIZE - FILEHEADER_V1_SIZE;
+    size_t end = io->size();
+    if (io->resize(end + shift) != 0)
+    {
+        return -1;
+    }
+    // 128 KB at a time
+    vector<char> buffer(PAGE_SIZE * 32);
+    while (end > FILEHEADER_V1_SIZE)
+    {
+        size_t start = max((size_t)FILEHEADER_V1_SIZE, end - min(end, buffer.size()));
+        if (io->read(start, end - start, buffer.data()) != 0 || io->write(start + shift, end - start, buffer.data()) != 0)
+        {
+            return -1;
+        }
+        end = start;
+    }
+    // pages of the layer above are of its first layout, no page format is chosen
+    header = FileHeader(v1[0], v1[1], v1[2], v1[3], v1[4], 0);
+    char raw[FILEHEADER_SIZE];
+    header.getRawData(raw);
+    return io->write(0, FILEHEADER_SIZE, raw);
+}
+
+RC PagedFileManager::openFile(const string &fileName, FileHandle &fileHandle, IOBackend backend)
+{
+    FileIO *io = FileIO::open(fileName, backend);
+    if (io == NULL)
+    {
+        return -1;
+    }
+    // an empty file gets its header from FileHandle
+    if (io->size() > 0)
+    {
+        char buffer[FILEHEADER_SIZE];
+        FileHeader header;
+        if (io->read(0, FILEHEADER_SIZE, buffer) == 0)
+        {
+            header.readRawData(buffer);
+        }
+        uint32_t v1[FILEHEADER_V1_LEN];
+        if (header.data.magic != PFM_MAGIC && readV1Header(io, v1) && upgradeHeader(io, v1, header) != 0)
+        {
+            cerr << fileName << " can't be upgraded from version 1" << endl;
+            io->close();
+            delete io;
+            return -1;
+        }
+        if (!header.isValid())
+        {
+            cerr << fileName << " is not a paged file of version 1 or " << PFM_VERSION << endl;
+            io->close();
+            delete io;
+            return -1;
+        }
+    }
+    fileHandle = FileHandle{io};
+    fileHandle.setFlushPolicy(flushEveryOps, flushEveryMs);
+    return 0;
+}
+
+RC PagedFileManager::closeFile(FileHandle &fileHandle)
+{
+    return fileHandle.close();
+}
+
+void PagedFileManager::setFlushPolicy(unsigned everyOps, unsigned everyMs)
+{
+    flushEveryOps = everyOps;
+    flushEveryMs = everyMs;
+}
+
+/****************************************************
+ *                      FileIO                      *
+ ****************************************************/
+FileIO *FileIO::open(const string &fileName, IOBackend backend)
+{
+    if (backend == IO_STDIO)
+    {
+        FILE *pfile = fopen(fileName.c_str(), "r+b");
+        if (pfile == NULL)
+        {
+            return NULL;
+        }
+        return new StdioFileIO(pfile);
+    }
+    int fd = ::open(fileName.c_str(), O_RDWR);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    if (backend == IO_MMAP)
+    {
+        return new MmapFileIO(fd);
+    }
+    return new PosixFileIO(fd);
+}
+
+RC FileIO::readv(size_t offset, const vector<iovec> &iov)
+{
+    for (unsigned i = 0; i < iov.size(); i++)
+    {
+        if (read(offset, iov[i].iov_len, iov[i].iov_base) != 0)
+        {
+            return -1;
+        }
+        offset += iov[i].iov_len;
+    }
+    return 0;
+}
+
+StdioFileIO::StdioFileIO(FILE *f)
+    : filePtr(f)
+{
+    // buffer pool caches pages already, and every stream of the same file must see the others' writes
+    setvbuf(filePtr, NULL, _IONBF, 0);
+}
+
+RC StdioFileIO::read(size_t offset, size_t len, void *data)
+{
+    fseek(filePtr, offset, SEEK_SET);
+    size_t n = fread(data, 1, len, filePtr);
+    rewind(filePtr);
+    return n == len ? 0 : -1;
+}
+
+RC StdioFileIO::write(size_t offset, size_t len, const void *data)
+{
+    fseek(filePtr, offset, SEEK_SET);
+    size_t n = fwrite(data, 1, len, filePtr);
+    fflush(filePtr);
+    rewind(filePtr);
+    return n == len ? 0 : -1;
+}
+
+/**
+ * in Byte
+ * http://www.cplusplus.com/reference/cstdio/fread/
+ */
+size_t StdioFileIO::size()
+{
+    size_t lSize = 0;
+
+    fseek(filePtr, 0, SEEK_END);
+    lSize = ftell(filePtr);
+    rewind(filePtr);
+
+    return lSize;
+}
+
+RC StdioFileIO::resize(size_t len)
+{
+    if (fflush(filePtr) != 0)
+    {
+        return -1;
+    }
+    return ftruncate(fileno(filePtr), len);
+}
+
+RC StdioFileIO::sync()
+{
+    if (fflush(filePtr) != 0)
+    {
+        return -1;
+    }
+    return fsync(fileno(filePtr));
+}
+
+int StdioFileIO::descriptor()
+{
+    return fileno(filePtr);
+}
+
+RC StdioFileIO::close()
+{
+    return fclose(filePtr);
+}
+
+PosixFileIO::PosixFileIO(int fd)
+    : fd(fd), length(0)
+{
+    refreshLength();
+}
+
+RC PosixFileIO::refreshLength()
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        return -1;
+    }
+    length = st.st_size;
+    return 0;
+}
+
+RC PosixFileIO::read(size_t offset, size_t len, void *data)
+{
+    // another handle of the same file may have extended it
+    if (offset + len > length && (refreshLength() != 0 || offset + len > length))
+    {
+        return -1;
+    }
+    char *p = (char *)data;
+    while (len > 0)
+    {
+        ssize_t n = pread(fd, p, len, offset);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return -1;
+        }
+        p += n;
+        offset += n;
+        len -= n;
+    }
+    return 0;
+}
+
+RC PosixFileIO::write(size_t offset, size_t len, const void *data)
+{
+    const char *p = (const char *)data;
+    while (len > 0)
+    {
+        ssize_t n = pwrite(fd, p, len, offset);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return -1;
+        }
+        p += n;
+        offset += n;
+        len -= n;
+    }
+    if (offset > length)
+    {
+        length = offset;
+    }
+    return 0;
+}
+
+RC PosixFileIO::readv(size_t offset, const vector<iovec> &iov)
+{
+    size_t len = 0;
+    for (unsigned i = 0; i < iov.size(); i++)
+    {
+        len += iov[i].iov_len;
+    }
+    if (offset + len > length && (refreshLength() != 0 || offset + len > length))
+    {
+        return -1;
+    }
+    // preadv may stop early, continue from where it stops
+    vector<iovec> rest(iov);
+    unsigned first = 0;
+    while (first < rest.size())
+    {
+        int cnt = rest.size() - first < IOV_MAX ? rest.size() - first : IOV_MAX;
+        ssize_t n = preadv(fd, &rest[first], cnt, offset);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return -1;
+        }
+        offset += n;
+        while (n > 0 && first < rest.size())
+        {
+            if ((size_t)n >= rest[first].iov_len)
+            {
+                n -= rest[first].iov_len;
+                first++;
+                continue;
+            }
+            rest[first].iov_base = static_cast<char *>(rest[first].iov_base) + n;
+            rest[first].iov_len -= n;
+            n = 0;
+        }
+    }
+    return 0;
+}
+
+size_t PosixFileIO::size()
+{
+    return length;
+}
+
+RC PosixFileIO::resize(size_t len)
+{
+    if (ftruncate(fd, len) != 0)
+    {
+        return -1;
+    }
+    length = len;
+    return 0;
+}
+
+RC PosixFileIO::sync()
+{
+    return fsync(fd);
+}
+
+int PosixFileIO::descriptor()
+{
+    return fd;
+}
+
+RC PosixFileIO::close()
+{
+    return ::close(fd);
+}
+
+MmapFileIO::MmapFileIO(int fd)
+    : PosixFileIO(fd), base(NULL), mappedLength(0), pattern(ACCESS_NORMAL)
+{
+    remap();
+}
+
+/**
+ * map the whole file as it is now, the old mapping is dropped
+ */
+RC MmapFileIO::remap()
+{
+    if (base)
+    {
+        munmap(base, mappedLength);
+        base = NULL;
+        mappedLength = 0;
+    }
+    if (length == 0)
+    {
+        return 0;
+    }
+    void *p = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+    {
+        return -1;
+    }
+    base = static_cast<char *>(p);
+    mappedLength = length;
+    if (pattern != ACCESS_NORMAL)
+    {
+        advise(pattern);
+    }
+    return 0;
+}
+
+const char *MmapFileIO::map(size_t offset, size_t len)
+{
+    if (offset + len > mappedLength)
+    {
+        // grown by appendPage() of this or another handle
+        if (offset + len > length && (refreshLength() != 0 || offset + len > length))
+        {
+            return NULL;
+        }
+        if (remap() != 0)
+        {
+            return NULL;
+        }
+    }
+    return base + offset;
+}
+
+RC MmapFileIO::read(size_t offset, size_t len, void *data)
+{
+    const char *p = map(offset, len);
+    if (p == NULL)
+    {
+        return -1;
+    }
+    memcpy(data, p, len);
+    return 0;
+}
+
+RC MmapFileIO::advise(AccessPattern pattern)
+{
+    this->pattern = pattern;
+    if (!base)
+    {
+        // applied by remap()
+        return 0;
+    }
+    int advice = MADV_NORMAL;
+    if (pattern == ACCESS_SEQUENTIAL)
+    {
+        advice = MADV_SEQUENTIAL;
+    }
+    else if (pattern == ACCESS_RANDOM)
+    {
+        advice = MADV_RANDOM;
+    }
+    return madvise(base, mappedLength, advice);
+}
+
+RC MmapFileIO::close()
+{
+    if (base)
+    {
+        munmap(base, mappedLength);
+        base = NULL;
+        mappedLength = 0;
+    }
+    return PosixFileIO::close();
+}
+
+/****************************************************
+ *                ReplacementPolicy                 *
+ ****************************************************/
+ClockPolicy::ClockPolicy()
+    : hand(0)
+{
+}
+
+void ClockPolicy::init(unsigned frameNum)
+{
+    hand = 0;
+    refBits.assign(frameNum, false);
+}
+
+void ClockPolicy::touch(unsigned frameId)
+{
+    refBits[frameId] = true;
+}
+
+int ClockPolicy::pickVictim(const vector<BufferFrame> &frames)
+{
+    // 2 rounds: 1st round may only clear the reference bits
+    for (unsigned i = 0; i < 2 * frames.size(); i++)
+    {
+        unsigned curr = hand;
+        hand = (hand + 1) % frames.size();
+        if (frames[curr].pinCount > 0)
+        {
+            continue;
+        }
+        if (refBits[curr])
+        {
+            refBits[curr] = false;
+            continue;
+        }
+        return curr;
+    }
+    return -1;
+}
+
+LRUPolicy::LRUPolicy()
+    : tick(0)
+{
+}
+
+void LRUPolicy::init(unsigned frameNum)
+{
+    tick = 0;
+    lastUsed.assign(frameNum, 0);
+}
+
+void LRUPolicy::touch(unsigned frameId)
+{
+    lastUsed[frameId] = ++tick;
+}
+
+int LRUPolicy::pickVictim(const vector<BufferFrame> &frames)
+{
+    int victim = -1;
+    for (unsigned i = 0; i < frames.size(); i++)
+    {
+        if (frames[i].pinCount > 0)
+        {
+            continue;
+        }
+        if (victim < 0 || lastUsed[i] < lastUsed[victim])
+        {
+            victim = i;
+        }
+    }
+    return victim;
+}
+
+/****************************************************
+ *                BufferPoolManager                 *
+ ****************************************************/
+
+BufferPoolManager *BufferPoolManager::_bp_manager = 0;
+static once_flag bpManagerOnce;
+
+BufferPoolManager *BufferPoolManager::instance()
+{
+    call_once(bpManagerOnce, []() {
+        _bp_manager = new BufferPoolManager();
+        // singleton is never deleted, make sure dirty frames reach the disk
+        atexit(flushAtExit);
+    });
+    return _bp_manager;
+}
+
+BufferPoolManager::BufferPoolManager()
+    : frames(BUFFER_POOL_FRAMES),
+      policy(new ClockPolicy()),
+      nextFileId(1),
+      loadingNum(0),
+      hitCounter(0),
+      missCounter(0),
+      prefetchCounter(0)
+{
+    pool = new char[BUFFER_POOL_FRAMES * PAGE_SIZE];
+    for (unsigned i = 0; i < BUFFER_POOL_FRAMES; i++)
+    {
+        frames[i].fileId = 0;
+        frames[i].pageNum = 0;
+        frames[i].offset = 0;
+        frames[i].pinCount = 0;
+        frames[i].dirty = false;
+        frames[i].valid = false;
+        frames[i].loading = false;
+        frames[i].data = pool + i * PAGE_SIZE;
+        // pop from back, so use the frames in order
+        freeFrames.push_back(BUFFER_POOL_FRAMES - 1 - i);
+    }
+    policy->init(BUFFER_POOL_FRAMES);
+}
+
+BufferPoolManager::~BufferPoolManager()
+{
+    flushAll();
+    delete policy;
+    delete[] pool;
+}
+
+void BufferPoolManager::flushAtExit()
+{
+    _bp_manager->flushAll();
+}
+
+unsigned long long BufferPoolManager::pageKey(unsigned fileId, PageNum pageNum)
+{
+    return (static_cast<unsigned long long>(fileId) << 32) | pageNum;
+}
+
+unordered_map<unsigned long long, unsigned>::iterator BufferPoolManager::findLoaded(unique_lock<mutex> &lock, unsigned fileId, PageNum pageNum)
+{
+    unordered_map<unsigned long long, unsigned>::iterator hit = pageTable.find(pageKey(fileId, pageNum));
+    while (hit != pageTable.end() && frames[hit->second].loading)
+    {
+        loaded.wait(lock);
+        // may have been dropped if the read failed
+        hit = pageTable.find(pageKey(fileId, pageNum));
+    }
+    return hit;
+}
+
+void BufferPoolManager::setReplacementPolicy(ReplacementPolicy *policy)
+{
+    lock_guard<mutex> lock(latch);
+    delete this->policy;
+    this->policy = policy;
+    this->policy->init(frames.size());
+}
+
+RC BufferPoolManager::registerFile(FileIO *io, unsigned &fileId)
+{
+    lock_guard<mutex> lock(latch);
+    struct stat st;
+    if (fstat(io->descriptor(), &st) != 0)
+    {
+        return -1;
+    }
+    for (map<unsigned, PoolFile>::iterator it = files.begin(); it != files.end(); it++)
+    {
+        if (it->second.dev == st.st_dev && it->second.ino == st.st_ino)
+        {
+            it->second.streams.push_back(io);
+            fileId = it->first;
+            return 0;
+        }
+    }
+    fileId = nextFileId++;
+    PoolFile &pf = files[fileId];
+    pf.dev = st.st_dev;
+    pf.ino = st.st_ino;
+    pf.streams.push_back(io);
+    pf.physicalReadCounter = 0;
+    pf.physicalWriteCounter = 0;
+    return 0;
+}
+
+RC BufferPoolManager::unregisterFile(unsigned fileId, FileIO *io)
+{
+    unique_lock<mutex> lock(latch);
+    while (loadingNum > 0)
+    {
+        loaded.wait(lock);
+    }
+    map<unsigned, PoolFile>::iterator it = files.find(fileId);
+    if (it == files.end())
+    {
+        // already discarded
+        return 0;
+    }
+    vector<FileIO *> &streams = it->second.streams;
+    for (unsigned i = 0; i < streams.size(); i++)
+    {
+        if (streams[i] == io)
+        {
+            // flush by io itself, since it's still open
+            swap(streams[i], streams[0]);
+            break;
+        }
+    }
+    RC rc = 0;
+    for (unsigned i = 0; i < frames.size(); i++)
+    {
+        if (frames[i].valid && frames[i].fileId == fileId && writeBack(frames[i]) != 0)
+        {
+            rc = -1;
+        }
+    }
+
+    for (unsigned i = 0; i < streams.size(); i++)
+    {
+        if (streams[i] == io)
+        {
+            streams.erase(streams.begin() + i);
+            break;
+        }
+    }
+    if (streams.empty())
+    {
+        for (unsigned i = 0; i < frames.size(); i++)
+        {
+            if (frames[i].valid && frames[i].fileId == fileId)
+            {
+                dropFrame(i);
+            }
+        }
+        files.erase(it);
+    }
+    return rc;
+}
+
+RC BufferPoolManager::discardFile(const string &fileName)
+{
+    unique_lock<mutex> lock(latch);
+    while (loadingNum > 0)
+    {
+        loaded.wait(lock);
+    }
+    struct stat st;
+    if (stat(fileName.c_str(), &st) != 0)
+    {
+        return -1;
+    }
+    for (map<unsigned, PoolFile>::iterator it = files.begin(); it != files.end(); it++)
+    {
+        if (it->second.dev == st.st_dev && it->second.ino == st.st_ino)
+        {
+            for (unsigned i = 0; i < frames.size(); i++)
+            {
+                if (frames[i].valid && frames[i].fileId == it->first)
+                {
+                    dropFrame(i);
+                }
+            }
+            files.erase(it);
+            return 0;
+        }
+    }
+    return 0;
+}
+
+void BufferPoolManager::dropFrame(unsigned frameId)
+{
+    BufferFrame &frame = frames[frameId];
+    pageTable.erase(pageKey(frame.fileId, frame.pageNum));
+    frame.valid = false;
+    frame.dirty = false;
+    frame.pinCount = 0;
+    freeFrames.push_back(frameId);
+}
+
+RC BufferPoolManager::writeBack(BufferFrame &frame)
+{
+    if (!frame.dirty)
+    {
+        return 0;
+    }
+    map<unsigned, PoolFile>::iterator it = files.find(frame.fileId);
+    if (it == files.end() || it->second.streams.empty())
+    {
+        cerr << "no open stream to write back page " << frame.pageNum << endl;
+        return -1;
+    }
+    if (it->second.streams[0]->write(frame.offset, PAGE_SIZE, frame.data) != 0)
+    {
+        return -1;
+    }
+    it->second.physicalWriteCounter++;
+    frame.dirty = false;
+    return 0;
+}
+
+RC BufferPoolManager::getFrame(unsigned &frameId)
+{
+    if (!freeFrames.empty())
+    {
+        frameId = freeFrames.back();
+        freeFrames.pop_back();
+        return 0;
+    }
+    int victim = policy->pickVictim(frames);
+    if (victim < 0)
+    {
+        cerr << "all frames in buffer pool are pinned" << endl;
+        return -1;
+    }
+    if (writeBack(frames[victim]) != 0)
+    {
+        return -1;
+    }
+    pageTable.erase(pageKey(frames[victim].fileId, frames[victim].pageNum));
+    frames[victim].valid = false;
+    frameId = victim;
+    return 0;
+}
+
+RC BufferPoolManager::fetchPage(unsigned fileId, FileIO *io, PageNum pageNum, size_t offset, char *&data)
+{
+    unique_lock<mutex> lock(latch);
+    unordered_map<unsigned long long, unsigned>::iterator hit = findLoaded(lock, fileId, pageNum);
+    if (hit != pageTable.end())
+    {
+        hitCounter++;
+        BufferFrame &frame = frames[hit->second];
+        frame.pinCount++;
+        policy->touch(hit->second);
+        data = frame.data;
+        return 0;
+    }
+
+    missCounter++;
+    unsigned frameId = 0;
+    if (getFrame(frameId) != 0)
+    {
+        return -1;
+    }
+    // reserved and pinned while the latch is not held, others fetching the page wait in findLoaded().
+    // A stream that can't be used by two threads at once is read under the latch, writeBack() may use it
+    BufferFrame &frame = frames[frameId];
+    frame.fileId = fileId;
+    frame.pageNum = pageNum;
+    frame.offset = offset;
+    frame.pinCount = 1;
+    frame.dirty = false;
+    frame.valid = true;
+    frame.loading = true;
+    pageTable[pageKey(fileId, pageNum)] = frameId;
+    loadingNum++;
+
+    bool unlatched = io->concurrentReads();
+    if (unlatched)
+    {
+        lock.unlock();
+    }
+    RC rc = io->read(offset, PAGE_SIZE, frame.data);
+    if (unlatched)
+    {
+        lock.lock();
+    }
+
+    frame.loading = false;
+    loadingNum--;
+    loaded.notify_all();
+    if (rc != 0)
+    {
+        dropFrame(frameId);
+        return -1;
+    }
+    files[fileId].physicalReadCounter++;
+    policy->touch(frameId);
+    data = frame.data;
+    return 0;
+}
+
+RC BufferPoolManager::installPage(unsigned fileId, PageNum pageNum, size_t offset, const void *data, bool dirty, char *&frameData)
+{
+    unique_lock<mutex> lock(latch);
+    unsigned frameId = 0;
+    // the prefetcher must not overwrite data after it
+    unordered_map<unsigned long long, unsigned>::iterator hit = findLoaded(lock, fileId, pageNum);
+    if (hit != pageTable.end())
+    {
+        frameId = hit->second;
+    }
+    else
+    {
+        if (getFrame(frameId) != 0)
+        {
+            return -1;
+        }
+        pageTable[pageKey(fileId, pageNum)] = frameId;
+        frames[frameId].pinCount = 0;
+        frames[frameId].dirty = false;
+    }
+    BufferFrame &frame = frames[frameId];
+    memcpy(frame.data, data, PAGE_SIZE);
+    frame.fileId = fileId;
+    frame.pageNum = pageNum;
+    frame.offset = offset;
+    frame.pinCount++;
+    frame.dirty = frame.dirty || dirty;
+    frame.valid = true;
+    policy->touch(frameId);
+    frameData = frame.data;
+    return 0;
+}
+
+RC BufferPoolManager::prefetchPage(unsigned fileId, FileIO *io, PageNum pageNum, size_t offset)
+{
+    unique_lock<mutex> lock(latch);
+    if (pageTable.find(pageKey(fileId, pageNum)) != pageTable.end() || files.find(fileId) == files.end())
+    {
+        return 0;
+    }
+    unsigned frameId = 0;
+    if (!freeFrames.empty())
+    {
+        frameId = freeFrames.back();
+        freeFrames.pop_back();
+    }
+    else
+    {
+        // never write back from here, the stream may not be safe for this thread
+        int victim = policy->pickVictim(frames);
+        if (victim < 0 || frames[victim].dirty)
+        {
+            return -1;
+        }
+        pageTable.erase(pageKey(frames[victim].fileId, frames[victim].pageNum));
+        frameId = victim;
+    }
+    BufferFrame &frame = frames[frameId];
+    frame.fileId = fileId;
+    frame.pageNum = pageNum;
+    frame.offset = offset;
+    frame.pinCount = 1;
+    frame.dirty = false;
+    frame.valid = true;
+    frame.loading = true;
+    pageTable[pageKey(fileId, pageNum)] = frameId;
+    loadingNum++;
+
+    lock.unlock();
+    RC rc = io->read(offset, PAGE_SIZE, frame.data);
+    lock.lock();
+
+    frame.loading = false;
+    frame.pinCount = 0;
+    loadingNum--;
+    if (rc != 0)
+    {
+        dropFrame(frameId);
+    }
+    else
+    {
+        files[fileId].physicalReadCounter++;
+        prefetchCounter++;
+        policy->touch(frameId);
+    }
+    loaded.notify_all();
+    return rc;
+}
+
+RC BufferPoolManager::unpinPage(unsigned fileId, PageNum pageNum, bool dirty)
+{
+    lock_guard<mutex> lock(latch);
+    unordered_map<unsigned long long, unsigned>::iterator hit = pageTable.find(pageKey(fileId, pageNum));
+    if (hit == pageTable.end())
+    {
+        return -1;
+    }
+    BufferFrame &frame = frames[hit->second];
+    if (frame.pinCount == 0)
+    {
+        cerr << "unpin a page which is not pinned" << endl;
+        return -1;
+    }
+    frame.pinCount--;
+    frame.dirty = frame.dirty || dirty;
+    return 0;
+}
+
+RC BufferPoolManager::flushPage(unsigned fileId, PageNum pageNum)
+{
+    lock_guard<mutex> lock(latch);
+    unordered_map<unsigned long long, unsigned>::iterator hit = pageTable.find(pageKey(fileId, pageNum));
+    if (hit == pageTable.end())
+    {
+        return 0;
+    }
+    return writeBack(frames[hit->second]);
+}
+
+RC BufferPoolManager::readResident(unsigned fileId, PageNum pageNum, void *data)
+{
+    unique_lock<mutex> lock(latch);
+    unordered_map<unsigned long long, unsigned>::iterator hit = findLoaded(lock, fileId, pageNum);
+    if (hit == pageTable.end())
+    {
+        return -1;
+    }
+    hitCounter++;
+    memcpy(data, frames[hit->second].data, PAGE_SIZE);
+    return 0;
+}
+
+RC BufferPoolManager::flushFile(unsigned fileId)
+{
+    lock_guard<mutex> lock(latch);
+    RC rc = 0;
+    for (unsigned i = 0; i < frames.size(); i++)
+    {
+        if (frames[i].valid && frames[i].fileId == fileId && writeBack(frames[i]) != 0)
+        {
+            rc = -1;
+        }
+    }
+    return rc;
+}
+
+RC BufferPoolManager::flushAll()
+{
+    lock_guard<mutex> lock(latch);
+    RC rc = 0;
+    for (unsigned i = 0; i < frames.size(); i++)
+    {
+        if (frames[i].valid && writeBack(frames[i]) != 0)
+        {
+            rc = -1;
+        }
+    }
+    return rc;
+}
+
+RC BufferPoolManager::collectCounterValues(unsigned &hitCount, unsigned &missCount)
+{
+    lock_guard<mutex> lock(latch);
+    hitCount = hitCounter;
+    missCount = missCounter;
+    return 0;
+}
+
+RC BufferPoolManager::collectPrefetchCounterValues(unsigned &prefetchCount)
+{
+    lock_guard<mutex> lock(latch);
+    prefetchCount = prefetchCounter;
+    return 0;
+}
+
+RC BufferPoolManager::collectFileCounterValues(unsigned fileId, unsigned &physicalReadCount, unsigned &physicalWriteCount)
+{
+    lock_guard<mutex> lock(latch);
+    map<unsigned, PoolFile>::iterator it = files.find(fileId);
+    if (it == files.end())
+    {
+        return -1;
+    }
+    physicalReadCount = it->second.physicalReadCounter;
+    physicalWriteCount = it->second.physicalWriteCounter;
+    return 0;
+}
+
+/****************************************************
+ *                    Prefetcher                    *
+ ****************************************************/
+
+Prefetcher *Prefetcher::_prefetcher = 0;
+static once_flag prefetcherOnce;
+
+Prefetcher *Prefetcher::instance()
+{
+    // first caller may be any thread
+    call_once(prefetcherOnce, []() { _prefetcher = new Prefetcher(); });
+    return _prefetcher;
+}
+
+Prefetcher::Prefetcher()
+    : nextScanId(0),
+      window(PREFETCH_WINDOW),
+      started(false)
+{
+}
+
+Prefetcher::~Prefetcher()
+{
+}
+
+void Prefetcher::work()
+{
+    BufferPoolManager *bpm = BufferPoolManager::instance();
+    unique_lock<mutex> lock(latch);
+    while (true)
+    {
+        queued.wait(lock, [this]() { return !tasks.empty(); });
+        Task task = tasks.front();
+        tasks.pop_front();
+        running.push_back(task.io);
+
+        lock.unlock();
+        bpm->prefetchPage(task.fileId, task.io, task.pageNum, task.offset);
+        lock.lock();
+
+        running.erase(find(running.begin(), running.end(), task.io));
+        finished.notify_all();
+    }
+}
+
+int Prefetcher::registerScan(FileHandle *fileHandle, PageNum first, PageNum last)
+{
+    lock_guard<mutex> lock(latch);
+    int scanId = nextScanId++;
+    scans[scanId] = Scan{fileHandle, last, first};
+    return scanId;
+}
+
+void Prefetcher::advance(int scanId, PageNum pageNum)
+{
+    unique_lock<mutex> lock(latch);
+    map<int, Scan>::iterator it = scans.find(scanId);
+    if (it == scans.end())
+    {
+        return;
+    }
+    Scan &scan = it->second;
+    // the window is [pageNum + 1, pageNum + window]
+    PageNum end = min(pageNum + window, scan.last);
+    if (scan.nextToQueue <= pageNum)
+    {
+        scan.nextToQueue = pageNum + 1;
+    }
+    FileHandle *fileHandle = scan.fileHandle;
+    PageNum from = scan.nextToQueue;
+    if (from > end)
+    {
+        return;
+    }
+    scan.nextToQueue = end + 1;
+    lock.unlock();
+
+    for (PageNum pn = from; pn <= end; pn++)
+    {
+        fileHandle->prefetchPage(pn);
+    }
+}
+
+void Prefetcher::unregisterScan(int scanId)
+{
+    lock_guard<mutex> lock(latch);
+    scans.erase(scanId);
+}
+
+RC Prefetcher::enqueue(unsigned fileId, FileIO *io, PageNum pageNum, size_t offset)
+{
+    lock_guard<mutex> lock(latch);
+    if (window == 0)
+    {
+        return 0;
+    }
+    if (!started)
+    {
+        // singleton is never deleted, the threads just wait at exit
+        started = true;
+        for (unsigned i = 0; i < PREFETCH_THREADS; i++)
+        {
+            thread(&Prefetcher::work, this).detach();
+        }
+    }
+    tasks.push_back(Task{fileId, io, pageNum, offset});
+    queued.notify_one();
     return 0;
 }
 
-RC PagedFileManager::destroyFile(const string &fileName)
+void Prefetcher::drain(FileIO *io)
 {
-    return remove(fileName.c_str());
+    unique_lock<mutex> lock(latch);
+    for (deque<Task>::iterator it = tasks.begin(); it != tasks.end();)
+    {
+        if (it->io == io)
+        {
+            it = tasks.erase(it);
+        }
+        else
+        {
+            it++;
+        }
+    }
+    finished.wait(lock, [this, io]() { return find(running.begin(), running.end(), io) == running.end(); });
 }
 
-RC PagedFileManager::openFile(const string &fileName, FileHandle &fileHandle)
+void Prefetcher::waitIdle()
 {
-    FILE *pfile;
-    pfile = fopen(fileName.c_str(), "r+b");
-    if (pfile == NULL)
-    {
-        return -1;
-    }
-    fileHandle = FileHandle{pfile};
-    return 0;
+    unique_lock<mutex> lock(latch);
+    finished.wait(lock, [this]() { return tasks.empty() && running.empty(); });
 }
 
-RC PagedFileManager::closeFile(FileHandle &fileHandle)
+void Prefetcher::setWindow(unsigned pages)
 {
-    return fileHandle.close();
+    lock_guard<mutex> lock(latch);
+    window = pages;
 }
 
 /****************************************************
@@ -160,24 +1297,31 @@ RC DirectroyPage::updateDataSize(PageNum &pageNum, unsigned size)
  ****************************************************/
 FileHeader::FileHeader()
 {
+    data.magic = PFM_MAGIC;
+    data.version = PFM_VERSION;
     data.readPageCounter = 0;
     data.writePageCounter = 0;
     data.appendPageCounter = 0;
     data.pageCount = 0;
     data.dirCount = 0;
+    data.pageFormat = 0;
 }
 
-FileHeader::FileHeader(unsigned readPageCounter,
-                       unsigned writePageCounter,
-                       unsigned appendPageCounter,
-                       unsigned pageCount,
-                       unsigned dirCount)
+FileHeader::FileHeader(uint64_t readPageCounter,
+                       uint64_t writePageCounter,
+                       uint64_t appendPageCounter,
+                       uint64_t pageCount,
+                       uint64_t dirCount,
+                       uint64_t pageFormat)
 {
+    data.magic = PFM_MAGIC;
+    data.version = PFM_VERSION;
     data.readPageCounter = readPageCounter;
     data.writePageCounter = writePageCounter;
     data.appendPageCounter = appendPageCounter;
     data.pageCount = pageCount;
     data.dirCount = dirCount;
+    data.pageFormat = pageFormat;
 }
 
 /**
@@ -198,6 +1342,17 @@ RC FileHeader::getRawData(void *d)
     return 0;
 }
 
+bool FileHeader::isValid()
+{
+    if (data.magic != PFM_MAGIC || data.version != PFM_VERSION)
+    {
+        return false;
+    }
+    return data.pageCount <= UINT_MAX &&
+           data.dirCount >= 1 &&
+           data.dirCount * DIR_PAGE_LEN >= data.pageCount;
+}
+
 /****************************************************
  *                    FileHandle                    *
  ****************************************************/
@@ -210,11 +1365,22 @@ FileHandle::FileHandle()
 
     pageCount = 0;
     dirCount = 0;
+    pageFormat = 0;
+
+    metaDirty = false;
+    opsSinceFlush = 0;
+    lastFlush = chrono::steady_clock::now();
+    flushEveryOps = 0;
+    flushEveryMs = 0;
 
-    filePtr = NULL;
+    fsmBuilt = false;
+
+    io = NULL;
+    bpm = BufferPoolManager::instance();
+    fileId = 0;
 }
 
-FileHandle::FileHandle(FILE *f)
+FileHandle::FileHandle(FileIO *io)
 {
     readPageCounter = 0;
     writePageCounter = 0;
@@ -222,8 +1388,24 @@ FileHandle::FileHandle(FILE *f)
 
     pageCount = 0;
     dirCount = 0;
+    pageFormat = 0;
+
+    metaDirty = false;
+    opsSinceFlush = 0;
+    lastFlush = chrono::steady_clock::now();
+    flushEveryOps = 0;
+    flushEveryMs = 0;
 
-    filePtr = f;
+    fsmBuilt = false;
+
+    this->io = io;
+    bpm = BufferPoolManager::instance();
+    fileId = 0;
+    if (bpm->registerFile(io, fileId) != 0)
+    {
+        cerr << "register file in buffer pool failed." << endl;
+        exit(-1);
+    }
 
     char *buffer = new char[PAGE_SIZE];
 
@@ -242,27 +1424,20 @@ FileHandle::FileHandle(FILE *f)
         appendPageCounter = fileHeader.data.appendPageCounter;
         pageCount = fileHeader.data.pageCount;
         dirCount = fileHeader.data.dirCount;
+        pageFormat = fileHeader.data.pageFormat;
 
-        // read directory page(s)
-        for (unsigned i = 0, offset = FILEHEADER_SIZE; i < dirCount; i++)
+        // read directory page(s), the 1st one lays before data pages, the others after them
+        for (unsigned i = 0; i < dirCount; i++)
         {
+            size_t offset = FILEHEADER_SIZE + (i == 0 ? 0 : (size_t)(pageCount + i) * PAGE_SIZE);
             dirPages.push_back(DirectroyPage());
+            dirDirty.push_back(false);
             if (_rawReadByte(offset, offset + PAGE_SIZE, buffer) != 0)
             {
                 cerr << "_rawReadByte failed." << endl;
                 exit(-1);
             }
-
             dirPages[i].readRawData(buffer);
-            // 1st directory page
-            if (i == 0)
-            {
-                offset += PAGE_SIZE * pageCount;
-            }
-            else
-            {
-                offset += PAGE_SIZE;
-            }
         }
     }
     // init file header
@@ -270,6 +1445,7 @@ FileHandle::FileHandle(FILE *f)
     {
         dirCount = 1;
         dirPages.push_back(DirectroyPage());
+        dirDirty.push_back(true);
         // init fileHeader and DirPages
         flushAll();
     }
@@ -282,12 +1458,159 @@ FileHandle::~FileHandle()
 
 RC FileHandle::readPage(PageNum pageNum, void *data)
 {
+    char *frame = nullptr;
+    if (pinPage(pageNum, frame) != 0)
+    {
+        return -1;
+    }
+    memcpy(data, frame, PAGE_SIZE);
+    return unpinPage(pageNum);
+}
+
+RC FileHandle::pinPage(PageNum pageNum, char *&data)
+{
+    if (pageNum >= pageCount)
+    {
+        return -1;
+    }
+    __atomic_add_fetch(&readPageCounter, 1, __ATOMIC_RELAXED);
+    return bpm->fetchPage(fileId, io, pageNum, pageOffset(pageNum), data);
+}
+
+RC FileHandle::unpinPage(PageNum pageNum, bool dirty)
+{
+    if (bpm->unpinPage(fileId, pageNum, dirty) != 0)
+    {
+        return -1;
+    }
+    if (dirty)
+    {
+        __atomic_add_fetch(&writePageCounter, 1, __ATOMIC_RELAXED);
+        return markMetaDirty();
+    }
+    return 0;
+}
+
+RC FileHandle::viewPage(PageNum pageNum, const char *&data)
+{
+    if (!io->inPlace())
+    {
+        char *frame = nullptr;
+        if (pinPage(pageNum, frame) != 0)
+        {
+            return -1;
+        }
+        data = frame;
+        return 0;
+    }
     if (pageNum >= pageCount)
     {
         return -1;
     }
-    readPageCounter++;
-    return _rawReadPage(pageNum + 1, data);
+    __atomic_add_fetch(&readPageCounter, 1, __ATOMIC_RELAXED);
+    // the mapping only sees what is on disk
+    if (bpm->flushPage(fileId, pageNum) != 0)
+    {
+        return -1;
+    }
+    data = io->map(pageOffset(pageNum), PAGE_SIZE);
+    return data ? 0 : -1;
+}
+
+RC FileHandle::releasePage(PageNum pageNum)
+{
+    if (io->inPlace())
+    {
+        return 0;
+    }
+    return unpinPage(pageNum);
+}
+
+RC FileHandle::advise(AccessPattern pattern)
+{
+    return io->advise(pattern);
+}
+
+bool FileHandle::inPlace()
+{
+    return io->inPlace();
+}
+
+bool FileHandle::concurrentReads()
+{
+    return io->concurrentReads();
+}
+
+RC FileHandle::readPages(PageNum start, unsigned n, void *dst)
+{
+    if (n == 0 || start >= pageCount || n > pageCount - start)
+    {
+        return -1;
+    }
+    __atomic_add_fetch(&readPageCounter, n, __ATOMIC_RELAXED);
+
+    // the whole range in one read: pages not in buffer pool go to dst,
+    // resident ones (may be dirty) are copied from their frames, their disk copy goes to a scratch page
+    char *p = static_cast<char *>(dst);
+    char scratch[PAGE_SIZE];
+    unsigned residentNum = 0;
+    vector<iovec> iov;
+    for (unsigned i = 0; i < n; i++)
+    {
+        if (bpm->readResident(fileId, start + i, p + (size_t)i * PAGE_SIZE) == 0)
+        {
+            residentNum++;
+            iov.push_back(iovec{scratch, PAGE_SIZE});
+        }
+        else if (!iov.empty() && iov.back().iov_base != scratch)
+        {
+            // extend the current run of dst
+            iov.back().iov_len += PAGE_SIZE;
+        }
+        else
+        {
+            iov.push_back(iovec{p + (size_t)i * PAGE_SIZE, PAGE_SIZE});
+        }
+    }
+    if (residentNum == n)
+    {
+        return 0;
+    }
+    // trailing resident pages need not be read at all
+    while (!iov.empty() && iov.back().iov_base == scratch)
+    {
+        iov.pop_back();
+    }
+    return io->readv(pageOffset(start), iov);
+}
+
+RC FileHandle::prefetchPage(PageNum pageNum)
+{
+    if (!io || !io->concurrentReads())
+    {
+        return -1;
+    }
+    if (pageNum >= pageCount)
+    {
+        return 0;
+    }
+    return Prefetcher::instance()->enqueue(fileId, io, pageNum, pageOffset(pageNum));
+}
+
+RC FileHandle::collectPhysicalCounterValues(unsigned &physicalReadCount, unsigned &physicalWriteCount)
+{
+    return bpm->collectFileCounterValues(fileId, physicalReadCount, physicalWriteCount);
+}
+
+unsigned FileHandle::getFileId()
+{
+    return fileId;
+}
+
+size_t FileHandle::pageOffset(PageNum pageNum)
+{
+    // 1st directory page lays before data pages
+    return FILEHEADER_SIZE + (size_t)(pageNum + 1) * PAGE_SIZE;
 }
 
 RC FileHandle::writePage(PageNum pageNum, const void *data)
@@ -307,49 +1630,41 @@ unsigned FileHandle::getNumberOfPages()
 
 RC FileHandle::collectCounterValues(unsigned &readPageCount, unsigned &writePageCount, unsigned &appendPageCount)
 {
-    readPageCount = readPageCounter;
-    writePageCount = writePageCounter;
-    appendPageCount = appendPageCounter;
+    readPageCount = (unsigned)__atomic_load_n(&readPageCounter, __ATOMIC_RELAXED);
+    writePageCount = (unsigned)__atomic_load_n(&writePageCounter, __ATOMIC_RELAXED);
+    appendPageCount = (unsigned)__atomic_load_n(&appendPageCounter, __ATOMIC_RELAXED);
     return 0;
 }
 
-RC FileHandle::_rawReadByte(unsigned start, unsigned end, void *data)
+RC FileHandle::collectCounterValues(uint64_t &readPageCount, uint64_t &writePageCount, uint64_t &appendPageCount)
 {
-    if (start >= end || end > getFileSize())
-    {
-        cerr << "start=" << start << " end=" << end << " getFileSize()=" << getFileSize() << endl;
-        return -1;
-    }
-    fseek(filePtr, start, SEEK_SET);
-    fread(data, 1, end - start, filePtr);
-    rewind(filePtr);
+    readPageCount = __atomic_load_n(&readPageCounter, __ATOMIC_RELAXED);
+    writePageCount = __atomic_load_n(&writePageCounter, __ATOMIC_RELAXED);
+    appendPageCount = __atomic_load_n(&appendPageCounter, __ATOMIC_RELAXED);
     return 0;
 }
 
-RC FileHandle::_rawWriteByte(unsigned start, unsigned end, void *data)
+RC FileHandle::_rawReadByte(size_t start, size_t end, void *data)
 {
-    if (start >= end || start > getFileSize())
+    if (start >= end)
     {
         return -1;
     }
-    fseek(filePtr, start, SEEK_SET);
-    fwrite(data, end - start, 1, filePtr);
-    fflush(filePtr);
-    rewind(filePtr);
+    if (io->read(start, end - start, data) != 0)
+    {
+        cerr << "start=" << start << " end=" << end << " getFileSize()=" << getFileSize() << endl;
+        return -1;
+    }
     return 0;
 }
 
-RC FileHandle::_rawReadPage(PageNum pageNum, void *data)
+RC FileHandle::_rawWriteByte(size_t start, size_t end, void *data)
 {
-    if (pageCount + dirCount - 1 < pageNum)
+    if (start >= end || start > getFileSize())
     {
         return -1;
     }
-    size_t pos = FILEHEADER_SIZE + pageNum * PAGE_SIZE;
-    fseek(filePtr, pos, SEEK_SET);
-    fread(data, PAGE_SIZE, 1, filePtr);
-    rewind(filePtr);
-    return 0;
+    return io->write(start, end - start, data);
 }
 
 RC FileHandle::_rawWritePage(PageNum pageNum, const void *data)
@@ -358,41 +1673,28 @@ RC FileHandle::_rawWritePage(PageNum pageNum, const void *data)
     {
         return -1;
     }
-    size_t pos = FILEHEADER_SIZE + pageNum * PAGE_SIZE;
-    fseek(filePtr, pos, SEEK_SET);
-    fwrite(data, PAGE_SIZE, 1, filePtr);
-    fflush(filePtr);
-    rewind(filePtr);
-    return 0;
-}
-RC FileHandle::_rawAppendPage(const void *data)
-{
-    fseek(filePtr, 0, SEEK_END);
-    fwrite(data, PAGE_SIZE, 1, filePtr);
-    fflush(filePtr);
-    rewind(filePtr);
-    return 0;
+    size_t pos = FILEHEADER_SIZE + (size_t)pageNum * PAGE_SIZE;
+    return io->write(pos, PAGE_SIZE, data);
 }
 
 /**
  * in Byte
- * http://www.cplusplus.com/reference/cstdio/fread/
  */
 size_t FileHandle::getFileSize()
 {
-    size_t lSize = 0;
-
-    fseek(filePtr, 0, SEEK_END);
-    lSize = ftell(filePtr);
-    rewind(filePtr);
-
-    return lSize;
+    return io->size();
 }
 
 RC FileHandle::close()
 {
+    // no prefetch task may use io after it's deleted
+    Prefetcher::instance()->drain(io);
     flushAll();
-    return fclose(filePtr);
+    bpm->unregisterFile(fileId, io);
+    RC rc = io->close();
+    delete io;
+    io = NULL;
+    return rc;
 }
 
 RC FileHandle::flushAll()
@@ -400,73 +1702,145 @@ RC FileHandle::flushAll()
     // save FileHeader
     char *buffer = new char[PAGE_SIZE];
     fileHeader = FileHeader{
-        readPageCounter,
-        writePageCounter,
-        appendPageCounter,
+        __atomic_load_n(&readPageCounter, __ATOMIC_RELAXED),
+        __atomic_load_n(&writePageCounter, __ATOMIC_RELAXED),
+        __atomic_load_n(&appendPageCounter, __ATOMIC_RELAXED),
         pageCount,
-        dirCount};
+        dirCount,
+        pageFormat};
     fileHeader.getRawData(buffer);
     _rawWriteByte(0, FILEHEADER_SIZE, buffer);
 
-    // save Directory Pages
-    for (unsigned i = 0, offset = 0; i < dirCount; i++)
+    // save changed Directory Pages, the 1st one lays before data pages, the others after them
+    for (unsigned i = 0; i < dirCount; i++)
     {
-        dirPages[i].getRawData(buffer);
-        _rawWritePage(offset, buffer);
-        // 1st directory page
-        if (i == 0)
+        if (!dirDirty[i])
         {
-            // aka offset = pageCount
-            offset += pageCount;
+            continue;
         }
-        offset += 1;
+        dirPages[i].getRawData(buffer);
+        _rawWritePage(i == 0 ? 0 : pageCount + i, buffer);
+        dirDirty[i] = false;
     }
-    fflush(filePtr);
-    rewind(filePtr);
 
     delete[] buffer;
 
+    metaDirty = false;
+    opsSinceFlush = 0;
+    lastFlush = chrono::steady_clock::now();
+    return 0;
+}
+
+void FileHandle::growDirPages()
+{
+    while (pageCount > DIR_PAGE_LEN * dirCount)
+    {
+        dirCount++;
+        dirPages.push_back(DirectroyPage());
+        dirDirty.push_back(true);
+    }
+}
+
+RC FileHandle::markMetaDirty()
+{
+    metaDirty = true;
+    opsSinceFlush++;
+    if (flushEveryOps > 0 && opsSinceFlush >= flushEveryOps)
+    {
+        return flushAll();
+    }
+    if (flushEveryMs > 0 &&
+        chrono::steady_clock::now() - lastFlush >= chrono::milliseconds(flushEveryMs))
+    {
+        return flushAll();
+    }
     return 0;
 }
 
+void FileHandle::setFlushPolicy(unsigned everyOps, unsigned everyMs)
+{
+    flushEveryOps = everyOps;
+    flushEveryMs = everyMs;
+}
+
+RC FileHandle::sync()
+{
+    if (bpm->flushFile(fileId) != 0 || flushAll() != 0)
+    {
+        return -1;
+    }
+    return io->sync();
+}
+
 RC FileHandle::writePage(PageNum pageNum, const void *data, unsigned dataSize)
 {
     if (pageNum >= pageCount)
     {
         return -1;
     }
-    writePageCounter++;
+    __atomic_add_fetch(&writePageCounter, 1, __ATOMIC_RELAXED);
 
-    _rawWritePage(pageNum + 1, data);
+    // write back later by buffer pool
+    char *frame = nullptr;
+    if (bpm->installPage(fileId, pageNum, pageOffset(pageNum), data, true, frame) != 0)
+    {
+        return -1;
+    }
+    bpm->unpinPage(fileId, pageNum, false);
     updateDataSize(pageNum, dataSize);
-    flushAll();
-    return 0;
+    return markMetaDirty();
 }
 
 RC FileHandle::appendPage(const void *data, unsigned dataSize)
 {
-    appendPageCounter++;
+    __atomic_add_fetch(&appendPageCounter, 1, __ATOMIC_RELAXED);
     pageCount++;
+    growDirPages();
 
-    // need add new directory page
-    if (pageCount > DIR_PAGE_LEN * dirCount)
+    // actually overwrite the 2nd directory page if any, all directory pages after data pages move back by one
+    for (unsigned i = 1; i < dirCount; i++)
     {
-        dirCount++;
-        dirPages.push_back(DirectroyPage());
+        dirDirty[i] = true;
     }
-
-    if (dirCount == 1)
+    if (_rawWritePage(pageCount, data) != 0)
     {
-        _rawAppendPage(data);
+        return -1;
     }
-    // actually overwrite the 2nd directory page
-    else
+    // keep the new page, it's very likely to be read soon
+    char *frame = nullptr;
+    if (bpm->installPage(fileId, pageCount - 1, pageOffset(pageCount - 1), data, false, frame) == 0)
     {
-        _rawWritePage(pageCount, data);
+        bpm->unpinPage(fileId, pageCount - 1, false);
     }
     updateDataSize(pageCount - 1, dataSize);
-    flushAll();
-    return 0;
+    return markMetaDirty();
+}
+
+RC FileHandle::appendPages(const void *data, unsigned n, const unsigned *dataSizes)
+{
+    if (n == 0 || n > UINT_MAX - pageCount)
+    {
+        return -1;
+    }
+    PageNum first = pageCount;
+    __atomic_add_fetch(&appendPageCounter, n, __ATOMIC_RELAXED);
+    pageCount += n;
+    growDirPages();
+
+    // directory pages after data pages are overwritten as by appendPage()
+    for (unsigned i = 1; i < dirCount; i++)
+    {
+        dirDirty[i] = true;
+    }
+    if (io->write(pageOffset(first), (size_t)n * PAGE_SIZE, data) != 0)
+    {
+        return -1;
+    }
+    for (unsigned i = 0; i < n; i++)
+    {
+        updateDataSize(first + i, dataSizes[i]);
+    }
+    return markMetaDirty();
 }
 
 RC FileHandle::updateDataSize(PageNum pageNum, unsigned dataSize)
@@ -476,11 +1850,42 @@ RC FileHandle::updateDataSize(PageNum pageNum, unsigned dataSize)
     {
         return -1;
     }
+    listFreePage(pageNum, dataSize);
     pageNum = pageNum % DIR_PAGE_LEN;
     dirPages[dirNum].updateDataSize(pageNum, dataSize);
+    dirDirty[dirNum] = true;
     return 0;
 }
 
+RC FileHandle::reservePages(unsigned n)
+{
+    if (n == 0 || n > UINT_MAX - pageCount)
+    {
+        return -1;
+    }
+    // cut the directory pages after data pages, they would be garbage in the new pages,
+    // then extend with zeros; flushAll() writes them again after the new pages
+    if (io->resize(pageOffset(pageCount)) != 0)
+    {
+        return -1;
+    }
+    pageCount += n;
+    __atomic_add_fetch(&appendPageCounter, n, __ATOMIC_RELAXED);
+    growDirPages();
+    // new pages are empty, index them with all others next time
+    fsmBuilt = false;
+    for (unsigned i = 1; i < dirCount; i++)
+    {
+        dirDirty[i] = true;
+    }
+    if (io->resize(pageOffset(pageCount)) != 0)
+    {
+        return -1;
+    }
+    // directory pages are not on disk now, don't wait for the flush policy
+    return flushAll();
+}
+
 RC FileHandle::getPageSize(PageNum pageNum, unsigned &size)
 {
     if (pageNum >= pageCount)
@@ -499,4 +1904,84 @@ RC FileHandle::getPageSize(PageNum pageNum, unsigned &size)
         return -1;
     }
     return 0;
-}
\ No newline at end of file
+}
+
+unsigned FileHandle::getPageFormat()
+{
+    return pageFormat;
+}
+
+RC FileHandle::setPageFormat(unsigned format)
+{
+    pageFormat = format;
+    return markMetaDirty();
+}
+
+RC FileHandle::findFreePage(unsigned size, PageNum &pageNum)
+{
+    if (!fsmBuilt)
+    {
+        buildFreeLists();
+    }
+    for (unsigned b = (size + FSM_BUCKET_SIZE - 1) / FSM_BUCKET_SIZE; b < FSM_BUCKETS; b++)
+    {
+        while (!freeLists[b].empty())
+        {
+            PageNum pn = freeLists[b].back();
+            unsigned dataSize = 0;
+            getPageSize(pn, dataSize);
+            if (freeBucket(dataSize) == b)
+            {
+                pageNum = pn;
+                return 0;
+            }
+            // moved to another bucket since listed
+            freeLists[b].pop_back();
+            listed[pn] &= ~(1 << b);
+        }
+    }
+    return -1;
+}
+
+unsigned FileHandle::freeBucket(unsigned dataSize)
+{
+    if (dataSize >= PAGE_SIZE)
+    {
+        return 0;
+    }
+    return min((PAGE_SIZE - dataSize) / FSM_BUCKET_SIZE, (unsigned)FSM_BUCKETS - 1);
+}
+
+void FileHandle::buildFreeLists()
+{
+    freeLists.assign(FSM_BUCKETS, vector<PageNum>());
+    listed.assign(pageCount, 0);
+    fsmBuilt = true;
+    // later pages are found first
+    for (PageNum pn = 0; pn < pageCount; pn++)
+    {
+        unsigned dataSize = 0;
+        getPageSize(pn, dataSize);
+        listFreePage(pn, dataSize);
+    }
+}
+
+void FileHandle::listFreePage(PageNum pageNum, unsigned dataSize)
+{
+    if (!fsmBuilt)
+    {
+        return;
+    }
+    if (listed.size() <= pageNum)
+    {
+        listed.resize(pageNum + 1, 0);
+    }
+    unsigned b = freeBucket(dataSize);
+    // bucket 0 is never searched
+    if (b == 0 || (listed[pageNum] & (1 << b)))
+    {
+        return;
+    }
+    freeLists[b].push_back(pageNum);
+    listed[pageNum] |= 1 << b;
+}
@@ -9,8 +9,19 @@ typedef char byte;
  * ALL SIZE is # of Bytes
  */
 #define PAGE_SIZE 4096
-#define FILEHEADER_LEN 5
-#define FILEHEADER_SIZE (FILEHEADER_LEN * sizeof(unsigned))
+
+/**
+ * File header: magic, version, then FILEHEADER_LEN 64-bit fields
+ * Version 1 had no magic/version and FILEHEADER_V1_LEN 32-bit fields, no page format.
+ * PagedFileManager::openFile() widens its header in place, pages are moved behind it as they are,
+ * their records are converted by RecordBasedFileManager::convertFile()
+ */
+#define PFM_MAGIC 0x4D464242 // "BBFM"
+#define PFM_VERSION 2
+#define FILEHEADER_LEN 6
+#define FILEHEADER_SIZE (2 * sizeof(uint32_t) + FILEHEADER_LEN * sizeof(uint64_t))
+#define FILEHEADER_V1_LEN 5
+#define FILEHEADER_V1_SIZE (FILEHEADER_V1_LEN * sizeof(uint32_t))
 
 /**
  * Each Directory Page keep # DIR_PAGE_LEN of
@@ -19,16 +30,65 @@ typedef char byte;
  */
 #define DIR_PAGE_LEN (PAGE_SIZE / sizeof(unsigned))
 
+/**
+ * Free space map: free bytes of a page is PAGE_SIZE - its data size,
+ * indexed in memory by FSM_BUCKETS buckets of FSM_BUCKET_SIZE bytes
+ * Aka 256 bytes each
+ */
+#define FSM_BUCKETS 16
+#define FSM_BUCKET_SIZE (PAGE_SIZE / FSM_BUCKETS)
+
+/**
+ * # of frames in the shared buffer pool
+ * Aka 1 MB of cached pages
+ */
+#define BUFFER_POOL_FRAMES 256
+
+/**
+ * Read-ahead of sequential scans, see Prefetcher
+ * PREFETCH_WINDOW pages ahead of the consumer, aka 256 KB
+ */
+#define PREFETCH_THREADS 2
+#define PREFETCH_WINDOW 64
+
 #include <string>
+#include <cstdint>
 #include <climits>
 #include <cstdio>
 #include <iostream>
 #include <vector>
+#include <map>
+#include <unordered_map>
 #include <cstring>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <sys/types.h>
+#include <sys/uio.h>
 
 using namespace std;
 
 class FileHandle;
+class FileIO;
+class BufferPoolManager;
+
+// how a FileHandle talks to the disk
+typedef enum { IO_STDIO = 0, // FILE* with fseek + fread/fwrite
+               IO_POSIX,     // file descriptor with pread/pwrite, default
+               IO_MMAP       // IO_POSIX, plus pages viewed in place from a shared read-only mapping
+} IOBackend;
+
+// expected access pattern of a file, only a hint to the backend
+typedef enum { ACCESS_NORMAL = 0,
+               ACCESS_SEQUENTIAL, // table scans
+               ACCESS_RANDOM      // index probes
+} AccessPattern;
+
+// set in the size of a VarChar kept out of its record, see OverflowPage in rbfm.h
+#define VC_OVERFLOW_FLAG 0x80000000u
 
 /****************************************************
  *                      Utils                       *
@@ -40,6 +100,7 @@ class Utils
     static unsigned makeStandardString(const string s, char *data);
     static void assertExit(const string e, RC ret);
     static void assertExit(const string e, bool b = true);
+    // a stub of VC_OVERFLOW_FLAG is [Size][PageNum]
     static unsigned getVCSizeWithHead(const char *data);
     static unsigned makeNullIndicator(const bool ni[], const unsigned len, void *data);
 };
@@ -55,23 +116,350 @@ class PagedFileManager
     RC createFile(const string &fileName);                       // Create a new file
     RC destroyFile(const string &fileName);                      // Destroy a file
     RC openFile(const string &fileName, FileHandle &fileHandle); // Open a file
+    RC openFile(const string &fileName, FileHandle &fileHandle, IOBackend backend);
     RC closeFile(FileHandle &fileHandle);                        // Close a file
 
+    // for files opened later, see FileHandle::setFlushPolicy()
+    void setFlushPolicy(unsigned everyOps, unsigned everyMs);
+
   protected:
     PagedFileManager();  // Constructor
     ~PagedFileManager(); // Destructor
 
   private:
     static PagedFileManager *_pf_manager;
+    // set by any thread, read by openFile()
+    atomic<unsigned> flushEveryOps;
+    atomic<unsigned> flushEveryMs;
+};
+
+/****************************************************
+ *                      FileIO                      *
+ ****************************************************
+ 
+ * Byte level access of an opened file by absolute offset.
+ * read() fails if [offset, offset + len) is not all in file,
+ * write() may extend the file.
+ */
+class FileIO
+{
+  public:
+    virtual ~FileIO(){};
+
+    virtual RC read(size_t offset, size_t len, void *data) = 0;
+    virtual RC write(size_t offset, size_t len, const void *data) = 0;
+    // scatter [offset, offset + SUM(iov.iov_len)) into iov
+    virtual RC readv(size_t offset, const vector<iovec> &iov);
+    virtual size_t size() = 0;
+    // extend or cut the file to len bytes, extended bytes are zeros (a hole if the file system can)
+    virtual RC resize(size_t len) = 0;
+    // make written data durable
+    virtual RC sync() = 0;
+    // for fstat() only, never move its position
+    virtual int descriptor() = 0;
+    virtual RC close() = 0;
+
+    // whether read() can be called from other threads while this one uses the FileIO
+    virtual bool concurrentReads() { return false; };
+    // whether map() gives the bytes in place
+    virtual bool inPlace() { return false; };
+    // [offset, offset + len) in place, valid until the next call on this FileIO; NULL if not in file
+    virtual const char *map(size_t offset, size_t len) { return NULL; };
+    virtual RC advise(AccessPattern pattern) { return 0; };
+
+    static FileIO *open(const string &fileName, IOBackend backend);
+};
+
+// every call is fseek + fread/fwrite + rewind, size() seeks to the end
+class StdioFileIO : public FileIO
+{
+    FILE *filePtr;
+
+  public:
+    StdioFileIO(FILE *f);
+    RC read(size_t offset, size_t len, void *data) override;
+    RC write(size_t offset, size_t len, const void *data) override;
+    size_t size() override;
+    RC resize(size_t len) override;
+    RC sync() override;
+    int descriptor() override;
+    RC close() override;
+};
+
+// one pread/pwrite per call, file length is cached
+class PosixFileIO : public FileIO
+{
+  protected:
+    int fd;
+    // prefetcher threads may refresh it
+    atomic<size_t> length;
+
+    RC refreshLength();
+
+  public:
+    PosixFileIO(int fd);
+    RC read(size_t offset, size_t len, void *data) override;
+    RC write(size_t offset, size_t len, const void *data) override;
+    // one preadv per call
+    RC readv(size_t offset, const vector<iovec> &iov) override;
+    size_t size() override;
+    RC resize(size_t len) override;
+    RC sync() override;
+    int descriptor() override;
+    RC close() override;
+
+    bool concurrentReads() override { return true; };
+};
+
+// PosixFileIO whose reads come from a MAP_SHARED mapping, remapped when the file grows
+class MmapFileIO : public PosixFileIO
+{
+    char *base;
+    size_t mappedLength;
+    AccessPattern pattern;
+
+    RC remap();
+
+  public:
+    MmapFileIO(int fd);
+    RC read(size_t offset, size_t len, void *data) override;
+    RC close() override;
+
+    // remap() may unmap under other threads
+    bool concurrentReads() override { return false; };
+    bool inPlace() override { return true; };
+    const char *map(size_t offset, size_t len) override;
+    RC advise(AccessPattern pattern) override;
+};
+
+/****************************************************
+ *                   BufferFrame                    *
+ ****************************************************/
+struct BufferFrame
+{
+    unsigned fileId;
+    PageNum pageNum;
+    // byte offset of the page in its file, used when writing back
+    size_t offset;
+    unsigned pinCount;
+    bool dirty;
+    bool valid;
+    // being read by the prefetcher or fetchPage() with the latch not held, pinned until done
+    bool loading;
+    char *data;
+};
+
+/****************************************************
+ *                ReplacementPolicy                 *
+ ****************************************************
+ 
+ * Decide which unpinned frame to reuse when the pool is full.
+ * Free (invalid) frames are always used first by the pool itself.
+ */
+class ReplacementPolicy
+{
+  public:
+    virtual ~ReplacementPolicy(){};
+
+    virtual void init(unsigned frameNum) = 0;
+    // called every time a frame is pinned
+    virtual void touch(unsigned frameId) = 0;
+    // return a frame with pinCount == 0, or -1 if all frames are pinned
+    virtual int pickVictim(const vector<BufferFrame> &frames) = 0;
+};
+
+class ClockPolicy : public ReplacementPolicy
+{
+    unsigned hand;
+    vector<bool> refBits;
+
+  public:
+    ClockPolicy();
+    void init(unsigned frameNum) override;
+    void touch(unsigned frameId) override;
+    int pickVictim(const vector<BufferFrame> &frames) override;
+};
+
+class LRUPolicy : public ReplacementPolicy
+{
+    unsigned long tick;
+    vector<unsigned long> lastUsed;
+
+  public:
+    LRUPolicy();
+    void init(unsigned frameNum) override;
+    void touch(unsigned frameId) override;
+    int pickVictim(const vector<BufferFrame> &frames) override;
+};
+
+/****************************************************
+ *                BufferPoolManager                 *
+ ****************************************************
+ 
+ * Fixed frames shared by all FileHandles (and so IXFileHandles).
+ * Pages are identified by (fileId, pageNum), fileId is given per
+ * (device, inode) when registerFile(), so two handles of the same
+ * file share the same frames.
+ * 
+ * Write back: writePage() only dirties the frame, dirty frames go
+ * to disk when evicted, flushFile() or the last handle is closed.
+ *
+ * All public calls are serialized by a latch, since the prefetcher
+ * threads fill frames with prefetchPage() in background.
+ */
+class BufferPoolManager
+{
+    struct PoolFile
+    {
+        dev_t dev;
+        ino_t ino;
+        // all handles opened on this file, any of them can write back
+        vector<FileIO *> streams;
+        unsigned physicalReadCounter;
+        unsigned physicalWriteCounter;
+    };
+
+    vector<BufferFrame> frames;
+    char *pool;
+    vector<unsigned> freeFrames;
+    map<unsigned, PoolFile> files;
+    // (fileId << 32 | pageNum) -> frame id
+    unordered_map<unsigned long long, unsigned> pageTable;
+    ReplacementPolicy *policy;
+    unsigned nextFileId;
+
+    mutex latch;
+    // signaled when a loading frame is done
+    condition_variable loaded;
+    unsigned loadingNum;
+
+    unsigned hitCounter;
+    unsigned missCounter;
+    unsigned prefetchCounter;
+
+    static unsigned long long pageKey(unsigned fileId, PageNum pageNum);
+    // wait for the page if it's loading, return its frame or pageTable.end()
+    unordered_map<unsigned long long, unsigned>::iterator findLoaded(unique_lock<mutex> &lock, unsigned fileId, PageNum pageNum);
+    RC getFrame(unsigned &frameId);
+    RC writeBack(BufferFrame &frame);
+    void dropFrame(unsigned frameId);
+    static void flushAtExit();
+
+  public:
+    static BufferPoolManager *instance();
+
+    RC registerFile(FileIO *io, unsigned &fileId);
+    // flush dirty frames through io; when io is the last stream, drop all frames of the file
+    RC unregisterFile(unsigned fileId, FileIO *io);
+    // forget all frames of fileName without writing them, call before removing the file
+    RC discardFile(const string &fileName);
+
+    // pin the page, read it from disk by io if not resident, the latch is not held while reading if io has concurrentReads()
+    RC fetchPage(unsigned fileId, FileIO *io, PageNum pageNum, size_t offset, char *&data);
+    // pin the page with given content, without reading the disk
+    RC installPage(unsigned fileId, PageNum pageNum, size_t offset, const void *data, bool dirty, char *&frame);
+    // read the page into an unpinned frame if not resident, the latch is not held while reading
+    RC prefetchPage(unsigned fileId, FileIO *io, PageNum pageNum, size_t offset);
+    RC unpinPage(unsigned fileId, PageNum pageNum, bool dirty);
+    // write back the page if it's resident and dirty
+    RC flushPage(unsigned fileId, PageNum pageNum);
+    // copy the page if it's resident, return -1 if not
+    RC readResident(unsigned fileId, PageNum pageNum, void *data);
+    RC flushFile(unsigned fileId);
+    RC flushAll();
+
+    // pool takes the ownership of policy
+    void setReplacementPolicy(ReplacementPolicy *policy);
+    RC collectCounterValues(unsigned &hitCount, unsigned &missCount);
+    RC collectPrefetchCounterValues(unsigned &prefetchCount);
+    RC collectFileCounterValues(unsigned fileId, unsigned &physicalReadCount, unsigned &physicalWriteCount);
+
+  protected:
+    BufferPoolManager();
+    ~BufferPoolManager();
+
+  private:
+    static BufferPoolManager *_bp_manager;
+};
+
+/****************************************************
+ *                    Prefetcher                    *
+ ****************************************************
+ 
+ * PREFETCH_THREADS I/O threads filling buffer frames ahead of scans.
+ * A scan registers the pages it will read in order, then tells
+ * advance() the page it's about to read; pages up to PREFETCH_WINDOW
+ * after it are queued. Queued pages of a file are dropped when its
+ * handle is closed.
+ */
+class Prefetcher
+{
+    struct Task
+    {
+        unsigned fileId;
+        FileIO *io;
+        PageNum pageNum;
+        size_t offset;
+    };
+
+    struct Scan
+    {
+        FileHandle *fileHandle;
+        PageNum last;
+        // pages before it have been queued
+        PageNum nextToQueue;
+    };
+
+    mutex latch;
+    condition_variable queued;
+    // signaled when a task is done
+    condition_variable finished;
+    deque<Task> tasks;
+    // FileIO of the tasks being read now
+    vector<FileIO *> running;
+    map<int, Scan> scans;
+    int nextScanId;
+    unsigned window;
+    // threads are started by the first enqueue()
+    bool started;
+
+    void work();
+
+  public:
+    static Prefetcher *instance();
+
+    // fileHandle will be read from first to last in order, return scan id.
+    // Nothing is prefetched if its backend can't read concurrently
+    int registerScan(FileHandle *fileHandle, PageNum first, PageNum last);
+    // the scan is about to read pageNum
+    void advance(int scanId, PageNum pageNum);
+    void unregisterScan(int scanId);
+
+    // queue a single page, use FileHandle::prefetchPage()
+    RC enqueue(unsigned fileId, FileIO *io, PageNum pageNum, size_t offset);
+    // drop the queued tasks of io, wait for its running ones
+    void drain(FileIO *io);
+    // wait until every queued task is done
+    void waitIdle();
+
+    // lookahead in pages, 0 to turn read-ahead off
+    void setWindow(unsigned pages);
+
+  protected:
+    Prefetcher();
+    ~Prefetcher();
+
+  private:
+    static Prefetcher *_prefetcher;
 };
 
 /****************************************************
  *                  DirectroyPage                   *
  ****************************************************
 
- * Actually, directory page has been abandoned.
- * All metadata of data size in this header file can only be PAGE_SIZE, aka full for always
- * just manage your page size inside 
+ * Data size of each data page, persisted as the free space map.
+ * Pages written without a data size are PAGE_SIZE, aka full,
+ * so they are never offered by FileHandle::findFreePage()
  */
 class DirectroyPage
 {
@@ -95,23 +483,29 @@ class FileHeader
      */
     struct FileHeaderData
     {
-        unsigned readPageCounter;
-        unsigned writePageCounter;
-        unsigned appendPageCounter;
-        unsigned pageCount;
-        unsigned dirCount;
+        uint32_t magic;
+        uint32_t version;
+        uint64_t readPageCounter;
+        uint64_t writePageCounter;
+        uint64_t appendPageCounter;
+        uint64_t pageCount;
+        uint64_t dirCount;
+        uint64_t pageFormat;
     };
 
   public:
     FileHeaderData data;
     FileHeader();
-    FileHeader(unsigned readPageCounter,
-               unsigned writePageCounter,
-               unsigned appendPageCounter,
-               unsigned pageCount,
-               unsigned dirCount);
+    FileHeader(uint64_t readPageCounter,
+               uint64_t writePageCounter,
+               uint64_t appendPageCounter,
+               uint64_t pageCount,
+               uint64_t dirCount,
+               uint64_t pageFormat);
     RC readRawData(void *d);
     RC getRawData(void *d);
+    // magic matches, version is PFM_VERSION, and the counts fit in PageNum
+    bool isValid();
 };
 
 /****************************************************
@@ -119,19 +513,39 @@ class FileHeader
  ****************************************************/
 class FileHandle
 {
-    FILE *filePtr;
+    // shared by the copies of a handle, deleted by close()
+    FileIO *io;
+    BufferPoolManager *bpm;
+    unsigned fileId;
     FileHeader fileHeader;
     vector<DirectroyPage> dirPages;
+    // directory pages to write by next flushAll()
+    vector<bool> dirDirty;
 
-    unsigned pageCount;
+    // free space map index, built by the first findFreePage().
+    // freeLists[b] has pages whose bucket is b, or was b (removed lazily);
+    // bit b of listed[pageNum] is set if pageNum is in freeLists[b]
+    bool fsmBuilt;
+    vector<vector<PageNum>> freeLists;
+    vector<uint16_t> listed;
+
+    PageNum pageCount;
     unsigned dirCount;
+    // format of new data pages, chosen by the layer above (see PageFormat of RBFM), 0 if not chosen
+    unsigned pageFormat;
+
+    // header and directory pages changed in memory but not on disk yet
+    bool metaDirty;
+    unsigned opsSinceFlush;
+    chrono::steady_clock::time_point lastFlush;
+    unsigned flushEveryOps;
+    unsigned flushEveryMs;
 
-    RC _rawReadPage(PageNum pageNum, void *data);
+    // pageNum counts the 1st directory page as 0
     RC _rawWritePage(PageNum pageNum, const void *data);
-    RC _rawAppendPage(const void *data);
 
-    RC _rawReadByte(unsigned offset, unsigned len, void *data);
-    RC _rawWriteByte(unsigned start, unsigned end, void *data);
+    RC _rawReadByte(size_t start, size_t end, void *data);
+    RC _rawWriteByte(size_t start, size_t end, void *data);
 
     RC readDirPages();
     RC updateDirPages();
@@ -140,26 +554,74 @@ class FileHandle
     RC updateFileHeader();
 
     RC flushAll();
+    // add directory pages until they cover pageCount data pages
+    void growDirPages();
+    // bucket of a page by its data size, all its pages have at least bucket * FSM_BUCKET_SIZE free bytes
+    static unsigned freeBucket(unsigned dataSize);
+    void buildFreeLists();
+    void listFreePage(PageNum pageNum, unsigned dataSize);
+    // count a metadata change, flushAll() if the flush policy says so
+    RC markMetaDirty();
 
     size_t getFileSize();
+    size_t pageOffset(PageNum pageNum);
 
   public:
-    FileHandle(FILE *f);
+    FileHandle(FileIO *io);
+
+    // get the frame of page in buffer pool, no copy. Must unpinPage() after using
+    RC pinPage(PageNum pageNum, char *&data);
+    // dirty: the frame has been modified, counted as a write
+    RC unpinPage(PageNum pageNum, bool dirty = false);
+    // read only view of the page, in place in the mapping for IO_MMAP, else a pinned frame.
+    // Must releasePage() after using, before any other call on this handle
+    RC viewPage(PageNum pageNum, const char *&data);
+    RC releasePage(PageNum pageNum);
+    RC advise(AccessPattern pattern);
+    // whether viewPage() gives the page in place without any copy
+    bool inPlace();
+    // whether readPages() may be called by several threads at once, while the file is not changed
+    bool concurrentReads();
+    // read n continuous pages to dst by one vectored read, resident pages are taken from buffer pool.
+    // The pages are not cached in buffer pool
+    RC readPages(PageNum start, unsigned n, void *dst);
+    // read the page into buffer pool in background, -1 if the backend can't, see Prefetcher
+    RC prefetchPage(PageNum pageNum);
+    // physical reads/writes of this file in buffer pool, against the logical counters below
+    RC collectPhysicalCounterValues(unsigned &physicalReadCount, unsigned &physicalWriteCount);
+    // buffer pool id of the file, shared by all handles of it; 0 if not opened
+    unsigned getFileId();
 
     RC writePage(PageNum pageNum, const void *data, unsigned dataSize);
     RC appendPage(const void *data, unsigned dataSize);
+    // append n pages of data by one write, dataSizes[i] for the i-th; the pages are not kept in buffer pool
+    RC appendPages(const void *data, unsigned n, const unsigned *dataSizes);
     RC updateDataSize(PageNum pageNum, unsigned dataSize);
+    // append n zero pages without writing them, the file is extended sparsely
+    RC reservePages(unsigned n);
 
     RC getPageSize(PageNum pageNum, unsigned &size);
+    // kept in the file header, pages are not read nor changed
+    unsigned getPageFormat();
+    RC setPageFormat(unsigned format);
+    // a page with at least size free bytes by the free space map, without reading any page; -1 if none
+    RC findFreePage(unsigned size, PageNum &pageNum);
     RC close();
 
+    // Header and directory pages are written on close() and sync() only,
+    // plus every everyOps page writes/appends or everyMs milliseconds if not 0.
+    void setFlushPolicy(unsigned everyOps, unsigned everyMs);
+    // write back dirty frames and metadata of this file, then fsync
+    RC sync();
+
     /***********************
      * ORIGINAL Interfaces *
      ***********************/
 
-    unsigned readPageCounter;
-    unsigned writePageCounter;
-    unsigned appendPageCounter;
+    // updated with __atomic builtins only, pages of a file are read and written by several threads at once
+    uint64_t readPageCounter;
+    uint64_t writePageCounter;
+    uint64_t appendPageCounter;
 
     FileHandle();  // Default constructor
     ~FileHandle(); // Destructor
@@ -169,6 +631,7 @@ class FileHandle
     RC appendPage(const void *data);                                                                       // Append a specific page
     unsigned getNumberOfPages();                                                                           // Get the number of pages in the file
     RC collectCounterValues(unsigned &readPageCount, unsigned &writePageCount, unsigned &appendPageCount); // Put the current counter values into variables
+    RC collectCounterValues(uint64_t &readPageCount, uint64_t &writePageCount, uint64_t &appendPageCount);
 };
 
 #endif
@@ -0,0 +1,155 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <chrono>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+const unsigned BENCH_RECORDS = 100000;
+const unsigned BENCH_RUNS = 3;
+
+// narrow rows of int columns
+static void createNarrowDescriptor(unsigned columns, vector<Attribute> &recordDescriptor)
+{
+	recordDescriptor.clear();
+	for (unsigned i = 0; i < columns; i++)
+	{
+		recordDescriptor.push_back(Attribute{"c" + to_string(i), TypeInt, 4});
+	}
+}
+
+static unsigned prepareNarrowRecord(const vector<Attribute> &recordDescriptor, int value, char *record)
+{
+	unsigned offset = getActualByteForNullsIndicator(recordDescriptor.size());
+	memset(record, 0, offset);
+	for (unsigned i = 0; i < recordDescriptor.size(); i++)
+	{
+		memcpy(record + offset, &value, sizeof(int));
+		offset += sizeof(int);
+	}
+	return offset;
+}
+
+// best of BENCH_RUNS full scans of all columns, in ms
+static double benchScan(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor)
+{
+	RC rc;
+	vector<string> attributeNames;
+	for (const Attribute &attr : recordDescriptor)
+	{
+		attributeNames.push_back(attr.name);
+	}
+	char *returnedData = (char *)malloc(PAGE_SIZE);
+	RID rid;
+	double best = 0;
+	for (unsigned run = 0; run < BENCH_RUNS; run++)
+	{
+		unsigned count = 0;
+		auto start = chrono::steady_clock::now();
+		RBFM_ScanIterator rbfm_ScanIterator;
+		rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, rbfm_ScanIterator);
+		assert(rc == success && "Scanning a file should not fail.");
+		while (rbfm_ScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+		{
+			count++;
+		}
+		rbfm_ScanIterator.close();
+		double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		assert(count == BENCH_RECORDS && "Scan should return all records.");
+		if (run == 0 || ms < best)
+		{
+			best = ms;
+		}
+	}
+	free(returnedData);
+	return best;
+}
+
+// data bytes of all pages by the free space map
+static unsigned getDataSize(FileHandle &fileHandle)
+{
+	unsigned total = 0, size = 0;
+	for (PageNum pageNum = 0; pageNum < fileHandle.getNumberOfPages(); pageNum++)
+	{
+		RC rc = fileHandle.getPageSize(pageNum, size);
+		assert(rc == success && "Getting a page size should not fail.");
+		total += size;
+	}
+	return total;
+}
+
+static void printFile(const string &title, RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor)
+{
+	unsigned pages = fileHandle.getNumberOfPages();
+	cout << title << "\t" << pages << " pages, " << BENCH_RECORDS / pages << " records/page, "
+		 << getDataSize(fileHandle) << " data bytes, scan " << benchScan(rbfm, fileHandle, recordDescriptor) << " ms" << endl;
+}
+
+void benchNarrow(RecordBasedFileManager *rbfm, unsigned columns)
+{
+	RC rc;
+	string slottedName = "bench_compact_slotted", compactName = "bench_compact";
+	remove(slottedName.c_str());
+	remove(compactName.c_str());
+	rc = rbfm->createFile(slottedName);
+	assert(rc == success && "Creating the file should not fail.");
+	rc = rbfm->createFile(compactName, PAGE_COMPACT);
+	assert(rc == success && "Creating the file should not fail.");
+	FileHandle slotted, compact;
+	rc = rbfm->openFile(slottedName, slotted);
+	assert(rc == success && "Opening the file should not fail.");
+	rc = rbfm->openFile(compactName, compact);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createNarrowDescriptor(columns, recordDescriptor);
+	char *record = (char *)malloc(PAGE_SIZE);
+	RID rid;
+	for (unsigned i = 0; i < BENCH_RECORDS; i++)
+	{
+		prepareNarrowRecord(recordDescriptor, i, record);
+		rc = rbfm->insertRecord(slotted, recordDescriptor, record, rid);
+		assert(rc == success && "Inserting a record should not fail.");
+		rc = rbfm->insertRecord(compact, recordDescriptor, record, rid);
+		assert(rc == success && "Inserting a record should not fail.");
+	}
+
+	cout << endl << "***** RBF Benchmark Compact: " << columns << " int columns, " << BENCH_RECORDS << " records *****" << endl;
+	printFile("slotted ", rbfm, slotted, recordDescriptor);
+	printFile("compact ", rbfm, compact, recordDescriptor);
+
+	// pages are rewritten in place, the file keeps its pages
+	unsigned unconverted = 0;
+	auto start = chrono::steady_clock::now();
+	rc = rbfm->migrateFile(slotted, recordDescriptor, unconverted);
+	double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	assert(rc == success && unconverted == 0 && "Migrating the file should not fail.");
+	printFile("migrated", rbfm, slotted, recordDescriptor);
+	cout << "migrate \t" << ms << " ms" << endl;
+
+	rc = rbfm->closeFile(slotted);
+	assert(rc == success && "Closing the file should not fail.");
+	rc = rbfm->closeFile(compact);
+	assert(rc == success && "Closing the file should not fail.");
+	rc = rbfm->destroyFile(slottedName);
+	assert(rc == success && "Destroying the file should not fail.");
+	rc = rbfm->destroyFile(compactName);
+	assert(rc == success && "Destroying the file should not fail.");
+	free(record);
+}
+
+int main()
+{
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+	benchNarrow(rbfm, 3);
+	benchNarrow(rbfm, 4);
+	return 0;
+}
@@ -0,0 +1,128 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <chrono>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+const unsigned BENCH_RECORDS = 20000;
+const unsigned BULK_RECORDS = 100000;
+
+// insert BENCH_RECORDS records with the given metadata flush policy, return us/record
+double benchInsert(RecordBasedFileManager *rbfm, const string &fileName, unsigned everyOps, unsigned everyMs)
+{
+	RC rc;
+	remove(fileName.c_str());
+	rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	PagedFileManager::instance()->setFlushPolicy(everyOps, everyMs);
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+	int nullFieldsIndicatorActualSize = getActualByteForNullsIndicator(recordDescriptor.size());
+	unsigned char *nullsIndicator = (unsigned char *)malloc(nullFieldsIndicatorActualSize);
+	memset(nullsIndicator, 0, nullFieldsIndicatorActualSize);
+	void *record = malloc(100);
+	int recordSize = 0;
+	RID rid;
+
+	auto start = chrono::steady_clock::now();
+	for (unsigned i = 0; i < BENCH_RECORDS; i++)
+	{
+		prepareRecord(recordDescriptor.size(), nullsIndicator, 8, "Anteater", i % 100, 177.8, i, record, &recordSize);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+		assert(rc == success && "Inserting a record should not fail.");
+	}
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+	double us = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+	free(nullsIndicator);
+	free(record);
+	return us / BENCH_RECORDS;
+}
+
+// insert BULK_RECORDS records one by one, or by insertRecords() batch records a call; return ms
+double benchBulk(RecordBasedFileManager *rbfm, const string &fileName, unsigned batch)
+{
+	RC rc;
+	remove(fileName.c_str());
+	rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+	unsigned char nullsIndicator[1] = {0};
+	const unsigned recordMax = 100;
+	char *records = (char *)malloc((size_t)BULK_RECORDS * recordMax);
+	int recordSize = 0;
+	for (unsigned i = 0; i < BULK_RECORDS; i++)
+	{
+		prepareRecord(recordDescriptor.size(), nullsIndicator, 8, "Anteater", i % 100, 177.8, i, records + (size_t)i * recordMax, &recordSize);
+	}
+	RID rid;
+	vector<RID> rids;
+	vector<const void *> pointers;
+
+	auto start = chrono::steady_clock::now();
+	for (unsigned i = 0; i < BULK_RECORDS; i += max(batch, 1u))
+	{
+		if (batch == 0)
+		{
+			rc = rbfm->insertRecord(fileHandle, recordDescriptor, records + (size_t)i * recordMax, rid);
+			assert(rc == success && "Inserting a record should not fail.");
+			continue;
+		}
+		pointers.clear();
+		for (unsigned j = i; j < min(i + batch, BULK_RECORDS); j++)
+		{
+			pointers.push_back(records + (size_t)j * recordMax);
+		}
+		rc = rbfm->insertRecords(fileHandle, recordDescriptor, pointers, rids);
+		assert(rc == success && "Inserting records should not fail.");
+	}
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+	double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+	free(records);
+	return ms;
+}
+
+int main()
+{
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+	string fileName = "bench_insert";
+
+	cout << endl << "***** RBF Benchmark Insert: " << BENCH_RECORDS << " records *****" << endl;
+	cout << "flush metadata every op    " << benchInsert(rbfm, fileName, 1, 0) << " us/record" << endl;
+	cout << "flush metadata every 64 ops " << benchInsert(rbfm, fileName, 64, 0) << " us/record" << endl;
+	cout << "flush metadata every 10 ms " << benchInsert(rbfm, fileName, 0, 10) << " us/record" << endl;
+	cout << "flush metadata on close    " << benchInsert(rbfm, fileName, 0, 0) << " us/record" << endl;
+
+	PagedFileManager::instance()->setFlushPolicy(0, 0);
+	cout << endl << "***** RBF Benchmark Bulk Insert: " << BULK_RECORDS << " records *****" << endl;
+	cout << "insertRecord one by one    " << benchBulk(rbfm, fileName, 0) << " ms" << endl;
+	cout << "insertRecords x1000        " << benchBulk(rbfm, fileName, 1000) << " ms" << endl;
+	cout << "insertRecords all at once  " << benchBulk(rbfm, fileName, BULK_RECORDS) << " ms" << endl;
+	return 0;
+}
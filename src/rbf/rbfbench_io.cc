@@ -0,0 +1,165 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <chrono>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// 4 * BUFFER_POOL_FRAMES, so FileHandle reads miss the pool most of the time
+const unsigned BENCH_PAGES = 4 * BUFFER_POOL_FRAMES;
+const unsigned BENCH_ROUNDS = 8;
+
+static double elapsedUs(chrono::steady_clock::time_point start)
+{
+	return chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+}
+
+// same layout as FileHandle: [header][1st directory page][data pages]
+static size_t dataOffset(unsigned pageNum)
+{
+	return FILEHEADER_SIZE + (size_t)(pageNum + 1) * PAGE_SIZE;
+}
+
+static const char *backendName(IOBackend backend)
+{
+	return backend == IO_STDIO ? "stdio" : "posix";
+}
+
+// raw FileIO calls, no buffer pool
+void benchRawIO(const string &fileName, IOBackend backend)
+{
+	RC rc;
+	FileIO *io = FileIO::open(fileName, backend);
+	assert(io != NULL && "Opening the file should not fail.");
+
+	char *data = (char *)malloc(PAGE_SIZE);
+	unsigned pages = BENCH_PAGES;
+	unsigned total = pages * BENCH_ROUNDS;
+
+	auto start = chrono::steady_clock::now();
+	for (unsigned r = 0; r < BENCH_ROUNDS; r++)
+	{
+		for (unsigned i = 0; i < pages; i++)
+		{
+			rc = io->read(dataOffset(i), PAGE_SIZE, data);
+			assert(rc == success && "Reading should not fail.");
+		}
+	}
+	double seqRead = elapsedUs(start);
+
+	srand(42);
+	start = chrono::steady_clock::now();
+	for (unsigned i = 0; i < total; i++)
+	{
+		rc = io->read(dataOffset(rand() % pages), PAGE_SIZE, data);
+		assert(rc == success && "Reading should not fail.");
+	}
+	double randRead = elapsedUs(start);
+
+	srand(42);
+	start = chrono::steady_clock::now();
+	for (unsigned i = 0; i < total; i++)
+	{
+		// keep the content, FileHandle reads it later
+		unsigned pageNum = rand() % pages;
+		memset(data, pageNum % 96 + 30, PAGE_SIZE);
+		rc = io->write(dataOffset(pageNum), PAGE_SIZE, data);
+		assert(rc == success && "Writing should not fail.");
+	}
+	double randWrite = elapsedUs(start);
+
+	// header sized accesses, like FileHandle does for its metadata
+	start = chrono::steady_clock::now();
+	for (unsigned i = 0; i < total; i++)
+	{
+		rc = io->read(0, FILEHEADER_SIZE, data);
+		assert(rc == success && "Reading should not fail.");
+		io->size();
+	}
+	double header = elapsedUs(start);
+
+	io->close();
+	delete io;
+	free(data);
+
+	cout << backendName(backend) << "\traw seq read   " << seqRead / total << " us/page" << endl;
+	cout << backendName(backend) << "\traw rand read  " << randRead / total << " us/page" << endl;
+	cout << backendName(backend) << "\traw rand write " << randWrite / total << " us/page" << endl;
+	cout << backendName(backend) << "\theader + size  " << header / total << " us/call" << endl;
+}
+
+// FileHandle::readPage through the buffer pool
+void benchFileHandle(PagedFileManager *pfm, const string &fileName, IOBackend backend)
+{
+	RC rc;
+	FileHandle fileHandle;
+	rc = pfm->openFile(fileName, fileHandle, backend);
+	assert(rc == success && "Opening the file should not fail.");
+
+	char *data = (char *)malloc(PAGE_SIZE);
+	unsigned pages = fileHandle.getNumberOfPages();
+	unsigned total = pages * BENCH_ROUNDS;
+	unsigned physicalRead0 = 0, physicalRead1 = 0, physicalWrite = 0;
+	fileHandle.collectPhysicalCounterValues(physicalRead0, physicalWrite);
+
+	srand(7);
+	auto start = chrono::steady_clock::now();
+	for (unsigned i = 0; i < total; i++)
+	{
+		rc = fileHandle.readPage(rand() % pages, data);
+		assert(rc == success && "Reading a page should not fail.");
+	}
+	double randRead = elapsedUs(start);
+	fileHandle.collectPhysicalCounterValues(physicalRead1, physicalWrite);
+
+	rc = pfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+	free(data);
+
+	cout << backendName(backend) << "\tFileHandle rand read " << randRead / total << " us/page ("
+		 << physicalRead1 - physicalRead0 << " of " << total << " from disk)" << endl;
+}
+
+int main()
+{
+	RC rc;
+	PagedFileManager *pfm = PagedFileManager::instance();
+	string fileName = "bench_io";
+
+	remove(fileName.c_str());
+	rc = pfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	rc = pfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+	char *data = (char *)malloc(PAGE_SIZE);
+	for (unsigned i = 0; i < BENCH_PAGES; i++)
+	{
+		memset(data, i % 96 + 30, PAGE_SIZE);
+		rc = fileHandle.appendPage(data);
+		assert(rc == success && "Appending a page should not fail.");
+	}
+	rc = pfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+	free(data);
+
+	cout << endl << "***** RBF Benchmark FileIO: " << BENCH_PAGES << " pages x " << BENCH_ROUNDS << " rounds *****" << endl;
+	IOBackend backends[] = {IO_STDIO, IO_POSIX};
+	for (IOBackend backend : backends)
+	{
+		benchRawIO(fileName, backend);
+		benchFileHandle(pfm, fileName, backend);
+	}
+
+	rc = pfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+	return 0;
+}
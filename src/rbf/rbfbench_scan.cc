@@ -0,0 +1,197 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <chrono>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+const unsigned BENCH_RECORDS = 100000;
+
+static double elapsedUs(chrono::steady_clock::time_point start)
+{
+	return chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+}
+
+// drop the file from OS page cache, the buffer pool is dropped by closing all handles
+static void coldCache(const string &fileName)
+{
+	int fd = open(fileName.c_str(), O_RDONLY);
+	assert(fd >= 0 && "Opening the file should not fail.");
+	fdatasync(fd);
+	posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	close(fd);
+}
+
+static void report(const string &name, unsigned pages, double us)
+{
+	double mb = (double)pages * PAGE_SIZE / (1024 * 1024);
+	cout << name << "\t" << us / 1000 << " ms, " << mb / (us / 1000000) << " MB/s" << endl;
+}
+
+// read all pages, chunkPages at a time, 0 for FileHandle::readPage one by one
+void benchRead(PagedFileManager *pfm, const string &fileName, unsigned chunkPages)
+{
+	RC rc;
+	coldCache(fileName);
+	FileHandle fileHandle;
+	rc = pfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	unsigned pages = fileHandle.getNumberOfPages();
+	char *data = (char *)malloc((chunkPages ? chunkPages : 1) * PAGE_SIZE);
+	auto start = chrono::steady_clock::now();
+	if (chunkPages == 0)
+	{
+		for (unsigned i = 0; i < pages; i++)
+		{
+			rc = fileHandle.readPage(i, data);
+			assert(rc == success && "Reading a page should not fail.");
+		}
+	}
+	else
+	{
+		for (unsigned i = 0; i < pages; i += chunkPages)
+		{
+			rc = fileHandle.readPages(i, min(chunkPages, pages - i), data);
+			assert(rc == success && "Reading pages should not fail.");
+		}
+	}
+	double us = elapsedUs(start);
+	rc = pfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+	free(data);
+
+	if (chunkPages == 0)
+	{
+		report("readPage  x1 page  ", pages, us);
+	}
+	else
+	{
+		report("readPages x" + to_string(chunkPages) + " pages" + (chunkPages < 10 ? " " : ""), pages, us);
+	}
+}
+
+// full RBFM scan of all attributes, read-ahead by Prefetcher if window > 0, batch rows a call if batch > 0
+void benchScan(RecordBasedFileManager *rbfm, const string &fileName, IOBackend backend, unsigned window, unsigned batch = 0)
+{
+	RC rc;
+	Prefetcher::instance()->setWindow(window);
+	coldCache(fileName);
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle, backend);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+	vector<string> attributeNames;
+	for (unsigned i = 0; i < recordDescriptor.size(); i++)
+	{
+		attributeNames.push_back(recordDescriptor[i].name);
+	}
+	RID rid;
+	unsigned count = 0;
+
+	auto start = chrono::steady_clock::now();
+	RBFM_ScanIterator rbfm_ScanIterator;
+	rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, rbfm_ScanIterator);
+	assert(rc == success && "Scanning a file should not fail.");
+	void *returnedData = malloc(max(batch, 1u) * rbfm_ScanIterator.getMaxRowSize());
+	if (batch > 0)
+	{
+		RID *rids = new RID[batch];
+		unsigned rows = 0;
+		while (rbfm_ScanIterator.getNextBatch(rids, returnedData, batch, rows) != RBFM_EOF)
+		{
+			count += rows;
+		}
+		delete[] rids;
+	}
+	else
+	{
+		while (rbfm_ScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+		{
+			count++;
+		}
+	}
+	rbfm_ScanIterator.close();
+	double us = elapsedUs(start);
+	assert(count == BENCH_RECORDS && "Scan should return all records.");
+
+	unsigned pages = fileHandle.getNumberOfPages();
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+	free(returnedData);
+
+	if (backend == IO_MMAP)
+	{
+		report("RBFM scan mmap     ", pages, us);
+	}
+	else if (batch > 0)
+	{
+		report("RBFM scan batch x" + to_string(batch), pages, us);
+	}
+	else
+	{
+		report(string("RBFM scan ") + (window > 0 ? "prefetch " : "readPages"), pages, us);
+	}
+}
+
+int main()
+{
+	RC rc;
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+	PagedFileManager *pfm = PagedFileManager::instance();
+	string fileName = "bench_scan";
+
+	remove(fileName.c_str());
+	rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+	int nullFieldsIndicatorActualSize = getActualByteForNullsIndicator(recordDescriptor.size());
+	unsigned char *nullsIndicator = (unsigned char *)malloc(nullFieldsIndicatorActualSize);
+	memset(nullsIndicator, 0, nullFieldsIndicatorActualSize);
+	void *record = malloc(100);
+	int recordSize = 0;
+	RID rid;
+	for (unsigned i = 0; i < BENCH_RECORDS; i++)
+	{
+		prepareRecord(recordDescriptor.size(), nullsIndicator, 8, "Anteater", i % 100, 177.8, i, record, &recordSize);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+		assert(rc == success && "Inserting a record should not fail.");
+	}
+	unsigned pages = fileHandle.getNumberOfPages();
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+	free(nullsIndicator);
+	free(record);
+
+	cout << endl << "***** RBF Benchmark Cold Scan: " << BENCH_RECORDS << " records, " << pages << " pages *****" << endl;
+	benchRead(pfm, fileName, 0);
+	benchRead(pfm, fileName, 1);
+	benchRead(pfm, fileName, 16);
+	benchRead(pfm, fileName, SCAN_CHUNK_PAGES);
+	benchRead(pfm, fileName, 64);
+	benchScan(rbfm, fileName, IO_POSIX, 0);
+	benchScan(rbfm, fileName, IO_POSIX, PREFETCH_WINDOW);
+	benchScan(rbfm, fileName, IO_MMAP, 0);
+	benchScan(rbfm, fileName, IO_POSIX, 0, 256);
+
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+	return 0;
+}
@@ -0,0 +1,240 @@
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <chrono>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+const unsigned BENCH_RECORDS = 20000;
+const unsigned BENCH_RUNS = 3;
+
+// columns cycle through int, real, varchar(8)
+static void createWideDescriptor(unsigned columns, vector<Attribute> &recordDescriptor)
+{
+	recordDescriptor.clear();
+	for (unsigned i = 0; i < columns; i++)
+	{
+		Attribute attr;
+		attr.name = "c" + to_string(i);
+		attr.type = (AttrType)(i % 3);
+		attr.length = attr.type == TypeVarChar ? 8 : 4;
+		recordDescriptor.push_back(attr);
+	}
+}
+
+static unsigned prepareWideRecord(const vector<Attribute> &recordDescriptor, int value, char *record)
+{
+	unsigned offset = getActualByteForNullsIndicator(recordDescriptor.size());
+	memset(record, 0, offset);
+	for (unsigned i = 0; i < recordDescriptor.size(); i++)
+	{
+		switch (recordDescriptor[i].type)
+		{
+		case TypeInt:
+		{
+			memcpy(record + offset, &value, sizeof(int));
+			offset += sizeof(int);
+			break;
+		}
+		case TypeReal:
+		{
+			float f = value / 2.0;
+			memcpy(record + offset, &f, sizeof(float));
+			offset += sizeof(float);
+			break;
+		}
+		case TypeVarChar:
+		{
+			unsigned len = 8;
+			memcpy(record + offset, &len, sizeof(unsigned));
+			memcpy(record + offset + sizeof(unsigned), "Anteater", len);
+			offset += sizeof(unsigned) + len;
+			break;
+		}
+		}
+	}
+	return offset;
+}
+
+// best of BENCH_RUNS full scans, in ms
+static double benchScan(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+						const string &conditionAttribute, CompOp compOp, const void *value, const vector<string> &attributeNames, unsigned expected)
+{
+	RC rc;
+	char *returnedData = (char *)malloc(PAGE_SIZE);
+	RID rid;
+	double best = 0;
+	for (unsigned run = 0; run < BENCH_RUNS; run++)
+	{
+		unsigned count = 0;
+		auto start = chrono::steady_clock::now();
+		RBFM_ScanIterator rbfm_ScanIterator;
+		rc = rbfm->scan(fileHandle, recordDescriptor, conditionAttribute, compOp, value, attributeNames, rbfm_ScanIterator);
+		assert(rc == success && "Scanning a file should not fail.");
+		while (rbfm_ScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+		{
+			count++;
+		}
+		rbfm_ScanIterator.close();
+		double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		assert(count == expected && "Scan should return all matching records.");
+		if (run == 0 || ms < best)
+		{
+			best = ms;
+		}
+	}
+	free(returnedData);
+	return best;
+}
+
+// best of BENCH_RUNS scans of all columns for lo <= c0 < hi, in ms. Pushed down to the scan,
+// or checked on the projected records as QE Filter does
+static double benchConjunction(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+							   int lo, int hi, const vector<string> &attributeNames, bool pushDown)
+{
+	RC rc;
+	char *returnedData = (char *)malloc(PAGE_SIZE);
+	unsigned nullSize = getActualByteForNullsIndicator(recordDescriptor.size());
+	vector<vector<ScanCondition>> conditions;
+	if (pushDown)
+	{
+		conditions.resize(1);
+		conditions[0].push_back(ScanCondition{recordDescriptor[0].name, GE_OP, &lo});
+		conditions[0].push_back(ScanCondition{recordDescriptor[0].name, LT_OP, &hi});
+	}
+	RID rid;
+	double best = 0;
+	for (unsigned run = 0; run < BENCH_RUNS; run++)
+	{
+		unsigned count = 0;
+		auto start = chrono::steady_clock::now();
+		RBFM_ScanIterator rbfm_ScanIterator;
+		rc = rbfm->scan(fileHandle, recordDescriptor, conditions, attributeNames, rbfm_ScanIterator);
+		assert(rc == success && "Scanning a file should not fail.");
+		while (rbfm_ScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+		{
+			int c0 = 0;
+			memcpy(&c0, returnedData + nullSize, sizeof(int));
+			count += c0 >= lo && c0 < hi ? 1 : 0;
+		}
+		rbfm_ScanIterator.close();
+		double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		assert(count == (unsigned)(hi - lo) && "Scan should return all matching records.");
+		if (run == 0 || ms < best)
+		{
+			best = ms;
+		}
+	}
+	free(returnedData);
+	return best;
+}
+
+// best of BENCH_RUNS parallel scans of all columns by workerNum threads, in ms
+static double benchParallel(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+							const vector<string> &attributeNames, unsigned workerNum, bool ordered)
+{
+	RC rc;
+	const unsigned batch = 256;
+	RID *rids = new RID[batch];
+	vector<vector<ScanCondition>> conditions;
+	double best = 0;
+	for (unsigned run = 0; run < BENCH_RUNS; run++)
+	{
+		unsigned count = 0, rows = 0;
+		auto start = chrono::steady_clock::now();
+		RBFM_ParallelScanIterator rbfm_ScanIterator;
+		rc = rbfm->parallelScan(fileHandle, recordDescriptor, conditions, attributeNames, workerNum, ordered, rbfm_ScanIterator);
+		assert(rc == success && "Scanning a file should not fail.");
+		char *returnedData = (char *)malloc(batch * rbfm_ScanIterator.getMaxRowSize());
+		while (rbfm_ScanIterator.getNextBatch(rids, returnedData, batch, rows) != RBFM_EOF)
+		{
+			count += rows;
+		}
+		rbfm_ScanIterator.close();
+		double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		free(returnedData);
+		assert(count == BENCH_RECORDS && "Scan should return all records.");
+		if (run == 0 || ms < best)
+		{
+			best = ms;
+		}
+	}
+	delete[] rids;
+	return best;
+}
+
+void benchWide(RecordBasedFileManager *rbfm, const string &fileName, unsigned columns, PageFormat format)
+{
+	RC rc;
+	remove(fileName.c_str());
+	rc = rbfm->createFile(fileName, format);
+	assert(rc == success && "Creating the file should not fail.");
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createWideDescriptor(columns, recordDescriptor);
+	char *record = (char *)malloc(PAGE_SIZE);
+	RID rid;
+	for (unsigned i = 0; i < BENCH_RECORDS; i++)
+	{
+		prepareWideRecord(recordDescriptor, i, record);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+		assert(rc == success && "Inserting a record should not fail.");
+	}
+
+	// the last int column
+	unsigned lastInt = (columns - 1) / 3 * 3;
+	vector<string> lastColumn(1, recordDescriptor[columns - 1].name);
+	vector<string> allColumns;
+	for (unsigned i = 0; i < columns; i++)
+	{
+		allColumns.push_back(recordDescriptor[i].name);
+	}
+	int threshold = BENCH_RECORDS / 2;
+
+	cout << endl << "***** RBF Benchmark Wide Scan: " << columns << " columns, " << BENCH_RECORDS << " records, "
+		 << fileHandle.getNumberOfPages() << (format == PAGE_PAX ? " PAX" : " slotted") << " pages *****" << endl;
+	cout << "project last column          \t"
+		 << benchScan(rbfm, fileHandle, recordDescriptor, "", NO_OP, NULL, lastColumn, BENCH_RECORDS) << " ms" << endl;
+	cout << "last int >= N/2, project last\t"
+		 << benchScan(rbfm, fileHandle, recordDescriptor, recordDescriptor[lastInt].name, GE_OP, &threshold, lastColumn, BENCH_RECORDS - threshold) << " ms" << endl;
+	cout << "project all columns          \t"
+		 << benchScan(rbfm, fileHandle, recordDescriptor, "", NO_OP, NULL, allColumns, BENCH_RECORDS) << " ms" << endl;
+	cout << "1% by c0 range, filter after \t"
+		 << benchConjunction(rbfm, fileHandle, recordDescriptor, threshold, threshold + BENCH_RECORDS / 100, allColumns, false) << " ms" << endl;
+	cout << "1% by c0 range, pushed down  \t"
+		 << benchConjunction(rbfm, fileHandle, recordDescriptor, threshold, threshold + BENCH_RECORDS / 100, allColumns, true) << " ms" << endl;
+	cout << "project all, 1 worker        \t"
+		 << benchParallel(rbfm, fileHandle, recordDescriptor, allColumns, 1, true) << " ms" << endl;
+	cout << "project all, 4 workers       \t"
+		 << benchParallel(rbfm, fileHandle, recordDescriptor, allColumns, 4, true) << " ms" << endl;
+	cout << "project all, 4 workers, any  \t"
+		 << benchParallel(rbfm, fileHandle, recordDescriptor, allColumns, 4, false) << " ms" << endl;
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+	free(record);
+}
+
+int main()
+{
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+	string fileName = "bench_widescan";
+
+	benchWide(rbfm, fileName, 20, PAGE_SLOTTED_FIELDS);
+	benchWide(rbfm, fileName, 20, PAGE_PAX);
+	benchWide(rbfm, fileName, 50, PAGE_SLOTTED_FIELDS);
+	benchWide(rbfm, fileName, 50, PAGE_PAX);
+	return 0;
+}
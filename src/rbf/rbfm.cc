@@ -1,14 +1,32 @@
 #include "rbfm.h"
 
+#include <algorithm>
+
 RBFM_ScanIterator::RBFM_ScanIterator()
     : fileHandle(nullptr),
-      vcSize(0),
-      compOp(NO_OP),
-      value(nullptr),
       nextPn(0),
       nextSn(0),
-      currPg(nullptr)
+      endPn(0),
+      onPage(false),
+      chunkStart(0),
+      chunkPages(0),
+      prefetchId(-1),
+      readLatch(nullptr),
+      stats(),
+      projectsVarChar(false),
+      failed(false)
+{
+}
+
+// one group of the condition, none for NO_OP
+static vector<vector<ScanCondition>> singleCondition(const string &conditionAttribute, CompOp compOp, const char *value)
 {
+    vector<vector<ScanCondition>> conditions;
+    if (compOp != NO_OP)
+    {
+        conditions.push_back(vector<ScanCondition>(1, ScanCondition{conditionAttribute, compOp, value}));
+    }
+    return conditions;
 }
 
 RBFM_ScanIterator::RBFM_ScanIterator(
@@ -18,254 +36,683 @@ RBFM_ScanIterator::RBFM_ScanIterator(
     const CompOp compOp,
     const char *value,
     const vector<string> attributeNames)
-    : fileHandle(fileHandle),
-      recordDescriptor(recordDescriptor),
-      vcSize(0),
-      compOp(compOp),
-      value(nullptr),
-      attributeNames(attributeNames),
-      nextPn(0),
-      nextSn(0),
-      currPg(nullptr)
+    : RBFM_ScanIterator(fileHandle, recordDescriptor, singleCondition(conditionAttribute, compOp, value), attributeNames)
 {
-    if (compOp != NO_OP)
+}
+
+RBFM_ScanIterator::RBFM_ScanIterator(
+    FileHandle *fileHandle,
+    const vector<Attribute> recordDescriptor,
+    const vector<vector<ScanCondition>> &conditions,
+    const vector<string> attributeNames)
+    : RBFM_ScanIterator(fileHandle, recordDescriptor, bindConditions(recordDescriptor, conditions), attributeNames, 0, UINT_MAX, nullptr)
+{
+}
+
+RBFM_ScanIterator::RBFM_ScanIterator(
+    FileHandle *fileHandle,
+    const vector<Attribute> recordDescriptor,
+    const vector<vector<BoundPredicate>> &groups,
+    const vector<string> attributeNames,
+    PageNum firstPage,
+    PageNum endPage,
+    mutex *readLatch)
+    : RBFM_ScanIterator()
+{
+    open(fileHandle, recordDescriptor, groups, attributeNames, firstPage, endPage, readLatch);
+}
+
+void RBFM_ScanIterator::open(FileHandle *fileHandle,
+                             const vector<Attribute> &recordDescriptor,
+                             const vector<vector<BoundPredicate>> &groups,
+                             const vector<string> &attributeNames,
+                             PageNum firstPage,
+                             PageNum endPage,
+                             mutex *readLatch)
+{
+    close();
+    this->fileHandle = fileHandle;
+    this->recordDescriptor = recordDescriptor;
+    this->groups = groups;
+    this->attributeNames = attributeNames;
+    this->readLatch = readLatch;
+    stats = Stats();
+    fixedRecord = FixedRecord<true>(recordDescriptor);
+    Record::getAttributeIndexes(recordDescriptor, attributeNames, projectedAttrs);
+    projectsVarChar = false;
+    for (unsigned attr : projectedAttrs)
+    {
+        projectsVarChar = projectsVarChar || recordDescriptor[attr].type == TypeVarChar;
+    }
+    zoneMap = RecordBasedFileManager::instance()->getZoneMap(*fileHandle);
+    if (zoneMap && !zoneMap->matches(recordDescriptor))
+    {
+        zoneMap = nullptr;
+    }
+    fileHandle->advise(ACCESS_SEQUENTIAL);
+    setRange(firstPage, endPage);
+}
+
+vector<vector<RBFM_ScanIterator::BoundPredicate>> RBFM_ScanIterator::bindConditions(const vector<Attribute> &recordDescriptor, const vector<vector<ScanCondition>> &conditions)
+{
+    vector<vector<BoundPredicate>> groups;
+    for (const vector<ScanCondition> &group : conditions)
     {
-        // find attribute type
-        unsigned attr = 0;
-        for (; attr < recordDescriptor.size(); attr++)
+        vector<BoundPredicate> bound;
+        for (const ScanCondition &condition : group)
         {
-            if (recordDescriptor[attr].name == conditionAttribute)
+            if (condition.compOp == NO_OP)
             {
-                break;
+                continue;
             }
+            // find attribute type
+            unsigned attr = 0;
+            for (; attr < recordDescriptor.size(); attr++)
+            {
+                if (recordDescriptor[attr].name == condition.attribute)
+                {
+                    break;
+                }
+            }
+            if (attr == recordDescriptor.size())
+            {
+                cerr << "Condition attribute not found." << endl;
+                exit(-1);
+            }
+            BoundPredicate predicate;
+            predicate.attr = attr;
+            predicate.predicate.reset(Predicate::compile(recordDescriptor[attr].type, condition.compOp, condition.value));
+            bound.push_back(predicate);
         }
-        if ((attr == recordDescriptor.size()) ||
-            (attr == 0 && recordDescriptor[0].name != conditionAttribute))
-        {
-            cerr << "Condition attribute not found." << endl;
-            exit(-1);
-        }
-        this->conditionAttribute = recordDescriptor[attr];
-
-        // copy value
-        if (this->conditionAttribute.type != TypeVarChar)
-        {
-            this->value = new char[4];
-            memcpy(this->value, value, 4);
-        }
-        else
+        if (bound.empty())
         {
-            unsigned size = Utils::getVCSizeWithHead(value);
-            this->value = new char[size];
-            memcpy(this->value, value, size);
+            // met by any record, so are the groups
+            groups.clear();
+            break;
         }
+        groups.push_back(bound);
     }
-    getNextPage();
+    return groups;
 }
 
-RBFM_ScanIterator::~RBFM_ScanIterator()
+void RBFM_ScanIterator::setRange(PageNum firstPage, PageNum endPage)
 {
-    if (value)
-    {
-        delete[] value;
-    }
-    if (currPg)
+    close();
+    nextPn = firstPage;
+    nextSn = 0;
+    endPn = endPage;
+    onPage = false;
+    chunkPages = 0;
+    failed = false;
+    PageNum last = min(endPage, fileHandle->getNumberOfPages());
+    if (!fileHandle->inPlace() && firstPage < last)
     {
-        delete currPg;
+        prefetchId = Prefetcher::instance()->registerScan(fileHandle, firstPage, last - 1);
     }
 }
 
+RBFM_ScanIterator::~RBFM_ScanIterator()
+{
+    close();
+}
+
 RC RBFM_ScanIterator::getNextRecord(RID &rid, void *data)
 {
-    // end
-    if (!currPg)
-    {
-        return RBFM_EOF;
-    }
+    unsigned rows = 0;
+    return getNextBatch(&rid, data, 1, rows);
+}
 
-    if (nextSn >= currPg->records.size())
+RC RBFM_ScanIterator::getNextBatch(RID *rids, void *buf, unsigned maxRows, unsigned &rows, unsigned *ends)
+{
+    char *des = static_cast<char *>(buf);
+    rows = 0;
+    // the first page of the range is read by the first call
+    if (!onPage && !failed && getNextPage() != 0)
     {
-        getNextPage();
-        return getNextRecord(rid, data);
+        return fail();
     }
-
-    Record *record = currPg->records[nextSn];
-
-    if (compOp != NO_OP)
+    while (onPage && rows < maxRows)
     {
-        unsigned attrSz = record->getAttribute(recordDescriptor, conditionAttribute.name, buffer);
-        // no data return, may be null
-        if (attrSz == 0)
+        DataPage page(currentPage());
+        if (!page.isValid())
         {
-            nextSn++;
-            return getNextRecord(rid, data);
+            return fail();
         }
-
-        // compareRes = target - record value
-        // compareRes < 0 => (record value > target)
-        // compareRes > 0 => (record value < target)
-        int compareRes = compareTo(buffer);
-        switch (compOp)
-        {
-        case EQ_OP:
+        unsigned slotNum = page.getSlotNum();
+        if (page.getFormat() == PAGE_PAX)
         {
-            if (compareRes != 0)
+            // only the minipages of the conditions and projection are read, no record is assembled
+            PaxPage pax(currentPage());
+            for (; nextSn < slotNum && rows < maxRows; nextSn++)
             {
-                nextSn++;
-                // 递归写法有潜在的爆栈的可能
-                return getNextRecord(rid, data);
+                if (!match(pax, nextSn))
+                {
+                    if (failed)
+                    {
+                        return fail();
+                    }
+                    continue;
+                }
+                if (pax.getFlag(nextSn) == REC_MOVED)
+                {
+                    rids[rows] = pax.getRid(nextSn);
+                }
+                else
+                {
+                    rids[rows].pageNum = nextPn - 1;
+                    rids[rows].slotNum = nextSn;
+                }
+                unsigned size = pax.attributeProject(nextSn, projectedAttrs, des);
+                if (expandRow(des, size) != 0)
+                {
+                    return fail();
+                }
+                des += size;
+                if (ends)
+                {
+                    ends[rows] = des - static_cast<char *>(buf);
+                }
+                rows++;
             }
-            break;
         }
-        case LT_OP:
+        for (; nextSn < slotNum && rows < maxRows; nextSn++)
         {
-            if (compareRes <= 0)
+            Record record = page.getRecord(nextSn);
+            if (!match(record))
             {
-                nextSn++;
-                return getNextRecord(rid, data);
+                if (failed)
+                {
+                    return fail();
+                }
+                continue;
             }
-            break;
-        }
-        case LE_OP:
-        {
-            if (compareRes < 0)
+            if (record.ptrFlag == REC_MOVED)
             {
-                nextSn++;
-                return getNextRecord(rid, data);
+                rids[rows] = record.rid;
             }
-            break;
-        }
-        case GT_OP:
-        {
-            if (compareRes >= 0)
+            else
             {
-                nextSn++;
-                return getNextRecord(rid, data);
+                rids[rows].pageNum = nextPn - 1;
+                rids[rows].slotNum = nextSn;
             }
-            break;
-        }
-        case GE_OP:
-        {
-            if (compareRes > 0)
+            unsigned size = record.encoded && fixedRecord.applies(record.data)
+                                ? fixedRecord.project(record.data, projectedAttrs, des)
+                                : record.attributeProject(recordDescriptor, projectedAttrs, des);
+            if (expandRow(des, size) != 0)
             {
-                nextSn++;
-                return getNextRecord(rid, data);
+                return fail();
             }
-            break;
+            des += size;
+            if (ends)
+            {
+                ends[rows] = des - static_cast<char *>(buf);
+            }
+            rows++;
         }
-        case NE_OP:
+        if (nextSn >= slotNum && getNextPage() != 0)
+        {
+            return fail();
+        }
+    }
+    return rows > 0 ? 0 : RBFM_EOF;
+}
+
+unsigned RBFM_ScanIterator::getMaxRowSize()
+{
+    unsigned size = (recordDescriptor.size() - 1) / 8 + 1;
+    for (unsigned attr : projectedAttrs)
+    {
+        size += recordDescriptor[attr].type == TypeVarChar ? sizeof(unsigned) + recordDescriptor[attr].length : 4;
+    }
+    // larger than a page if VarChars are kept in overflow pages
+    return size;
+}
+
+template <typename View>
+bool RBFM_ScanIterator::meetGroups(View view)
+{
+    if (groups.empty())
+    {
+        return true;
+    }
+    for (const vector<BoundPredicate> &group : groups)
+    {
+        bool met = true;
+        for (const BoundPredicate &predicate : group)
         {
-            if (compareRes == 0)
+            const char *attr = view(predicate.attr);
+            // null meets no condition
+            if (!attr || !predicate.predicate->eval(attr))
             {
-                nextSn++;
-                return getNextRecord(rid, data);
+                met = false;
+                break;
             }
-            break;
         }
+        if (met)
+        {
+            return true;
         }
     }
+    return false;
+}
 
-    Utils::assertExit("next record should not be nullptr", !record);
-    Utils::assertExit("can't scan delete/updated record", record->ptrFlag != 0);
+bool RBFM_ScanIterator::match(Record &record)
+{
+    // forwarding pointers are skipped, their records are met where they are moved to
+    if (record.ptrFlag == REC_DELETED || record.ptrFlag == REC_FORWARD)
+    {
+        return false;
+    }
+    if (record.encoded && fixedRecord.applies(record.data))
+    {
+        return meetGroups([&](unsigned attr) { return fixedRecord.view(record.data, attr); });
+    }
+    return meetGroups([&](unsigned attr) { return loadValue(record.viewAttribute(recordDescriptor, attr), attr); });
+}
 
-    // cerr << "next Record: " <<  record->toString(recordDescriptor) << endl;
-    record->attributeProject(recordDescriptor, attributeNames, static_cast<char *>(data));
-    // memcpy(data, record->data, record->sizeWithoutHeader(recordDescriptor));
-    
-    rid.pageNum = nextPn - 1;
-    rid.slotNum = nextSn;
+bool RBFM_ScanIterator::match(PaxPage &page, unsigned row)
+{
+    int ptrFlag = page.getFlag(row);
+    if (ptrFlag == REC_DELETED || ptrFlag == REC_FORWARD)
+    {
+        return false;
+    }
+    return meetGroups([&](unsigned attr) { return loadValue(page.viewAttribute(row, attr), attr); });
+}
 
-    nextSn++;
+const char *RBFM_ScanIterator::loadValue(const char *value, unsigned attr)
+{
+    if (!value || recordDescriptor[attr].type != TypeVarChar || !OverflowPage::isStub(value))
+    {
+        return value;
+    }
+    unsigned size = 0;
+    memcpy(&size, value, sizeof(unsigned));
+    overflowValue.resize(sizeof(unsigned) + (size & ~VC_OVERFLOW_FLAG));
+    unique_lock<mutex> lock;
+    if (readLatch)
+    {
+        lock = unique_lock<mutex>(*readLatch);
+    }
+    if (OverflowPage::readValue(*fileHandle, value, overflowValue.data()) != 0)
+    {
+        cerr << "read overflow value failed" << endl;
+        failed = true;
+        return nullptr;
+    }
+    return overflowValue.data();
+}
 
+RC RBFM_ScanIterator::expandRow(char *row, unsigned &size)
+{
+    if (!projectsVarChar || !OverflowPage::hasStub(recordDescriptor, row))
+    {
+        return 0;
+    }
+    unique_lock<mutex> lock;
+    if (readLatch)
+    {
+        lock = unique_lock<mutex>(*readLatch);
+    }
+    if (OverflowPage::expand(*fileHandle, recordDescriptor, row, size) != 0)
+    {
+        cerr << "expand overflow value failed" << endl;
+        return -1;
+    }
     return 0;
 }
 
-void RBFM_ScanIterator::getNextPage()
+RC RBFM_ScanIterator::fail()
+{
+    failed = true;
+    onPage = false;
+    close();
+    return RBFM_SCAN_ERROR;
+}
+
+bool RBFM_ScanIterator::skipPage(PageNum pageNum)
 {
-    // end of paged file
-    if (fileHandle->getNumberOfPages() <= nextPn)
+    return zoneMap && zoneMap->excludes(pageNum, groups);
+}
+
+RC RBFM_ScanIterator::getNextPage()
+{
+    // end of paged file or range
+    PageNum last = min(endPn, fileHandle->getNumberOfPages());
+    // pages of a chunk are checked when it's read
+    bool inChunk = !fileHandle->inPlace() && nextPn >= chunkStart && nextPn < chunkStart + chunkPages;
+    for (; !inChunk && nextPn < last && skipPage(nextPn); nextPn++)
+    {
+        stats.pagesSkipped++;
+    }
+    if (last <= nextPn)
+    {
+        onPage = false;
+        return 0;
+    }
+    unique_lock<mutex> lock;
+    if (readLatch)
     {
-        if (currPg)
+        lock = unique_lock<mutex>(*readLatch);
+    }
+    if (fileHandle->inPlace())
+    {
+        // records are used in place, but the mapping may move if the file grows while scanning
+        const char *page = nullptr;
+        if (fileHandle->viewPage(nextPn, page) != 0)
         {
-            delete currPg;
+            cerr << "view page failed" << endl;
+            return -1;
         }
-        currPg = nullptr;
-        return;
+        chunkStart = nextPn;
+        chunkPages = 1;
+        chunk.resize(PAGE_SIZE);
+        memcpy(chunk.data(), page, PAGE_SIZE);
+        fileHandle->releasePage(nextPn);
     }
-    fileHandle->readPage(nextPn, buffer);
-    if (currPg)
+    else if (!inChunk)
     {
-        delete currPg;
+        // a chunk ends before a page to skip
+        chunkStart = nextPn;
+        chunkPages = 1;
+        while (chunkPages < min((unsigned)SCAN_CHUNK_PAGES, last - nextPn) && !skipPage(nextPn + chunkPages))
+        {
+            chunkPages++;
+        }
+        chunk.resize(SCAN_CHUNK_PAGES * PAGE_SIZE);
+        // keep the pages after this chunk coming while it's being read and used
+        if (prefetchId >= 0)
+        {
+            Prefetcher::instance()->advance(prefetchId, chunkStart + chunkPages - 1);
+        }
+        if (fileHandle->readPages(chunkStart, chunkPages, chunk.data()) != 0)
+        {
+            cerr << "read pages failed" << endl;
+            return -1;
+        }
     }
-    currPg = new DataPage(recordDescriptor, buffer);
+    stats.pagesScanned++;
+    onPage = true;
     nextPn++;
     nextSn = 0;
+    return 0;
+}
+
+const char *RBFM_ScanIterator::currentPage()
+{
+    return chunk.data() + (size_t)(nextPn - 1 - chunkStart) * PAGE_SIZE;
 }
 
-int RBFM_ScanIterator::compareTo(char *thatVal)
+RC RBFM_ScanIterator::close()
 {
-    switch (conditionAttribute.type)
+    if (prefetchId >= 0)
     {
-    case TypeInt:
+        Prefetcher::instance()->unregisterScan(prefetchId);
+        prefetchId = -1;
+    }
+    return 0;
+}
+
+RBFM_ScanIterator::Stats RBFM_ScanIterator::getStats()
+{
+    return stats;
+}
+
+RBFM_ParallelScanIterator::RBFM_ParallelScanIterator()
+    : fileHandle(nullptr),
+      ordered(false),
+      maxRowSize(0),
+      maxPending(0),
+      morselNum(0),
+      nextMorsel(0),
+      takenNum(0),
+      closing(false),
+      stats(),
+      nextRow(0)
+{
+}
+
+RBFM_ParallelScanIterator::~RBFM_ParallelScanIterator()
+{
+    close();
+}
+
+RC RBFM_ParallelScanIterator::open(FileHandle *fileHandle,
+                                   const vector<Attribute> &recordDescriptor,
+                                   const vector<vector<ScanCondition>> &conditions,
+                                   const vector<string> &attributeNames,
+                                   unsigned workerNum,
+                                   bool ordered)
+{
+    if (!workers.empty() || workerNum == 0)
     {
-        int int_this = 0, int_that = 0;
-        memcpy(&int_this, value, sizeof(int));
-        memcpy(&int_that, thatVal, sizeof(int));
-        // cerr << "comparing " << int_this << " ? " << int_that << endl;
-        return int_this - int_that;
+        return -1;
     }
-    case TypeReal:
+    this->fileHandle = fileHandle;
+    this->recordDescriptor = recordDescriptor;
+    this->attributeNames = attributeNames;
+    this->ordered = ordered;
+    groups = RBFM_ScanIterator::bindConditions(recordDescriptor, conditions);
+    vector<unsigned> projectedAttrs;
+    Record::getAttributeIndexes(recordDescriptor, attributeNames, projectedAttrs);
+    maxRowSize = (recordDescriptor.size() - 1) / 8 + 1;
+    for (unsigned attr : projectedAttrs)
     {
-        float f_this = 0, f_that = 0;
-        memcpy(&f_this, value, sizeof(float));
-        memcpy(&f_that, thatVal, sizeof(float));
-        // cerr << "comparing " << f_this << " ? " << f_that << endl;
-        if (f_this - f_that < 0.001 && f_that - f_this < 0.001)
-        {
-            return 0;
-        }
-        return ((f_this - f_that) < 0.0 ? -1 : 1);
+        maxRowSize += recordDescriptor[attr].type == TypeVarChar ? sizeof(unsigned) + recordDescriptor[attr].length : 4;
     }
-    case TypeVarChar:
+
+    maxPending = 2 * workerNum;
+    morselNum = (fileHandle->getNumberOfPages() + MORSEL_PAGES - 1) / MORSEL_PAGES;
+    nextMorsel = 0;
+    takenNum = 0;
+    closing = false;
+    stats = RBFM_ScanIterator::Stats();
+    results.clear();
+    current = Morsel();
+    nextRow = 0;
+    for (unsigned i = 0; i < workerNum; i++)
     {
-        unsigned size = Utils::getVCSizeWithHead(value);
-        unsigned thatSize = Utils::getVCSizeWithHead(thatVal);
+        workers.push_back(thread(&RBFM_ParallelScanIterator::work, this));
+    }
+    return 0;
+}
 
-        // empty string
-        if (size == sizeof(unsigned))
+void RBFM_ParallelScanIterator::work()
+{
+    const unsigned batch = 64;
+    // the iterator advises fileHandle
+    unique_lock<mutex> lock(latch);
+    RBFM_ScanIterator it(fileHandle, recordDescriptor, groups, attributeNames, 0, 0,
+                         fileHandle->concurrentReads() ? nullptr : &readLatch);
+    while (!closing && nextMorsel < morselNum)
+    {
+        unsigned m = nextMorsel++;
+        lock.unlock();
+
+        Morsel morsel;
+        morsel.failed = false;
+        unsigned rows = 0;
+        it.setRange(m * MORSEL_PAGES, (m + 1) * MORSEL_PAGES);
+        do
         {
-            return thatSize == sizeof(unsigned) ? 0 : -1;
-        }
-        if (thatSize == sizeof(unsigned))
+            size_t used = morsel.rows.size();
+            size_t n = morsel.rids.size();
+            morsel.rows.resize(used + batch * maxRowSize);
+            morsel.rids.resize(n + batch);
+            morsel.ends.resize(n + batch);
+            RC rc = it.getNextBatch(&morsel.rids[n], &morsel.rows[used], batch, rows, &morsel.ends[n]);
+            if (rc != 0)
+            {
+                morsel.failed = rc == RBFM_SCAN_ERROR;
+                rows = 0;
+            }
+            for (unsigned i = 0; i < rows; i++)
+            {
+                morsel.ends[n + i] += used;
+            }
+            morsel.rids.resize(n + rows);
+            morsel.ends.resize(n + rows);
+            morsel.rows.resize(rows > 0 ? morsel.ends.back() : used);
+        } while (rows > 0);
+        it.close();
+
+        lock.lock();
+        // morsels before m are done or being done, so m is queued once they are taken
+        taken.wait(lock, [this, m]() { return closing || m < takenNum + maxPending; });
+        results[m] = move(morsel);
+        queued.notify_all();
+    }
+    stats.pagesScanned += it.stats.pagesScanned;
+    stats.pagesSkipped += it.stats.pagesSkipped;
+}
+
+bool RBFM_ParallelScanIterator::takeMorsel()
+{
+    unique_lock<mutex> lock(latch);
+    if (takenNum >= morselNum)
+    {
+        return false;
+    }
+    // in order, taken morsels are exactly those before takenNum
+    queued.wait(lock, [this]() { return ordered ? results.count(takenNum) > 0 : !results.empty(); });
+    map<unsigned, Morsel>::iterator next = ordered ? results.find(takenNum) : results.begin();
+    current = move(next->second);
+    results.erase(next);
+    nextRow = 0;
+    takenNum++;
+    taken.notify_all();
+    return true;
+}
+
+RC RBFM_ParallelScanIterator::getNextRecord(RID &rid, void *data)
+{
+    unsigned rows = 0;
+    return getNextBatch(&rid, data, 1, rows);
+}
+
+RC RBFM_ParallelScanIterator::getNextBatch(RID *rids, void *buf, unsigned maxRows, unsigned &rows)
+{
+    char *des = static_cast<char *>(buf);
+    rows = 0;
+    while (rows < maxRows)
+    {
+        if (nextRow >= current.rids.size())
         {
-            return 1;
+            // don't wait for more if some rows are there
+            if (rows > 0)
+            {
+                break;
+            }
+            // rows of the morsel before the failure are returned first
+            if (current.failed)
+            {
+                close();
+                return RBFM_SCAN_ERROR;
+            }
+            if (!takeMorsel())
+            {
+                break;
+            }
+            continue;
         }
+        unsigned start = nextRow == 0 ? 0 : current.ends[nextRow - 1];
+        unsigned n = min(maxRows - rows, (unsigned)current.rids.size() - nextRow);
+        unsigned end = current.ends[nextRow + n - 1];
+        memcpy(des, current.rows.data() + start, end - start);
+        copy(current.rids.begin() + nextRow, current.rids.begin() + nextRow + n, rids + rows);
+        des += end - start;
+        nextRow += n;
+        rows += n;
+    }
+    return rows > 0 ? 0 : RBFM_EOF;
+}
 
-        // + '\0'
-        char _c[size - sizeof(unsigned) + 1];
-        memcpy(_c, value + sizeof(unsigned), size - sizeof(unsigned));
-        _c[size - sizeof(unsigned)] = '\0';
-        string _s(_c);
-
-        char _c_that[thatSize - sizeof(unsigned) + 1];
-        memcpy(_c_that, thatVal + sizeof(unsigned), thatSize - sizeof(unsigned));
-        _c_that[thatSize - sizeof(unsigned)] = '\0';
-        string _s_that(_c_that);
+unsigned RBFM_ParallelScanIterator::getMaxRowSize()
+{
+    return maxRowSize;
+}
 
-        // cerr << "comparing \"" << _s << "\" ? \"" << _s_that << "\"" << endl;
-        return _s.compare(_s_that);
+RC RBFM_ParallelScanIterator::close()
+{
+    {
+        lock_guard<mutex> lock(latch);
+        closing = true;
     }
+    taken.notify_all();
+    for (thread &worker : workers)
+    {
+        worker.join();
     }
+    workers.clear();
+    results.clear();
+    current = Morsel();
+    nextRow = 0;
+    takenNum = morselNum;
     return 0;
 }
 
-RC RBFM_ScanIterator::close()
+RBFM_ScanIterator::Stats RBFM_ParallelScanIterator::getStats()
 {
-    return 0;
+    lock_guard<mutex> lock(latch);
+    return stats;
+}
+
+// one class for each (type, compOp)
+template <AttrType T>
+static Predicate *compileOp(CompOp compOp, const char *value, unsigned size)
+{
+    switch (compOp)
+    {
+    case EQ_OP:
+        return new TypedPredicate<T, EQ_OP>(value, size);
+    case LT_OP:
+        return new TypedPredicate<T, LT_OP>(value, size);
+    case LE_OP:
+        return new TypedPredicate<T, LE_OP>(value, size);
+    case GT_OP:
+        return new TypedPredicate<T, GT_OP>(value, size);
+    case GE_OP:
+        return new TypedPredicate<T, GE_OP>(value, size);
+    case NE_OP:
+        return new TypedPredicate<T, NE_OP>(value, size);
+    case NO_OP:
+        return nullptr;
+    }
+    return nullptr;
+}
+
+Predicate *Predicate::compile(AttrType type, CompOp compOp, const void *value)
+{
+    const char *c_value = static_cast<const char *>(value);
+    switch (type)
+    {
+    case TypeInt:
+        return compileOp<TypeInt>(compOp, c_value, sizeof(int));
+    case TypeReal:
+        return compileOp<TypeReal>(compOp, c_value, sizeof(float));
+    case TypeVarChar:
+        return compOp == NO_OP ? nullptr : compileOp<TypeVarChar>(compOp, c_value, Utils::getVCSizeWithHead(c_value));
+    }
+    return nullptr;
+}
+
+AttrComparator Predicate::getComparator(AttrType type)
+{
+    switch (type)
+    {
+    case TypeInt:
+        return AttrCompare<TypeInt>::compare;
+    case TypeReal:
+        return AttrCompare<TypeReal>::compare;
+    case TypeVarChar:
+        return AttrCompare<TypeVarChar>::compare;
+    }
+    return nullptr;
 }
 
 const string Record::RECORD_HEAD = "Rec:";
 const unsigned Record::REC_HEADER_SIZE = sizeof(int) + sizeof(RID) + 4;
+const unsigned Record::FIELD_END_SIZE = sizeof(unsigned short);
 
 unsigned Record::getRecordSize(const vector<Attribute> &recordDescriptor, const void *rawData)
 {
@@ -273,21 +720,16 @@ unsigned Record::getRecordSize(const vector<Attribute> &recordDescriptor, const
     {
         return 0;
     }
-    unsigned offset = 0;
     unsigned attributeNum = recordDescriptor.size();
     const char *data = static_cast<const char *>(rawData);
 
-    // parse record null indicator
-    bool nullIndicators[attributeNum];
-
-    // nullIndicators size as offset
-    offset += parseNullIndicator(nullIndicators, recordDescriptor, rawData);
+    // nullIndicators size as offset, null bits are read in place
+    unsigned offset = (attributeNum - 1) / 8 + 1;
 
     // parse attributes
-    unsigned vcSize = 0;
     for (unsigned i = 0; i < attributeNum; i++)
     {
-        if (nullIndicators[i])
+        if (data[i / 8] & (0x80 >> (i % 8)))
         {
             continue;
         }
@@ -301,8 +743,7 @@ unsigned Record::getRecordSize(const vector<Attribute> &recordDescriptor, const
         }
         case TypeVarChar:
         {
-            memcpy(&vcSize, data + offset, sizeof(unsigned));
-            offset += sizeof(unsigned) + vcSize;
+            offset += Utils::getVCSizeWithHead(data + offset);
             break;
         }
         }
@@ -331,49 +772,163 @@ unsigned Record::parseNullIndicator(bool nullIndicators[], const vector<Attribut
     return (attributeNum - 1) / 8 + 1;
 }
 
-Record::Record(vector<Attribute> recordDescriptor, const char *rawData)
-    : ptrFlag(-1),
-      data(nullptr)
-{
-    // empty record
-    if (rawData == nullptr)
-    {
-        this->ptrFlag = 2;
-        this->data = nullptr;
-        return;
-    }
-
-    unsigned size = getRecordSize(recordDescriptor, rawData);
-    data = new char[size];
-    memcpy(data, rawData, size);
-}
-
-Record::~Record()
-{
-    if (data)
-    {
-        delete[] data;
-    }
-}
-
-unsigned Record::sizeWithoutHeader(const vector<Attribute> &recordDescriptor)
+unsigned Record::encode(const vector<Attribute> &recordDescriptor, const void *rawData, char *des, const char **values, unsigned limit)
 {
-    if (ptrFlag == 2)
+    const char *data = static_cast<const char *>(rawData);
+    unsigned attributeNum = recordDescriptor.size();
+    unsigned nullSize = (attributeNum - 1) / 8 + 1;
+    unsigned fieldsOffset = nullSize + attributeNum * FIELD_END_SIZE;
+    if (fieldsOffset > limit)
     {
         return 0;
     }
-    return getRecordSize(recordDescriptor, data);
-}
 
-unsigned Record::sizeWithHeader(const vector<Attribute> &recordDescriptor)
-{
-    if (ptrFlag == 2)
+    memcpy(des, data, nullSize);
+    // the ends are taken by the walk which also gives the raw size, null bits are read in place
+    unsigned offset = nullSize;
+    unsigned short fieldEnd;
+    for (unsigned i = 0; i < attributeNum; i++)
     {
-        return REC_HEADER_SIZE;
-    }
-    return sizeWithoutHeader(recordDescriptor) + REC_HEADER_SIZE;
-}
-
+        bool isNull = data[i / 8] & (0x80 >> (i % 8));
+        if (values)
+        {
+            values[i] = isNull ? nullptr : data + offset;
+        }
+        if (!isNull)
+        {
+            switch (recordDescriptor[i].type)
+            {
+            case TypeInt:
+            case TypeReal:
+            {
+                offset += 4;
+                break;
+            }
+            case TypeVarChar:
+            {
+                offset += Utils::getVCSizeWithHead(data + offset);
+                break;
+            }
+            }
+        }
+        fieldEnd = fieldsOffset + offset - nullSize;
+        memcpy(des + nullSize + i * FIELD_END_SIZE, &fieldEnd, FIELD_END_SIZE);
+    }
+    if (fieldsOffset + offset - nullSize > limit)
+    {
+        memset(des, 0, fieldsOffset);
+        return 0;
+    }
+    // fields keep their raw layout, only the ends are added
+    memcpy(des + fieldsOffset, data + nullSize, offset - nullSize);
+    return fieldsOffset + offset - nullSize;
+}
+
+unsigned Record::getEncodedSize(const vector<Attribute> &recordDescriptor, unsigned rawSize)
+{
+    return rawSize + recordDescriptor.size() * FIELD_END_SIZE;
+}
+
+void Record::getAttributeIndexes(const vector<Attribute> &recordDescriptor, const vector<string> &attributeNames, vector<unsigned> &attrs)
+{
+    attrs.clear();
+    for (unsigned i = 0; i < recordDescriptor.size(); i++)
+    {
+        if (find(attributeNames.begin(), attributeNames.end(), recordDescriptor[i].name) != attributeNames.end())
+        {
+            attrs.push_back(i);
+        }
+    }
+}
+
+Record::Record(const char *data, unsigned size, bool encoded)
+    : ptrFlag(0),
+      data(data),
+      size(size),
+      encoded(encoded)
+{
+    // empty record
+    if (data == nullptr)
+    {
+        this->ptrFlag = REC_DELETED;
+        this->size = 0;
+    }
+}
+
+unsigned Record::sizeWithoutHeader()
+{
+    return size;
+}
+
+unsigned Record::sizeWithHeader()
+{
+    return size + REC_HEADER_SIZE;
+}
+
+RID Record::getForward()
+{
+    RID moved;
+    memcpy(&moved, data, sizeof(RID));
+    return moved;
+}
+
+bool Record::isNull(unsigned attr)
+{
+    return !!((data[attr / 8] << (attr % 8)) & 0x80);
+}
+
+void Record::getField(const vector<Attribute> &recordDescriptor, unsigned attr, unsigned &cursor, unsigned &start, unsigned &end)
+{
+    if (encoded)
+    {
+        unsigned nullSize = (recordDescriptor.size() - 1) / 8 + 1;
+        unsigned short fieldEnd = 0;
+        if (attr == 0)
+        {
+            start = nullSize + recordDescriptor.size() * FIELD_END_SIZE;
+        }
+        else
+        {
+            memcpy(&fieldEnd, data + nullSize + (attr - 1) * FIELD_END_SIZE, FIELD_END_SIZE);
+            start = fieldEnd;
+        }
+        memcpy(&fieldEnd, data + nullSize + attr * FIELD_END_SIZE, FIELD_END_SIZE);
+        end = fieldEnd;
+        return;
+    }
+
+    start = cursor;
+    switch (recordDescriptor[attr].type)
+    {
+    case TypeInt:
+    case TypeReal:
+    {
+        end = start + 4;
+        break;
+    }
+    case TypeVarChar:
+    {
+        end = start + Utils::getVCSizeWithHead(data + start);
+        break;
+    }
+    }
+    cursor = end;
+}
+
+unsigned Record::getRawData(const vector<Attribute> &recordDescriptor, char *des)
+{
+    if (!encoded)
+    {
+        memcpy(des, data, size);
+        return size;
+    }
+    unsigned nullSize = (recordDescriptor.size() - 1) / 8 + 1;
+    unsigned fieldsOffset = nullSize + recordDescriptor.size() * FIELD_END_SIZE;
+    memcpy(des, data, nullSize);
+    memcpy(des + nullSize, data + fieldsOffset, size - fieldsOffset);
+    return nullSize + size - fieldsOffset;
+}
+
 string Record::toString(const vector<Attribute> &recordDescriptor)
 {
     if (!data)
@@ -382,50 +937,40 @@ string Record::toString(const vector<Attribute> &recordDescriptor)
     }
 
     string s;
-    unsigned offset = 0;
     unsigned attributeNum = recordDescriptor.size();
-    bool nullIndicators[attributeNum];
-    offset += parseNullIndicator(nullIndicators, recordDescriptor, data);
-    
+    unsigned cursor = (attributeNum - 1) / 8 + 1, start = 0, end = 0;
+
     // parse attributes
     int _int;
     float _float;
-    unsigned vcSize = 0;
-    char _vc[sizeWithoutHeader(recordDescriptor)];
 
     for (unsigned i = 0; i < attributeNum; i++)
     {
         s += recordDescriptor[i].name + ": ";
-        if (nullIndicators[i])
+        if (isNull(i))
         {
             s += "NULL\n";
             continue;
         }
+        getField(recordDescriptor, i, cursor, start, end);
         switch (recordDescriptor[i].type)
         {
         case TypeInt:
         {
             // can't modify data itself, since it's the original raw data
-            memcpy(&_int, data + offset, sizeof(int));
-            offset += sizeof(int);
+            memcpy(&_int, data + start, sizeof(int));
             s += to_string(_int);
             break;
         }
         case TypeReal:
         {
-            memcpy(&_float, data + offset, sizeof(float));
-            offset += sizeof(float);
+            memcpy(&_float, data + start, sizeof(float));
             s += to_string(_float);
             break;
         }
         case TypeVarChar:
         {
-            memcpy(&vcSize, data + offset, sizeof(unsigned));
-            offset += sizeof(unsigned);
-            memcpy(_vc, data + offset, vcSize);
-            offset += vcSize;
-            _vc[vcSize] = '\0';
-            s += string(_vc);
+            s += string(data + start + sizeof(unsigned), end - start - sizeof(unsigned));
             break;
         }
         }
@@ -436,14 +981,8 @@ string Record::toString(const vector<Attribute> &recordDescriptor)
 
 unsigned Record::getAttribute(const vector<Attribute> &recordDescriptor, const string &attributeName, char *des)
 {
-    unsigned offset = 0;
-    unsigned vcSize = 0;
-    unsigned attributeNum = recordDescriptor.size();
-    bool nullIndicators[attributeNum];
-    offset += parseNullIndicator(nullIndicators, recordDescriptor, data);
-
     unsigned attr = 0;
-    for (; attr < attributeNum; attr++)
+    for (; attr < recordDescriptor.size(); attr++)
     {
         if (recordDescriptor[attr].name == attributeName)
         {
@@ -451,462 +990,1911 @@ unsigned Record::getAttribute(const vector<Attribute> &recordDescriptor, const s
         }
     }
 
-    if ((attr == attributeNum) ||
-        (attr == 0 && recordDescriptor[attr].name != attributeName))
+    if (attr == recordDescriptor.size())
     {
         cerr << "can't found the attributeName" << endl;
         exit(-1);
     }
+    return getAttribute(recordDescriptor, attr, des);
+}
 
-    if (nullIndicators[attr])
+unsigned Record::getAttribute(const vector<Attribute> &recordDescriptor, unsigned attr, char *des)
+{
+    const char *attribute = viewAttribute(recordDescriptor, attr);
+    if (!attribute)
     {
         return 0;
     }
+    // VarChar: copy both size and data
+    unsigned size = recordDescriptor[attr].type == TypeVarChar ? Utils::getVCSizeWithHead(attribute) : 4;
+    memcpy(des, attribute, size);
+    return size;
+}
 
-    // pass all useless datas
-    for (unsigned i = 0; i < attr; i++)
+const char *Record::viewAttribute(const vector<Attribute> &recordDescriptor, unsigned attr)
+{
+    if (isNull(attr))
     {
-        if (nullIndicators[i])
-        {
-            continue;
-        }
-        switch (recordDescriptor[i].type)
-        {
-        case TypeInt:
-        case TypeReal:
-        {
-            offset += 4;
-            break;
-        }
-        case TypeVarChar:
-        {
-            memcpy(&vcSize, data + offset, sizeof(unsigned));
-            offset += sizeof(unsigned) + vcSize;
-            break;
-        }
-        }
+        return nullptr;
     }
 
-    switch (recordDescriptor[attr].type)
-    {
-    case TypeInt:
-    case TypeReal:
-    {
-        memcpy(des, data + offset, 4);
-        return 4;
-    }
-    case TypeVarChar:
+    unsigned cursor = (recordDescriptor.size() - 1) / 8 + 1, start = 0, end = 0;
+    // pass all useless datas
+    for (unsigned i = 0; !encoded && i < attr; i++)
     {
-        memcpy(&vcSize, data + offset, sizeof(unsigned));
-        // copy both size and data
-        memcpy(des, data + offset, sizeof(unsigned) + vcSize);
-        return sizeof(unsigned) + vcSize;
-    }
+        if (!isNull(i))
+        {
+            getField(recordDescriptor, i, cursor, start, end);
+        }
     }
-    return 0;
+    getField(recordDescriptor, attr, cursor, start, end);
+    return data + start;
 }
 
 unsigned Record::attributeProject(const vector<Attribute> &recordDescriptor, const vector<string> attributeNames, char *des)
 {
-    unsigned srcOffset = 0,
-             desOffset = 0,
-             vcSize = 0;
-    // get src null indicators
-    bool srcNullIndicators[recordDescriptor.size()];
-    srcOffset += parseNullIndicator(srcNullIndicators, recordDescriptor, data);
-
-    // make des null indicators
-    bool desNullIndicators[recordDescriptor.size()];
-
-    for (unsigned i = 0; i < recordDescriptor.size(); i++)
-    {
-        desNullIndicators[i] = true;
+    vector<unsigned> attrs;
+    getAttributeIndexes(recordDescriptor, attributeNames, attrs);
+    return attributeProject(recordDescriptor, attrs, des);
+}
 
-        // if original indicator is true, then still true, since there's no data
-        if (srcNullIndicators[i])
-        {
-            continue;
-        }
+unsigned Record::attributeProject(const vector<Attribute> &recordDescriptor, const vector<unsigned> &attrs, char *des)
+{
+    unsigned attributeNum = recordDescriptor.size();
+    unsigned nullSize = (attributeNum - 1) / 8 + 1;
+    unsigned cursor = nullSize, start = 0, end = 0;
+    unsigned desOffset = nullSize;
 
-        // else decide whether user need this attribute
-        for (unsigned j = 0; j < attributeNames.size(); j++)
-        {
-            if (recordDescriptor[i].name == attributeNames[j])
-            {
-                desNullIndicators[i] = false;
-                break;
-            }
-        }
-    }
-    
-    // copy null indicator data to des
-    desOffset = Utils::makeNullIndicator(desNullIndicators, recordDescriptor.size(), des);
-    
-    // test desNullIndicators
-    bool test[recordDescriptor.size()];
-    parseNullIndicator(test, recordDescriptor, des);
-    for (unsigned i = 0; i < recordDescriptor.size(); i++)
+    // attributes not projected are null, remain bits are 0
+    memset(des, 0xFF, nullSize);
+    if (attributeNum % 8)
     {
-        if (test[i] != desNullIndicators[i])
-        {
-            cerr << "desNullIndicators wrong!" << endl;
-            exit(-1);
-        }
+        des[nullSize - 1] &= (char)(0xFF << (8 - attributeNum % 8));
     }
 
-
-    Utils::assertExit("[ERR]desOffset != srcOffset", desOffset != srcOffset);
-    
-    // pick data to copy
-    for (unsigned i = 0; i < recordDescriptor.size(); i++)
+    // raw data is walked up to the last projected attribute
+    unsigned walked = 0;
+    for (unsigned attr : attrs)
     {
-        // cerr << "desOffset=" << desOffset << ", srcOffset=" << srcOffset << endl;
-        // cerr << "desNullIndicators com=" << memcmp(des, data, desOffset) << endl;
-
-        // if srcNullIndicators[i], then desNullIndicators[i]
-        if (srcNullIndicators[i])
-        {
-            continue;
-        }
-        switch (recordDescriptor[i].type)
-        {
-        case TypeInt:
-        case TypeReal:
+        for (; !encoded && walked < attr; walked++)
         {
-            // jump this attribute
-            if (desNullIndicators[i])
+            if (!isNull(walked))
             {
-                srcOffset += 4;
+                getField(recordDescriptor, walked, cursor, start, end);
             }
-            else
-            {
-                memcpy(des + desOffset, data + srcOffset, 4);
-                srcOffset += 4;
-                desOffset += 4;
-            }
-            break;
         }
-        case TypeVarChar:
+        walked = attr + 1;
+
+        // if original indicator is true, then still true, since there's no data
+        if (isNull(attr))
         {
-            vcSize = Utils::getVCSizeWithHead(data + srcOffset);
-            if (desNullIndicators[i])
-            {
-                srcOffset += vcSize;
-            }
-            else
-            {
-                // copy both size and data
-                memcpy(des + desOffset, data + srcOffset, vcSize);
-                srcOffset += vcSize;
-                desOffset += vcSize;
-            }
-            break;
-        }
+            continue;
         }
+        getField(recordDescriptor, attr, cursor, start, end);
+        des[attr / 8] &= (char)~(0x80 >> (attr % 8));
+        memcpy(des + desOffset, data + start, end - start);
+        desOffset += end - start;
     }
-    // cerr << "desOffset=" << desOffset << ", srcOffset=" << srcOffset << endl;
-    // cerr << "memcmp=" << memcmp(data, des, desOffset) << endl;
     return desOffset;
 }
 
 unsigned Record::attributeProjectCompress(const vector<Attribute> &recordDescriptor, const vector<string> attributeNames, char *des)
 {
-    unsigned srcOffset = 0,
-             desOffset = 0,
-             vcSize = 0;
-    // get src null indicators
-    bool srcNullIndicators[recordDescriptor.size()];
-    srcOffset += parseNullIndicator(srcNullIndicators, recordDescriptor, data);
-
-    // make des null indicators
-    bool desNullIndicators[recordDescriptor.size()];
+    vector<unsigned> attrs;
+    getAttributeIndexes(recordDescriptor, attributeNames, attrs);
 
-    for (unsigned i = 0; i < recordDescriptor.size(); i++)
-    {
-        desNullIndicators[i] = true;
-
-        // if original indicator is true, then still true, since there's no data
-        if (srcNullIndicators[i])
-        {
-            continue;
-        }
+    unsigned cursor = (recordDescriptor.size() - 1) / 8 + 1, start = 0, end = 0;
+    unsigned walked = 0;
 
-        // else decide whether user need this attribute
-        for (unsigned j = 0; j < attributeNames.size(); j++)
-        {
-            if (recordDescriptor[i].name == attributeNames[j])
-            {
-                desNullIndicators[i] = false;
-                break;
-            }
-        }
-    }
-    
     // copy null indicator data to des
     unsigned compressNISize = (attributeNames.size() - 1) / 8 + 1;
     memset(des, 0, compressNISize);
-    desOffset += compressNISize;
-
+    unsigned desOffset = compressNISize;
 
-    // Utils::assertExit("[ERR]desOffset != srcOffset", desOffset != srcOffset);
-    
     // pick data to copy
-    for (unsigned i = 0; i < recordDescriptor.size(); i++)
+    for (unsigned attr : attrs)
     {
-        // cerr << "desOffset=" << desOffset << ", srcOffset=" << srcOffset << endl;
-        // cerr << "desNullIndicators com=" << memcmp(des, data, desOffset) << endl;
-
-        // if srcNullIndicators[i], then desNullIndicators[i]
-        if (srcNullIndicators[i])
+        for (; !encoded && walked < attr; walked++)
         {
-            continue;
-        }
-        switch (recordDescriptor[i].type)
-        {
-        case TypeInt:
-        case TypeReal:
-        {
-            // jump this attribute
-            if (desNullIndicators[i])
-            {
-                srcOffset += 4;
-            }
-            else
+            if (!isNull(walked))
             {
-                memcpy(des + desOffset, data + srcOffset, 4);
-                srcOffset += 4;
-                desOffset += 4;
+                getField(recordDescriptor, walked, cursor, start, end);
             }
-            break;
         }
-        case TypeVarChar:
+        walked = attr + 1;
+
+        if (isNull(attr))
         {
-            vcSize = Utils::getVCSizeWithHead(data + srcOffset);
-            if (desNullIndicators[i])
-            {
-                srcOffset += vcSize;
-            }
-            else
-            {
-                // copy both size and data
-                memcpy(des + desOffset, data + srcOffset, vcSize);
-                srcOffset += vcSize;
-                desOffset += vcSize;
-            }
-            break;
-        }
+            continue;
         }
+        getField(recordDescriptor, attr, cursor, start, end);
+        memcpy(des + desOffset, data + start, end - start);
+        desOffset += end - start;
     }
-    // cerr << "desOffset=" << desOffset << ", srcOffset=" << srcOffset << endl;
-    // cerr << "memcmp=" << memcmp(data, des, desOffset) << endl;
     return desOffset;
 }
 
 
-const unsigned DataPage::DATA_PAGE_HEADER_SIZE = sizeof(unsigned) * 2;
+const unsigned DataPage::DATA_PAGE_HEADER_SIZE = sizeof(unsigned) * 5;
+const unsigned DataPage::SLOT_SIZE = sizeof(unsigned short) * 2;
+
+// ptrFlag in the length of a PAGE_COMPACT slot, lengths are less than PAGE_SIZE
+static const unsigned SLOT_FLAG_SHIFT = 14;
+static const unsigned SLOT_LENGTH_MASK = (1 << SLOT_FLAG_SHIFT) - 1;
 
-DataPage::DataPage(vector<Attribute> recordDescriptor)
-    : recordDescriptor(recordDescriptor),
-      size(DATA_PAGE_HEADER_SIZE)
+DataPage::DataPage(char *page)
+    : page(page)
 {
 }
 
-DataPage::DataPage(vector<Attribute> recordDescriptor, char *data)
-    : recordDescriptor(recordDescriptor),
-      size(0)
+DataPage::DataPage(const char *page)
+    : DataPage(const_cast<char *>(page))
 {
-    char *_data = data;
-    unsigned recordNum = 0;
-
-    // read page header, data is a copy, just modify it
-    memcpy(&size, data, sizeof(unsigned));
-    data += sizeof(unsigned);
-    memcpy(&recordNum, data, sizeof(unsigned));
-    data += sizeof(unsigned);
-
-    // read records
-    int ptrFlag;
-    RID rid;
+}
 
-    for (unsigned i = 0; i < recordNum; i++)
+bool DataPage::isValid()
+{
+    unsigned format = getHeader(0);
+    if (format != PAGE_EMPTY && format != PAGE_SLOTTED && format != PAGE_SLOTTED_FIELDS && format != PAGE_PAX && format != PAGE_COMPACT && format != PAGE_OVERFLOW)
     {
-        // jump "Rec:"
-        data += 4;
-        memcpy(&ptrFlag, data, sizeof(int));
-        data += sizeof(int);
-        if (ptrFlag == 1)
-        {
-            cerr << "can't deal with ptrFlag == 1" << endl;
-            exit(-1);
-        }
-
-        memcpy(&rid, data, sizeof(RID));
-        data += sizeof(RID);
-        Record *rec = nullptr;
+        cerr << "DataPage: unknown page format " << format << endl;
+        return false;
+    }
+    return true;
+}
 
-        if (ptrFlag == 2)
-        {
-            rec = new Record(recordDescriptor, nullptr);
-        }
-        else
-        {
-            rec = new Record(recordDescriptor, data);
-        }
+unsigned DataPage::getHeader(unsigned i)
+{
+    unsigned value = 0;
+    memcpy(&value, page + i * sizeof(unsigned), sizeof(unsigned));
+    return value;
+}
 
-        rec->ptrFlag = ptrFlag;
-        rec->rid = rid;
-        data += rec->sizeWithoutHeader(recordDescriptor);
-        records.push_back(rec);
-    }
+void DataPage::setHeader(unsigned i, unsigned value)
+{
+    memcpy(page + i * sizeof(unsigned), &value, sizeof(unsigned));
+}
 
-    if (data - _data != size)
-    {
-        cerr << "DataPage::DataPage: data - _data=" << data - _data << " != size=" << size << endl;
-        exit(-1);
-    }
+void DataPage::getSlot(unsigned slotNum, unsigned &offset, unsigned &length)
+{
+    unsigned short slot[2];
+    memcpy(slot, page + PAGE_SIZE - (slotNum + 1) * SLOT_SIZE, SLOT_SIZE);
+    offset = slot[0];
+    length = getFormat() == PAGE_COMPACT ? slot[1] & SLOT_LENGTH_MASK : slot[1];
 }
 
-DataPage::~DataPage()
+void DataPage::setSlot(unsigned slotNum, unsigned offset, unsigned length, int ptrFlag)
 {
-    for (unsigned i = 0; i < records.size(); i++)
+    if (getFormat() == PAGE_COMPACT)
     {
-        delete records[i];
+        length |= ptrFlag << SLOT_FLAG_SHIFT;
     }
+    unsigned short slot[2] = {(unsigned short)offset, (unsigned short)length};
+    memcpy(page + PAGE_SIZE - (slotNum + 1) * SLOT_SIZE, slot, SLOT_SIZE);
 }
 
-unsigned DataPage::getAvailableSize()
+int DataPage::getSlotFlag(unsigned slotNum)
 {
-    unsigned available = size;
-    for (unsigned i = 0; i < records.size(); i++)
-    {
-        if (records[i]->ptrFlag == 2)
-        {
-            available -= records[i]->sizeWithHeader(recordDescriptor);
-        }
-    }
-    return available;
+    unsigned short slot[2];
+    memcpy(slot, page + PAGE_SIZE - (slotNum + 1) * SLOT_SIZE, SLOT_SIZE);
+    return slot[1] >> SLOT_FLAG_SHIFT;
 }
 
-void DataPage::appendRecord(Record *record)
+unsigned DataPage::getHeaderSize(int ptrFlag)
 {
-    record->ptrFlag = 0;
-    record->rid.slotNum = records.size();
-    records.push_back(record);
-    size += record->sizeWithHeader(recordDescriptor);
-    if (size > PAGE_SIZE)
+    if (getFormat() != PAGE_COMPACT)
     {
-        cerr << "append Record excessed PAGE_SIZE" << endl;
-        exit(-1);
+        return Record::REC_HEADER_SIZE;
     }
+    return ptrFlag == REC_MOVED ? sizeof(RID) : 0;
 }
 
-void DataPage::insertRecord(Record *record)
+void DataPage::init()
 {
-    record->ptrFlag = 0;
-    unsigned slotNum = records.size();
+    setHeader(0, PAGE_SLOTTED_FIELDS);
+    setHeader(1, 0);
+    setHeader(2, DATA_PAGE_HEADER_SIZE);
+    setHeader(3, 0);
+    setHeader(4, PAGE_SIZE - DATA_PAGE_HEADER_SIZE);
+}
 
-    // find a deleted record and reuse its RID
-    for (unsigned i = 0; i < records.size(); i++)
+void DataPage::init(unsigned format, const vector<Attribute> &recordDescriptor)
+{
+    if (format == PAGE_PAX)
     {
-        if (records[i]->ptrFlag == 2)
-        {
-            slotNum = i;
-            break;
-        }
+        PaxPage(page).init(recordDescriptor);
+        return;
     }
-    if (slotNum == records.size())
+    init();
+    if (format == PAGE_COMPACT || format == PAGE_SLOTTED)
     {
-        return appendRecord(record);
+        setHeader(0, format);
     }
+}
 
-    // reuse its RID
-    record->rid.slotNum = slotNum;
-
-    // updata size before free it
-    size += record->sizeWithHeader(recordDescriptor) -
-            records[slotNum]->sizeWithHeader(recordDescriptor);
-
-    // free the deleted item
-    delete records[slotNum];
-    records[slotNum] = record;
+unsigned DataPage::getFormat()
+{
+    return getHeader(0);
+}
 
-    if (size > PAGE_SIZE)
-    {
-        cerr << "insert Record excessed PAGE_SIZE" << endl;
-        exit(-1);
-    }
+unsigned DataPage::getSlotNum()
+{
+    // 0 for PAGE_EMPTY as well
+    return getHeader(1);
 }
 
-void DataPage::deleteRecord(unsigned slotNum)
+Record DataPage::getRecord(unsigned slotNum)
 {
-    Record *rec = records[slotNum];
-    if (rec->ptrFlag != 0)
+    if (getFormat() == PAGE_PAX)
     {
-        cerr << "DataPage::deleteRecord can't deal with rec->ptrFlag != 0." << endl;
-        exit(-1);
+        return PaxPage(page).getRecord(slotNum);
     }
-
-    // still keep the whole header
-    size -= rec->sizeWithoutHeader(recordDescriptor);
-    cerr << "size-=" << rec->sizeWithoutHeader(recordDescriptor) << "=" << size << endl;
-    rec->ptrFlag = 2;
-    delete[] rec->data;
-    rec->data = nullptr;
+    unsigned offset = 0, length = 0;
+    if (slotNum < getSlotNum())
+    {
+        getSlot(slotNum, offset, length);
+    }
+    if (length == 0)
+    {
+        return Record(nullptr, 0);
+    }
+    const char *rec = page + offset;
+    if (getFormat() == PAGE_COMPACT)
+    {
+        int ptrFlag = getSlotFlag(slotNum);
+        unsigned headerSize = getHeaderSize(ptrFlag);
+        Record record(rec + headerSize, length - headerSize, true);
+        record.ptrFlag = ptrFlag;
+        record.rid = RID{0, 0};
+        if (ptrFlag == REC_MOVED)
+        {
+            memcpy(&record.rid, rec, sizeof(RID));
+        }
+        return record;
+    }
+    Record record(rec + Record::REC_HEADER_SIZE, length - Record::REC_HEADER_SIZE, getFormat() != PAGE_SLOTTED);
+    // jump "Rec:"
+    memcpy(&record.ptrFlag, rec + 4, sizeof(int));
+    memcpy(&record.rid, rec + 4 + sizeof(int), sizeof(RID));
+    return record;
 }
 
-void DataPage::getRawData(char *data)
+unsigned DataPage::getDataSize()
 {
-    char *_data = data;
-    unsigned recordNum = records.size();
-    memset(data, 0, PAGE_SIZE);
+    if (getHeader(0) == PAGE_EMPTY)
+    {
+        return 0;
+    }
+    if (getFormat() == PAGE_OVERFLOW)
+    {
+        return PAGE_SIZE;
+    }
+    if (getFormat() == PAGE_PAX)
+    {
+        return PaxPage(page).getDataSize();
+    }
+    return PAGE_SIZE - getHeader(4);
+}
+
+unsigned DataPage::getFreeSize()
+{
+    if (getHeader(0) == PAGE_EMPTY)
+    {
+        return PAGE_SIZE - DATA_PAGE_HEADER_SIZE;
+    }
+    if (getFormat() == PAGE_OVERFLOW || getFormat() == PAGE_PAX)
+    {
+        return PAGE_SIZE - getDataSize();
+    }
+    return getHeader(4);
+}
+
+unsigned DataPage::getBodySize(const vector<Attribute> &recordDescriptor, unsigned rawSize)
+{
+    // PAGE_EMPTY will be init() as PAGE_SLOTTED_FIELDS
+    return getFormat() == PAGE_SLOTTED ? rawSize : Record::getEncodedSize(recordDescriptor, rawSize);
+}
+
+bool DataPage::canFit(unsigned bodySize)
+{
+    unsigned need = bodySize + getHeaderSize(REC_HOME) + SLOT_SIZE;
+    unsigned free = getFreeSize();
+    // a deleted slot saves a new one
+    return need <= free || (getHeader(3) != 0 && need - SLOT_SIZE <= free);
+}
+
+RC DataPage::insertRecord(const vector<Attribute> &recordDescriptor, const char *rawData, unsigned rawSize, RID &rid)
+{
+    if (getFormat() == PAGE_PAX)
+    {
+        return PaxPage(page).insertRecord(recordDescriptor, rawData, rid);
+    }
+    rid.slotNum = getFreeSlot();
+    return writeRecord(recordDescriptor, rid.slotNum, rawData, rawSize, REC_HOME, rid);
+}
+
+unsigned DataPage::appendRecords(const vector<Attribute> &recordDescriptor, const void *const *records, unsigned recordNum,
+                                 PageNum pageNum, RID *rids, const char **values)
+{
+    unsigned i = 0;
+    if (getFormat() == PAGE_PAX)
+    {
+        PaxPage pax(page);
+        for (; i < recordNum; i++)
+        {
+            rids[i].pageNum = pageNum;
+            if (pax.insertRecord(recordDescriptor, static_cast<const char *>(records[i]), rids[i]) != 0)
+            {
+                break;
+            }
+        }
+        return i;
+    }
+    // nothing is deleted, free space is all between records and slots; the header is written back once
+    unsigned slotNum = getSlotNum(), offset = getHeader(2), freeSize = getHeader(4);
+    unsigned headerSize = getHeaderSize(REC_HOME);
+    unsigned attrNum = recordDescriptor.size();
+    int ptrFlag = REC_HOME;
+    for (; i < recordNum && offset + headerSize + (slotNum + 1) * SLOT_SIZE < PAGE_SIZE; i++)
+    {
+        // the record is measured by encoding it into the room left
+        char *rec = page + offset;
+        unsigned room = PAGE_SIZE - offset - headerSize - (slotNum + 1) * SLOT_SIZE;
+        unsigned length = Record::encode(recordDescriptor, records[i], rec + headerSize, values ? values + (size_t)i * attrNum : nullptr, room);
+        if (length == 0)
+        {
+            break;
+        }
+        length += headerSize;
+        rids[i].pageNum = pageNum;
+        rids[i].slotNum = slotNum;
+        if (headerSize > 0)
+        {
+            memcpy(rec, Record::RECORD_HEAD.c_str(), 4);
+            memcpy(rec + 4, &ptrFlag, sizeof(int));
+            memcpy(rec + 4 + sizeof(int), &rids[i], sizeof(RID));
+        }
+        setSlot(slotNum, offset, length);
+        slotNum++;
+        offset += length;
+        freeSize -= length + SLOT_SIZE;
+    }
+    setHeader(1, slotNum);
+    setHeader(2, offset);
+    setHeader(4, freeSize);
+    return i;
+}
+
+RC DataPage::insertMoved(const vector<Attribute> &recordDescriptor, const char *rawData, unsigned rawSize, const RID &home, RID &rid)
+{
+    if (getFormat() == PAGE_PAX)
+    {
+        return PaxPage(page).insertMoved(recordDescriptor, rawData, home, rid);
+    }
+    rid.slotNum = getFreeSlot();
+    return writeRecord(recordDescriptor, rid.slotNum, rawData, rawSize, REC_MOVED, home);
+}
+
+RC DataPage::updateRecord(const vector<Attribute> &recordDescriptor, unsigned slotNum, const char *rawData, unsigned rawSize)
+{
+    if (getFormat() == PAGE_PAX)
+    {
+        return PaxPage(page).updateRecord(recordDescriptor, slotNum, rawData);
+    }
+    Record record = getRecord(slotNum);
+    if (record.ptrFlag == REC_DELETED)
+    {
+        return -1;
+    }
+    // a forwarding pointer gets its record back
+    int ptrFlag = record.ptrFlag == REC_MOVED ? REC_MOVED : REC_HOME;
+    return writeRecord(recordDescriptor, slotNum, rawData, rawSize, ptrFlag, record.rid);
+}
+
+RC DataPage::forwardRecord(unsigned slotNum, const RID &target)
+{
+    if (getFormat() == PAGE_PAX)
+    {
+        return PaxPage(page).forwardRecord(slotNum, target);
+    }
+    Record record = getRecord(slotNum);
+    if (record.ptrFlag == REC_DELETED)
+    {
+        return -1;
+    }
+    return writeBody(slotNum, reinterpret_cast<const char *>(&target), sizeof(RID), REC_FORWARD, record.rid);
+}
+
+unsigned DataPage::getFreeSlot()
+{
+    // reuse the RID of a deleted slot, else a new one
+    unsigned first = getHeader(3);
+    return first > 0 ? first - 1 : getSlotNum();
+}
+
+void DataPage::takeFreeSlot(unsigned slotNum)
+{
+    unsigned next = 0, length = 0;
+    getSlot(slotNum, next, length);
+    unsigned prev = getHeader(3);
+    if (prev == slotNum + 1)
+    {
+        setHeader(3, next);
+        return;
+    }
+    // not the first, only if the slot isn't from getFreeSlot()
+    unsigned offset = 0;
+    for (; prev > 0; prev = offset)
+    {
+        getSlot(prev - 1, offset, length);
+        if (offset == slotNum + 1)
+        {
+            setSlot(prev - 1, next, 0);
+            return;
+        }
+    }
+}
+
+void DataPage::recount()
+{
+    unsigned slotNum = getSlotNum(), offset = 0, length = 0;
+    unsigned free = PAGE_SIZE - DATA_PAGE_HEADER_SIZE - slotNum * SLOT_SIZE;
+    unsigned first = 0;
+    // pushed from the last, the lowest deleted slot is taken first
+    for (unsigned i = slotNum; i > 0; i--)
+    {
+        getSlot(i - 1, offset, length);
+        if (length == 0)
+        {
+            setSlot(i - 1, first, 0);
+            first = i;
+        }
+        free -= length;
+    }
+    setHeader(3, first);
+    setHeader(4, free);
+}
+
+RC DataPage::writeRecord(const vector<Attribute> &recordDescriptor, unsigned slotNum, const char *rawData, unsigned rawSize, int ptrFlag, const RID &owner)
+{
+    if (getFormat() == PAGE_SLOTTED)
+    {
+        return writeBody(slotNum, rawData, rawSize, ptrFlag, owner);
+    }
+    char body[PAGE_SIZE];
+    unsigned bodySize = Record::encode(recordDescriptor, rawData, body);
+    return writeBody(slotNum, body, bodySize, ptrFlag, owner);
+}
+
+RC DataPage::writeBody(unsigned slotNum, const char *body, unsigned bodySize, int ptrFlag, const RID &owner)
+{
+    unsigned oldSlotNum = getSlotNum(), offset = 0, oldLength = 0;
+    if (slotNum < oldSlotNum)
+    {
+        getSlot(slotNum, offset, oldLength);
+    }
+    unsigned newSlotNum = slotNum < oldSlotNum ? oldSlotNum : slotNum + 1;
+    unsigned headerSize = getHeaderSize(ptrFlag);
+    unsigned length = bodySize + headerSize;
+
+    // the old record's space is reused
+    if (length + (newSlotNum - oldSlotNum) * SLOT_SIZE > getFreeSize() + oldLength)
+    {
+        return -1;
+    }
+    if (getFormat() == PAGE_EMPTY)
+    {
+        init();
+    }
+    if (slotNum < oldSlotNum && oldLength == 0)
+    {
+        takeFreeSlot(slotNum);
+    }
+    setHeader(4, getHeader(4) + oldLength - length - (newSlotNum - oldSlotNum) * SLOT_SIZE);
+
+    if (length <= oldLength)
+    {
+        // in place, the tail is free at once if it's the last record
+        if (offset + oldLength == getHeader(2))
+        {
+            setHeader(2, offset + length);
+        }
+    }
+    else
+    {
+        if (oldLength > 0)
+        {
+            setSlot(slotNum, 0, 0);
+            if (offset + oldLength == getHeader(2))
+            {
+                setHeader(2, offset);
+            }
+        }
+        // records and slots must not meet
+        if (getHeader(2) + length > PAGE_SIZE - newSlotNum * SLOT_SIZE)
+        {
+            compact();
+        }
+        offset = getHeader(2);
+        setHeader(2, offset + length);
+    }
+
+    char *rec = page + offset;
+    if (getFormat() != PAGE_COMPACT)
+    {
+        memcpy(rec, Record::RECORD_HEAD.c_str(), 4);
+        memcpy(rec + 4, &ptrFlag, sizeof(int));
+        memcpy(rec + 4 + sizeof(int), &owner, sizeof(RID));
+    }
+    else if (ptrFlag == REC_MOVED)
+    {
+        memcpy(rec, &owner, sizeof(RID));
+    }
+    memcpy(rec + headerSize, body, bodySize);
+
+    setSlot(slotNum, offset, length, ptrFlag);
+    setHeader(1, newSlotNum);
+    return 0;
+}
+
+RC DataPage::deleteRecord(unsigned slotNum)
+{
+    if (getFormat() == PAGE_PAX)
+    {
+        return PaxPage(page).deleteRecord(slotNum);
+    }
+    unsigned offset = 0, length = 0;
+    if (slotNum >= getSlotNum())
+    {
+        return -1;
+    }
+    getSlot(slotNum, offset, length);
+    if (length == 0)
+    {
+        return -1;
+    }
+    // first of the free slot chain
+    setSlot(slotNum, getHeader(3), 0);
+    setHeader(3, slotNum + 1);
+    setHeader(4, getHeader(4) + length);
+    // the last record's space is free at once, others' wait for compact()
+    if (offset + length == getHeader(2))
+    {
+        setHeader(2, offset);
+    }
+    return 0;
+}
+
+void DataPage::compact()
+{
+    if (getFormat() == PAGE_PAX)
+    {
+        PaxPage(page).compact();
+        return;
+    }
+    unsigned slotNum = getSlotNum(), offset = 0, length = 0;
+    // live slots by their offsets
+    vector<pair<unsigned, unsigned>> live;
+    for (unsigned i = 0; i < slotNum; i++)
+    {
+        getSlot(i, offset, length);
+        if (length > 0)
+        {
+            live.push_back(make_pair(offset, i));
+        }
+    }
+    sort(live.begin(), live.end());
+
+    unsigned freeOffset = DATA_PAGE_HEADER_SIZE;
+    for (unsigned i = 0; i < live.size(); i++)
+    {
+        getSlot(live[i].second, offset, length);
+        if (offset != freeOffset)
+        {
+            memmove(page + freeOffset, page + offset, length);
+            setSlot(live[i].second, freeOffset, length, getSlotFlag(live[i].second));
+        }
+        freeOffset += length;
+    }
+    setHeader(2, freeOffset);
+}
+
+unsigned DataPage::vacuum()
+{
+    if (getFormat() == PAGE_EMPTY || getFormat() == PAGE_OVERFLOW)
+    {
+        return 0;
+    }
+    if (getFormat() == PAGE_PAX)
+    {
+        return PaxPage(page).vacuum();
+    }
+    unsigned slotNum = getSlotNum(), offset = 0, length = 0;
+    unsigned before = PAGE_SIZE - getHeader(2) - slotNum * SLOT_SIZE;
+    unsigned live = 0;
+    for (unsigned i = 0; i < slotNum; i++)
+    {
+        getSlot(i, offset, length);
+        live += length;
+    }
+    for (; slotNum > 0; slotNum--)
+    {
+        getSlot(slotNum - 1, offset, length);
+        if (length > 0)
+        {
+            break;
+        }
+    }
+    setHeader(1, slotNum);
+    // dropped slots may be in the chain
+    recount();
+    if (getHeader(2) > DATA_PAGE_HEADER_SIZE + live)
+    {
+        compact();
+    }
+    return PAGE_SIZE - getHeader(2) - slotNum * SLOT_SIZE - before;
+}
+
+RC DataPage::convert(const vector<Attribute> &recordDescriptor)
+{
+    if (getFormat() != PAGE_SLOTTED)
+    {
+        return 0;
+    }
+    unsigned slotNum = getSlotNum(), length = 0;
+    unsigned live = 0;
+    for (unsigned i = 0; i < slotNum; i++)
+    {
+        Record record = getRecord(i);
+        if (record.data && record.ptrFlag != REC_FORWARD)
+        {
+            live++;
+        }
+    }
+    // every record grows by its field ends, forwarding pointers are kept
+    if (getDataSize() + live * recordDescriptor.size() * Record::FIELD_END_SIZE > PAGE_SIZE)
+    {
+        return -1;
+    }
+
+    char old[PAGE_SIZE];
+    memcpy(old, page, PAGE_SIZE);
+    init();
+    setHeader(1, slotNum);
+    unsigned freeOffset = DATA_PAGE_HEADER_SIZE;
+    for (unsigned i = 0; i < slotNum; i++)
+    {
+        // slots are read from the old copy, the new records may cover them
+        unsigned short slot[2];
+        memcpy(slot, old + PAGE_SIZE - (i + 1) * SLOT_SIZE, SLOT_SIZE);
+        if (slot[1] == 0)
+        {
+            setSlot(i, 0, 0);
+            continue;
+        }
+        // header with ptrFlag and RID is kept
+        int ptrFlag = REC_HOME;
+        memcpy(&ptrFlag, old + slot[0] + 4, sizeof(int));
+        memcpy(page + freeOffset, old + slot[0], Record::REC_HEADER_SIZE);
+        if (ptrFlag == REC_FORWARD)
+        {
+            length = slot[1];
+            memcpy(page + freeOffset, old + slot[0], length);
+        }
+        else
+        {
+            length = Record::REC_HEADER_SIZE +
+                     Record::encode(recordDescriptor, old + slot[0] + Record::REC_HEADER_SIZE, page + freeOffset + Record::REC_HEADER_SIZE);
+        }
+        setSlot(i, freeOffset, length);
+        freeOffset += length;
+    }
+    setHeader(2, freeOffset);
+    recount();
+    return 0;
+}
+
+void DataPage::convertCompact()
+{
+    if (getFormat() != PAGE_SLOTTED_FIELDS)
+    {
+        return;
+    }
+    char old[PAGE_SIZE];
+    memcpy(old, page, PAGE_SIZE);
+    unsigned slotNum = getSlotNum();
+    setHeader(0, PAGE_COMPACT);
+    unsigned freeOffset = DATA_PAGE_HEADER_SIZE;
+    for (unsigned i = 0; i < slotNum; i++)
+    {
+        // slots are read from the old copy
+        unsigned short slot[2];
+        memcpy(slot, old + PAGE_SIZE - (i + 1) * SLOT_SIZE, SLOT_SIZE);
+        if (slot[1] == 0)
+        {
+            setSlot(i, 0, 0);
+            continue;
+        }
+        int ptrFlag = REC_HOME;
+        memcpy(&ptrFlag, old + slot[0] + 4, sizeof(int));
+        unsigned headerSize = getHeaderSize(ptrFlag);
+        unsigned bodySize = slot[1] - Record::REC_HEADER_SIZE;
+        if (ptrFlag == REC_MOVED)
+        {
+            memcpy(page + freeOffset, old + slot[0] + 4 + sizeof(int), sizeof(RID));
+        }
+        memcpy(page + freeOffset + headerSize, old + slot[0] + Record::REC_HEADER_SIZE, bodySize);
+        setSlot(i, freeOffset, headerSize + bodySize, ptrFlag);
+        freeOffset += headerSize + bodySize;
+    }
+    setHeader(2, freeOffset);
+    recount();
+}
+
+// Record::getRecordSize() of raw data within left bytes; 0 if it runs over
+static unsigned getBoundedSize(const vector<Attribute> &recordDescriptor, const char *data, unsigned left)
+{
+    unsigned offset = (recordDescriptor.size() - 1) / 8 + 1;
+    for (unsigned i = 0; i < recordDescriptor.size() && offset <= left; i++)
+    {
+        if (data[i / 8] & (0x80 >> (i % 8)))
+        {
+            continue;
+        }
+        if (recordDescriptor[i].type != TypeVarChar)
+        {
+            offset += 4;
+        }
+        else if (offset + sizeof(unsigned) <= left)
+        {
+            offset += Utils::getVCSizeWithHead(data + offset);
+        }
+        else
+        {
+            return 0;
+        }
+    }
+    return offset <= left ? offset : 0;
+}
+
+RC DataPage::readV1(const char *page, const vector<Attribute> &recordDescriptor, vector<string> &records)
+{
+    // [Size][RecordNum]
+    const unsigned headerSize = 2 * sizeof(unsigned);
+    unsigned size = 0, recordNum = 0;
+    memcpy(&size, page, sizeof(unsigned));
+    memcpy(&recordNum, page + sizeof(unsigned), sizeof(unsigned));
+    if (size < headerSize || size > PAGE_SIZE || recordNum > (size - headerSize) / Record::REC_HEADER_SIZE)
+    {
+        return -1;
+    }
+    records.clear();
+    unsigned offset = headerSize, live = 0;
+    for (unsigned i = 0; i < recordNum; i++)
+    {
+        if (offset + Record::REC_HEADER_SIZE > size || memcmp(page + offset, Record::RECORD_HEAD.c_str(), 4) != 0)
+        {
+            return -1;
+        }
+        int ptrFlag = REC_HOME;
+        memcpy(&ptrFlag, page + offset + 4, sizeof(int));
+        if (ptrFlag != REC_HOME && ptrFlag != REC_DELETED)
+        {
+            return -1;
+        }
+        offset += Record::REC_HEADER_SIZE;
+        if (ptrFlag == REC_DELETED)
+        {
+            records.push_back(string());
+            continue;
+        }
+        unsigned rawSize = getBoundedSize(recordDescriptor, page + offset, size - offset);
+        if (rawSize == 0)
+        {
+            return -1;
+        }
+        records.push_back(string(page + offset, rawSize));
+        offset += rawSize;
+        live = i + 1;
+    }
+    if (offset != size)
+    {
+        return -1;
+    }
+    records.resize(live);
+    return 0;
+}
+
+RC DataPage::planV1(unsigned format, const vector<Attribute> &recordDescriptor, const vector<string> &records, vector<unsigned> &moved)
+{
+    unsigned headerSize = format == PAGE_COMPACT ? 0 : Record::REC_HEADER_SIZE;
+    unsigned forwardSize = headerSize + sizeof(RID);
+    vector<unsigned> lengths(records.size(), 0), order;
+    unsigned dataSize = DATA_PAGE_HEADER_SIZE + records.size() * SLOT_SIZE;
+    for (unsigned i = 0; i < records.size(); i++)
+    {
+        if (!records[i].empty())
+        {
+            lengths[i] = headerSize + Record::getEncodedSize(recordDescriptor, records[i].size());
+            dataSize += lengths[i];
+            order.push_back(i);
+        }
+    }
+    stable_sort(order.begin(), order.end(), [&](unsigned a, unsigned b) { return lengths[a] > lengths[b]; });
+
+    moved.clear();
+    for (unsigned i = 0; i < order.size() && dataSize > PAGE_SIZE && lengths[order[i]] > forwardSize; i++)
+    {
+        dataSize -= lengths[order[i]] - forwardSize;
+        moved.push_back(order[i]);
+    }
+    return dataSize <= PAGE_SIZE ? 0 : -1;
+}
+
+void DataPage::initV1(unsigned format, const vector<Attribute> &recordDescriptor, PageNum pageNum, const vector<string> &records,
+                      const map<unsigned, RID> &moved)
+{
+    // every slot deleted first, written ones are taken off the free slot chain
+    init(format, recordDescriptor);
+    setHeader(1, records.size());
+    for (unsigned i = 0; i < records.size(); i++)
+    {
+        setSlot(i, 0, 0);
+    }
+    recount();
+    for (unsigned i = 0; i < records.size(); i++)
+    {
+        if (records[i].empty())
+        {
+            continue;
+        }
+        RID owner = {pageNum, i};
+        auto target = moved.find(i);
+        if (target != moved.end())
+        {
+            writeBody(i, reinterpret_cast<const char *>(&target->second), sizeof(RID), REC_FORWARD, owner);
+        }
+        else
+        {
+            writeRecord(recordDescriptor, i, records[i].data(), records[i].size(), REC_HOME, owner);
+        }
+    }
+}
+
+const unsigned PaxPage::PAX_HEADER_SIZE = sizeof(unsigned) * 5;
+const unsigned PaxPage::CELL_SIZE = 4;
+
+PaxPage::PaxPage(char *page)
+    : page(page)
+{
+    load();
+}
+
+PaxPage::PaxPage(const char *page)
+    : PaxPage(const_cast<char *>(page))
+{
+}
+
+unsigned PaxPage::getInsertSize(const vector<Attribute> &recordDescriptor, unsigned rawSize)
+{
+    // heap values are the raw data without its null indicator
+    return rawSize + recordDescriptor.size() * CELL_SIZE + sizeof(unsigned short) + 1 + sizeof(RID);
+}
+
+unsigned PaxPage::getHeader(unsigned i)
+{
+    unsigned value = 0;
+    memcpy(&value, page + i * sizeof(unsigned), sizeof(unsigned));
+    return value;
+}
+
+void PaxPage::setHeader(unsigned i, unsigned value)
+{
+    memcpy(page + i * sizeof(unsigned), &value, sizeof(unsigned));
+}
+
+void PaxPage::load()
+{
+    capacity = getHeader(3);
+    attrNum = getHeader(4);
+    headerSize = PAX_HEADER_SIZE + (attrNum + 3) / 4 * 4;
+    nullSize = (attrNum + 7) / 8;
+    rowSize = attrNum * CELL_SIZE + nullSize + sizeof(unsigned short) + 1;
+}
+
+AttrType PaxPage::getType(unsigned attr)
+{
+    return (AttrType)page[PAX_HEADER_SIZE + attr];
+}
+
+unsigned PaxPage::cellAt(unsigned row, unsigned attr)
+{
+    return headerSize + (attr * capacity + row) * CELL_SIZE;
+}
+
+unsigned PaxPage::nullAt(unsigned row)
+{
+    return headerSize + attrNum * capacity * CELL_SIZE + row * nullSize;
+}
+
+unsigned PaxPage::auxAt(unsigned row)
+{
+    return headerSize + capacity * (attrNum * CELL_SIZE + nullSize) + row * sizeof(unsigned short);
+}
+
+unsigned PaxPage::flagAt(unsigned row)
+{
+    return headerSize + capacity * (attrNum * CELL_SIZE + nullSize + sizeof(unsigned short)) + row;
+}
+
+unsigned PaxPage::getCell(unsigned row, unsigned attr)
+{
+    unsigned cell = 0;
+    memcpy(&cell, page + cellAt(row, attr), CELL_SIZE);
+    return cell;
+}
+
+unsigned PaxPage::getAux(unsigned row)
+{
+    unsigned short aux = 0;
+    memcpy(&aux, page + auxAt(row), sizeof(unsigned short));
+    return aux;
+}
+
+void PaxPage::init(const vector<Attribute> &recordDescriptor)
+{
+    setHeader(0, PAGE_PAX);
+    setHeader(1, 0);
+    setHeader(2, PAGE_SIZE);
+    setHeader(3, 0);
+    setHeader(4, recordDescriptor.size());
+    load();
+    memset(page + PAX_HEADER_SIZE, 0, headerSize - PAX_HEADER_SIZE);
+    for (unsigned i = 0; i < attrNum; i++)
+    {
+        page[PAX_HEADER_SIZE + i] = (char)recordDescriptor[i].type;
+    }
+}
+
+unsigned PaxPage::getRowNum()
+{
+    return getHeader(1);
+}
+
+int PaxPage::getFlag(unsigned row)
+{
+    if (row >= getRowNum())
+    {
+        return REC_DELETED;
+    }
+    return (unsigned char)page[flagAt(row)];
+}
+
+RID PaxPage::getRid(unsigned row)
+{
+    RID rid;
+    memcpy(&rid, page + getAux(row), sizeof(RID));
+    return rid;
+}
+
+bool PaxPage::isNull(unsigned row, unsigned attr)
+{
+    return !!((page[nullAt(row) + attr / 8] << (attr % 8)) & 0x80);
+}
+
+const char *PaxPage::viewAttribute(unsigned row, unsigned attr)
+{
+    if (isNull(row, attr))
+    {
+        return nullptr;
+    }
+    if (getType(attr) == TypeVarChar)
+    {
+        return page + getCell(row, attr);
+    }
+    return page + cellAt(row, attr);
+}
+
+unsigned PaxPage::attributeProject(unsigned row, const vector<unsigned> &attrs, char *des)
+{
+    unsigned desOffset = nullSize;
+
+    // attributes not projected are null, remain bits are 0
+    memset(des, 0xFF, nullSize);
+    if (attrNum % 8)
+    {
+        des[nullSize - 1] &= (char)(0xFF << (8 - attrNum % 8));
+    }
+    for (unsigned attr : attrs)
+    {
+        const char *value = viewAttribute(row, attr);
+        if (!value)
+        {
+            continue;
+        }
+        unsigned size = getType(attr) == TypeVarChar ? Utils::getVCSizeWithHead(value) : CELL_SIZE;
+        des[attr / 8] &= (char)~(0x80 >> (attr % 8));
+        memcpy(des + desOffset, value, size);
+        desOffset += size;
+    }
+    return desOffset;
+}
+
+Record PaxPage::getRecord(unsigned row)
+{
+    int ptrFlag = getFlag(row);
+    if (ptrFlag == REC_DELETED)
+    {
+        return Record(nullptr, 0);
+    }
+    shared_ptr<vector<char>> owned = make_shared<vector<char>>(nullSize + attrNum * CELL_SIZE + getHeapSize(row));
+    char *des = owned->data();
+    unsigned size = sizeof(RID);
+    if (ptrFlag == REC_FORWARD)
+    {
+        memcpy(des, page + getAux(row), sizeof(RID));
+    }
+    else
+    {
+        memcpy(des, page + nullAt(row), nullSize);
+        size = nullSize;
+        for (unsigned attr = 0; attr < attrNum; attr++)
+        {
+            const char *value = viewAttribute(row, attr);
+            if (!value)
+            {
+                continue;
+            }
+            unsigned length = getType(attr) == TypeVarChar ? Utils::getVCSizeWithHead(value) : CELL_SIZE;
+            memcpy(des + size, value, length);
+            size += length;
+        }
+    }
+    Record record(des, size);
+    record.owned = owned;
+    record.ptrFlag = ptrFlag;
+    record.rid = ptrFlag == REC_MOVED ? getRid(row) : RID{0, 0};
+    return record;
+}
+
+unsigned PaxPage::getHeapSize(unsigned row)
+{
+    int ptrFlag = getFlag(row);
+    if (ptrFlag == REC_DELETED)
+    {
+        return 0;
+    }
+    unsigned size = getAux(row) ? sizeof(RID) : 0;
+    if (ptrFlag == REC_FORWARD)
+    {
+        return size;
+    }
+    for (unsigned attr = 0; attr < attrNum; attr++)
+    {
+        if (getType(attr) == TypeVarChar && !isNull(row, attr))
+        {
+            size += Utils::getVCSizeWithHead(page + getCell(row, attr));
+        }
+    }
+    return size;
+}
+
+int PaxPage::getHeapSize(const vector<Attribute> &recordDescriptor, const char *rawData)
+{
+    if (recordDescriptor.size() != attrNum)
+    {
+        return -1;
+    }
+    unsigned offset = nullSize, size = 0;
+    for (unsigned attr = 0; attr < attrNum; attr++)
+    {
+        if (recordDescriptor[attr].type != getType(attr))
+        {
+            return -1;
+        }
+        if ((rawData[attr / 8] << (attr % 8)) & 0x80)
+        {
+            continue;
+        }
+        if (getType(attr) == TypeVarChar)
+        {
+            unsigned length = Utils::getVCSizeWithHead(rawData + offset);
+            size += length;
+            offset += length;
+        }
+        else
+        {
+            offset += CELL_SIZE;
+        }
+    }
+    return size;
+}
+
+unsigned PaxPage::getDataSize()
+{
+    unsigned rowNum = getRowNum();
+    unsigned size = headerSize + rowNum * rowSize;
+    for (unsigned row = 0; row < rowNum; row++)
+    {
+        size += getHeapSize(row);
+    }
+    return size;
+}
+
+void PaxPage::repack(unsigned newCapacity)
+{
+    char old[PAGE_SIZE];
+    memcpy(old, page, PAGE_SIZE);
+    PaxPage from(old);
+
+    setHeader(3, newCapacity);
+    load();
+    memset(page + headerSize, 0, PAGE_SIZE - headerSize);
+    unsigned rowNum = getRowNum(), heap = PAGE_SIZE;
+    for (unsigned row = 0; row < rowNum; row++)
+    {
+        int ptrFlag = from.getFlag(row);
+        page[flagAt(row)] = (char)ptrFlag;
+        if (ptrFlag == REC_DELETED)
+        {
+            continue;
+        }
+        memcpy(page + nullAt(row), old + from.nullAt(row), nullSize);
+        unsigned short aux = from.getAux(row);
+        if (aux)
+        {
+            heap -= sizeof(RID);
+            memcpy(page + heap, old + aux, sizeof(RID));
+            aux = heap;
+            memcpy(page + auxAt(row), &aux, sizeof(unsigned short));
+        }
+        if (ptrFlag == REC_FORWARD)
+        {
+            continue;
+        }
+        for (unsigned attr = 0; attr < attrNum; attr++)
+        {
+            unsigned cell = from.getCell(row, attr);
+            if (getType(attr) == TypeVarChar && !from.isNull(row, attr))
+            {
+                unsigned length = Utils::getVCSizeWithHead(old + cell);
+                heap -= length;
+                memcpy(page + heap, old + cell, length);
+                cell = heap;
+            }
+            memcpy(page + cellAt(row, attr), &cell, CELL_SIZE);
+        }
+    }
+    setHeader(2, heap);
+}
+
+RC PaxPage::writeRow(const vector<Attribute> &recordDescriptor, unsigned row, const char *rawData, int ptrFlag, const RID *owner)
+{
+    int heapNeed = rawData ? getHeapSize(recordDescriptor, rawData) : 0;
+    if (heapNeed < 0)
+    {
+        return -1;
+    }
+    if (owner)
+    {
+        heapNeed += sizeof(RID);
+    }
+    unsigned rowNum = getRowNum();
+    unsigned newRowNum = max(rowNum, row + 1);
+
+    if (newRowNum > capacity || getHeader(2) < headerSize + capacity * rowSize + heapNeed)
+    {
+        // rebuilt without the old values of row, as large as the space left allows
+        unsigned live = getDataSize() - headerSize - rowNum * rowSize - getHeapSize(row);
+        if (headerSize + live + heapNeed + newRowNum * rowSize > PAGE_SIZE)
+        {
+            return -1;
+        }
+        unsigned maxCapacity = (PAGE_SIZE - headerSize - live - heapNeed) / rowSize;
+        if (row < rowNum)
+        {
+            page[flagAt(row)] = (char)REC_DELETED;
+        }
+        repack(min(maxCapacity, max(newRowNum, max(capacity * 2, 8u))));
+    }
+
+    unsigned heap = getHeader(2);
+    setHeader(1, newRowNum);
+    page[flagAt(row)] = (char)ptrFlag;
+    unsigned short aux = 0;
+    if (owner)
+    {
+        heap -= sizeof(RID);
+        memcpy(page + heap, owner, sizeof(RID));
+        aux = heap;
+    }
+    memcpy(page + auxAt(row), &aux, sizeof(unsigned short));
+    if (rawData)
+    {
+        memcpy(page + nullAt(row), rawData, nullSize);
+    }
+    else
+    {
+        memset(page + nullAt(row), 0, nullSize);
+    }
+
+    unsigned offset = nullSize;
+    for (unsigned attr = 0; attr < attrNum; attr++)
+    {
+        unsigned cell = 0;
+        if (rawData && !isNull(row, attr))
+        {
+            if (getType(attr) == TypeVarChar)
+            {
+                unsigned length = Utils::getVCSizeWithHead(rawData + offset);
+                heap -= length;
+                memcpy(page + heap, rawData + offset, length);
+                cell = heap;
+                offset += length;
+            }
+            else
+            {
+                memcpy(&cell, rawData + offset, CELL_SIZE);
+                offset += CELL_SIZE;
+            }
+        }
+        memcpy(page + cellAt(row, attr), &cell, CELL_SIZE);
+    }
+    setHeader(2, heap);
+    return 0;
+}
+
+unsigned PaxPage::getFreeRow()
+{
+    // a deleted row is reused with its RID
+    unsigned rowNum = getRowNum(), row = 0;
+    for (; row < rowNum; row++)
+    {
+        if (getFlag(row) == REC_DELETED)
+        {
+            break;
+        }
+    }
+    return row;
+}
+
+RC PaxPage::insertRecord(const vector<Attribute> &recordDescriptor, const char *rawData, RID &rid)
+{
+    rid.slotNum = getFreeRow();
+    return writeRow(recordDescriptor, rid.slotNum, rawData, REC_HOME, nullptr);
+}
+
+RC PaxPage::insertMoved(const vector<Attribute> &recordDescriptor, const char *rawData, const RID &home, RID &rid)
+{
+    rid.slotNum = getFreeRow();
+    return writeRow(recordDescriptor, rid.slotNum, rawData, REC_MOVED, &home);
+}
+
+RC PaxPage::updateRecord(const vector<Attribute> &recordDescriptor, unsigned row, const char *rawData)
+{
+    int ptrFlag = getFlag(row);
+    if (ptrFlag == REC_DELETED)
+    {
+        return -1;
+    }
+    // a forwarding pointer gets its record back; the home RID is copied out, the page may be rebuilt
+    if (ptrFlag == REC_MOVED)
+    {
+        RID home = getRid(row);
+        return writeRow(recordDescriptor, row, rawData, REC_MOVED, &home);
+    }
+    return writeRow(recordDescriptor, row, rawData, REC_HOME, nullptr);
+}
+
+RC PaxPage::forwardRecord(unsigned row, const RID &target)
+{
+    if (getFlag(row) == REC_DELETED)
+    {
+        return -1;
+    }
+    return writeRow(vector<Attribute>(), row, nullptr, REC_FORWARD, &target);
+}
+
+RC PaxPage::deleteRecord(unsigned row)
+{
+    if (getFlag(row) == REC_DELETED)
+    {
+        return -1;
+    }
+    // values are left in the heap until compact()
+    page[flagAt(row)] = (char)REC_DELETED;
+    memset(page + auxAt(row), 0, sizeof(unsigned short));
+    return 0;
+}
+
+void PaxPage::compact()
+{
+    repack(capacity);
+}
+
+unsigned PaxPage::vacuum()
+{
+    unsigned rowNum = getRowNum(), trimmed = rowNum;
+    for (; trimmed > 0; trimmed--)
+    {
+        if (getFlag(trimmed - 1) != REC_DELETED)
+        {
+            break;
+        }
+    }
+    unsigned heap = getHeader(2);
+    unsigned live = getDataSize() - headerSize - rowNum * rowSize;
+    if (trimmed == rowNum && heap + live == PAGE_SIZE)
+    {
+        return 0;
+    }
+    // the minipages shrink to the rows left
+    unsigned before = heap - headerSize - capacity * rowSize;
+    setHeader(1, trimmed);
+    repack(trimmed);
+    return getHeader(2) - headerSize - capacity * rowSize - before;
+}
+
+const unsigned OverflowPage::OVERFLOW_HEADER_SIZE = sizeof(unsigned) * 4;
+const unsigned OverflowPage::CAPACITY = PAGE_SIZE - OverflowPage::OVERFLOW_HEADER_SIZE;
+const PageNum OverflowPage::NO_PAGE = UINT_MAX;
+const unsigned OverflowPage::STUB_SIZE = sizeof(unsigned) + sizeof(PageNum);
+
+OverflowPage::OverflowPage(char *page)
+    : page(page)
+{
+}
+
+unsigned OverflowPage::getHeader(unsigned i)
+{
+    unsigned value = 0;
+    memcpy(&value, page + i * sizeof(unsigned), sizeof(unsigned));
+    return value;
+}
+
+void OverflowPage::setHeader(unsigned i, unsigned value)
+{
+    memcpy(page + i * sizeof(unsigned), &value, sizeof(unsigned));
+}
+
+void OverflowPage::init(PageNum next, const char *chars, unsigned size)
+{
+    memset(page, 0, PAGE_SIZE);
+    setHeader(0, PAGE_OVERFLOW);
+    setHeader(1, 0);
+    setHeader(2, next);
+    setHeader(3, size);
+    memcpy(page + OVERFLOW_HEADER_SIZE, chars, size);
+}
+
+PageNum OverflowPage::getNext()
+{
+    return getHeader(2);
+}
+
+unsigned OverflowPage::getSize()
+{
+    return getHeader(3);
+}
+
+const char *OverflowPage::getChars()
+{
+    return page + OVERFLOW_HEADER_SIZE;
+}
+
+bool OverflowPage::isStub(const char *value)
+{
+    unsigned size = 0;
+    memcpy(&size, value, sizeof(unsigned));
+    return size & VC_OVERFLOW_FLAG;
+}
+
+PageNum OverflowPage::getFirst(const char *stub)
+{
+    PageNum first = 0;
+    memcpy(&first, stub + sizeof(unsigned), sizeof(PageNum));
+    return first;
+}
+
+void OverflowPage::makeStub(unsigned size, PageNum first, char *des)
+{
+    size |= VC_OVERFLOW_FLAG;
+    memcpy(des, &size, sizeof(unsigned));
+    memcpy(des + sizeof(unsigned), &first, sizeof(PageNum));
+}
+
+RC OverflowPage::readValue(FileHandle &fileHandle, const char *stub, char *des)
+{
+    unsigned size = 0;
+    memcpy(&size, stub, sizeof(unsigned));
+    size &= ~VC_OVERFLOW_FLAG;
+    PageNum pageNum = getFirst(stub);
+    // des may be the stub itself
+    memcpy(des, &size, sizeof(unsigned));
+    char page[PAGE_SIZE];
+    OverflowPage overflow(page);
+    for (unsigned done = 0; done < size; pageNum = overflow.getNext())
+    {
+        if (pageNum == NO_PAGE || fileHandle.readPage(pageNum, page) != 0 || overflow.getHeader(0) != PAGE_OVERFLOW ||
+            done + overflow.getSize() > size)
+        {
+            cerr << "broken overflow chain" << endl;
+            return -1;
+        }
+        memcpy(des + sizeof(unsigned) + done, overflow.getChars(), overflow.getSize());
+        done += overflow.getSize();
+    }
+    return 0;
+}
+
+bool OverflowPage::hasStub(const vector<Attribute> &recordDescriptor, const char *data)
+{
+    unsigned offset = (recordDescriptor.size() - 1) / 8 + 1;
+    for (unsigned attr = 0; attr < recordDescriptor.size(); attr++)
+    {
+        if ((data[attr / 8] << (attr % 8)) & 0x80)
+        {
+            continue;
+        }
+        if (recordDescriptor[attr].type != TypeVarChar)
+        {
+            offset += 4;
+            continue;
+        }
+        if (isStub(data + offset))
+        {
+            return true;
+        }
+        offset += Utils::getVCSizeWithHead(data + offset);
+    }
+    return false;
+}
+
+RC OverflowPage::expand(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, char *data, unsigned &size)
+{
+    // most records have no stub and are left as they are
+    if (!hasStub(recordDescriptor, data))
+    {
+        return 0;
+    }
+    vector<char> copy(data, data + size);
+    unsigned from = (recordDescriptor.size() - 1) / 8 + 1, offset = from;
+    for (unsigned attr = 0; attr < recordDescriptor.size(); attr++)
+    {
+        if ((data[attr / 8] << (attr % 8)) & 0x80)
+        {
+            continue;
+        }
+        const char *value = copy.data() + from;
+        bool isVarChar = recordDescriptor[attr].type == TypeVarChar;
+        unsigned length = isVarChar ? Utils::getVCSizeWithHead(value) : 4;
+        if (isVarChar && isStub(value))
+        {
+            if (readValue(fileHandle, value, data + offset) != 0)
+            {
+                return -1;
+            }
+        }
+        else
+        {
+            memcpy(data + offset, value, length);
+        }
+        from += length;
+        offset += isVarChar ? Utils::getVCSizeWithHead(data + offset) : 4;
+    }
+    size = offset;
+    return 0;
+}
+
+const unsigned ZoneMap::UNKNOWN_ROWS = UINT_MAX;
+const unsigned ZoneMap::ZONE_HEADER_SIZE = sizeof(uint64_t) + sizeof(unsigned) * 2;
+const unsigned ZoneMap::ZONE_SIZE = 4 * 2 + sizeof(unsigned);
+
+// DataWrites of a zone file in use, it matches no data file
+static const uint64_t ZONE_UNSAVED = UINT64_MAX;
+
+ZoneMap::ZoneMap(FileIO *io)
+    : io(io),
+      trackedNum(0),
+      dirtyStart(0)
+{
+}
+
+ZoneMap::~ZoneMap()
+{
+    io->close();
+    delete io;
+}
+
+string ZoneMap::getZoneFileName(const string &fileName)
+{
+    return fileName + ".zone";
+}
+
+RC ZoneMap::create(const string &fileName, uint64_t dataWrites)
+{
+    string zoneFileName = getZoneFileName(fileName);
+    FILE *file = fopen(zoneFileName.c_str(), "wb");
+    if (file == NULL || fclose(file) != 0)
+    {
+        return -1;
+    }
+    FileIO *io = FileIO::open(zoneFileName, IO_POSIX);
+    if (io == NULL)
+    {
+        return -1;
+    }
+    return ZoneMap(io).save(dataWrites);
+}
+
+shared_ptr<ZoneMap> ZoneMap::load(const string &fileName, uint64_t dataWrites)
+{
+    string zoneFileName = getZoneFileName(fileName);
+    FileIO *io = FileIO::open(zoneFileName, IO_POSIX);
+    if (io == NULL)
+    {
+        return nullptr;
+    }
+    shared_ptr<ZoneMap> zoneMap(new ZoneMap(io));
+    char header[ZONE_HEADER_SIZE];
+    uint64_t saved = ZONE_UNSAVED;
+    unsigned attrNum = 0, pageNum = 0;
+    bool valid = io->read(0, ZONE_HEADER_SIZE, header) == 0;
+    if (valid)
+    {
+        memcpy(&saved, header, sizeof(uint64_t));
+        memcpy(&attrNum, header + sizeof(uint64_t), sizeof(unsigned));
+        memcpy(&pageNum, header + sizeof(uint64_t) + sizeof(unsigned), sizeof(unsigned));
+    }
+    // the data file is written after the zones were saved
+    valid = valid && saved == dataWrites;
+    vector<char> types(attrNum);
+    valid = valid && (attrNum == 0 || io->read(ZONE_HEADER_SIZE, attrNum, types.data()) == 0);
+    if (valid)
+    {
+        vector<Attribute> recordDescriptor;
+        for (char type : types)
+        {
+            recordDescriptor.push_back(Attribute{"", (AttrType)type, 4});
+        }
+        zoneMap->setTypes(recordDescriptor);
+        zoneMap->entries.resize((size_t)pageNum * zoneMap->getEntrySize());
+        valid = pageNum == 0 || io->read(ZONE_HEADER_SIZE + attrNum, zoneMap->entries.size(), zoneMap->entries.data()) == 0;
+    }
+    // stale until save(), in case the data file is written and this is not saved
+    valid = valid && io->write(0, sizeof(uint64_t), &ZONE_UNSAVED) == 0;
+    if (!valid)
+    {
+        zoneMap.reset();
+        remove(zoneFileName.c_str());
+        return nullptr;
+    }
+    zoneMap->dirtyStart = pageNum;
+    return zoneMap;
+}
+
+RC ZoneMap::save(uint64_t dataWrites)
+{
+    lock_guard<mutex> lock(latch);
+    unsigned attrNum = types.size();
+    unsigned pageNum = getPageNum();
+    unsigned entrySize = getEntrySize();
+    vector<char> typeBytes(types.begin(), types.end());
+    if (attrNum > 0 && io->write(ZONE_HEADER_SIZE, attrNum, typeBytes.data()) != 0)
+    {
+        return -1;
+    }
+    size_t entryStart = ZONE_HEADER_SIZE + attrNum;
+    if (dirtyStart < pageNum &&
+        io->write(entryStart + (size_t)dirtyStart * entrySize, (size_t)(pageNum - dirtyStart) * entrySize, &entries[(size_t)dirtyStart * entrySize]) != 0)
+    {
+        return -1;
+    }
+    // entries of other types may be left after them
+    if (io->size() != entryStart + entries.size() && io->resize(entryStart + entries.size()) != 0)
+    {
+        return -1;
+    }
+    // the header last, the entries are valid once it's written
+    char header[ZONE_HEADER_SIZE];
+    memcpy(header, &dataWrites, sizeof(uint64_t));
+    memcpy(header + sizeof(uint64_t), &attrNum, sizeof(unsigned));
+    memcpy(header + sizeof(uint64_t) + sizeof(unsigned), &pageNum, sizeof(unsigned));
+    if (io->write(0, ZONE_HEADER_SIZE, header) != 0)
+    {
+        return -1;
+    }
+    dirtyStart = pageNum;
+    return 0;
+}
+
+unsigned ZoneMap::getEntrySize()
+{
+    return sizeof(unsigned) + trackedNum * ZONE_SIZE;
+}
+
+unsigned ZoneMap::getPageNum()
+{
+    return entries.size() / getEntrySize();
+}
+
+char *ZoneMap::getEntry(PageNum pageNum)
+{
+    unsigned entrySize = getEntrySize();
+    unsigned pageCount = getPageNum();
+    if (pageNum >= pageCount)
+    {
+        entries.resize((size_t)(pageNum + 1) * entrySize);
+        for (PageNum added = pageCount; added <= pageNum; added++)
+        {
+            memcpy(&entries[(size_t)added * entrySize], &UNKNOWN_ROWS, sizeof(unsigned));
+        }
+        dirtyStart = min(dirtyStart, pageCount);
+    }
+    dirtyStart = min(dirtyStart, pageNum);
+    return &entries[(size_t)pageNum * entrySize];
+}
+
+void ZoneMap::setTypes(const vector<Attribute> &recordDescriptor)
+{
+    types.clear();
+    tracked.clear();
+    comparators.clear();
+    trackedNum = 0;
+    for (const Attribute &attr : recordDescriptor)
+    {
+        types.push_back(attr.type);
+        tracked.push_back(attr.type == TypeVarChar ? -1 : (int)trackedNum++);
+        comparators.push_back(Predicate::getComparator(attr.type));
+    }
+    // zones of other types tell nothing
+    entries.clear();
+    dirtyStart = 0;
+}
+
+bool ZoneMap::matches(const vector<Attribute> &recordDescriptor)
+{
+    lock_guard<mutex> lock(latch);
+    return sameTypes(recordDescriptor);
+}
+
+bool ZoneMap::sameTypes(const vector<Attribute> &recordDescriptor)
+{
+    if (types.size() != recordDescriptor.size())
+    {
+        return false;
+    }
+    for (unsigned i = 0; i < types.size(); i++)
+    {
+        if (types[i] != recordDescriptor[i].type)
+        {
+            return false;
+        }
+    }
+    return true;
+}
 
-    // copy page header
-    memcpy(data, &size, sizeof(unsigned));
-    data += sizeof(unsigned);
-    memcpy(data, &recordNum, sizeof(unsigned));
-    data += sizeof(unsigned);
+template <typename View>
+void ZoneMap::addRow(char *entry, View view)
+{
+    unsigned rowNum = 0;
+    memcpy(&rowNum, entry, sizeof(unsigned));
+    unsigned attrNum = types.size();
+    for (unsigned attr = 0; attr < attrNum; attr++)
+    {
+        int index = tracked[attr];
+        if (index < 0)
+        {
+            continue;
+        }
+        char *zone = entry + sizeof(unsigned) + index * ZONE_SIZE;
+        unsigned nullCount = 0;
+        memcpy(&nullCount, zone + 8, sizeof(unsigned));
+        const char *value = view(attr);
+        if (!value)
+        {
+            nullCount++;
+            memcpy(zone + 8, &nullCount, sizeof(unsigned));
+            continue;
+        }
+        // the first non-null value sets both bounds, a value below the min can't be above the max
+        if (nullCount == rowNum)
+        {
+            memcpy(zone, value, 4);
+            memcpy(zone + 4, value, 4);
+        }
+        else if (comparators[attr](value, zone) < 0)
+        {
+            memcpy(zone, value, 4);
+        }
+        else if (comparators[attr](value, zone + 4) > 0)
+        {
+            memcpy(zone + 4, value, 4);
+        }
+    }
+    rowNum++;
+    memcpy(entry, &rowNum, sizeof(unsigned));
+}
 
-    // generate records raw data
-    Record *rec;
-    unsigned recSize;
-    for (unsigned i = 0; i < recordNum; i++)
+void ZoneMap::addSlot(char *entry, const vector<Attribute> &recordDescriptor, const char *page, unsigned slotNum)
+{
+    // forwarding pointers are counted where their records are moved to
+    DataPage dataPage(page);
+    if (dataPage.getFormat() == PAGE_PAX)
+    {
+        PaxPage pax(page);
+        int ptrFlag = pax.getFlag(slotNum);
+        if (ptrFlag == REC_HOME || ptrFlag == REC_MOVED)
+        {
+            addRow(entry, [&](unsigned attr) { return pax.viewAttribute(slotNum, attr); });
+        }
+        return;
+    }
+    Record record = dataPage.getRecord(slotNum);
+    if (record.ptrFlag == REC_HOME || record.ptrFlag == REC_MOVED)
+    {
+        addRow(entry, [&](unsigned attr) { return record.viewAttribute(recordDescriptor, attr); });
+    }
+}
+
+void ZoneMap::refresh(PageNum pageNum, const vector<Attribute> &recordDescriptor, const char *page)
+{
+    lock_guard<mutex> lock(latch);
+    recompute(pageNum, recordDescriptor, page);
+}
+
+void ZoneMap::recompute(PageNum pageNum, const vector<Attribute> &recordDescriptor, const char *page)
+{
+    if (!sameTypes(recordDescriptor))
+    {
+        setTypes(recordDescriptor);
+    }
+    char *entry = getEntry(pageNum);
+    memset(entry, 0, getEntrySize());
+    unsigned slotNum = DataPage(page).getSlotNum();
+    for (unsigned i = 0; i < slotNum; i++)
+    {
+        addSlot(entry, recordDescriptor, page, i);
+    }
+}
+
+// zone of rowNum values a stride apart as addRow() keeps it, bounds are compared as V; # of nulls.
+// Reals are bound exactly, addRow() keeps them within the tolerance of AttrCompare
+template <typename V>
+static unsigned boundValues(const char *const *values, unsigned stride, unsigned rowNum, char *zone)
+{
+    V low = 0, high = 0, value = 0;
+    unsigned nullCount = 0;
+    for (unsigned row = 0; row < rowNum; row++)
     {
-        if (data - _data > PAGE_SIZE)
+        const char *field = values[(size_t)row * stride];
+        if (!field)
+        {
+            nullCount++;
+            continue;
+        }
+        memcpy(&value, field, sizeof(V));
+        // the first non-null value sets both bounds
+        if (nullCount == row)
+        {
+            low = high = value;
+        }
+        else if (value < low)
+        {
+            low = value;
+        }
+        else if (value > high)
         {
-            cerr << "DataPage: data - _data > PAGE_SIZE" << endl;
-            exit(-1);
+            high = value;
         }
-        rec = records[i];
-        // add "Rec:"
-        memcpy(data, Record::RECORD_HEAD.c_str(), 4);
-        data += 4;
-        memcpy(data, &(rec->ptrFlag), sizeof(int));
-        data += sizeof(int);
-        memcpy(data, &(rec->rid), sizeof(RID));
-        data += sizeof(RID);
+    }
+    if (nullCount < rowNum)
+    {
+        memcpy(zone, &low, sizeof(V));
+        memcpy(zone + 4, &high, sizeof(V));
+    }
+    return nullCount;
+}
 
-        recSize = rec->sizeWithoutHeader(recordDescriptor);
-        if (recSize == 0)
+void ZoneMap::refresh(PageNum pageNum, const vector<Attribute> &recordDescriptor, const char *const *values, unsigned rowNum)
+{
+    lock_guard<mutex> lock(latch);
+    if (!sameTypes(recordDescriptor))
+    {
+        setTypes(recordDescriptor);
+    }
+    char *entry = getEntry(pageNum);
+    memset(entry, 0, getEntrySize());
+    memcpy(entry, &rowNum, sizeof(unsigned));
+    // attribute by attribute, as addRow() would row by row
+    unsigned attrNum = types.size();
+    for (unsigned attr = 0; attr < attrNum; attr++)
+    {
+        if (tracked[attr] < 0)
         {
             continue;
         }
-        memcpy(data, rec->data, recSize);
-        data += recSize;
+        char *zone = entry + sizeof(unsigned) + tracked[attr] * ZONE_SIZE;
+        unsigned nullCount = types[attr] == TypeInt ? boundValues<int>(values + attr, attrNum, rowNum, zone)
+                                                    : boundValues<float>(values + attr, attrNum, rowNum, zone);
+        memcpy(zone + 8, &nullCount, sizeof(unsigned));
+    }
+}
+
+void ZoneMap::widen(PageNum pageNum, const vector<Attribute> &recordDescriptor, const char *page, unsigned slotNum)
+{
+    lock_guard<mutex> lock(latch);
+    unsigned rowNum = UNKNOWN_ROWS;
+    if (sameTypes(recordDescriptor) && pageNum < getPageNum())
+    {
+        memcpy(&rowNum, &entries[(size_t)pageNum * getEntrySize()], sizeof(unsigned));
     }
-    if (data - _data != size)
+    if (rowNum == UNKNOWN_ROWS)
     {
-        cerr << "DataPage::getRawData: data - _data=" << data - _data << " != size=" << size << endl;
-        exit(-1);
+        recompute(pageNum, recordDescriptor, page);
+        return;
+    }
+    addSlot(getEntry(pageNum), recordDescriptor, page, slotNum);
+}
+
+bool ZoneMap::excludes(PageNum pageNum, const vector<vector<RBFM_ScanIterator::BoundPredicate>> &groups)
+{
+    lock_guard<mutex> lock(latch);
+    if (pageNum >= getPageNum())
+    {
+        return false;
+    }
+    const char *entry = &entries[(size_t)pageNum * getEntrySize()];
+    unsigned rowNum = 0;
+    memcpy(&rowNum, entry, sizeof(unsigned));
+    if (rowNum == UNKNOWN_ROWS)
+    {
+        return false;
+    }
+    if (rowNum == 0)
+    {
+        return true;
+    }
+    if (groups.empty())
+    {
+        return false;
+    }
+    // each group has a predicate no row can meet
+    for (const vector<RBFM_ScanIterator::BoundPredicate> &group : groups)
+    {
+        bool excluded = false;
+        for (const RBFM_ScanIterator::BoundPredicate &predicate : group)
+        {
+            // zones may have been started over for another descriptor since the scan was made
+            if (predicate.attr >= tracked.size() || tracked[predicate.attr] < 0)
+            {
+                continue;
+            }
+            const char *zone = entry + sizeof(unsigned) + tracked[predicate.attr] * ZONE_SIZE;
+            unsigned nullCount = 0;
+            memcpy(&nullCount, zone + 8, sizeof(unsigned));
+            // null meets no condition
+            if (nullCount == rowNum || !predicate.predicate->mayMeet(zone, zone + 4))
+            {
+                excluded = true;
+                break;
+            }
+        }
+        if (!excluded)
+        {
+            return false;
+        }
     }
+    return true;
 }
 
 RecordBasedFileManager *RecordBasedFileManager::_rbf_manager = 0;
+static once_flag rbfManagerOnce;
 
 RecordBasedFileManager *RecordBasedFileManager::instance()
 {
-    if (!_rbf_manager)
-        _rbf_manager = new RecordBasedFileManager();
-
+    // first caller may be any thread
+    call_once(rbfManagerOnce, []() { _rbf_manager = new RecordBasedFileManager(); });
     return _rbf_manager;
 }
 
@@ -915,289 +2903,995 @@ RecordBasedFileManager::RecordBasedFileManager()
     pfm = PagedFileManager::instance();
 }
 
-RecordBasedFileManager::~RecordBasedFileManager()
+RecordBasedFileManager::~RecordBasedFileManager()
+{
+}
+
+RC RecordBasedFileManager::createFile(const string &fileName)
+{
+    if (pfm->createFile(fileName) != 0)
+    {
+        return -1;
+    }
+    FileHandle fileHandle;
+    if (pfm->openFile(fileName, fileHandle) != 0)
+    {
+        return -1;
+    }
+    RC rc = ZoneMap::create(fileName, getDataWrites(fileHandle));
+    pfm->closeFile(fileHandle);
+    return rc;
+}
+
+RC RecordBasedFileManager::createFile(const string &fileName, PageFormat format)
+{
+    if (pfm->createFile(fileName) != 0)
+    {
+        return -1;
+    }
+    FileHandle fileHandle;
+    if (pfm->openFile(fileName, fileHandle) != 0)
+    {
+        return -1;
+    }
+    fileHandle.setPageFormat(format);
+    RC rc = ZoneMap::create(fileName, getDataWrites(fileHandle));
+    pfm->closeFile(fileHandle);
+    return rc;
+}
+
+RC RecordBasedFileManager::destroyFile(const string &fileName)
+{
+    remove(ZoneMap::getZoneFileName(fileName).c_str());
+    return pfm->destroyFile(fileName);
+}
+
+RC RecordBasedFileManager::openFile(const string &fileName, FileHandle &fileHandle)
+{
+    return openFile(fileName, fileHandle, IO_POSIX);
+}
+
+RC RecordBasedFileManager::openFile(const string &fileName, FileHandle &fileHandle, IOBackend backend)
+{
+    if (pfm->openFile(fileName, fileHandle, backend) != 0)
+    {
+        return -1;
+    }
+    // handles of a file share its zone map
+    lock_guard<mutex> lock(zoneLatch);
+    OpenZoneMap &open = zoneMaps[fileHandle.getFileId()];
+    if (open.handleNum++ == 0)
+    {
+        open.zoneMap = ZoneMap::load(fileName, getDataWrites(fileHandle));
+    }
+    return 0;
+}
+
+RC RecordBasedFileManager::closeFile(FileHandle &fileHandle)
+{
+    {
+        lock_guard<mutex> lock(zoneLatch);
+        map<unsigned, OpenZoneMap>::iterator it = zoneMaps.find(fileHandle.getFileId());
+        if (it != zoneMaps.end() && --it->second.handleNum == 0)
+        {
+            if (it->second.zoneMap)
+            {
+                it->second.zoneMap->save(getDataWrites(fileHandle));
+            }
+            zoneMaps.erase(it);
+        }
+    }
+    return pfm->closeFile(fileHandle);
+}
+
+shared_ptr<ZoneMap> RecordBasedFileManager::getZoneMap(FileHandle &fileHandle)
+{
+    lock_guard<mutex> lock(zoneLatch);
+    map<unsigned, OpenZoneMap>::iterator it = zoneMaps.find(fileHandle.getFileId());
+    if (it == zoneMaps.end())
+    {
+        return nullptr;
+    }
+    return it->second.zoneMap;
+}
+
+void RecordBasedFileManager::refreshZone(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, PageNum pageNum, const char *page)
+{
+    shared_ptr<ZoneMap> zoneMap = getZoneMap(fileHandle);
+    if (zoneMap)
+    {
+        zoneMap->refresh(pageNum, recordDescriptor, page);
+    }
+}
+
+uint64_t RecordBasedFileManager::getDataWrites(FileHandle &fileHandle)
+{
+    return __atomic_load_n(&fileHandle.writePageCounter, __ATOMIC_RELAXED) + __atomic_load_n(&fileHandle.appendPageCounter, __ATOMIC_RELAXED);
+}
+
+bool RecordBasedFileManager::fitsPage(const vector<Attribute> &recordDescriptor, unsigned rawSize)
+{
+    return Record::getEncodedSize(recordDescriptor, rawSize) + Record::REC_HEADER_SIZE + DataPage::SLOT_SIZE + DataPage::DATA_PAGE_HEADER_SIZE <= PAGE_SIZE;
+}
+
+bool RecordBasedFileManager::chooseOverflow(const vector<Attribute> &recordDescriptor, const char *data, vector<unsigned> &attrs)
+{
+    // (size, attr) of each VarChar larger than its stub
+    vector<pair<unsigned, unsigned>> values;
+    unsigned size = (recordDescriptor.size() - 1) / 8 + 1;
+    for (unsigned attr = 0; attr < recordDescriptor.size(); attr++)
+    {
+        if ((data[attr / 8] << (attr % 8)) & 0x80)
+        {
+            continue;
+        }
+        unsigned length = recordDescriptor[attr].type == TypeVarChar ? Utils::getVCSizeWithHead(data + size) : 4;
+        if (length > OverflowPage::STUB_SIZE)
+        {
+            values.push_back(make_pair(length, attr));
+        }
+        size += length;
+    }
+    sort(values.rbegin(), values.rend());
+
+    attrs.clear();
+    for (unsigned i = 0; i < values.size() && !fitsPage(recordDescriptor, size); i++)
+    {
+        attrs.push_back(values[i].second);
+        size -= values[i].first - OverflowPage::STUB_SIZE;
+    }
+    sort(attrs.begin(), attrs.end());
+    return fitsPage(recordDescriptor, size);
+}
+
+RC RecordBasedFileManager::moveOutValues(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const char *data, const vector<unsigned> &attrs,
+                                         vector<char> &stubbed, vector<PageNum> &chains)
+{
+    unsigned nullSize = (recordDescriptor.size() - 1) / 8 + 1, offset = nullSize;
+    stubbed.assign(data, data + nullSize);
+    for (unsigned attr = 0; attr < recordDescriptor.size(); attr++)
+    {
+        if ((data[attr / 8] << (attr % 8)) & 0x80)
+        {
+            continue;
+        }
+        const char *value = data + offset;
+        unsigned length = recordDescriptor[attr].type == TypeVarChar ? Utils::getVCSizeWithHead(value) : 4;
+        offset += length;
+        if (!binary_search(attrs.begin(), attrs.end(), attr))
+        {
+            stubbed.insert(stubbed.end(), value, value + length);
+            continue;
+        }
+        PageNum first = 0;
+        if (writeOverflow(fileHandle, recordDescriptor, value + sizeof(unsigned), length - sizeof(unsigned), first) != 0)
+        {
+            freeOverflow(fileHandle, recordDescriptor, chains);
+            return -1;
+        }
+        chains.push_back(first);
+        char stub[OverflowPage::STUB_SIZE];
+        OverflowPage::makeStub(length - sizeof(unsigned), first, stub);
+        stubbed.insert(stubbed.end(), stub, stub + OverflowPage::STUB_SIZE);
+    }
+    return 0;
+}
+
+RC RecordBasedFileManager::writeOverflow(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const char *chars, unsigned size, PageNum &first)
+{
+    // appended one after another, each full to the free space map
+    first = fileHandle.getNumberOfPages();
+    char page[PAGE_SIZE];
+    OverflowPage overflow(page);
+    for (unsigned done = 0; done < size || done == 0; done += OverflowPage::CAPACITY)
+    {
+        unsigned n = min(size - done, OverflowPage::CAPACITY);
+        PageNum pageNum = fileHandle.getNumberOfPages();
+        overflow.init(done + n < size ? pageNum + 1 : OverflowPage::NO_PAGE, chars + done, n);
+        if (fileHandle.appendPage(page, PAGE_SIZE) != 0)
+        {
+            return -1;
+        }
+        // no row for a scan to read
+        refreshZone(fileHandle, recordDescriptor, pageNum, page);
+        if (size == 0)
+        {
+            break;
+        }
+    }
+    return 0;
+}
+
+RC RecordBasedFileManager::freeOverflow(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const vector<PageNum> &chains)
+{
+    char *frame = nullptr;
+    for (PageNum pageNum : chains)
+    {
+        while (pageNum != OverflowPage::NO_PAGE)
+        {
+            if (fileHandle.pinPage(pageNum, frame) != 0)
+            {
+                return -1;
+            }
+            DataPage page(frame);
+            if (page.getFormat() != PAGE_OVERFLOW)
+            {
+                cerr << "broken overflow chain" << endl;
+                fileHandle.unpinPage(pageNum);
+                return -1;
+            }
+            PageNum next = OverflowPage(frame).getNext();
+            // taken by inserts as any empty page
+            memset(frame, 0, PAGE_SIZE);
+            page.init(fileHandle.getPageFormat(), recordDescriptor);
+            refreshZone(fileHandle, recordDescriptor, pageNum, frame);
+            fileHandle.updateDataSize(pageNum, page.getDataSize());
+            fileHandle.unpinPage(pageNum, true);
+            pageNum = next;
+        }
+    }
+    return 0;
+}
+
+RC RecordBasedFileManager::getOverflow(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const RID &rid, vector<PageNum> &chains)
+{
+    PageNum pageNum = 0;
+    Record rec(nullptr, 0);
+    if (viewRecord(fileHandle, rid, pageNum, rec) != 0)
+    {
+        return -1;
+    }
+    for (unsigned attr = 0; attr < recordDescriptor.size(); attr++)
+    {
+        const char *value = recordDescriptor[attr].type == TypeVarChar ? rec.viewAttribute(recordDescriptor, attr) : nullptr;
+        if (value && OverflowPage::isStub(value))
+        {
+            chains.push_back(OverflowPage::getFirst(value));
+        }
+    }
+    return fileHandle.releasePage(pageNum);
+}
+
+RC RecordBasedFileManager::insertRecord(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const void *data, RID &rid)
+{
+    unsigned dataSize = Record::getRecordSize(recordDescriptor, data);
+    const char *c_data = static_cast<const char *>(data);
+    vector<char> stubbed;
+    if (!fitsPage(recordDescriptor, dataSize))
+    {
+        vector<unsigned> attrs;
+        vector<PageNum> chains;
+        if (!chooseOverflow(recordDescriptor, c_data, attrs))
+        {
+            cerr << "record excessed PAGE_SIZE" << endl;
+            return -1;
+        }
+        if (moveOutValues(fileHandle, recordDescriptor, c_data, attrs, stubbed, chains) != 0)
+        {
+            return -1;
+        }
+        c_data = stubbed.data();
+        dataSize = stubbed.size();
+    }
+
+    if (fileHandle.getNumberOfPages() == 0)
+    {
+        return addPageAndInsert(fileHandle, recordDescriptor, c_data, dataSize, rid);
+    }
+    return findPageAndInsert(fileHandle, recordDescriptor, c_data, dataSize, rid);
+}
+
+RC RecordBasedFileManager::insertRecords(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const vector<const void *> &records, vector<RID> &rids)
+{
+    // no record of a descriptor whose largest record fits a page is looked at for overflow values
+    unsigned maxSize = (recordDescriptor.size() - 1) / 8 + 1;
+    for (const Attribute &attr : recordDescriptor)
+    {
+        maxSize += attr.type == TypeVarChar ? sizeof(unsigned) + min(attr.length, (AttrLength)PAGE_SIZE) : 4;
+    }
+    bool bounded = fitsPage(recordDescriptor, maxSize);
+    // attributes to move out of each record, by index of records
+    map<unsigned, vector<unsigned>> overflows;
+    for (unsigned i = 0; !bounded && i < records.size(); i++)
+    {
+        if (fitsPage(recordDescriptor, Record::getRecordSize(recordDescriptor, records[i])))
+        {
+            continue;
+        }
+        if (!chooseOverflow(recordDescriptor, static_cast<const char *>(records[i]), overflows[i]))
+        {
+            cerr << "record excessed PAGE_SIZE" << endl;
+            return -1;
+        }
+    }
+    // overflow pages go before the packed ones
+    vector<const void *> stored(records);
+    map<unsigned, vector<char>> stubbed;
+    vector<PageNum> chains;
+    for (const pair<const unsigned, vector<unsigned>> &overflow : overflows)
+    {
+        unsigned i = overflow.first;
+        if (moveOutValues(fileHandle, recordDescriptor, static_cast<const char *>(records[i]), overflow.second, stubbed[i], chains) != 0)
+        {
+            freeOverflow(fileHandle, recordDescriptor, chains);
+            return -1;
+        }
+        stored[i] = stubbed[i].data();
+    }
+
+    // pages are packed into chunk and appended by one write once it's full
+    unsigned format = fileHandle.getPageFormat();
+    unsigned attrNum = recordDescriptor.size();
+    shared_ptr<ZoneMap> zoneMap = getZoneMap(fileHandle);
+    // zones are taken from the fields met by encoding, PAGE_PAX pages are refreshed from their content
+    bool collect = zoneMap && format != PAGE_PAX;
+    vector<char> chunk((size_t)INSERT_CHUNK_PAGES * PAGE_SIZE);
+    vector<unsigned> dataSizes;
+    // values of the rows of the chunk, rows of the i-th page from rowStarts[i]
+    vector<const char *> values;
+    vector<unsigned> rowStarts(1, 0);
+    PageNum first = fileHandle.getNumberOfPages();
+    DataPage page(chunk.data());
+    page.init(format, recordDescriptor);
+    // the page is done, the chunk is appended if it's full or last; a new page is started
+    auto finishPage = [&](bool last) -> RC {
+        dataSizes.push_back(page.getDataSize());
+        rowStarts.push_back(rowStarts.back() + page.getSlotNum());
+        if (dataSizes.size() == INSERT_CHUNK_PAGES || last)
+        {
+            if (fileHandle.appendPages(chunk.data(), dataSizes.size(), dataSizes.data()) != 0)
+            {
+                return -1;
+            }
+            for (unsigned n = 0; zoneMap && n < dataSizes.size(); n++)
+            {
+                if (collect)
+                {
+                    zoneMap->refresh(first + n, recordDescriptor, &values[(size_t)rowStarts[n] * attrNum], rowStarts[n + 1] - rowStarts[n]);
+                }
+                else
+                {
+                    zoneMap->refresh(first + n, recordDescriptor, &chunk[(size_t)n * PAGE_SIZE]);
+                }
+            }
+            first += dataSizes.size();
+            dataSizes.clear();
+            rowStarts.assign(1, 0);
+        }
+        char *pageData = &chunk[dataSizes.size() * PAGE_SIZE];
+        memset(pageData, 0, PAGE_SIZE);
+        page = DataPage(pageData);
+        page.init(format, recordDescriptor);
+        return 0;
+    };
+
+    rids.resize(records.size());
+    // a page is filled from the records left, it can't take more of them than slots
+    unsigned maxRows = PAGE_SIZE / DataPage::SLOT_SIZE;
+    for (unsigned i = 0; i < records.size();)
+    {
+        unsigned row = rowStarts.back();
+        unsigned recordNum = min((unsigned)records.size() - i, maxRows);
+        if (collect && values.size() < (size_t)(row + recordNum) * attrNum)
+        {
+            values.resize((size_t)(row + recordNum) * attrNum);
+        }
+        unsigned appended = page.appendRecords(recordDescriptor, &stored[i], recordNum, first + dataSizes.size(), &rids[i],
+                                               collect ? &values[(size_t)row * attrNum] : nullptr);
+        // the record doesn't fit an empty page, its VarChars are longer than recordDescriptor tells
+        if (appended == 0)
+        {
+            cerr << "record excessed PAGE_SIZE" << endl;
+            return -1;
+        }
+        i += appended;
+        if (finishPage(i == records.size()) != 0)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+RC RecordBasedFileManager::addPageAndInsert(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const char *data, unsigned size, RID &rid, const RID *home)
 {
+    char pageData[PAGE_SIZE];
+    memset(pageData, 0, PAGE_SIZE);
+    DataPage page(pageData);
+    page.init(fileHandle.getPageFormat(), recordDescriptor);
+
+    rid.pageNum = fileHandle.getNumberOfPages();
+    RC rc = home ? page.insertMoved(recordDescriptor, data, size, *home, rid) : page.insertRecord(recordDescriptor, data, size, rid);
+    if (rc != 0 || fileHandle.appendPage(pageData, page.getDataSize()) != 0)
+    {
+        return -1;
+    }
+    refreshZone(fileHandle, recordDescriptor, rid.pageNum, pageData);
+    return 0;
 }
 
-RC RecordBasedFileManager::createFile(const string &fileName)
+RC RecordBasedFileManager::findPageAndInsert(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const char *data, unsigned size, RID &rid, const RID *home)
 {
-    return pfm->createFile(fileName);
-}
+    // legacy PAGE_SLOTTED pages need less, they are still found
+    unsigned need = Record::getEncodedSize(recordDescriptor, size) + Record::REC_HEADER_SIZE + DataPage::SLOT_SIZE;
+    if (fileHandle.getPageFormat() == PAGE_PAX)
+    {
+        need = PaxPage::getInsertSize(recordDescriptor, size);
+    }
+    else if (fileHandle.getPageFormat() == PAGE_COMPACT)
+    {
+        need = Record::getEncodedSize(recordDescriptor, size) + (home ? sizeof(RID) : 0) + DataPage::SLOT_SIZE;
+    }
 
-RC RecordBasedFileManager::destroyFile(const string &fileName)
-{
-    return pfm->destroyFile(fileName);
+    // only the page found by free space map is read
+    PageNum pageNum = 0;
+    char *frame = nullptr;
+    while (fileHandle.findFreePage(need, pageNum) == 0)
+    {
+        if (fileHandle.pinPage(pageNum, frame) != 0)
+        {
+            return -1;
+        }
+        DataPage page(frame);
+        if (!page.isValid())
+        {
+            fileHandle.unpinPage(pageNum);
+            return -1;
+        }
+        rid.pageNum = pageNum;
+        // written to the frame directly
+        RC rc = home ? page.insertMoved(recordDescriptor, data, size, *home, rid) : page.insertRecord(recordDescriptor, data, size, rid);
+        if (rc == 0)
+        {
+            shared_ptr<ZoneMap> zoneMap = getZoneMap(fileHandle);
+            if (zoneMap)
+            {
+                zoneMap->widen(pageNum, recordDescriptor, frame, rid.slotNum);
+            }
+            fileHandle.updateDataSize(pageNum, page.getDataSize());
+            return fileHandle.unpinPage(pageNum, true);
+        }
+        // free space map is behind the page, e.g. metadata not flushed before a crash
+        fileHandle.updateDataSize(pageNum, page.getDataSize());
+        fileHandle.unpinPage(pageNum);
+    }
+    return addPageAndInsert(fileHandle, recordDescriptor, data, size, rid, home);
 }
 
-RC RecordBasedFileManager::openFile(const string &fileName, FileHandle &fileHandle)
+RC RecordBasedFileManager::viewRecord(FileHandle &fileHandle, const RID &rid, PageNum &pageNum, Record &record)
 {
-    return pfm->openFile(fileName, fileHandle);
-}
+    const char *frame = nullptr;
+    if (fileHandle.viewPage(rid.pageNum, frame) != 0)
+    {
+        cerr << "read page failed" << endl;
+        return -1;
+    }
+    pageNum = rid.pageNum;
+    if (!DataPage(frame).isValid())
+    {
+        fileHandle.releasePage(pageNum);
+        return -1;
+    }
+    record = DataPage(frame).getRecord(rid.slotNum);
 
-RC RecordBasedFileManager::closeFile(FileHandle &fileHandle)
-{
-    return pfm->closeFile(fileHandle);
+    if (record.ptrFlag == REC_FORWARD)
+    {
+        RID moved = record.getForward();
+        fileHandle.releasePage(pageNum);
+        if (fileHandle.viewPage(moved.pageNum, frame) != 0)
+        {
+            cerr << "read page failed" << endl;
+            return -1;
+        }
+        pageNum = moved.pageNum;
+        if (!DataPage(frame).isValid())
+        {
+            fileHandle.releasePage(pageNum);
+            return -1;
+        }
+        record = DataPage(frame).getRecord(moved.slotNum);
+        // one hop at most
+        if (record.ptrFlag == REC_MOVED && record.rid.pageNum == rid.pageNum && record.rid.slotNum == rid.slotNum)
+        {
+            return 0;
+        }
+        cerr << "broken forwarding pointer" << endl;
+        fileHandle.releasePage(pageNum);
+        return -1;
+    }
+    if (record.ptrFlag != REC_HOME)
+    {
+        // already deleted, or moved here and known by another RID
+        fileHandle.releasePage(pageNum);
+        return -1;
+    }
+    return 0;
 }
 
-RC RecordBasedFileManager::insertRecord(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const void *data, RID &rid)
+RC RecordBasedFileManager::readRecord(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const RID &rid, void *data)
 {
-    // remove all const restriction, void->char & clone
-    vector<Attribute> c_recordDescriptor(recordDescriptor);
-    unsigned dataSize = Record::getRecordSize(recordDescriptor, data);
-    char c_data[dataSize];
-    memcpy(c_data, data, dataSize);
-
-    if (fileHandle.getNumberOfPages() == 0)
+    PageNum pageNum = 0;
+    Record rec(nullptr, 0);
+    if (viewRecord(fileHandle, rid, pageNum, rec) != 0)
+    {
+        return -1;
+    }
+    unsigned size = rec.getRawData(recordDescriptor, static_cast<char *>(data));
+    if (fileHandle.releasePage(pageNum) != 0)
     {
-        return addPageAndInsert(fileHandle, c_recordDescriptor, c_data, rid);
+        return -1;
     }
-    return findPageAndInsert(fileHandle, c_recordDescriptor, c_data, rid);
+    return OverflowPage::expand(fileHandle, recordDescriptor, static_cast<char *>(data), size);
 }
 
-RC RecordBasedFileManager::addPageAndInsert(FileHandle &fileHandle, vector<Attribute> &recordDescriptor, char *data, RID &rid)
+RC RecordBasedFileManager::readRecords(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const vector<RID> &rids, const vector<void *> &data, vector<RC> &rcs)
 {
-    DataPage page(recordDescriptor);
-
-    // append page to get pageNum
-    page.getRawData(buffer);
-    fileHandle.appendPage(buffer);
-    unsigned pageNum = fileHandle.getNumberOfPages() - 1;
-
-    Record *record = new Record(recordDescriptor, data);
-    record->rid.pageNum = pageNum;
-
-    page.appendRecord(record);
-
-    rid = record->rid;
-
-    page.getRawData(buffer);
-    fileHandle.writePage(pageNum, buffer);
+    rcs.assign(rids.size(), -1);
+    vector<pair<RID, unsigned>> targets, forwarded;
+    for (unsigned i = 0; i < rids.size(); i++)
+    {
+        targets.push_back(make_pair(rids[i], i));
+    }
+    if (readSorted(fileHandle, recordDescriptor, targets, rids, data, rcs, &forwarded) != 0 ||
+        readSorted(fileHandle, recordDescriptor, forwarded, rids, data, rcs, nullptr) != 0)
+    {
+        return -1;
+    }
+    // once no page is viewed
+    for (unsigned i = 0; i < rids.size(); i++)
+    {
+        // data of a failed RID is never written
+        if (rcs[i] != 0)
+        {
+            continue;
+        }
+        unsigned size = Record::getRecordSize(recordDescriptor, data[i]);
+        if (OverflowPage::expand(fileHandle, recordDescriptor, static_cast<char *>(data[i]), size) != 0)
+        {
+            return -1;
+        }
+    }
     return 0;
 }
 
-RC RecordBasedFileManager::findPageAndInsert(FileHandle &fileHandle, vector<Attribute> &recordDescriptor, char *data, RID &rid)
+RC RecordBasedFileManager::readSorted(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, vector<pair<RID, unsigned>> &targets, const vector<RID> &rids,
+                                      const vector<void *> &data, vector<RC> &rcs, vector<pair<RID, unsigned>> *forwarded)
 {
-    bool APPEND_ONLY = true;
-
-    Record *record = new Record(recordDescriptor, data);
-    unsigned recordSize = record->sizeWithHeader(recordDescriptor);
-
-    // try last page firstly
-    unsigned pageNum = fileHandle.getNumberOfPages() - 1;
-    fileHandle.readPage(pageNum, buffer);
-    DataPage *lst = new DataPage(recordDescriptor, buffer);
-    DataPage *page = lst;
-
-    // lst can't fit
-    if (lst->getAvailableSize() + recordSize > PAGE_SIZE)
+    sort(targets.begin(), targets.end(), [](const pair<RID, unsigned> &a, const pair<RID, unsigned> &b) {
+        return a.first.pageNum != b.first.pageNum ? a.first.pageNum < b.first.pageNum : a.first.slotNum < b.first.slotNum;
+    });
+    const char *frame = nullptr;
+    for (unsigned i = 0; i < targets.size();)
     {
-        if (APPEND_ONLY)
+        PageNum pageNum = targets[i].first.pageNum;
+        if (pageNum >= fileHandle.getNumberOfPages())
         {
-            delete page;
-            return addPageAndInsert(fileHandle, recordDescriptor, data, rid);
+            // no such records, rcs are left -1
+            break;
         }
-
-        // lst == first? only one page, just do append
-        if (pageNum == 0)
+        if (fileHandle.viewPage(pageNum, frame) != 0)
         {
-            delete lst;
-            return addPageAndInsert(fileHandle, recordDescriptor, data, rid);
+            cerr << "read page failed" << endl;
+            return -1;
         }
-
-        // have other pages
-        pageNum = 0;
-        for (; pageNum < fileHandle.getNumberOfPages() - 1; pageNum++)
+        DataPage page(frame);
+        if (!page.isValid())
         {
-            fileHandle.readPage(pageNum, buffer);
-            delete page;
-            page = new DataPage(recordDescriptor, buffer);
-            if (page->getAvailableSize() + recordSize <= PAGE_SIZE)
+            // records of the page are not read, their rcs are left -1
+            while (i < targets.size() && targets[i].first.pageNum == pageNum)
             {
-                break;
+                i++;
             }
+            fileHandle.releasePage(pageNum);
+            continue;
         }
-
-        // still not found
-        if (pageNum == fileHandle.getNumberOfPages() - 1)
+        for (; i < targets.size() && targets[i].first.pageNum == pageNum; i++)
         {
-            delete page;
-            return addPageAndInsert(fileHandle, recordDescriptor, data, rid);
+            unsigned index = targets[i].second;
+            Record record = page.getRecord(targets[i].first.slotNum);
+            if (forwarded && record.ptrFlag == REC_FORWARD)
+            {
+                forwarded->push_back(make_pair(record.getForward(), index));
+                continue;
+            }
+            // one hop at most, the moved record must be of its home
+            bool home = forwarded ? record.ptrFlag == REC_HOME
+                                  : record.ptrFlag == REC_MOVED && record.rid.pageNum == rids[index].pageNum && record.rid.slotNum == rids[index].slotNum;
+            if (home)
+            {
+                record.getRawData(recordDescriptor, static_cast<char *>(data[index]));
+                rcs[index] = 0;
+            }
         }
-
-        // found, do other thing below
+        fileHandle.releasePage(pageNum);
     }
+    return 0;
+}
 
-    record->rid.pageNum = pageNum;
-    page->insertRecord(record);
-
-    rid = record->rid;
-    page->getRawData(buffer);
-    fileHandle.writePage(pageNum, buffer);
-
-    delete page;
+RC RecordBasedFileManager::printRecord(const vector<Attribute> &recordDescriptor, const void *data)
+{
+    const char *c_data = static_cast<const char *>(data);
+    Record rec(c_data, Record::getRecordSize(recordDescriptor, data));
+    cerr << rec.toString(recordDescriptor);
     return 0;
 }
 
-RC RecordBasedFileManager::readRecord(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const RID &rid, void *data)
+RC RecordBasedFileManager::deleteAt(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const RID &rid)
+{
+    char *frame = nullptr;
+    if (fileHandle.pinPage(rid.pageNum, frame) != 0)
+    {
+        cerr << "read page failed" << endl;
+        return -1;
+    }
+    DataPage page(frame);
+    if (!page.isValid() || page.deleteRecord(rid.slotNum) != 0)
+    {
+        fileHandle.unpinPage(rid.pageNum);
+        return -1;
+    }
+    refreshZone(fileHandle, recordDescriptor, rid.pageNum, frame);
+    fileHandle.updateDataSize(rid.pageNum, page.getDataSize());
+    return fileHandle.unpinPage(rid.pageNum, true);
+}
+
+RC RecordBasedFileManager::deleteRecord(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const RID &rid)
 {
-    if (fileHandle.readPage(rid.pageNum, buffer) != 0)
+    vector<PageNum> chains;
+    if (getOverflow(fileHandle, recordDescriptor, rid, chains) != 0)
+    {
+        return -1;
+    }
+    char *frame = nullptr;
+    if (fileHandle.pinPage(rid.pageNum, frame) != 0)
     {
         cerr << "read page failed" << endl;
         return -1;
     }
 
-    DataPage page(recordDescriptor, buffer);
-    if (rid.slotNum >= page.records.size())
+    DataPage page(frame);
+    if (!page.isValid())
+    {
+        fileHandle.unpinPage(rid.pageNum);
+        return -1;
+    }
+    if (rid.slotNum >= page.getSlotNum())
     {
         cerr << "page.recordNum > rid.slotNum" << endl;
+        fileHandle.unpinPage(rid.pageNum);
         return -1;
     }
 
-    Record *rec = page.records[rid.slotNum];
-    if (rec->ptrFlag == 1)
+    Record rec = page.getRecord(rid.slotNum);
+    if (rec.ptrFlag != REC_HOME && rec.ptrFlag != REC_FORWARD)
     {
-        cerr << "can't deal with record ptr now" << endl;
-        exit(-1);
+        // already deleted, or moved here and known by another RID
+        fileHandle.unpinPage(rid.pageNum);
+        return -1;
+    }
+    if (rec.ptrFlag == REC_FORWARD && deleteAt(fileHandle, recordDescriptor, rec.getForward()) != 0)
+    {
+        fileHandle.unpinPage(rid.pageNum);
+        return -1;
+    }
+
+    page.deleteRecord(rid.slotNum);
+    refreshZone(fileHandle, recordDescriptor, rid.pageNum, frame);
+    fileHandle.updateDataSize(rid.pageNum, page.getDataSize());
+    fileHandle.unpinPage(rid.pageNum, true);
+    return freeOverflow(fileHandle, recordDescriptor, chains);
+}
+
+RC RecordBasedFileManager::moveRecord(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, DataPage &page, const RID &home, const char *data, unsigned size)
+{
+    RID moved;
+    if (findPageAndInsert(fileHandle, recordDescriptor, data, size, moved, &home) != 0)
+    {
+        return -1;
     }
-    if (rec->ptrFlag == 2)
+    if (page.forwardRecord(home.slotNum, moved) != 0)
     {
-        // already deleted
+        // a pointer larger than the record, and no space left for it
+        deleteAt(fileHandle, recordDescriptor, moved);
         return -1;
     }
-    unsigned dataSize = rec->sizeWithoutHeader(recordDescriptor);
-    memcpy(data, rec->data, dataSize);
     return 0;
 }
 
-RC RecordBasedFileManager::printRecord(const vector<Attribute> &recordDescriptor, const void *data)
+RC RecordBasedFileManager::updateRecord(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const void *data, const RID &rid)
 {
-    // remove all const restriction, void->char & clone
-    vector<Attribute> c_recordDescriptor(recordDescriptor);
     unsigned dataSize = Record::getRecordSize(recordDescriptor, data);
-    char c_data[dataSize];
-    memcpy(c_data, data, dataSize);
-
-    Record rec(c_recordDescriptor, c_data);
-    cerr << rec.toString(c_recordDescriptor);
-    return 0;
+    const char *c_data = static_cast<const char *>(data);
+    vector<unsigned> attrs;
+    if (!fitsPage(recordDescriptor, dataSize) && !chooseOverflow(recordDescriptor, c_data, attrs))
+    {
+        cerr << "record excessed PAGE_SIZE" << endl;
+        return -1;
+    }
+    vector<PageNum> oldChains;
+    if (getOverflow(fileHandle, recordDescriptor, rid, oldChains) != 0)
+    {
+        return -1;
+    }
+    // the new values are written before the old ones are freed
+    vector<char> stubbed;
+    vector<PageNum> chains;
+    if (!attrs.empty())
+    {
+        if (moveOutValues(fileHandle, recordDescriptor, c_data, attrs, stubbed, chains) != 0)
+        {
+            return -1;
+        }
+        c_data = stubbed.data();
+        dataSize = stubbed.size();
+    }
+    if (updateStored(fileHandle, recordDescriptor, c_data, dataSize, rid) != 0)
+    {
+        freeOverflow(fileHandle, recordDescriptor, chains);
+        return -1;
+    }
+    return freeOverflow(fileHandle, recordDescriptor, oldChains);
 }
 
-RC RecordBasedFileManager::deleteRecord(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const RID &rid)
+RC RecordBasedFileManager::updateStored(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const char *c_data, unsigned dataSize, const RID &rid)
 {
-    if (fileHandle.readPage(rid.pageNum, buffer) != 0)
+    char *frame = nullptr;
+    if (fileHandle.pinPage(rid.pageNum, frame) != 0)
     {
         cerr << "read page failed" << endl;
         return -1;
     }
-
-    DataPage page(recordDescriptor, buffer);
-    if (rid.slotNum >= page.records.size())
+    DataPage page(frame);
+    if (!page.isValid())
     {
-        cerr << "page.recordNum > rid.slotNum" << endl;
+        fileHandle.unpinPage(rid.pageNum);
+        return -1;
+    }
+    Record rec = page.getRecord(rid.slotNum);
+    if (rec.ptrFlag != REC_HOME && rec.ptrFlag != REC_FORWARD)
+    {
+        // already deleted, or moved here and known by another RID
+        fileHandle.unpinPage(rid.pageNum);
         return -1;
     }
+    bool forwarded = rec.ptrFlag == REC_FORWARD;
+    RID moved;
+    if (forwarded)
+    {
+        moved = rec.getForward();
+    }
 
-    Record *rec = page.records[rid.slotNum];
-    if (rec->ptrFlag == 1)
+    // in place, a moved record comes back home if it fits now
+    if (page.updateRecord(recordDescriptor, rid.slotNum, c_data, dataSize) != 0)
     {
-        cerr << "can't deal with record ptr now" << endl;
-        exit(-1);
+        if (forwarded)
+        {
+            char *movedFrame = nullptr;
+            if (fileHandle.pinPage(moved.pageNum, movedFrame) != 0)
+            {
+                cerr << "read page failed" << endl;
+                fileHandle.unpinPage(rid.pageNum);
+                return -1;
+            }
+            DataPage movedPage(movedFrame);
+            if (!movedPage.isValid())
+            {
+                fileHandle.unpinPage(moved.pageNum);
+                fileHandle.unpinPage(rid.pageNum);
+                return -1;
+            }
+            RC rc = movedPage.updateRecord(recordDescriptor, moved.slotNum, c_data, dataSize);
+            if (rc == 0)
+            {
+                refreshZone(fileHandle, recordDescriptor, moved.pageNum, movedFrame);
+                fileHandle.updateDataSize(moved.pageNum, movedPage.getDataSize());
+            }
+            fileHandle.unpinPage(moved.pageNum, rc == 0);
+            if (rc == 0)
+            {
+                return fileHandle.unpinPage(rid.pageNum);
+            }
+        }
+        // moved again from home, the pointer is replaced
+        if (moveRecord(fileHandle, recordDescriptor, page, rid, c_data, dataSize) != 0)
+        {
+            fileHandle.unpinPage(rid.pageNum);
+            return -1;
+        }
     }
-    if (rec->ptrFlag == 2)
+    // the old moved record is replaced either way
+    if (forwarded)
     {
-        // already deleted
-        return -1;
+        deleteAt(fileHandle, recordDescriptor, moved);
     }
+    refreshZone(fileHandle, recordDescriptor, rid.pageNum, frame);
+    fileHandle.updateDataSize(rid.pageNum, page.getDataSize());
+    return fileHandle.unpinPage(rid.pageNum, true);
+}
 
-    page.deleteRecord(rid.slotNum);
-    page.getRawData(buffer);
-    fileHandle.writePage(rid.pageNum, buffer);
+RC RecordBasedFileManager::readAttribute(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const RID &rid, const string &attributeName, void *data)
+{
+    PageNum pageNum = 0;
+    Record rec(nullptr, 0);
+    if (viewRecord(fileHandle, rid, pageNum, rec) != 0)
+    {
+        return -1;
+    }
+    char *des = static_cast<char *>(data);
+    unsigned size = rec.getAttribute(recordDescriptor, attributeName, des);
+    if (fileHandle.releasePage(pageNum) != 0)
+    {
+        return -1;
+    }
+    // only a VarChar is as long as a stub
+    if (size == OverflowPage::STUB_SIZE && OverflowPage::isStub(des))
+    {
+        return OverflowPage::readValue(fileHandle, des, des);
+    }
     return 0;
 }
 
-RC RecordBasedFileManager::updateRecord(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const void *data, const RID &rid)
+RC RecordBasedFileManager::convertFile(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, unsigned &unconverted)
 {
-    cerr << "can't update." << endl;
-    exit(-1);
-
-    // remove all const restriction, void->char & clone
-    // vector<Attribute> c_recordDescriptor(recordDescriptor);
-    // unsigned dataSize = Record::getRecordSize(recordDescriptor, data);
-    // char c_data[dataSize];
-    // memcpy(c_data, data, dataSize);
-
-    // if (fileHandle.readPage(rid.pageNum, buffer) != 0)
-    // {
-    //     cerr << "read page failed" << endl;
-    //     return -1;
-    // }
-
-    // DataPage page(recordDescriptor, buffer);
-    // if (rid.slotNum >= page.records.size())
-    // {
-    //     cerr << "page.recordNum > rid.slotNum" << endl;
-    //     return -1;
-    // }
-
-    // Record *oldRecord = page.records[rid.slotNum];
-    // Record *newRecord = new Record(recordDescriptor, data);
-
-    // if (oldRecord->ptrFlag == 1)
-    // {
-    //     cerr << "update can't deal with record ptr now" << endl;
-    //     exit(-1);
-    // }
-    // if (oldRecord->ptrFlag == 2)
-    // {
-    //     // already deleted
-    //     return -1;
-    // }
-
-    // // whether can fit the new record
-    // unsigned oldSize = oldRecord->sizeWithHeader(recordDescriptor);
-    // unsigned newSize = newRecord->sizeWithHeader(recordDescriptor);
-
-    // bool canFit = true;
-    // if (newSize > oldSize)
-    // {
-    //     canFit = false;
-    //     if (page.size + newSize - oldSize <= PAGE_SIZE)
-    //     {
-    //         canFit = true;
-    //     }
-    // }
-
-    // if (canFit)
-    // {
-    //     page.updateRecord(rid.slotNum, newRecord);
-    //     return 0;
-    // }
+    unconverted = 0;
+    char *frame = nullptr;
+    char data[PAGE_SIZE];
+    for (PageNum pageNum = 0; pageNum < fileHandle.getNumberOfPages(); pageNum++)
+    {
+        if (fileHandle.pinPage(pageNum, frame) != 0)
+        {
+            return -1;
+        }
+        DataPage page(frame);
+        if (page.getFormat() > PAGE_OVERFLOW)
+        {
+            // no format, its first unsigned is the size of a version 1 page. Records of a file being migrated
+            // are encoded compact at once, less of them are moved out
+            unsigned format = fileHandle.getPageFormat() == PAGE_COMPACT ? PAGE_COMPACT : PAGE_SLOTTED_FIELDS;
+            if (convertV1(fileHandle, recordDescriptor, pageNum, frame, format) != 0)
+            {
+                unconverted++;
+                fileHandle.unpinPage(pageNum);
+                continue;
+            }
+            refreshZone(fileHandle, recordDescriptor, pageNum, frame);
+            fileHandle.updateDataSize(pageNum, page.getDataSize());
+            fileHandle.unpinPage(pageNum, true);
+            continue;
+        }
+        if (page.getFormat() != PAGE_SLOTTED)
+        {
+            fileHandle.unpinPage(pageNum);
+            continue;
+        }
+        // records are moved out from the last slot until the rest fit
+        unsigned slotNum = page.getSlotNum();
+        while (page.convert(recordDescriptor) != 0 && slotNum > 0)
+        {
+            Record record = page.getRecord(--slotNum);
+            if (record.ptrFlag != REC_HOME)
+            {
+                continue;
+            }
+            // copied out, the page is changed by moving
+            unsigned size = record.getRawData(recordDescriptor, data);
+            moveRecord(fileHandle, recordDescriptor, page, record.rid, data, size);
+        }
+        if (page.getFormat() == PAGE_SLOTTED)
+        {
+            unconverted++;
+        }
+        refreshZone(fileHandle, recordDescriptor, pageNum, frame);
+        fileHandle.updateDataSize(pageNum, page.getDataSize());
+        fileHandle.unpinPage(pageNum, true);
+    }
+    return 0;
 }
 
-RC RecordBasedFileManager::readAttribute(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const RID &rid, const string &attributeName, void *data)
+RC RecordBasedFileManager::convertV1(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, PageNum pageNum, char *page, unsigned format)
 {
-    if (fileHandle.readPage(rid.pageNum, buffer) != 0)
+    vector<string> records;
+    vector<unsigned> slots;
+    if (DataPage::readV1(page, recordDescriptor, records) != 0 || DataPage::planV1(format, recordDescriptor, records, slots) != 0)
     {
-        cerr << "read page failed" << endl;
         return -1;
     }
+    // moved out before the page is rewritten, the ones moved are deleted again if one can't be.
+    // The free space map has the page full, it's never chosen
+    map<unsigned, RID> moved;
+    for (unsigned slotNum : slots)
+    {
+        RID home = {pageNum, slotNum}, rid;
+        if (findPageAndInsert(fileHandle, recordDescriptor, records[slotNum].data(), records[slotNum].size(), rid, &home) != 0)
+        {
+            for (auto &target : moved)
+            {
+                deleteAt(fileHandle, recordDescriptor, target.second);
+            }
+            return -1;
+        }
+        moved[slotNum] = rid;
+    }
+    DataPage(page).initV1(format, recordDescriptor, pageNum, records, moved);
+    return 0;
+}
 
-    DataPage page(recordDescriptor, buffer);
-    if (rid.slotNum >= page.records.size())
+RC RecordBasedFileManager::migrateFile(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, unsigned &unconverted)
+{
+    if (fileHandle.getPageFormat() == PAGE_PAX)
     {
-        cerr << "page.recordNum > rid.slotNum" << endl;
         return -1;
     }
+    // records moved out by convertFile() are added compact already
+    fileHandle.setPageFormat(PAGE_COMPACT);
+    if (convertFile(fileHandle, recordDescriptor, unconverted) != 0)
+    {
+        return -1;
+    }
+    char *frame = nullptr;
+    for (PageNum pageNum = 0; pageNum < fileHandle.getNumberOfPages(); pageNum++)
+    {
+        if (fileHandle.pinPage(pageNum, frame) != 0)
+        {
+            return -1;
+        }
+        DataPage page(frame);
+        if (page.getFormat() != PAGE_SLOTTED_FIELDS)
+        {
+            fileHandle.unpinPage(pageNum);
+            continue;
+        }
+        page.convertCompact();
+        fileHandle.updateDataSize(pageNum, page.getDataSize());
+        fileHandle.unpinPage(pageNum, true);
+    }
+    return 0;
+}
 
-    Record *rec = page.records[rid.slotNum];
-
-    if (rec->ptrFlag != 0)
+RC RecordBasedFileManager::vacuumPages(FileHandle &fileHandle, PageNum &pageNum, unsigned maxPages, unsigned &reclaimed)
+{
+    char *frame = nullptr;
+    PageNum end = fileHandle.getNumberOfPages();
+    if (maxPages < end - min(pageNum, end))
     {
-        cerr << "can't deal with record ptr now" << endl;
-        exit(-1);
+        end = pageNum + maxPages;
+    }
+    for (; pageNum < end; pageNum++)
+    {
+        if (fileHandle.pinPage(pageNum, frame) != 0)
+        {
+            return -1;
+        }
+        DataPage page(frame);
+        if (!page.isValid())
+        {
+            fileHandle.unpinPage(pageNum);
+            return -1;
+        }
+        unsigned gained = page.vacuum();
+        if (gained == 0)
+        {
+            fileHandle.unpinPage(pageNum);
+            continue;
+        }
+        reclaimed += gained;
+        fileHandle.updateDataSize(pageNum, page.getDataSize());
+        fileHandle.unpinPage(pageNum, true);
     }
+    return 0;
+}
 
-    rec->getAttribute(recordDescriptor, attributeName, static_cast<char *>(data));
+RC RecordBasedFileManager::vacuumFile(FileHandle &fileHandle, unsigned &reclaimed)
+{
+    reclaimed = 0;
+    PageNum pageNum = 0;
+    while (pageNum < fileHandle.getNumberOfPages())
+    {
+        if (vacuumPages(fileHandle, pageNum, VACUUM_BATCH_PAGES, reclaimed) != 0)
+        {
+            return -1;
+        }
+    }
     return 0;
 }
 
@@ -1209,12 +3903,39 @@ RC RecordBasedFileManager::scan(FileHandle &fileHandle,
                                 const vector<string> &attributeNames,
                                 RBFM_ScanIterator &rbfm_ScanIterator)
 {
-    RBFM_ScanIterator *ret = new RBFM_ScanIterator(&fileHandle,
-                                                   recordDescriptor,
-                                                   conditionAttribute,
-                                                   compOp,
-                                                   static_cast<const char *>(value),
-                                                   attributeNames);
-    rbfm_ScanIterator = *ret;
+    rbfm_ScanIterator.open(&fileHandle,
+                           recordDescriptor,
+                           RBFM_ScanIterator::bindConditions(recordDescriptor, singleCondition(conditionAttribute, compOp, static_cast<const char *>(value))),
+                           attributeNames,
+                           0,
+                           UINT_MAX,
+                           nullptr);
+    return 0;
+}
+
+RC RecordBasedFileManager::scan(FileHandle &fileHandle,
+                                const vector<Attribute> &recordDescriptor,
+                                const vector<vector<ScanCondition>> &conditions,
+                                const vector<string> &attributeNames,
+                                RBFM_ScanIterator &rbfm_ScanIterator)
+{
+    rbfm_ScanIterator.open(&fileHandle,
+                           recordDescriptor,
+                           RBFM_ScanIterator::bindConditions(recordDescriptor, conditions),
+                           attributeNames,
+                           0,
+                           UINT_MAX,
+                           nullptr);
     return 0;
+}
+
+RC RecordBasedFileManager::parallelScan(FileHandle &fileHandle,
+                                        const vector<Attribute> &recordDescriptor,
+                                        const vector<vector<ScanCondition>> &conditions,
+                                        const vector<string> &attributeNames,
+                                        unsigned workerNum,
+                                        bool ordered,
+                                        RBFM_ParallelScanIterator &rbfm_ScanIterator)
+{
+    return rbfm_ScanIterator.open(&fileHandle, recordDescriptor, conditions, attributeNames, workerNum, ordered);
 }
\ No newline at end of file
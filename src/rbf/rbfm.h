@@ -5,6 +5,7 @@
 #include <vector>
 #include <climits>
 #include <cstring>
+#include <memory>
 
 #include "../rbf/pfm.h"
 
@@ -12,6 +13,8 @@ using namespace std;
 
 class Record;
 class DataPage;
+class PaxPage;
+class ZoneMap;
 class RecordBasedFileManager;
 
 typedef struct
@@ -43,23 +46,258 @@ typedef enum { EQ_OP = 0, // =
 } CompOp;
 
 #define RBFM_EOF (-1) // end of a scan operator
+#define RBFM_SCAN_ERROR (-2) // a value of a scan operator can't be read, the scan is ended
+
+/**
+ * # of pages a scan reads by one FileHandle::readPages()
+ * Aka 128 KB
+ */
+#define SCAN_CHUNK_PAGES 32
+
+/**
+ * # of pages a worker of a parallel scan takes at a time
+ * Aka 256 KB
+ */
+#define MORSEL_PAGES 64
+
+// # of pages RecordBasedFileManager::insertRecords() packs and appends by one FileHandle::appendPages()
+#define INSERT_CHUNK_PAGES 32
+
+// # of pages RecordBasedFileManager::vacuumFile() compacts by one vacuumPages()
+#define VACUUM_BATCH_PAGES 64
+
+// first unsigned of a data page
+typedef enum { PAGE_EMPTY = 0,         // zero page by FileHandle::reservePages(), never written
+               PAGE_SLOTTED = 1,       // records are raw data, see RecordBasedFileManager::convertFile()
+               PAGE_SLOTTED_FIELDS = 2, // records have field tables, see DataPage
+               PAGE_PAX = 3,            // attributes in column minipages, see PaxPage
+               PAGE_COMPACT = 4,        // PAGE_SLOTTED_FIELDS without record headers, see DataPage
+               PAGE_OVERFLOW = 5        // part of a VarChar kept out of its record, see OverflowPage
+} PageFormat;
+
+// Record::ptrFlag
+typedef enum { REC_HOME = 0,    // at its own RID
+               REC_FORWARD = 1, // forwarding pointer, data is the RID the record is moved to
+               REC_DELETED = 2, // never stored
+               REC_MOVED = 3    // moved here by RecordBasedFileManager::updateRecord(), rid is its own RID
+} RecordFlag;
+
+// Order of two attribute values as in a record, VarChar is [size][chars]: <0, 0, >0
+template <AttrType T>
+struct AttrCompare;
+
+template <>
+struct AttrCompare<TypeInt>
+{
+    static int compare(const char *a, const char *b)
+    {
+        int x = 0, y = 0;
+        memcpy(&x, a, sizeof(int));
+        memcpy(&y, b, sizeof(int));
+        return x < y ? -1 : (x > y ? 1 : 0);
+    }
+};
+
+template <>
+struct AttrCompare<TypeReal>
+{
+    static int compare(const char *a, const char *b)
+    {
+        float x = 0, y = 0;
+        memcpy(&x, a, sizeof(float));
+        memcpy(&y, b, sizeof(float));
+        if (x - y < 0.001 && y - x < 0.001)
+        {
+            return 0;
+        }
+        return x < y ? -1 : 1;
+    }
+};
+
+template <>
+struct AttrCompare<TypeVarChar>
+{
+    static int compare(const char *a, const char *b)
+    {
+        unsigned x = 0, y = 0;
+        memcpy(&x, a, sizeof(unsigned));
+        memcpy(&y, b, sizeof(unsigned));
+        int res = memcmp(a + sizeof(unsigned), b + sizeof(unsigned), x < y ? x : y);
+        if (res != 0)
+        {
+            return res;
+        }
+        return x < y ? -1 : (x > y ? 1 : 0);
+    }
+};
+
+typedef int (*AttrComparator)(const char *a, const char *b);
+
+// "attribute compOp value" compiled once for the attribute type, no type switch per record
+class Predicate
+{
+  public:
+    virtual ~Predicate() {}
+    // attr is a non-null attribute as in a record
+    virtual bool eval(const char *attr) const = 0;
+    // whether some attribute in [min, max] may meet it, false only if none can
+    virtual bool mayMeet(const char *min, const char *max) const = 0;
+
+    // nullptr for NO_OP; value is copied
+    static Predicate *compile(AttrType type, CompOp compOp, const void *value);
+    static AttrComparator getComparator(AttrType type);
+};
+
+template <AttrType T, CompOp Op>
+class TypedPredicate : public Predicate
+{
+    vector<char> value;
+
+  public:
+    TypedPredicate(const char *value, unsigned size)
+        : value(value, value + size)
+    {
+    }
+
+    bool eval(const char *attr) const
+    {
+        int res = AttrCompare<T>::compare(attr, value.data());
+        // Op is a constant, one case is left
+        switch (Op)
+        {
+        case EQ_OP:
+            return res == 0;
+        case LT_OP:
+            return res < 0;
+        case LE_OP:
+            return res <= 0;
+        case GT_OP:
+            return res > 0;
+        case GE_OP:
+            return res >= 0;
+        case NE_OP:
+            return res != 0;
+        case NO_OP:
+            return true;
+        }
+        return true;
+    }
+
+    bool mayMeet(const char *min, const char *max) const
+    {
+        switch (Op)
+        {
+        case EQ_OP:
+            return AttrCompare<T>::compare(min, value.data()) <= 0 && AttrCompare<T>::compare(max, value.data()) >= 0;
+        case LT_OP:
+            return AttrCompare<T>::compare(min, value.data()) < 0;
+        case LE_OP:
+            return AttrCompare<T>::compare(min, value.data()) <= 0;
+        case GT_OP:
+            return AttrCompare<T>::compare(max, value.data()) > 0;
+        case GE_OP:
+            return AttrCompare<T>::compare(max, value.data()) >= 0;
+        case NE_OP:
+            return AttrCompare<T>::compare(min, value.data()) != 0 || AttrCompare<T>::compare(max, value.data()) != 0;
+        case NO_OP:
+            return true;
+        }
+        return true;
+    }
+};
+
+// "attribute compOp value" of a scan, value as an attribute in a record
+struct ScanCondition
+{
+    string attribute;
+    CompOp compOp;
+    const void *value;
+};
+
+// FixedRecord: records of TypeInt and TypeReal attributes only. With no null every attribute is FIELD_SIZE bytes
+// at a fixed offset, raw: [NullIndicator][Attr 0]...[Attr n - 1], Encoded: [NullIndicator][FieldEnd]...[Attr 0]...[Attr n - 1].
+// Offsets are taken once per descriptor; a record with a null, or of a descriptor with a VarChar, is read by Record
+template <bool Encoded>
+class FixedRecord
+{
+    unsigned attrNum;
+    unsigned nullSize;
+    // offset of Attr 0
+    unsigned fieldsOffset;
+    // null bits of the last null indicator byte, padding bits are left out
+    unsigned char lastMask;
+
+  public:
+    const static unsigned FIELD_SIZE = 4;
+
+    static bool isFixed(const vector<Attribute> &recordDescriptor);
+
+    // applies to no record
+    FixedRecord();
+    FixedRecord(const vector<Attribute> &recordDescriptor);
+    // data can be read by this: the descriptor is fixed and data has no null
+    bool applies(const char *data) const;
+    // size of data with no null
+    unsigned getSize() const;
+    const char *view(const char *data, unsigned attr) const;
+    // raw data of attrs, ascending, as Record::attributeProject()
+    unsigned project(const char *data, const vector<unsigned> &attrs, char *des) const;
+    // raw data of attrs, ascending, as Record::attributeProjectCompress() of projectedNum names; des may be data itself
+    unsigned projectCompress(const char *data, const vector<unsigned> &attrs, unsigned projectedNum, char *des) const;
+};
 
 class RBFM_ScanIterator
 {
   public:
+    // a condition compiled against recordDescriptor
+    struct BoundPredicate
+    {
+        unsigned attr;
+        // shared by parallel scan workers
+        shared_ptr<Predicate> predicate;
+    };
+
+    struct Stats
+    {
+        // pages read and looked at
+        unsigned pagesScanned;
+        // pages passed over by the zone map without reading
+        unsigned pagesSkipped;
+    };
+
     FileHandle *fileHandle;
     vector<Attribute> recordDescriptor;
-    Attribute conditionAttribute;
-    // the standard size will be vcSize + sizeof(unsigned)
-    unsigned vcSize;
-    CompOp compOp;
-    // for TypeVarChar, its still contains the size [size][data]
-    char *value;
+    // a record meets all predicates of any group; no group if there is no condition
+    vector<vector<BoundPredicate>> groups;
     vector<string> attributeNames;
+    // index of attributeNames in recordDescriptor, ascending
+    vector<unsigned> projectedAttrs;
     unsigned nextPn;
     unsigned nextSn;
-    DataPage *currPg;
-    char buffer[PAGE_SIZE];
+    // pages from it are not scanned, UINT_MAX to the end of file
+    unsigned endPn;
+    // a page is being scanned, it's in chunk at nextPn - 1; none before the first getNextBatch()
+    bool onPage;
+    // pages [chunkStart, chunkStart + chunkPages) read ahead, a copy of the viewed page if fileHandle is inPlace()
+    vector<char> chunk;
+    unsigned chunkStart;
+    unsigned chunkPages;
+    // registered to Prefetcher, -1 if not
+    int prefetchId;
+    // held while reading pages if fileHandle can't be read by several threads at once, see RBFM_ParallelScanIterator
+    mutex *readLatch;
+    // of the file when the scan is made, nullptr if it has none or it's of another recordDescriptor
+    shared_ptr<ZoneMap> zoneMap;
+    // since the scan is made, across setRange()
+    Stats stats;
+    // a VarChar of a condition read from its overflow pages
+    vector<char> overflowValue;
+    // rows may have stubs to expand
+    bool projectsVarChar;
+    // a page or a value of its overflow pages couldn't be read, see getNextBatch()
+    bool failed;
+    // records of an all fixed-width recordDescriptor with no null are read at fixed offsets
+    FixedRecord<true> fixedRecord;
 
     RBFM_ScanIterator();
     RBFM_ScanIterator(
@@ -69,12 +307,210 @@ class RBFM_ScanIterator
         const CompOp compOp,
         const char *value,
         const vector<string> attributeNames);
+    RBFM_ScanIterator(
+        FileHandle *fileHandle,
+        const vector<Attribute> recordDescriptor,
+        const vector<vector<ScanCondition>> &conditions,
+        const vector<string> attributeNames);
+    // pages [firstPage, endPage) only, with conditions bound already
+    RBFM_ScanIterator(
+        FileHandle *fileHandle,
+        const vector<Attribute> recordDescriptor,
+        const vector<vector<BoundPredicate>> &groups,
+        const vector<string> attributeNames,
+        PageNum firstPage,
+        PageNum endPage,
+        mutex *readLatch);
     ~RBFM_ScanIterator();
 
+    // start over as the scan of the constructor of the same arguments, a scan made before is closed
+    void open(FileHandle *fileHandle,
+              const vector<Attribute> &recordDescriptor,
+              const vector<vector<BoundPredicate>> &groups,
+              const vector<string> &attributeNames,
+              PageNum firstPage,
+              PageNum endPage,
+              mutex *readLatch);
+    // compile conditions against recordDescriptor, NO_OP conditions are dropped
+    static vector<vector<BoundPredicate>> bindConditions(const vector<Attribute> &recordDescriptor, const vector<vector<ScanCondition>> &conditions);
+    // scan pages [firstPage, endPage) from the start, endPage is clamped to the file
+    void setRange(PageNum firstPage, PageNum endPage);
+
+    RC getNextRecord(RID &rid, void *data);
+    // up to maxRows projected records packed one after another in buf, their RIDs in rids,
+    // and the end offset of each in buf if ends is given.
+    // buf must hold maxRows * getMaxRowSize() bytes; RBFM_EOF if no record is left.
+    // RBFM_SCAN_ERROR if a page or a VarChar of its overflow pages can't be read, rows of the batch are
+    // dropped and the scan is ended
+    RC getNextBatch(RID *rids, void *buf, unsigned maxRows, unsigned &rows, unsigned *ends = nullptr);
+    // largest projected record by the lengths in recordDescriptor
+    unsigned getMaxRowSize();
+    // pages the zone map shows no row of can meet the conditions are skipped, not read;
+    // -1 if the page can't be read
+    RC getNextPage();
+    const char *currentPage();
+    RC close();
+    Stats getStats();
+    // record is not deleted nor a forwarding pointer, and meets the conditions
+    bool match(Record &record);
+    // match() of a row of a PAGE_PAX page, only the minipages of the conditions are read
+    bool match(PaxPage &page, unsigned row);
+
+  private:
+    // the groups are met by the attributes given by view(attr), nullptr if null
+    template <typename View>
+    bool meetGroups(View view);
+    bool skipPage(PageNum pageNum);
+    // value of attr, read from its overflow pages if it's a stub; nullptr and failed if it can't be read
+    const char *loadValue(const char *value, unsigned attr);
+    // OverflowPage::expand() of a projected row
+    RC expandRow(char *row, unsigned &size);
+    // end the scan, return RBFM_SCAN_ERROR
+    RC fail();
+};
+
+/*
+ * A scan split into morsels of MORSEL_PAGES pages, taken in page order by a pool of worker threads.
+ * Each worker runs an RBFM_ScanIterator on its morsel, conditions and projection included, and queues
+ * the rows of the whole morsel. At most 2 morsels per worker are queued and not taken yet.
+ * Rows come in the order of RBFM_ScanIterator if ordered, else morsel by morsel as they are done.
+ * The file must not be changed until close().
+ */
+class RBFM_ParallelScanIterator
+{
+    struct Morsel
+    {
+        vector<RID> rids;
+        vector<char> rows;
+        // end offset of each row in rows
+        vector<unsigned> ends;
+        // the scan of the morsel is ended by RBFM_SCAN_ERROR after rows
+        bool failed;
+    };
+
+    FileHandle *fileHandle;
+    vector<Attribute> recordDescriptor;
+    vector<vector<RBFM_ScanIterator::BoundPredicate>> groups;
+    vector<string> attributeNames;
+    bool ordered;
+    unsigned maxRowSize;
+    // morsels queued and not taken yet, or being queued
+    unsigned maxPending;
+
+    vector<thread> workers;
+    mutex latch;
+    // signaled when a morsel is queued
+    condition_variable queued;
+    // signaled when a morsel is taken, or closing
+    condition_variable taken;
+    // morsel index -> its rows
+    map<unsigned, Morsel> results;
+    unsigned morselNum;
+    unsigned nextMorsel;
+    unsigned takenNum;
+    bool closing;
+    // passed to the workers if the file can't be read by several threads at once
+    mutex readLatch;
+    // of the workers, added up as each is done
+    RBFM_ScanIterator::Stats stats;
+
+    // morsel being returned, its rows before nextRow are returned
+    Morsel current;
+    unsigned nextRow;
+
+    void work();
+    // wait for the next morsel into current, false if all are taken
+    bool takeMorsel();
+
+  public:
+    RBFM_ParallelScanIterator();
+    ~RBFM_ParallelScanIterator();
+
+    // start workerNum threads, see RecordBasedFileManager::scan() for conditions
+    RC open(FileHandle *fileHandle,
+            const vector<Attribute> &recordDescriptor,
+            const vector<vector<ScanCondition>> &conditions,
+            const vector<string> &attributeNames,
+            unsigned workerNum,
+            bool ordered);
+
     RC getNextRecord(RID &rid, void *data);
-    void getNextPage();
+    // see RBFM_ScanIterator::getNextBatch()
+    RC getNextBatch(RID *rids, void *buf, unsigned maxRows, unsigned &rows);
+    unsigned getMaxRowSize();
+    // stop and join the workers
     RC close();
-    int compareTo(char *thatVal);
+    // complete once all rows are returned or after close()
+    RBFM_ScanIterator::Stats getStats();
+};
+
+/*
+ * Per page row count, and min, max and null count of each TypeInt and TypeReal attribute,
+ * kept in "<data file>.zone" so a scan skips pages none of whose rows can meet its conditions.
+ * A page is refreshed from its content whenever RecordBasedFileManager changes it; a zone only grows
+ * by an insert and is recomputed by a delete or update. The zone file is loaded by the first
+ * RecordBasedFileManager::openFile() of the data file and saved by the last closeFile(). It's dropped
+ * if the data file was written without it, e.g. through PagedFileManager or a crash.
+ * ZoneFile: [DataWrites][AttrNum][PageNum][Types]...[Entry 0]...[Entry PageNum - 1]
+ * Entry: [RowNum]([Min][Max][NullCount] per tracked attribute), RowNum is UNKNOWN_ROWS if the page has no zone
+ */
+class ZoneMap
+{
+    FileIO *io;
+    // of the recordDescriptor, empty until a page is refreshed
+    vector<AttrType> types;
+    // index of each attribute among the tracked ones, -1 if not tracked
+    vector<int> tracked;
+    unsigned trackedNum;
+    // Predicate::getComparator() of each attribute, taken once by setTypes()
+    vector<AttrComparator> comparators;
+    // one entry per page, pages after them have no zone
+    vector<char> entries;
+    // entries from it to write by save()
+    PageNum dirtyStart;
+    // held by the public calls but load(), pages are written while scans read the zones
+    mutex latch;
+
+    ZoneMap(FileIO *io);
+    unsigned getEntrySize();
+    unsigned getPageNum();
+    // entry of pageNum, entries are added up to it
+    char *getEntry(PageNum pageNum);
+    // start over for recordDescriptor if the zones are of another one
+    void setTypes(const vector<Attribute> &recordDescriptor);
+    // count a live row, its attributes given by view(attr), nullptr if null
+    template <typename View>
+    void addRow(char *entry, View view);
+    // addRow() of the slot if it's a live row
+    void addSlot(char *entry, const vector<Attribute> &recordDescriptor, const char *page, unsigned slotNum);
+    // matches() and refresh() with the latch held
+    bool sameTypes(const vector<Attribute> &recordDescriptor);
+    void recompute(PageNum pageNum, const vector<Attribute> &recordDescriptor, const char *page);
+
+  public:
+    static const unsigned UNKNOWN_ROWS;
+    static const unsigned ZONE_HEADER_SIZE;
+    static const unsigned ZONE_SIZE;
+
+    ~ZoneMap();
+    static string getZoneFileName(const string &fileName);
+    // empty zone file of data file fileName, replacing any; dataWrites: see load()
+    static RC create(const string &fileName, uint64_t dataWrites);
+    // nullptr if there is no valid zone file, or it's not saved after the dataWrites-th
+    // page write or append of the data file; it's marked not saved until save()
+    static shared_ptr<ZoneMap> load(const string &fileName, uint64_t dataWrites);
+    RC save(uint64_t dataWrites);
+
+    // zones are of recordDescriptor
+    bool matches(const vector<Attribute> &recordDescriptor);
+    // recompute the zone of pageNum from its content
+    void refresh(PageNum pageNum, const vector<Attribute> &recordDescriptor, const char *page);
+    // recompute the zone of pageNum from its rowNum rows, values[row * attrs + attr] as by Record::encode()
+    void refresh(PageNum pageNum, const vector<Attribute> &recordDescriptor, const char *const *values, unsigned rowNum);
+    // slotNum of the page is inserted, other rows are not changed
+    void widen(PageNum pageNum, const vector<Attribute> &recordDescriptor, const char *page, unsigned slotNum);
+    // no row of pageNum can meet any group
+    bool excludes(PageNum pageNum, const vector<vector<RBFM_ScanIterator::BoundPredicate>> &groups);
 };
 
 class Record
@@ -83,58 +519,379 @@ class Record
     static unsigned getRecordSize(const vector<Attribute> &recordDescriptor, const void *rawData);
     // return null indicator original size in record
     static unsigned parseNullIndicator(bool nullIndicators[], const vector<Attribute> &recordDescriptor, const void *rawData);
+    // raw data to [NullIndicator][FieldEnd]...[Fields], return its size; 0 if it's larger than limit, des is left zeroed.
+    // values[attr] is set to the field of attr in rawData if given, nullptr if null
+    static unsigned encode(const vector<Attribute> &recordDescriptor, const void *rawData, char *des, const char **values = nullptr,
+                           unsigned limit = UINT_MAX);
+    static unsigned getEncodedSize(const vector<Attribute> &recordDescriptor, unsigned rawSize);
+    // indexes of attributeNames in recordDescriptor, ascending
+    static void getAttributeIndexes(const vector<Attribute> &recordDescriptor, const vector<string> &attributeNames, vector<unsigned> &attrs);
     const static string RECORD_HEAD;
     const static unsigned REC_HEADER_SIZE;
+    // FieldEnd: end offset of a field in the encoded record, == its start if null
+    const static unsigned FIELD_END_SIZE;
 
-    // 0: not a ptr
-    // 1: is a ptr
-    // 2: is deleted
-    // -1: unset! which can never happen if correct
+    // RecordFlag
     int ptrFlag;
 
     // check whether rid is original rid in upper level
     RID rid;
-    char *data;
+    // not owned: in place in a page or the caller's, unless kept by owned. NULL if deleted
+    const char *data;
+    unsigned size;
+    // data is encoded with field table, any field is found in O(1); else it's raw data and fields are walked
+    bool encoded;
+    // data assembled out of a page, e.g. by PaxPage::getRecord(), shared by the copies
+    shared_ptr<vector<char>> owned;
 
-    Record(vector<Attribute> recordDescriptor, const char *rawData);
-    ~Record();
+    // view of size bytes of data, ptrFlag = 0
+    Record(const char *data, unsigned size, bool encoded = false);
 
-    // if deleted, size will be REC_HEADER_SIZE (data = NULL, ptrFlag = 2, rid = rid)
-    // if pointered(moved), size will be REC_HEADER_SIZE (data = NULL, ptrFlg = 1, rid = new rid)
-    unsigned sizeWithoutHeader(const vector<Attribute> &recordDescriptor);
-    unsigned sizeWithHeader(const vector<Attribute> &recordDescriptor);
+    // if deleted, size will be 0 (data = NULL, ptrFlag = REC_DELETED)
+    unsigned sizeWithoutHeader();
+    unsigned sizeWithHeader();
 
     string toString(const vector<Attribute> &recordDescriptor);
-    
+    // ptrFlag = REC_FORWARD
+    RID getForward();
+    bool isNull(unsigned attr);
+    // copy as raw data, return its size
+    unsigned getRawData(const vector<Attribute> &recordDescriptor, char *des);
+
     // return attribute actual data size
     unsigned getAttribute(const vector<Attribute> &recordDescriptor, const string &attributeName, char *des);
-    
+    unsigned getAttribute(const vector<Attribute> &recordDescriptor, unsigned attr, char *des);
+    // attribute in place, nullptr if null
+    const char *viewAttribute(const vector<Attribute> &recordDescriptor, unsigned attr);
+
     // return projected data size
     unsigned attributeProject(const vector<Attribute> &recordDescriptor, const vector<string> attributeNames, char *des);
+    // attrs: indexes from getAttributeIndexes()
+    unsigned attributeProject(const vector<Attribute> &recordDescriptor, const vector<unsigned> &attrs, char *des);
     unsigned attributeProjectCompress(const vector<Attribute> &recordDescriptor, const vector<string> attributeNames, char *des);
+
+  private:
+    // [start, end) of non-null attribute attr in data.
+    // For raw data, attributes must be asked in order, cursor is where the walk is
+    void getField(const vector<Attribute> &recordDescriptor, unsigned attr, unsigned &cursor, unsigned &start, unsigned &end);
 };
 
-// DataPage: [Size][RecordNum][Records Data]...
-// Record: ["Rec:"][ptrFlag][RID][Raw Data]
+template <bool Encoded>
+bool FixedRecord<Encoded>::isFixed(const vector<Attribute> &recordDescriptor)
+{
+    for (const Attribute &attr : recordDescriptor)
+    {
+        if (attr.type == TypeVarChar)
+        {
+            return false;
+        }
+    }
+    return !recordDescriptor.empty();
+}
+
+template <bool Encoded>
+FixedRecord<Encoded>::FixedRecord()
+    : attrNum(0), nullSize(0), fieldsOffset(0), lastMask(0)
+{
+}
+
+template <bool Encoded>
+FixedRecord<Encoded>::FixedRecord(const vector<Attribute> &recordDescriptor)
+    : FixedRecord()
+{
+    if (!isFixed(recordDescriptor))
+    {
+        return;
+    }
+    attrNum = recordDescriptor.size();
+    nullSize = (attrNum - 1) / 8 + 1;
+    fieldsOffset = Encoded ? nullSize + attrNum * Record::FIELD_END_SIZE : nullSize;
+    lastMask = attrNum % 8 ? 0xFF << (8 - attrNum % 8) : 0xFF;
+}
+
+template <bool Encoded>
+bool FixedRecord<Encoded>::applies(const char *data) const
+{
+    if (attrNum == 0)
+    {
+        return false;
+    }
+    for (unsigned i = 0; i + 1 < nullSize; i++)
+    {
+        if (data[i])
+        {
+            return false;
+        }
+    }
+    return !(data[nullSize - 1] & lastMask);
+}
+
+template <bool Encoded>
+unsigned FixedRecord<Encoded>::getSize() const
+{
+    return fieldsOffset + attrNum * FIELD_SIZE;
+}
+
+template <bool Encoded>
+const char *FixedRecord<Encoded>::view(const char *data, unsigned attr) const
+{
+    return data + fieldsOffset + attr * FIELD_SIZE;
+}
+
+template <bool Encoded>
+unsigned FixedRecord<Encoded>::project(const char *data, const vector<unsigned> &attrs, char *des) const
+{
+    // attributes not projected are null, remain bits are 0
+    memset(des, 0xFF, nullSize);
+    des[nullSize - 1] &= lastMask;
+    unsigned desOffset = nullSize;
+    // runs of adjacent attributes are copied at once
+    for (unsigned i = 0, run = 1; i < attrs.size(); i += run)
+    {
+        for (run = 1; i + run < attrs.size() && attrs[i + run] == attrs[i] + run; run++)
+        {
+        }
+        for (unsigned j = i; j < i + run; j++)
+        {
+            des[attrs[j] / 8] &= (char)~(0x80 >> (attrs[j] % 8));
+        }
+        memcpy(des + desOffset, view(data, attrs[i]), run * FIELD_SIZE);
+        desOffset += run * FIELD_SIZE;
+    }
+    return desOffset;
+}
+
+template <bool Encoded>
+unsigned FixedRecord<Encoded>::projectCompress(const char *data, const vector<unsigned> &attrs, unsigned projectedNum, char *des) const
+{
+    // fields only move to the front, data has no null so its indicator can be overwritten first
+    unsigned compressNISize = (projectedNum - 1) / 8 + 1;
+    memset(des, 0, compressNISize);
+    unsigned desOffset = compressNISize;
+    for (unsigned i = 0, run = 1; i < attrs.size(); i += run)
+    {
+        for (run = 1; i + run < attrs.size() && attrs[i + run] == attrs[i] + run; run++)
+        {
+        }
+        memmove(des + desOffset, view(data, attrs[i]), run * FIELD_SIZE);
+        desOffset += run * FIELD_SIZE;
+    }
+    return desOffset;
+}
+
+// DataPage: [Format][SlotNum][FreeOffset][FreeSlot][FreeSize][Records Data]...free...[Slot SlotNum - 1]...[Slot 0]
+// Slot: [Offset][Length], Length is 0 if deleted and Offset is then the next deleted slot + 1, 0 for the last one.
+// FreeSlot: first deleted slot + 1, 0 if none; FreeSize: free bytes, holes of deleted records included
+// Record: ["Rec:"][ptrFlag][RID][NullIndicator][FieldEnd]...[Fields], see Record::encode()
+// Record of PAGE_SLOTTED: ["Rec:"][ptrFlag][RID][Raw Data]
+// PAGE_COMPACT: Slot: [Offset][ptrFlag << 14 | Length], Record: [NullIndicator][FieldEnd]...[Fields],
+// the RID is kept only by a REC_MOVED record, before its NullIndicator; a REC_FORWARD record is the RID it's moved to
+// A view of the page in place, records are never copied out unless asked.
+// Calls on a PAGE_PAX page are passed to PaxPage, getBodySize() and canFit() are of slotted pages only.
+// A PAGE_OVERFLOW page is full and has no slot
 class DataPage
 {
+    char *page;
+
+    unsigned getHeader(unsigned i);
+    void setHeader(unsigned i, unsigned value);
+    void getSlot(unsigned slotNum, unsigned &offset, unsigned &length);
+    // ptrFlag is kept by the slot on PAGE_COMPACT pages only
+    void setSlot(unsigned slotNum, unsigned offset, unsigned length, int ptrFlag = REC_HOME);
+    // ptrFlag of a slot of a PAGE_COMPACT page
+    int getSlotFlag(unsigned slotNum);
+    // bytes before the body of a record of ptrFlag
+    unsigned getHeaderSize(int ptrFlag);
+    unsigned getFreeSlot();
+    // unlink deleted slotNum from the free slot chain, it's about to be written
+    void takeFreeSlot(unsigned slotNum);
+    // FreeSlot and FreeSize from the slots, after slots are rewritten
+    void recount();
+    // encode as the page format into slotNum
+    RC writeRecord(const vector<Attribute> &recordDescriptor, unsigned slotNum, const char *rawData, unsigned rawSize, int ptrFlag, const RID &owner);
+    // body is what follows the record header. slotNum is new, deleted or replaced; -1 if can't fit
+    RC writeBody(unsigned slotNum, const char *body, unsigned bodySize, int ptrFlag, const RID &owner);
+
   public:
     const static unsigned DATA_PAGE_HEADER_SIZE;
-    vector<Record *> records;
-    vector<Attribute> recordDescriptor;
+    const static unsigned SLOT_SIZE;
+
+    DataPage(char *page);
+    // read only, no modifying call may be made
+    DataPage(const char *page);
+    // the page is of a known PageFormat; no other call may be made on a page that is not
+    bool isValid();
+
+    // format the page as an empty PAGE_SLOTTED_FIELDS page
+    void init();
+    // empty page of format, PAGE_SLOTTED_FIELDS if it's PAGE_EMPTY
+    void init(unsigned format, const vector<Attribute> &recordDescriptor);
+    unsigned getFormat();
+    unsigned getSlotNum();
+    // ptrFlag = 2 if deleted or slotNum is out of page
+    Record getRecord(unsigned slotNum);
+    // bytes used by page header, records and slots
+    unsigned getDataSize();
+    // free bytes, holes of deleted records included
+    unsigned getFreeSize();
+    // record body of rawSize bytes raw data in this page
+    unsigned getBodySize(const vector<Attribute> &recordDescriptor, unsigned rawSize);
+    bool canFit(unsigned bodySize);
+    // encode as the page format, reuse a deleted slot or add one, rid.pageNum must be set; -1 if can't fit
+    RC insertRecord(const vector<Attribute> &recordDescriptor, const char *rawData, unsigned rawSize, RID &rid);
+    // insertRecord() of records from the first, each adding a slot, until one can't fit; # of records appended, their
+    // rids are set as of pageNum. For pages filled from init() without deletes; values[i * attrs + attr] as by
+    // Record::encode(), not set for PAGE_PAX
+    unsigned appendRecords(const vector<Attribute> &recordDescriptor, const void *const *records, unsigned recordNum,
+                           PageNum pageNum, RID *rids, const char **values = nullptr);
+    // REC_MOVED record of home
+    RC insertMoved(const vector<Attribute> &recordDescriptor, const char *rawData, unsigned rawSize, const RID &home, RID &rid);
+    // in place of the record or its forwarding pointer; -1 if can't fit, page is unchanged
+    RC updateRecord(const vector<Attribute> &recordDescriptor, unsigned slotNum, const char *rawData, unsigned rawSize);
+    // replace the record by a REC_FORWARD one to target; -1 if can't fit
+    RC forwardRecord(unsigned slotNum, const RID &target);
+    RC deleteRecord(unsigned slotNum);
+    // move records to the front, free space becomes continuous, slot numbers are kept
+    void compact();
+    // compact() if there are holes and drop trailing deleted slots, no RID is left on them.
+    // Return the continuous free bytes gained, 0 if the page is unchanged
+    unsigned vacuum();
+    // PAGE_SLOTTED to PAGE_SLOTTED_FIELDS in place, slot numbers are kept; -1 if records can't fit anymore
+    RC convert(const vector<Attribute> &recordDescriptor);
+    // PAGE_SLOTTED_FIELDS to PAGE_COMPACT in place, slot numbers are kept. Records only shrink, holes are compacted
+    void convertCompact();
+
+    // Page of a version 1 file (see PFM_VERSION): [Size][RecordNum][Records], Size counts the header too.
+    // Record: ["Rec:"][ptrFlag][RID][Raw Data], ptrFlag is REC_HOME or REC_DELETED, a deleted record has no data.
+    // Raw data of its records by slot number, empty if deleted, trailing deleted slots are dropped;
+    // -1 if it's not such a page of recordDescriptor
+    static RC readV1(const char *page, const vector<Attribute> &recordDescriptor, vector<string> &records);
+    // slots of the records to move out, the largest first, for the rest and forwarding pointers in place of the
+    // moved to fit a page of format; -1 if they can't
+    static RC planV1(unsigned format, const vector<Attribute> &recordDescriptor, const vector<string> &records, vector<unsigned> &moved);
+    // the page as of format with records at their slots of pageNum, those in moved as forwarding pointers to
+    // moved[slotNum]. records must fit as planned by planV1()
+    void initV1(unsigned format, const vector<Attribute> &recordDescriptor, PageNum pageNum, const vector<string> &records,
+                const map<unsigned, RID> &moved);
+};
 
-    // this is a DUP data, same as SUM(records.forEach.size())
-    unsigned size;
+// PaxPage: [Format][RowNum][HeapOffset][Capacity][AttrNum][AttrType]...(to 4 bytes)
+//          [Column 0]...[Column AttrNum - 1][NullIndicators][Aux][Flags]...free...[Heap]
+// Each minipage has Capacity entries, one per row, a row is the record of slot row:
+// Column: 4 bytes per row, Int and Real in place, VarChar the heap offset of its [size][chars]; 0 if null
+// NullIndicators: as in raw data; Aux: unsigned short heap offset of the RID of a REC_FORWARD or REC_MOVED row, else 0;
+// Flags: a RecordFlag byte. The heap grows down from the page end, space of deleted values waits for compact()
+// Rows are added by rebuilding the page with a larger capacity when the minipages are full.
+// Attribute types are kept in the page, a page of another descriptor is never written
+class PaxPage
+{
+    char *page;
+    unsigned attrNum;
+    unsigned capacity;
+    // header with attribute types, null indicator of a row, all minipage entries of a row
+    unsigned headerSize;
+    unsigned nullSize;
+    unsigned rowSize;
+
+    unsigned getHeader(unsigned i);
+    void setHeader(unsigned i, unsigned value);
+    void load();
+    AttrType getType(unsigned attr);
+    // page offsets of the entries of row
+    unsigned cellAt(unsigned row, unsigned attr);
+    unsigned nullAt(unsigned row);
+    unsigned auxAt(unsigned row);
+    unsigned flagAt(unsigned row);
+    unsigned getCell(unsigned row, unsigned attr);
+    unsigned getAux(unsigned row);
+    // heap bytes used by row
+    unsigned getHeapSize(unsigned row);
+    // heap bytes of the raw data's VarChars; -1 if recordDescriptor is not the page's
+    int getHeapSize(const vector<Attribute> &recordDescriptor, const char *rawData);
+    // rebuild the minipages with newCapacity rows and the heap without holes, rows are kept
+    void repack(unsigned newCapacity);
+    // write row, new or replaced, of rawData (none if REC_FORWARD) and owner if given; -1 if can't fit, page is unchanged
+    RC writeRow(const vector<Attribute> &recordDescriptor, unsigned row, const char *rawData, int ptrFlag, const RID *owner);
+    unsigned getFreeRow();
 
-    DataPage(vector<Attribute> recordDescriptor);
-    DataPage(vector<Attribute> recordDescriptor, char *data);
-    ~DataPage();
+  public:
+    const static unsigned PAX_HEADER_SIZE;
+    const static unsigned CELL_SIZE;
+
+    // bound of the bytes a record of rawSize bytes raw data takes in any PAGE_PAX page, as a moved one
+    static unsigned getInsertSize(const vector<Attribute> &recordDescriptor, unsigned rawSize);
+
+    PaxPage(char *page);
+    // read only, no modifying call may be made
+    PaxPage(const char *page);
+
+    // format the page as an empty PAGE_PAX page of recordDescriptor
+    void init(const vector<Attribute> &recordDescriptor);
+    unsigned getRowNum();
+    // RecordFlag, REC_DELETED if row is out of page
+    int getFlag(unsigned row);
+    // the RID kept by a REC_FORWARD or REC_MOVED row
+    RID getRid(unsigned row);
+    bool isNull(unsigned row, unsigned attr);
+    // attribute in place as in raw data, nullptr if null
+    const char *viewAttribute(unsigned row, unsigned attr);
+    // as Record::attributeProject(), read from the minipages of attrs only
+    unsigned attributeProject(unsigned row, const vector<unsigned> &attrs, char *des);
+    // raw data of the row assembled in Record::owned, as DataPage::getRecord()
+    Record getRecord(unsigned row);
+    // bytes used by the header, the minipage entries of the rows and the heap values
+    unsigned getDataSize();
+
+    // as those of DataPage
+    RC insertRecord(const vector<Attribute> &recordDescriptor, const char *rawData, RID &rid);
+    RC insertMoved(const vector<Attribute> &recordDescriptor, const char *rawData, const RID &home, RID &rid);
+    RC updateRecord(const vector<Attribute> &recordDescriptor, unsigned row, const char *rawData);
+    RC forwardRecord(unsigned row, const RID &target);
+    RC deleteRecord(unsigned row);
+    void compact();
+    unsigned vacuum();
+};
+
+/*
+ * A VarChar too long for its record to fit a page is kept in a chain of PAGE_OVERFLOW pages of the file,
+ * the record keeps a stub in its place: [VC_OVERFLOW_FLAG | Size][PageNum of the first page].
+ * Sizes of fields are walked over stubs as usual, see Utils::getVCSizeWithHead(). Values are put back
+ * by reads and scans of RecordBasedFileManager only for the attributes read, projected or in conditions.
+ * OverflowPage: [Format][SlotNum = 0][NextPage][Size][Chars], a full page of no slot to DataPage
+ */
+class OverflowPage
+{
+    char *page;
+
+    unsigned getHeader(unsigned i);
+    void setHeader(unsigned i, unsigned value);
 
-    unsigned getAvailableSize();
-    void appendRecord(Record *record);
-    void insertRecord(Record *record);
-    void deleteRecord(unsigned slotNum);
-    void getRawData(char *data);
+  public:
+    static const unsigned OVERFLOW_HEADER_SIZE;
+    // chars of a page
+    static const unsigned CAPACITY;
+    // NextPage of the last page
+    static const PageNum NO_PAGE;
+    static const unsigned STUB_SIZE;
+
+    OverflowPage(char *page);
+
+    // format the page as part of a chain
+    void init(PageNum next, const char *chars, unsigned size);
+    PageNum getNext();
+    unsigned getSize();
+    const char *getChars();
+
+    // a VarChar as in a record, is it a stub
+    static bool isStub(const char *value);
+    static PageNum getFirst(const char *stub);
+    static void makeStub(unsigned size, PageNum first, char *des);
+    // raw data, or a projection of it, has a stub
+    static bool hasStub(const vector<Attribute> &recordDescriptor, const char *data);
+    // the VarChar of stub into des as [Size][Chars]
+    static RC readValue(FileHandle &fileHandle, const char *stub, char *des);
+    // stubs of raw data, or a projection of it, replaced by their values in place; data must hold them
+    static RC expand(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, char *data, unsigned &size);
 };
 
 class RecordBasedFileManager
@@ -143,22 +900,51 @@ class RecordBasedFileManager
     static RecordBasedFileManager *instance();
 
     RC createFile(const string &fileName);
+    // pages of the file are added as format, e.g. PAGE_PAX for column minipages
+    RC createFile(const string &fileName, PageFormat format);
     RC destroyFile(const string &fileName);
     RC openFile(const string &fileName, FileHandle &fileHandle);
+    RC openFile(const string &fileName, FileHandle &fileHandle, IOBackend backend);
     RC closeFile(FileHandle &fileHandle);
+    // zone map of an open file, nullptr if it has none
+    shared_ptr<ZoneMap> getZoneMap(FileHandle &fileHandle);
 
+    // long VarChars are moved to overflow pages if the record can't fit a page, see OverflowPage
     RC insertRecord(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const void *data, RID &rid);
-    RC addPageAndInsert(FileHandle &fileHandle, vector<Attribute> &recordDescriptor, char *data, RID &rid);
-    RC findPageAndInsert(FileHandle &fileHandle, vector<Attribute> &recordDescriptor, char *data, RID &rid);
+    // records are packed into new pages in memory, each appended by one write; free space of existing pages is not used.
+    // Nothing is written if a record is too large
+    RC insertRecords(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const vector<const void *> &records, vector<RID> &rids);
+    // REC_MOVED record if home is given
+    RC addPageAndInsert(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const char *data, unsigned size, RID &rid, const RID *home = nullptr);
+    RC findPageAndInsert(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const char *data, unsigned size, RID &rid, const RID *home = nullptr);
 
     RC readRecord(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const RID &rid, void *data);
+    // readRecord() of each RID into data[i], rcs[i] is -1 for a deleted one. RIDs are read in page order,
+    // each page viewed once, and forwarded records once per page they're moved to; -1 if a page can't be read
+    RC readRecords(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const vector<RID> &rids, const vector<void *> &data, vector<RC> &rcs);
     RC printRecord(const vector<Attribute> &recordDescriptor, const void *data);
     RC deleteRecord(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const RID &rid);
 
-    // Assume the RID does not change after an update
+    // The RID does not change after an update: a record that can't fit is moved to another page,
+    // leaving a forwarding pointer. It's one hop at most, a moved record is moved again from its home
     RC updateRecord(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const void *data, const RID &rid);
     RC readAttribute(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const RID &rid, const string &attributeName, void *data);
 
+    // encode records of PAGE_SLOTTED pages and pages of a version 1 file (see PFM_VERSION) in place as
+    // PAGE_SLOTTED_FIELDS, PAGE_COMPACT if it's the file's format, RIDs are kept. Records that can't fit anymore
+    // are moved as by updateRecord(); pages still left are counted in unconverted
+    RC convertFile(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, unsigned &unconverted);
+    // convertFile(), then PAGE_SLOTTED_FIELDS pages to PAGE_COMPACT in place and new pages are added as PAGE_COMPACT.
+    // Pages of a version 1 file are converted to PAGE_COMPACT at once. RIDs are kept; -1 for a PAGE_PAX file
+    RC migrateFile(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, unsigned &unconverted);
+
+    // DataPage::vacuum() up to maxPages pages from pageNum and update the free space map, slot numbers are kept.
+    // pageNum is moved past them, to getNumberOfPages() once the file is done; bytes gained are added to reclaimed.
+    // Each page is pinned only while it's compacted, so other work can go on between calls
+    RC vacuumPages(FileHandle &fileHandle, PageNum &pageNum, unsigned maxPages, unsigned &reclaimed);
+    // vacuumPages() over the whole file, VACUUM_BATCH_PAGES at a time
+    RC vacuumFile(FileHandle &fileHandle, unsigned &reclaimed);
+
     RC scan(FileHandle &fileHandle,
             const vector<Attribute> &recordDescriptor,
             const string &conditionAttribute,
@@ -166,15 +952,70 @@ class RecordBasedFileManager
             const void *value,                    // used in the comparison
             const vector<string> &attributeNames, // a list of projected attributes
             RBFM_ScanIterator &rbfm_ScanIterator);
+    // records meeting all conditions of any group (OR of ANDs), evaluated on the page before projection.
+    // NO_OP conditions are met by any record
+    RC scan(FileHandle &fileHandle,
+            const vector<Attribute> &recordDescriptor,
+            const vector<vector<ScanCondition>> &conditions,
+            const vector<string> &attributeNames,
+            RBFM_ScanIterator &rbfm_ScanIterator);
+    // scan of conditions by workerNum threads, rows in the order of scan() if ordered
+    RC parallelScan(FileHandle &fileHandle,
+                    const vector<Attribute> &recordDescriptor,
+                    const vector<vector<ScanCondition>> &conditions,
+                    const vector<string> &attributeNames,
+                    unsigned workerNum,
+                    bool ordered,
+                    RBFM_ParallelScanIterator &rbfm_ScanIterator);
 
   protected:
     RecordBasedFileManager();
     ~RecordBasedFileManager();
 
   private:
+    // record of rid, through its forwarding pointer. Page pageNum is viewed on success, released by caller
+    RC viewRecord(FileHandle &fileHandle, const RID &rid, PageNum &pageNum, Record &record);
+    // records at targets (RID, index of rids) in page order into data; REC_FORWARD ones are added to forwarded if
+    // given, else only REC_MOVED ones of their home RID are read
+    RC readSorted(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, vector<pair<RID, unsigned>> &targets, const vector<RID> &rids,
+                  const vector<void *> &data, vector<RC> &rcs, vector<pair<RID, unsigned>> *forwarded);
+    // see updateRecord(), data is stored as it is
+    RC updateStored(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const char *data, unsigned size, const RID &rid);
+    // move the record of home out of page, which is pinned
+    RC moveRecord(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, DataPage &page, const RID &home, const char *data, unsigned size);
+    RC deleteAt(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const RID &rid);
+    // version 1 page pageNum, which is pinned, to format in place, see DataPage::readV1(). Records that can't fit
+    // are moved first as by updateRecord(); -1 if the page is left as it is
+    RC convertV1(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, PageNum pageNum, char *page, unsigned format);
+    // ZoneMap::refresh() of the page if the file has a zone map
+    void refreshZone(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, PageNum pageNum, const char *page);
+    // whether a record of rawSize fits an empty page
+    static bool fitsPage(const vector<Attribute> &recordDescriptor, unsigned rawSize);
+    // VarChars of data to move out, largest first, for it to fit a page; false if it can't
+    static bool chooseOverflow(const vector<Attribute> &recordDescriptor, const char *data, vector<unsigned> &attrs);
+    // data with attrs written to overflow pages and replaced by stubs, the first pages are added to chains
+    RC moveOutValues(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const char *data, const vector<unsigned> &attrs,
+                     vector<char> &stubbed, vector<PageNum> &chains);
+    // append the pages of a VarChar of size chars
+    RC writeOverflow(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const char *chars, unsigned size, PageNum &first);
+    // pages of the chains become empty data pages of the file
+    RC freeOverflow(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const vector<PageNum> &chains);
+    // first pages of the stubs of the record of rid; -1 if there is no such record
+    RC getOverflow(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const RID &rid, vector<PageNum> &chains);
+    // writes and appends of the file, to match its zone file
+    static uint64_t getDataWrites(FileHandle &fileHandle);
+
+    struct OpenZoneMap
+    {
+        shared_ptr<ZoneMap> zoneMap;
+        unsigned handleNum;
+    };
+
     static RecordBasedFileManager *_rbf_manager;
     PagedFileManager *pfm;
-    char buffer[PAGE_SIZE];
+    // by FileHandle::getFileId() of the files opened by openFile()
+    map<unsigned, OpenZoneMap> zoneMaps;
+    mutex zoneLatch;
 };
 
 #endif
@@ -0,0 +1,149 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+int RBFTest_Batch(RecordBasedFileManager *rbfm)
+{
+	// Functions tested
+	// 1. Create File & Insert Records
+	// 2. Delete Records
+	// 3. Scan by batches, against the same scan record by record
+	// 4. Scan with one match out of many records
+	// 5. Destroy File
+	cout << endl << "***** In RBF Test Case Batch *****" << endl;
+
+	RC rc;
+	string fileName = "test_batch";
+
+	rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	rc = createFileShouldSucceed(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+	unsigned char nullsIndicator[1] = {0};
+	char record[PAGE_SIZE];
+	int recordSize = 0;
+	unsigned numRecords = 100000;
+	vector<RID> rids;
+	RID rid;
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		prepareRecord(recordDescriptor.size(), nullsIndicator, i % 9, string(i % 9, 'a' + i % 26), i % 100, 177.8, i, record, &recordSize);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+		assert(rc == success && "Inserting a record should not fail.");
+		rids.push_back(rid);
+	}
+	for (unsigned i = 0; i < numRecords; i += 7)
+	{
+		rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+		assert(rc == success && "Deleting a record should not fail.");
+	}
+
+	vector<string> attributeNames;
+	attributeNames.push_back("EmpName");
+	attributeNames.push_back("Salary");
+	int age = 10;
+	unsigned maxRows = 37;
+
+	RBFM_ScanIterator batchIterator;
+	rc = rbfm->scan(fileHandle, recordDescriptor, "Age", LT_OP, &age, attributeNames, batchIterator);
+	assert(rc == success && "Scanning a file should not fail.");
+	RBFM_ScanIterator recordIterator;
+	rc = rbfm->scan(fileHandle, recordDescriptor, "Age", LT_OP, &age, attributeNames, recordIterator);
+	assert(rc == success && "Scanning a file should not fail.");
+
+	unsigned rowSize = batchIterator.getMaxRowSize();
+	assert(rowSize == 1 + sizeof(int) + 30 + sizeof(int) && "Max row size should be by the projected attributes.");
+	char *batch = (char *)malloc(maxRows * rowSize);
+	RID *batchRids = new RID[maxRows];
+	char *returnedData = (char *)malloc(rowSize);
+	unsigned rows = 0, count = 0, batches = 0;
+	while (batchIterator.getNextBatch(batchRids, batch, maxRows, rows) != RBFM_EOF)
+	{
+		assert(rows > 0 && rows <= maxRows && "Batch should not be empty nor overflow.");
+		char *row = batch;
+		for (unsigned i = 0; i < rows; i++)
+		{
+			rc = recordIterator.getNextRecord(rid, returnedData);
+			assert(rc == success && "Scan should return the same records.");
+			assert(rid.pageNum == batchRids[i].pageNum && rid.slotNum == batchRids[i].slotNum && "Scan should return the same RIDs.");
+			int salary = 0;
+			unsigned nameLength = 0;
+			memcpy(&nameLength, row + 1, sizeof(int));
+			memcpy(&salary, row + 1 + sizeof(int) + nameLength, sizeof(int));
+			assert(salary % 100 < age && salary % 7 != 0 && "Record should meet the condition and not be deleted.");
+			// rows are packed one after another
+			unsigned size = 1 + sizeof(int) + nameLength + sizeof(int);
+			assert(memcmp(row, returnedData, size) == 0 && "Scan should return the same records.");
+			row += size;
+		}
+		count += rows;
+		batches++;
+	}
+	assert(recordIterator.getNextRecord(rid, returnedData) == RBFM_EOF && "Scans should end together.");
+	batchIterator.close();
+	recordIterator.close();
+	unsigned expected = 0;
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		expected += i % 100 < 10 && i % 7 != 0 ? 1 : 0;
+	}
+	assert(count == expected && batches >= expected / maxRows && "Scan should return all records met.");
+
+	// every record but the last is filtered out
+	int salary = numRecords - 1;
+	rc = rbfm->scan(fileHandle, recordDescriptor, "Salary", EQ_OP, &salary, attributeNames, batchIterator);
+	assert(rc == success && "Scanning a file should not fail.");
+	rc = batchIterator.getNextBatch(batchRids, batch, maxRows, rows);
+	assert(rc == success && rows == 1 && "The last record should be met.");
+	assert(batchRids[0].pageNum == rids.back().pageNum && batchRids[0].slotNum == rids.back().slotNum && "The last RID should be returned.");
+	rc = batchIterator.getNextBatch(batchRids, batch, maxRows, rows);
+	assert(rc == RBFM_EOF && rows == 0 && "Scan should end.");
+	batchIterator.close();
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	rc = destroyFileShouldSucceed(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	free(batch);
+	free(returnedData);
+	delete[] batchRids;
+
+	cout << "RBF Test Case Batch Finished! The result will be examined." << endl << endl;
+
+	return 0;
+}
+
+int main()
+{
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+	remove("test_batch");
+
+	RC rcmain = RBFTest_Batch(rbfm);
+	return rcmain;
+}
@@ -0,0 +1,154 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+int RBFTest_BufferPool(PagedFileManager *pfm)
+{
+	// Functions tested
+	// 1. Create File
+	// 2. Open File
+	// 3. Append Pages (more than the frames of buffer pool)
+	// 4. Write Pages, some of them will be evicted dirty
+	// 5. Pin/Unpin Page
+	// 6. Read Pages & Logical/Physical Counters
+	// 7. Close/Reopen File & Read Pages
+	// 8. Destroy File
+	cout << endl << "***** In RBF Test Case Buffer Pool *****" << endl;
+
+	RC rc;
+	string fileName = "test_bufferpool";
+	unsigned numPages = BUFFER_POOL_FRAMES + 16;
+
+	rc = pfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	rc = createFileShouldSucceed(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	rc = pfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	char *data = (char *)malloc(PAGE_SIZE);
+	char *buffer = (char *)malloc(PAGE_SIZE);
+
+	for (unsigned i = 0; i < numPages; i++)
+	{
+		memset(data, i % 96 + 30, PAGE_SIZE);
+		rc = fileHandle.appendPage(data);
+		assert(rc == success && "Appending a page should not fail.");
+	}
+
+	// dirty all pages, so evicted frames must be written back
+	for (unsigned i = 0; i < numPages; i++)
+	{
+		memset(data, (i + 1) % 96 + 30, PAGE_SIZE);
+		rc = fileHandle.writePage(i, data);
+		assert(rc == success && "Writing a page should not fail.");
+	}
+
+	for (unsigned i = 0; i < numPages; i++)
+	{
+		memset(data, (i + 1) % 96 + 30, PAGE_SIZE);
+		rc = fileHandle.readPage(i, buffer);
+		assert(rc == success && "Reading a page should not fail.");
+		if (memcmp(data, buffer, PAGE_SIZE) != 0)
+		{
+			cout << "[FAIL] Test Case Buffer Pool Failed! Page " << i << " is wrong." << endl << endl;
+			free(data);
+			free(buffer);
+			return -1;
+		}
+	}
+
+	// hot page should be read from disk at most once
+	unsigned readPageCount = 0, writePageCount = 0, appendPageCount = 0;
+	unsigned physicalReadCount = 0, physicalWriteCount = 0;
+	unsigned readPageCount1 = 0, physicalReadCount1 = 0;
+	fileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount);
+	fileHandle.collectPhysicalCounterValues(physicalReadCount, physicalWriteCount);
+	for (unsigned i = 0; i < 100; i++)
+	{
+		rc = fileHandle.readPage(numPages - 1, buffer);
+		assert(rc == success && "Reading a page should not fail.");
+	}
+	fileHandle.collectCounterValues(readPageCount1, writePageCount, appendPageCount);
+	fileHandle.collectPhysicalCounterValues(physicalReadCount1, physicalWriteCount);
+	assert(readPageCount1 - readPageCount == 100 && "Logical read counter should be correct.");
+	assert(physicalReadCount1 - physicalReadCount <= 1 && "Hot page should stay in buffer pool.");
+	assert(physicalWriteCount > 0 && "Dirty frames should have been written back when evicted.");
+
+	// modify a frame in place
+	char *frame = nullptr;
+	rc = fileHandle.pinPage(0, frame);
+	assert(rc == success && "Pinning a page should not fail.");
+	memset(frame, 'P', PAGE_SIZE);
+	rc = fileHandle.unpinPage(0, true);
+	assert(rc == success && "Unpinning a page should not fail.");
+
+	rc = pfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	// all dirty frames should have reached the disk
+	FileHandle fileHandle2;
+	rc = pfm->openFile(fileName, fileHandle2);
+	assert(rc == success && "Opening the file should not fail.");
+	assert(fileHandle2.getNumberOfPages() == numPages && "The number of pages should be correct.");
+
+	memset(data, 'P', PAGE_SIZE);
+	rc = fileHandle2.readPage(0, buffer);
+	assert(rc == success && "Reading a page should not fail.");
+	assert(memcmp(data, buffer, PAGE_SIZE) == 0 && "Page modified in frame should be persisted.");
+
+	for (unsigned i = 1; i < numPages; i++)
+	{
+		memset(data, (i + 1) % 96 + 30, PAGE_SIZE);
+		rc = fileHandle2.readPage(i, buffer);
+		assert(rc == success && "Reading a page should not fail.");
+		if (memcmp(data, buffer, PAGE_SIZE) != 0)
+		{
+			cout << "[FAIL] Test Case Buffer Pool Failed! Page " << i << " is wrong after reopen." << endl << endl;
+			free(data);
+			free(buffer);
+			return -1;
+		}
+	}
+
+	rc = pfm->closeFile(fileHandle2);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = pfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	rc = destroyFileShouldSucceed(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	free(data);
+	free(buffer);
+
+	cout << "RBF Test Case Buffer Pool Finished! The result will be examined." << endl << endl;
+
+	return 0;
+}
+
+int main()
+{
+	PagedFileManager *pfm = PagedFileManager::instance();
+
+	remove("test_bufferpool");
+
+	RC rcmain = RBFTest_BufferPool(pfm);
+	return rcmain;
+}
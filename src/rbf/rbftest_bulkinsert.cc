@@ -0,0 +1,182 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+int RBFTest_BulkInsert(RecordBasedFileManager *rbfm)
+{
+	// Functions tested
+	// 1. Create File
+	// 2. Insert Records in bulk, pages are packed and appended
+	// 3. Read Records by the RIDs returned, Scan them by Int and Real conditions
+	// 4. Reject a batch with a too large Record, nothing written
+	// 5. Insert one by one after, Scan all
+	// 6. Destroy File
+	cout << endl << "***** In RBF Test Case Bulk Insert *****" << endl;
+
+	RC rc;
+	string fileName = "test_bulkinsert";
+
+	rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	rc = createFileShouldSucceed(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+	unsigned char nullsIndicator[1] = {0};
+	unsigned char nullName[1] = {0x80};
+	unsigned numRecords = 5000;
+	const unsigned recordMax = 200;
+	char *records = (char *)malloc(numRecords * recordMax);
+	vector<const void *> batch;
+	vector<int> sizes;
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		int recordSize = 0;
+		string name(i % 90, 'a' + i % 26);
+		prepareRecord(recordDescriptor.size(), i % 7 == 0 ? nullName : nullsIndicator, name.size(), name, i, 177.8, i, records + i * recordMax, &recordSize);
+		batch.push_back(records + i * recordMax);
+		sizes.push_back(recordSize);
+	}
+
+	vector<RID> rids;
+	rc = rbfm->insertRecords(fileHandle, recordDescriptor, batch, rids);
+	assert(rc == success && "Inserting records should not fail.");
+	assert(rids.size() == numRecords && "All RIDs should be returned.");
+	unsigned pages = fileHandle.getNumberOfPages();
+	for (unsigned i = 1; i < numRecords; i++)
+	{
+		assert((rids[i].pageNum == rids[i - 1].pageNum ? rids[i].slotNum == rids[i - 1].slotNum + 1
+													   : rids[i].pageNum == rids[i - 1].pageNum + 1 && rids[i].slotNum == 0) &&
+			   "Records should be packed in order.");
+	}
+	assert(rids.back().pageNum == pages - 1 && "Pages should be appended.");
+	// all pages but the last are closed by a record that can't fit
+	for (PageNum pageNum = 0; pageNum + 1 < pages; pageNum++)
+	{
+		unsigned size = 0;
+		rc = fileHandle.getPageSize(pageNum, size);
+		assert(rc == success && "Getting the page size should not fail.");
+		assert(size + recordMax + Record::REC_HEADER_SIZE + DataPage::SLOT_SIZE > PAGE_SIZE && "Pages should be packed.");
+	}
+
+	char returnedData[PAGE_SIZE];
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedData);
+		assert(rc == success && "Reading a record should not fail.");
+		assert(memcmp(returnedData, batch[i], sizes[i]) == 0 && "Record read should be the one inserted.");
+	}
+
+	// zones of the packed pages bound their rows, no page with a match is skipped
+	int lowAge = 50, highAge = numRecords - 50;
+	float height = 177.8;
+	vector<string> ageName(1, "Age");
+	RBFM_ScanIterator zoneIterator;
+	RID zoneRid;
+	unsigned matches[3] = {0, 0, 0};
+	rc = rbfm->scan(fileHandle, recordDescriptor, "Age", LT_OP, &lowAge, ageName, zoneIterator);
+	assert(rc == success && "Scanning a file should not fail.");
+	while (zoneIterator.getNextRecord(zoneRid, returnedData) != RBFM_EOF)
+	{
+		matches[0]++;
+	}
+	rc = rbfm->scan(fileHandle, recordDescriptor, "Age", GE_OP, &highAge, ageName, zoneIterator);
+	assert(rc == success && "Scanning a file should not fail.");
+	while (zoneIterator.getNextRecord(zoneRid, returnedData) != RBFM_EOF)
+	{
+		matches[1]++;
+	}
+	rc = rbfm->scan(fileHandle, recordDescriptor, "Height", EQ_OP, &height, ageName, zoneIterator);
+	assert(rc == success && "Scanning a file should not fail.");
+	while (zoneIterator.getNextRecord(zoneRid, returnedData) != RBFM_EOF)
+	{
+		matches[2]++;
+	}
+	zoneIterator.close();
+	assert(matches[0] == 50 && matches[1] == 50 && matches[2] == numRecords && "Scan should return all matching records.");
+
+	// the too large one is the last, nothing is written; a long VarChar would be moved to overflow pages, int columns can't
+	vector<Attribute> wideDescriptor;
+	for (unsigned i = 0; i < PAGE_SIZE / sizeof(int); i++)
+	{
+		wideDescriptor.push_back(Attribute{"c" + to_string(i), TypeInt, 4});
+	}
+	unsigned nullSize = getActualByteForNullsIndicator(wideDescriptor.size());
+	char *nullRecord = (char *)malloc(nullSize);
+	memset(nullRecord, 0xff, nullSize);
+	char *longRecord = (char *)malloc(2 * PAGE_SIZE);
+	memset(longRecord, 0, 2 * PAGE_SIZE);
+	vector<const void *> badBatch(100, nullRecord);
+	badBatch.push_back(longRecord);
+	vector<RID> badRids;
+	rc = rbfm->insertRecords(fileHandle, wideDescriptor, badBatch, badRids);
+	assert(rc != success && "Inserting a too large record should fail.");
+	assert(fileHandle.getNumberOfPages() == pages && "Nothing should be written.");
+
+	vector<const void *> emptyBatch;
+	rc = rbfm->insertRecords(fileHandle, recordDescriptor, emptyBatch, badRids);
+	assert(rc == success && badRids.empty() && fileHandle.getNumberOfPages() == pages && "Empty batch should do nothing.");
+
+	// one by one fills the last page
+	RID rid;
+	rc = rbfm->insertRecord(fileHandle, recordDescriptor, batch[1], rid);
+	assert(rc == success && "Inserting a record should not fail.");
+	assert(rid.pageNum == pages - 1 && "Free space of the last page should be used.");
+
+	vector<string> attributeNames(1, "Age");
+	RBFM_ScanIterator rbfm_ScanIterator;
+	rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, rbfm_ScanIterator);
+	assert(rc == success && "Scanning a file should not fail.");
+	unsigned count = 0;
+	while (rbfm_ScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+	{
+		count++;
+	}
+	rbfm_ScanIterator.close();
+	assert(count == numRecords + 1 && "Scan should return all records.");
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	rc = destroyFileShouldSucceed(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	free(records);
+	free(longRecord);
+	free(nullRecord);
+
+	cout << "RBF Test Case Bulk Insert Finished! The result will be examined." << endl << endl;
+
+	return 0;
+}
+
+int main()
+{
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+	remove("test_bulkinsert");
+
+	RC rcmain = RBFTest_BulkInsert(rbfm);
+	return rcmain;
+}
@@ -0,0 +1,235 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <algorithm>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// i-th record, some attributes are null
+static void prepareCompactRecord(const vector<Attribute> &recordDescriptor, unsigned i, unsigned nameLength, char *record, int *recordSize)
+{
+	unsigned char nullsIndicator[1] = {0};
+	if (i % 7 == 0)
+	{
+		nullsIndicator[0] = 0x40; // Age
+	}
+	prepareRecord(recordDescriptor.size(), nullsIndicator, nameLength, string(nameLength, 'a' + i % 26), i % 100, i * 0.5, i, record, recordSize);
+}
+
+// all rows of a scan, sorted
+static vector<string> scanRows(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor)
+{
+	vector<string> attributeNames;
+	for (const Attribute &attr : recordDescriptor)
+	{
+		attributeNames.push_back(attr.name);
+	}
+	RBFM_ScanIterator rbfm_ScanIterator;
+	RC rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, rbfm_ScanIterator);
+	assert(rc == success && "Scanning a file should not fail.");
+	RID rid;
+	char *data = (char *)malloc(PAGE_SIZE);
+	vector<string> result;
+	while (rbfm_ScanIterator.getNextRecord(rid, data) != RBFM_EOF)
+	{
+		result.push_back(string(data, Record::getRecordSize(recordDescriptor, data)));
+	}
+	rbfm_ScanIterator.close();
+	free(data);
+	sort(result.begin(), result.end());
+	return result;
+}
+
+// data bytes of all pages by the free space map
+static unsigned getDataSize(FileHandle &fileHandle)
+{
+	unsigned total = 0, size = 0;
+	for (PageNum pageNum = 0; pageNum < fileHandle.getNumberOfPages(); pageNum++)
+	{
+		RC rc = fileHandle.getPageSize(pageNum, size);
+		assert(rc == success && "Getting a page size should not fail.");
+		total += size;
+	}
+	return total;
+}
+
+// every live record reads as prepared
+static void checkRecords(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+						 const vector<RID> &rids, const vector<bool> &live, const vector<unsigned> &nameLengths)
+{
+	char *record = (char *)malloc(PAGE_SIZE);
+	char *returnedData = (char *)malloc(PAGE_SIZE);
+	int recordSize = 0;
+	for (unsigned i = 0; i < rids.size(); i++)
+	{
+		RC rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedData);
+		if (!live[i])
+		{
+			assert(rc != success && "Reading a deleted record should fail.");
+			continue;
+		}
+		assert(rc == success && "Reading a record should not fail.");
+		prepareCompactRecord(recordDescriptor, i, nameLengths[i], record, &recordSize);
+		assert(memcmp(returnedData, record, recordSize) == 0 && "Record should be kept.");
+
+		rc = rbfm->readAttribute(fileHandle, recordDescriptor, rids[i], "Salary", returnedData);
+		assert(rc == success && "Reading an attribute should not fail.");
+		assert(*(int *)returnedData == (int)i && "Attribute should be kept.");
+	}
+	free(record);
+	free(returnedData);
+}
+
+int RBFTest_Compact(RecordBasedFileManager *rbfm)
+{
+	// Functions tested
+	// 1. Create File of PAGE_COMPACT, records take less space than in PAGE_SLOTTED_FIELDS
+	// 2. Insert/Update/Delete Records, the same on a PAGE_SLOTTED_FIELDS file
+	// 3. Read Records and Attributes, scan
+	// 4. Migrate the PAGE_SLOTTED_FIELDS file, RIDs and records are kept
+	// 5. Destroy File
+	cout << endl << "***** In RBF Test Case Compact *****" << endl;
+
+	RC rc;
+	string compactName = "test_compact";
+	string slottedName = "test_compact_slotted";
+
+	rc = rbfm->createFile(compactName, PAGE_COMPACT);
+	assert(rc == success && "Creating the file should not fail.");
+	rc = rbfm->createFile(slottedName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle compact, slotted;
+	rc = rbfm->openFile(compactName, compact);
+	assert(rc == success && compact.getPageFormat() == PAGE_COMPACT && "Page format should be kept by the file.");
+	rc = rbfm->openFile(slottedName, slotted);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+	char *record = (char *)malloc(PAGE_SIZE);
+	int recordSize = 0;
+	RID rid;
+
+	unsigned numRecords = 3000;
+	vector<RID> compactRids, slottedRids;
+	vector<unsigned> nameLengths;
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		nameLengths.push_back(1 + i % 8);
+		prepareCompactRecord(recordDescriptor, i, nameLengths[i], record, &recordSize);
+		rc = rbfm->insertRecord(compact, recordDescriptor, record, rid);
+		assert(rc == success && "Inserting a record should not fail.");
+		compactRids.push_back(rid);
+		rc = rbfm->insertRecord(slotted, recordDescriptor, record, rid);
+		assert(rc == success && "Inserting a record should not fail.");
+		slottedRids.push_back(rid);
+	}
+
+	char page[PAGE_SIZE];
+	rc = compact.readPage(0, page);
+	assert(rc == success && "Reading a page should not fail.");
+	assert(DataPage(page).getFormat() == PAGE_COMPACT && "Pages should be of PAGE_COMPACT.");
+	unsigned compactPages = compact.getNumberOfPages();
+	unsigned slottedPages = slotted.getNumberOfPages();
+	assert(compactPages < slottedPages && "Compact records should take fewer pages.");
+
+	// grown ones are forwarded, some are deleted
+	vector<bool> live(numRecords, true);
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		if (i % 5 == 0)
+		{
+			rc = rbfm->deleteRecord(compact, recordDescriptor, compactRids[i]);
+			assert(rc == success && "Deleting a record should not fail.");
+			rc = rbfm->deleteRecord(slotted, recordDescriptor, slottedRids[i]);
+			assert(rc == success && "Deleting a record should not fail.");
+			live[i] = false;
+			continue;
+		}
+		if (i % 3 == 0)
+		{
+			nameLengths[i] = i % 2 ? 30 : 1;
+			prepareCompactRecord(recordDescriptor, i, nameLengths[i], record, &recordSize);
+			rc = rbfm->updateRecord(compact, recordDescriptor, record, compactRids[i]);
+			assert(rc == success && "Updating a record should not fail.");
+			rc = rbfm->updateRecord(slotted, recordDescriptor, record, slottedRids[i]);
+			assert(rc == success && "Updating a record should not fail.");
+		}
+	}
+	checkRecords(rbfm, compact, recordDescriptor, compactRids, live, nameLengths);
+	vector<string> rows = scanRows(rbfm, compact, recordDescriptor);
+	assert(rows == scanRows(rbfm, slotted, recordDescriptor) && "Scan should return the same rows.");
+	assert(rows.size() == (unsigned)count(live.begin(), live.end(), true) && "Scan should return all records left.");
+
+	unsigned reclaimed = 0;
+	rc = rbfm->vacuumFile(compact, reclaimed);
+	assert(rc == success && reclaimed > 0 && "Space of deleted records should be reclaimed.");
+	checkRecords(rbfm, compact, recordDescriptor, compactRids, live, nameLengths);
+
+	// in place, records lose their headers and new pages are compact
+	unsigned before = getDataSize(slotted);
+	unsigned unconverted = 0;
+	rc = rbfm->migrateFile(slotted, recordDescriptor, unconverted);
+	assert(rc == success && unconverted == 0 && "Migrating the file should not fail.");
+	assert(slotted.getPageFormat() == PAGE_COMPACT && "New pages should be of PAGE_COMPACT.");
+	assert(getDataSize(slotted) + rows.size() * Record::REC_HEADER_SIZE <= before && "Record headers should be dropped.");
+	rc = slotted.readPage(0, page);
+	assert(rc == success && DataPage(page).getFormat() == PAGE_COMPACT && "Pages should be of PAGE_COMPACT.");
+	checkRecords(rbfm, slotted, recordDescriptor, slottedRids, live, nameLengths);
+	assert(rows == scanRows(rbfm, slotted, recordDescriptor) && "Scan should return the same rows.");
+
+	// records still move and come back on a migrated file
+	for (unsigned i = 1; i < numRecords; i += 10)
+	{
+		nameLengths[i] = 30 - nameLengths[i] % 29;
+		prepareCompactRecord(recordDescriptor, i, nameLengths[i], record, &recordSize);
+		rc = rbfm->updateRecord(slotted, recordDescriptor, record, slottedRids[i]);
+		assert(rc == success && "Updating a record should not fail.");
+	}
+	checkRecords(rbfm, slotted, recordDescriptor, slottedRids, live, nameLengths);
+
+	rc = rbfm->closeFile(compact);
+	assert(rc == success && "Closing the file should not fail.");
+	rc = rbfm->closeFile(slotted);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = rbfm->openFile(slottedName, slotted);
+	assert(rc == success && slotted.getPageFormat() == PAGE_COMPACT && "Page format should be kept by the file.");
+	rc = rbfm->closeFile(slotted);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = rbfm->destroyFile(compactName);
+	assert(rc == success && "Destroying the file should not fail.");
+	rc = destroyFileShouldSucceed(compactName);
+	assert(rc == success && "Destroying the file should not fail.");
+	rc = rbfm->destroyFile(slottedName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	free(record);
+
+	cout << "RBF Test Case Compact Finished! The result will be examined." << endl << endl;
+
+	return 0;
+}
+
+int main()
+{
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+	remove("test_compact");
+	remove("test_compact_slotted");
+
+	RC rcmain = RBFTest_Compact(rbfm);
+	return rcmain;
+}
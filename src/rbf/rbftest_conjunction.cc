@@ -0,0 +1,180 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <functional>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+struct Emp
+{
+	string name;
+	int age;
+	// -1 for NULL
+	float height;
+	int salary;
+};
+
+// scan with the conditions, projecting Age & Salary, and check the records against met
+void scanShouldMeet(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+					const vector<vector<ScanCondition>> &conditions, const vector<Emp> &emps, function<bool(const Emp &)> met)
+{
+	RC rc;
+	unsigned expected = 0;
+	for (const Emp &emp : emps)
+	{
+		expected += met(emp) ? 1 : 0;
+	}
+
+	vector<string> attributeNames;
+	attributeNames.push_back("Age");
+	attributeNames.push_back("Salary");
+	RBFM_ScanIterator rbfm_ScanIterator;
+	rc = rbfm->scan(fileHandle, recordDescriptor, conditions, attributeNames, rbfm_ScanIterator);
+	assert(rc == success && "Scanning a file should not fail.");
+	char returnedData[PAGE_SIZE];
+	RID rid;
+	unsigned count = 0;
+	while (rbfm_ScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+	{
+		int age = 0, salary = 0;
+		memcpy(&age, returnedData + 1, sizeof(int));
+		memcpy(&salary, returnedData + 1 + sizeof(int), sizeof(int));
+		assert((returnedData[0] & 0x50) == 0 && "Projected attributes should not be null.");
+		assert(emps[age].salary == salary && "Projected attributes should be kept.");
+		assert(met(emps[age]) && "Record should meet the conditions.");
+		count++;
+	}
+	rbfm_ScanIterator.close();
+	assert(count == expected && "Scan should return all records met.");
+}
+
+int RBFTest_Conjunction(RecordBasedFileManager *rbfm)
+{
+	// Functions tested
+	// 1. Create File & Insert Records
+	// 2. Scan with AND of conditions
+	// 3. Scan with OR of groups
+	// 4. NO_OP conditions & no condition
+	// 5. Destroy File
+	cout << endl << "***** In RBF Test Case Conjunction *****" << endl;
+
+	RC rc;
+	string fileName = "test_conjunction";
+
+	rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	rc = createFileShouldSucceed(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+	unsigned char nullsIndicator[1] = {0};
+	unsigned char nullHeight[1] = {0x20};
+	char record[PAGE_SIZE];
+	int recordSize = 0;
+	RID rid;
+	unsigned numRecords = 2000;
+	vector<Emp> emps;
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		Emp emp;
+		emp.name = string(i % 4, 'a' + i % 3);
+		emp.age = i;
+		emp.height = i % 13 == 0 ? -1 : 150 + i % 50;
+		emp.salary = i % 7;
+		prepareRecord(recordDescriptor.size(), emp.height < 0 ? nullHeight : nullsIndicator, emp.name.size(), emp.name,
+					  emp.age, emp.height, emp.salary, record, &recordSize);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+		assert(rc == success && "Inserting a record should not fail.");
+		emps.push_back(emp);
+	}
+
+	int age100 = 100, age200 = 200, age50 = 50, salary3 = 3;
+	float height170 = 170;
+	unsigned nameSize = 2;
+	char aa[6];
+	memcpy(aa, &nameSize, sizeof(unsigned));
+	memcpy(aa + sizeof(unsigned), "aa", nameSize);
+
+	// Age >= 100 AND Age < 200 AND EmpName = "aa"
+	vector<vector<ScanCondition>> conditions(1);
+	conditions[0].push_back(ScanCondition{"Age", GE_OP, &age100});
+	conditions[0].push_back(ScanCondition{"Age", LT_OP, &age200});
+	conditions[0].push_back(ScanCondition{"EmpName", EQ_OP, aa});
+	scanShouldMeet(rbfm, fileHandle, recordDescriptor, conditions, emps, [](const Emp &emp) {
+		return emp.age >= 100 && emp.age < 200 && emp.name == "aa";
+	});
+
+	// Age < 50 OR (Salary = 3 AND Height > 170), null Height meets no condition
+	conditions.clear();
+	conditions.resize(2);
+	conditions[0].push_back(ScanCondition{"Age", LT_OP, &age50});
+	conditions[1].push_back(ScanCondition{"Salary", EQ_OP, &salary3});
+	conditions[1].push_back(ScanCondition{"Height", GT_OP, &height170});
+	scanShouldMeet(rbfm, fileHandle, recordDescriptor, conditions, emps, [](const Emp &emp) {
+		return emp.age < 50 || (emp.salary == 3 && emp.height >= 0 && emp.height > 170);
+	});
+
+	// Height <> 170 AND NO_OP
+	conditions.clear();
+	conditions.resize(1);
+	conditions[0].push_back(ScanCondition{"Height", NE_OP, &height170});
+	conditions[0].push_back(ScanCondition{"", NO_OP, NULL});
+	scanShouldMeet(rbfm, fileHandle, recordDescriptor, conditions, emps, [](const Emp &emp) {
+		return emp.height >= 0 && emp.height != 170;
+	});
+
+	// Age < 50 OR NO_OP
+	conditions.resize(2);
+	conditions[0].clear();
+	conditions[0].push_back(ScanCondition{"Age", LT_OP, &age50});
+	conditions[1].clear();
+	conditions[1].push_back(ScanCondition{"", NO_OP, NULL});
+	scanShouldMeet(rbfm, fileHandle, recordDescriptor, conditions, emps, [](const Emp &) {
+		return true;
+	});
+
+	// no condition
+	conditions.clear();
+	scanShouldMeet(rbfm, fileHandle, recordDescriptor, conditions, emps, [](const Emp &) {
+		return true;
+	});
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	rc = destroyFileShouldSucceed(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	cout << "RBF Test Case Conjunction Finished! The result will be examined." << endl << endl;
+
+	return 0;
+}
+
+int main()
+{
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+	remove("test_conjunction");
+
+	RC rcmain = RBFTest_Conjunction(rbfm);
+	return rcmain;
+}
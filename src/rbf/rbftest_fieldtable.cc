@@ -0,0 +1,278 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <map>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+const unsigned WIDE_COLUMNS = 30;
+
+void createWideRecordDescriptor(vector<Attribute> &recordDescriptor)
+{
+	for (unsigned i = 0; i < WIDE_COLUMNS; i++)
+	{
+		Attribute attr;
+		attr.name = "c" + to_string(i);
+		attr.type = (AttrType)(i % 3);
+		attr.length = attr.type == TypeVarChar ? (AttrLength)10 : (AttrLength)4;
+		recordDescriptor.push_back(attr);
+	}
+}
+
+// every 7th field is null, VarChars are of 0 to 9 chars
+void prepareWideRecord(const vector<Attribute> &recordDescriptor, unsigned index, char *buffer, int *size)
+{
+	int nullSize = getActualByteForNullsIndicator(recordDescriptor.size());
+	memset(buffer, 0, nullSize);
+	int offset = nullSize;
+	for (unsigned i = 0; i < recordDescriptor.size(); i++)
+	{
+		if ((index + i) % 7 == 0)
+		{
+			buffer[i / 8] |= (char)(0x80 >> (i % 8));
+			continue;
+		}
+		switch (recordDescriptor[i].type)
+		{
+		case TypeInt:
+		{
+			int v = index * 100 + i;
+			memcpy(buffer + offset, &v, sizeof(int));
+			offset += sizeof(int);
+			break;
+		}
+		case TypeReal:
+		{
+			float v = index + i / 10.0;
+			memcpy(buffer + offset, &v, sizeof(float));
+			offset += sizeof(float);
+			break;
+		}
+		case TypeVarChar:
+		{
+			int len = (index + i) % 10;
+			memcpy(buffer + offset, &len, sizeof(int));
+			offset += sizeof(int);
+			memset(buffer + offset, 'a' + i % 26, len);
+			offset += len;
+			break;
+		}
+		}
+	}
+	*size = offset;
+}
+
+// records of a PAGE_SLOTTED page are raw data
+unsigned appendLegacyPage(FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, unsigned first, unsigned num, vector<RID> &rids)
+{
+	char data[PAGE_SIZE];
+	char record[PAGE_SIZE];
+	int recordSize = 0;
+	RID rid;
+	memset(data, 0, PAGE_SIZE);
+	// [Format][SlotNum][FreeOffset][FreeSlot][FreeSize]
+	unsigned header[5] = {PAGE_SLOTTED, 0, DataPage::DATA_PAGE_HEADER_SIZE, 0, PAGE_SIZE - DataPage::DATA_PAGE_HEADER_SIZE};
+	memcpy(data, header, DataPage::DATA_PAGE_HEADER_SIZE);
+	DataPage page(data);
+	rid.pageNum = fileHandle.getNumberOfPages();
+	unsigned i = first;
+	for (; i < first + num; i++)
+	{
+		prepareWideRecord(recordDescriptor, i, record, &recordSize);
+		if (page.insertRecord(recordDescriptor, record, recordSize, rid) != 0)
+		{
+			break;
+		}
+		rids.push_back(rid);
+	}
+	assert(page.getFormat() == PAGE_SLOTTED && "Legacy page should keep its format.");
+	RC rc = fileHandle.appendPage(data, page.getDataSize());
+	assert(rc == success && "Appending a page should not fail.");
+	return i - first;
+}
+
+// every record by RID, every attribute against the raw record walked
+void checkRecords(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const vector<RID> &rids)
+{
+	char record[PAGE_SIZE];
+	char returnedData[PAGE_SIZE];
+	char attr[PAGE_SIZE];
+	int recordSize = 0;
+	RC rc;
+	for (unsigned i = 0; i < rids.size(); i++)
+	{
+		prepareWideRecord(recordDescriptor, i, record, &recordSize);
+		rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedData);
+		assert(rc == success && "Reading a record should not fail.");
+		assert(memcmp(record, returnedData, recordSize) == 0 && "Record read should be the same as inserted.");
+
+		Record raw(record, recordSize);
+		for (unsigned j = 0; j < recordDescriptor.size(); j += 4)
+		{
+			unsigned size = raw.getAttribute(recordDescriptor, j, attr);
+			memset(returnedData, 0, PAGE_SIZE);
+			rc = rbfm->readAttribute(fileHandle, recordDescriptor, rids[i], recordDescriptor[j].name, returnedData);
+			assert(rc == success && "Reading an attribute should not fail.");
+			assert(memcmp(attr, returnedData, size) == 0 && "Attribute read should be the same as inserted.");
+		}
+	}
+}
+
+// projected columns of every record, against the raw record; moved records are met out of RID order
+unsigned checkScan(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const vector<RID> &rids)
+{
+	char record[PAGE_SIZE];
+	char projected[PAGE_SIZE];
+	char returnedData[PAGE_SIZE];
+	int recordSize = 0;
+	RC rc;
+	RID rid;
+	vector<string> attributeNames;
+	attributeNames.push_back("c29");
+	attributeNames.push_back("c2");
+	attributeNames.push_back("c13");
+	attributeNames.push_back("c14");
+
+	RBFM_ScanIterator rbfm_ScanIterator;
+	rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, rbfm_ScanIterator);
+	assert(rc == success && "Scanning a file should not fail.");
+	map<pair<unsigned, unsigned>, unsigned> index;
+	for (unsigned i = 0; i < rids.size(); i++)
+	{
+		index[make_pair(rids[i].pageNum, rids[i].slotNum)] = i;
+	}
+	unsigned count = 0;
+	while (rbfm_ScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+	{
+		auto it = index.find(make_pair(rid.pageNum, rid.slotNum));
+		assert(it != index.end() && "Scan should return RIDs inserted.");
+		prepareWideRecord(recordDescriptor, it->second, record, &recordSize);
+		index.erase(it);
+		Record raw(record, recordSize);
+		unsigned size = raw.attributeProject(recordDescriptor, attributeNames, projected);
+		assert(memcmp(projected, returnedData, size) == 0 && "Projected attributes should be the same as inserted.");
+		count++;
+	}
+	rbfm_ScanIterator.close();
+	return count;
+}
+
+int RBFTest_FieldTable(RecordBasedFileManager *rbfm)
+{
+	// Functions tested
+	// 1. Create File
+	// 2. Insert wide Records with nulls, field tables are added
+	// 3. Read Records & Attributes
+	// 4. Scan with projection
+	// 5. Append PAGE_SLOTTED pages & read them
+	// 6. Convert File, records of a full page are moved
+	// 7. Destroy File
+	cout << endl << "***** In RBF Test Case Field Table *****" << endl;
+
+	RC rc;
+	string fileName = "test_fieldtable";
+
+	rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	rc = createFileShouldSucceed(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createWideRecordDescriptor(recordDescriptor);
+
+	// field table of a record alone
+	char record[PAGE_SIZE];
+	char encoded[PAGE_SIZE];
+	char returnedData[PAGE_SIZE];
+	int recordSize = 0;
+	prepareWideRecord(recordDescriptor, 3, record, &recordSize);
+	unsigned encodedSize = Record::encode(recordDescriptor, record, encoded);
+	assert(encodedSize == Record::getEncodedSize(recordDescriptor, recordSize) && "Encoded size should be counted.");
+	Record rec(encoded, encodedSize, true);
+	assert(rec.isNull(4) && !rec.isNull(5) && "Null fields should be kept.");
+	assert(rec.getAttribute(recordDescriptor, 4, returnedData) == 0 && "Null attribute should be empty.");
+	assert(rec.getRawData(recordDescriptor, returnedData) == (unsigned)recordSize && memcmp(record, returnedData, recordSize) == 0 &&
+		   "Record should be decoded as it was.");
+
+	vector<RID> rids;
+	RID rid;
+	unsigned numRecords = 500;
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		prepareWideRecord(recordDescriptor, i, record, &recordSize);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+		assert(rc == success && "Inserting a record should not fail.");
+		rids.push_back(rid);
+	}
+	checkRecords(rbfm, fileHandle, recordDescriptor, rids);
+	assert(checkScan(rbfm, fileHandle, recordDescriptor, rids) == numRecords && "Scan should return all records.");
+
+	// legacy pages after the new ones: one of few records, one full
+	unsigned newPages = fileHandle.getNumberOfPages();
+	unsigned legacy = appendLegacyPage(fileHandle, recordDescriptor, rids.size(), 5, rids);
+	assert(legacy == 5 && "Legacy records should fit.");
+	legacy = appendLegacyPage(fileHandle, recordDescriptor, rids.size(), PAGE_SIZE, rids);
+	assert(legacy > 5 && "Legacy page should be full.");
+	checkRecords(rbfm, fileHandle, recordDescriptor, rids);
+	assert(checkScan(rbfm, fileHandle, recordDescriptor, rids) == rids.size() && "Scan should return legacy records.");
+
+	unsigned unconverted = 0;
+	rc = rbfm->convertFile(fileHandle, recordDescriptor, unconverted);
+	assert(rc == success && "Converting a file should not fail.");
+	assert(unconverted == 0 && "Every legacy page should be converted.");
+
+	char *data = (char *)malloc(PAGE_SIZE);
+	rc = fileHandle.readPage(newPages, data);
+	assert(rc == success && "Reading a page should not fail.");
+	assert(DataPage(data).getFormat() == PAGE_SLOTTED_FIELDS && "Legacy page should be converted.");
+	rc = fileHandle.readPage(newPages + 1, data);
+	assert(rc == success && "Reading a page should not fail.");
+	assert(DataPage(data).getFormat() == PAGE_SLOTTED_FIELDS && "Full legacy page should be converted.");
+	assert(DataPage(data).getRecord(DataPage(data).getSlotNum() - 1).ptrFlag == REC_FORWARD && "Last record should be moved.");
+	free(data);
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+	checkRecords(rbfm, fileHandle, recordDescriptor, rids);
+	assert(checkScan(rbfm, fileHandle, recordDescriptor, rids) == rids.size() && "Scan should return all records.");
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	rc = destroyFileShouldSucceed(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	cout << "RBF Test Case Field Table Finished! The result will be examined." << endl << endl;
+
+	return 0;
+}
+
+int main()
+{
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+	remove("test_fieldtable");
+
+	RC rcmain = RBFTest_FieldTable(rbfm);
+	return rcmain;
+}
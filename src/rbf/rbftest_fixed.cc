@@ -0,0 +1,205 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <algorithm>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// columns of Int and Real only
+static void createFixedDescriptor(unsigned columns, vector<Attribute> &recordDescriptor)
+{
+	recordDescriptor.clear();
+	for (unsigned i = 0; i < columns; i++)
+	{
+		recordDescriptor.push_back(Attribute{"c" + to_string(i), i % 3 == 2 ? TypeReal : TypeInt, 4});
+	}
+}
+
+// i-th record, every seventh one has nulls
+static unsigned prepareFixedRecord(const vector<Attribute> &recordDescriptor, unsigned i, char *record)
+{
+	unsigned nullSize = getActualByteForNullsIndicator(recordDescriptor.size());
+	memset(record, 0, nullSize);
+	unsigned offset = nullSize;
+	for (unsigned attr = 0; attr < recordDescriptor.size(); attr++)
+	{
+		if (i % 7 == 0 && attr % 2 == 1)
+		{
+			record[attr / 8] |= 0x80 >> (attr % 8);
+			continue;
+		}
+		if (recordDescriptor[attr].type == TypeReal)
+		{
+			float value = i * 0.5f + attr;
+			memcpy(record + offset, &value, sizeof(float));
+		}
+		else
+		{
+			int value = i * 10 + attr;
+			memcpy(record + offset, &value, sizeof(int));
+		}
+		offset += 4;
+	}
+	return offset;
+}
+
+// FixedRecord reads records with no null as Record does, raw and encoded
+static void testAccess(unsigned columns)
+{
+	vector<Attribute> recordDescriptor;
+	createFixedDescriptor(columns, recordDescriptor);
+	FixedRecord<false> raw(recordDescriptor);
+	FixedRecord<true> encoded(recordDescriptor);
+	char record[PAGE_SIZE], encodedRecord[PAGE_SIZE], expected[PAGE_SIZE], returned[PAGE_SIZE];
+
+	vector<unsigned> attrs;
+	vector<string> attributeNames;
+	for (unsigned attr = 0; attr < columns; attr++)
+	{
+		// two runs and a single one
+		if (attr % 4 != 2)
+		{
+			attrs.push_back(attr);
+			attributeNames.push_back(recordDescriptor[attr].name);
+		}
+	}
+	for (unsigned i = 0; i < 14; i++)
+	{
+		unsigned recordSize = prepareFixedRecord(recordDescriptor, i, record);
+		unsigned encodedSize = Record::encode(recordDescriptor, record, encodedRecord);
+		if (i % 7 == 0)
+		{
+			assert(!raw.applies(record) && !encoded.applies(encodedRecord) && "A record with a null should be left to Record.");
+			continue;
+		}
+		assert(raw.applies(record) && encoded.applies(encodedRecord) && "A record with no null should be read at fixed offsets.");
+		assert(raw.getSize() == recordSize && encoded.getSize() == encodedSize && "Size should be fixed.");
+
+		Record rawRecord(record, recordSize);
+		Record encodedView(encodedRecord, encodedSize, true);
+		for (unsigned attr = 0; attr < columns; attr++)
+		{
+			assert(memcmp(raw.view(record, attr), rawRecord.viewAttribute(recordDescriptor, attr), 4) == 0 && "Attribute should be at its offset.");
+			assert(memcmp(encoded.view(encodedRecord, attr), rawRecord.viewAttribute(recordDescriptor, attr), 4) == 0 &&
+				   "Attribute should be at its offset.");
+		}
+
+		unsigned size = encodedView.attributeProject(recordDescriptor, attrs, expected);
+		assert(encoded.project(encodedRecord, attrs, returned) == size && memcmp(expected, returned, size) == 0 &&
+			   "Projection should be the same as by Record.");
+		size = rawRecord.attributeProjectCompress(recordDescriptor, attributeNames, expected);
+		assert(raw.projectCompress(record, attrs, attributeNames.size(), record) == size && memcmp(expected, record, size) == 0 &&
+			   "Projection in place should be the same as by Record.");
+	}
+
+	vector<Attribute> withVarChar;
+	createRecordDescriptor(withVarChar);
+	assert(!FixedRecord<false>::isFixed(withVarChar) && !FixedRecord<false>(withVarChar).applies(record) && "A VarChar should leave records to Record.");
+}
+
+// rows of a scan against records read one by one and projected by Record
+static void testScan(RecordBasedFileManager *rbfm, const string &fileName, PageFormat format)
+{
+	RC rc;
+	remove(fileName.c_str());
+	rc = rbfm->createFile(fileName, format);
+	assert(rc == success && "Creating the file should not fail.");
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createFixedDescriptor(10, recordDescriptor);
+	char record[PAGE_SIZE], returnedData[PAGE_SIZE], expected[PAGE_SIZE];
+	unsigned numRecords = 3000;
+	vector<RID> rids(numRecords);
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		prepareFixedRecord(recordDescriptor, i, record);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+		assert(rc == success && "Inserting a record should not fail.");
+	}
+
+	vector<string> attributeNames = {"c0", "c1", "c2", "c5", "c9"};
+	vector<unsigned> attrs;
+	Record::getAttributeIndexes(recordDescriptor, attributeNames, attrs);
+	// c1 is null in every seventh record
+	int value = 20000;
+	RBFM_ScanIterator rbfm_ScanIterator;
+	rc = rbfm->scan(fileHandle, recordDescriptor, "c1", GE_OP, &value, attributeNames, rbfm_ScanIterator);
+	assert(rc == success && "Scanning a file should not fail.");
+	RID rid;
+	unsigned count = 0;
+	while (rbfm_ScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+	{
+		unsigned i = find_if(rids.begin(), rids.end(), [&](const RID &r) { return r.pageNum == rid.pageNum && r.slotNum == rid.slotNum; }) - rids.begin();
+		assert(i < numRecords && i % 7 != 0 && i * 10 + 1 >= (unsigned)value && "Scan should return matching records.");
+		unsigned recordSize = prepareFixedRecord(recordDescriptor, i, record);
+		unsigned size = Record(record, recordSize).attributeProject(recordDescriptor, attrs, expected);
+		assert(memcmp(expected, returnedData, size) == 0 && "Scan should project as Record.");
+		count++;
+	}
+	rbfm_ScanIterator.close();
+	unsigned matching = 0;
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		matching += i % 7 != 0 && i * 10 + 1 >= (unsigned)value;
+	}
+	assert(count == matching && "Scan should return all matching records.");
+
+	// records with nulls are read as well when nothing is compared
+	rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, rbfm_ScanIterator);
+	assert(rc == success && "Scanning a file should not fail.");
+	count = 0;
+	while (rbfm_ScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+	{
+		count++;
+	}
+	rbfm_ScanIterator.close();
+	assert(count == numRecords && "Scan should return all records.");
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+}
+
+int RBFTest_Fixed(RecordBasedFileManager *rbfm)
+{
+	// Functions tested
+	// 1. FixedRecord of Int and Real descriptors, raw and encoded records read and projected as by Record
+	// 2. Records with a null and descriptors with a VarChar are left to Record
+	// 3. Scan with a condition and a projection, records with nulls among them
+	// 4. Of PAGE_SLOTTED_FIELDS and PAGE_COMPACT files
+	cout << endl << "***** In RBF Test Case Fixed *****" << endl;
+
+	testAccess(3);
+	testAccess(8);
+	testAccess(19);
+	testScan(rbfm, "test_fixed", PAGE_SLOTTED_FIELDS);
+	testScan(rbfm, "test_fixed", PAGE_COMPACT);
+
+	cout << "RBF Test Case Fixed Finished! The result will be examined." << endl << endl;
+
+	return 0;
+}
+
+int main()
+{
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+	remove("test_fixed");
+
+	RC rcmain = RBFTest_Fixed(rbfm);
+	return rcmain;
+}
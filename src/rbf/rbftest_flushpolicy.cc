@@ -0,0 +1,130 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// number of pages recorded in the file header on disk
+unsigned pagesOnDisk(PagedFileManager *pfm, const string &fileName)
+{
+	FileHandle fileHandle;
+	RC rc = pfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+	unsigned pages = fileHandle.getNumberOfPages();
+	rc = pfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+	return pages;
+}
+
+int RBFTest_FlushPolicy(PagedFileManager *pfm)
+{
+	// Functions tested
+	// 1. Create File
+	// 2. Append Pages, metadata is not written
+	// 3. Sync
+	// 4. Flush Policy (every N ops)
+	// 5. Close/Reopen File & Counters
+	// 6. Destroy File
+	cout << endl << "***** In RBF Test Case Flush Policy *****" << endl;
+
+	RC rc;
+	string fileName = "test_flushpolicy";
+
+	rc = pfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	rc = pfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	char *data = (char *)malloc(PAGE_SIZE);
+	char *buffer = (char *)malloc(PAGE_SIZE);
+	for (unsigned i = 0; i < 10; i++)
+	{
+		memset(data, i + 30, PAGE_SIZE);
+		rc = fileHandle.appendPage(data);
+		assert(rc == success && "Appending a page should not fail.");
+	}
+	assert(pagesOnDisk(pfm, fileName) == 0 && "Header should not be written by appendPage().");
+
+	rc = fileHandle.sync();
+	assert(rc == success && "Sync should not fail.");
+	assert(pagesOnDisk(pfm, fileName) == 10 && "Header should be written by sync().");
+
+	fileHandle.setFlushPolicy(4, 0);
+	for (unsigned i = 10; i < 14; i++)
+	{
+		memset(data, i + 30, PAGE_SIZE);
+		rc = fileHandle.appendPage(data);
+		assert(rc == success && "Appending a page should not fail.");
+	}
+	assert(pagesOnDisk(pfm, fileName) == 14 && "Header should be written every 4 ops.");
+
+	rc = fileHandle.appendPage(data);
+	assert(rc == success && "Appending a page should not fail.");
+	rc = fileHandle.writePage(0, data);
+	assert(rc == success && "Writing a page should not fail.");
+
+	unsigned readPageCount = 0, writePageCount = 0, appendPageCount = 0;
+	fileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount);
+
+	rc = pfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	// everything should be written by close()
+	FileHandle fileHandle2;
+	rc = pfm->openFile(fileName, fileHandle2);
+	assert(rc == success && "Opening the file should not fail.");
+	assert(fileHandle2.getNumberOfPages() == 15 && "The number of pages should be correct.");
+
+	unsigned readPageCount2 = 0, writePageCount2 = 0, appendPageCount2 = 0;
+	fileHandle2.collectCounterValues(readPageCount2, writePageCount2, appendPageCount2);
+	assert(readPageCount2 == readPageCount && writePageCount2 == writePageCount && appendPageCount2 == appendPageCount && "Counters should be persisted.");
+
+	rc = fileHandle2.readPage(0, buffer);
+	assert(rc == success && "Reading a page should not fail.");
+	assert(memcmp(data, buffer, PAGE_SIZE) == 0 && "Page content should be persisted.");
+	for (unsigned i = 1; i < 14; i++)
+	{
+		memset(data, i + 30, PAGE_SIZE);
+		rc = fileHandle2.readPage(i, buffer);
+		assert(rc == success && "Reading a page should not fail.");
+		assert(memcmp(data, buffer, PAGE_SIZE) == 0 && "Page content should be persisted.");
+	}
+
+	rc = pfm->closeFile(fileHandle2);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = pfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	rc = destroyFileShouldSucceed(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	free(data);
+	free(buffer);
+
+	cout << "RBF Test Case Flush Policy Finished! The result will be examined." << endl << endl;
+
+	return 0;
+}
+
+int main()
+{
+	PagedFileManager *pfm = PagedFileManager::instance();
+
+	remove("test_flushpolicy");
+
+	RC rcmain = RBFTest_FlushPolicy(pfm);
+	return rcmain;
+}
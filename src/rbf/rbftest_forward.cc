@@ -0,0 +1,216 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// records of ptrFlag in the whole file
+unsigned countRecords(FileHandle &fileHandle, int ptrFlag)
+{
+	char *data = (char *)malloc(PAGE_SIZE);
+	unsigned count = 0;
+	for (unsigned i = 0; i < fileHandle.getNumberOfPages(); i++)
+	{
+		RC rc = fileHandle.readPage(i, data);
+		assert(rc == success && "Reading a page should not fail.");
+		DataPage page(data);
+		for (unsigned j = 0; j < page.getSlotNum(); j++)
+		{
+			count += page.getRecord(j).ptrFlag == ptrFlag ? 1 : 0;
+		}
+	}
+	free(data);
+	return count;
+}
+
+// name of record i is nameLength chars
+void checkRecord(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const RID &rid,
+				 unsigned i, unsigned nameLength)
+{
+	unsigned char nullsIndicator[1] = {0};
+	char record[PAGE_SIZE];
+	char returnedData[PAGE_SIZE];
+	int recordSize = 0;
+	prepareRecord(recordDescriptor.size(), nullsIndicator, nameLength, string(nameLength, 'a' + i % 26), i, 177.8, i, record, &recordSize);
+	RC rc = rbfm->readRecord(fileHandle, recordDescriptor, rid, returnedData);
+	assert(rc == success && "Reading a record should not fail.");
+	assert(memcmp(record, returnedData, recordSize) == 0 && "Record read should be the same as updated.");
+
+	int age = 0;
+	rc = rbfm->readAttribute(fileHandle, recordDescriptor, rid, "Age", returnedData);
+	assert(rc == success && "Reading an attribute should not fail.");
+	memcpy(&age, returnedData, sizeof(int));
+	assert(age == (int)i && "Attribute read should be the same as updated.");
+}
+
+void updateRecord(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor, const RID &rid,
+				  unsigned i, unsigned nameLength)
+{
+	unsigned char nullsIndicator[1] = {0};
+	char record[PAGE_SIZE];
+	int recordSize = 0;
+	prepareRecord(recordDescriptor.size(), nullsIndicator, nameLength, string(nameLength, 'a' + i % 26), i, 177.8, i, record, &recordSize);
+	RC rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rid);
+	assert(rc == success && "Updating a record should not fail.");
+}
+
+int RBFTest_Forward(RecordBasedFileManager *rbfm)
+{
+	// Functions tested
+	// 1. Create File & Insert Records
+	// 2. Update Records in place
+	// 3. Update Records larger, moved with forwarding pointers
+	// 4. Read Records & Attributes by the same RIDs
+	// 5. Scan returns each Record once
+	// 6. Update moved Records again, still one hop
+	// 7. Update moved Records smaller, back to their pages
+	// 8. Delete moved Records
+	// 9. Destroy File
+	cout << endl << "***** In RBF Test Case Forward *****" << endl;
+
+	RC rc;
+	string fileName = "test_forward";
+
+	rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	rc = createFileShouldSucceed(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+	recordDescriptor[0].length = (AttrLength)1000;
+
+	unsigned char nullsIndicator[1] = {0};
+	char record[PAGE_SIZE];
+	char returnedData[PAGE_SIZE];
+	int recordSize = 0;
+	unsigned numRecords = 500;
+	vector<RID> rids;
+	vector<unsigned> lengths;
+	RID rid;
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		prepareRecord(recordDescriptor.size(), nullsIndicator, 8, string(8, 'a' + i % 26), i, 177.8, i, record, &recordSize);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+		assert(rc == success && "Inserting a record should not fail.");
+		rids.push_back(rid);
+		lengths.push_back(8);
+	}
+	unsigned pages = fileHandle.getNumberOfPages();
+
+	// smaller, in place
+	for (unsigned i = 1; i < numRecords; i += 5)
+	{
+		updateRecord(rbfm, fileHandle, recordDescriptor, rids[i], i, 2);
+		lengths[i] = 2;
+	}
+	assert(fileHandle.getNumberOfPages() == pages && countRecords(fileHandle, REC_FORWARD) == 0 && "Smaller records should stay.");
+
+	// larger, pages are full
+	for (unsigned i = 0; i < numRecords; i += 5)
+	{
+		updateRecord(rbfm, fileHandle, recordDescriptor, rids[i], i, 300);
+		lengths[i] = 300;
+	}
+	unsigned forwarded = countRecords(fileHandle, REC_FORWARD);
+	assert(forwarded > 0 && forwarded == countRecords(fileHandle, REC_MOVED) && "Larger records should be moved.");
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		checkRecord(rbfm, fileHandle, recordDescriptor, rids[i], i, lengths[i]);
+	}
+
+	vector<string> attributeNames;
+	attributeNames.push_back("Age");
+	RBFM_ScanIterator rbfm_ScanIterator;
+	rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, rbfm_ScanIterator);
+	assert(rc == success && "Scanning a file should not fail.");
+	vector<bool> seen(numRecords, false);
+	unsigned count = 0;
+	while (rbfm_ScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+	{
+		int age = 0;
+		memcpy(&age, returnedData + 1, sizeof(int));
+		assert(age >= 0 && age < (int)numRecords && !seen[age] && "Each record should be scanned once.");
+		assert(rid.pageNum == rids[age].pageNum && rid.slotNum == rids[age].slotNum && "Moved record should be scanned by its RID.");
+		seen[age] = true;
+		count++;
+	}
+	rbfm_ScanIterator.close();
+	assert(count == numRecords && "Scan should return all records.");
+
+	// moved again from home, never a chain
+	for (unsigned i = 0; i < numRecords; i += 5)
+	{
+		updateRecord(rbfm, fileHandle, recordDescriptor, rids[i], i, 1000);
+		lengths[i] = 1000;
+	}
+	forwarded = countRecords(fileHandle, REC_FORWARD);
+	assert(forwarded == countRecords(fileHandle, REC_MOVED) && "One moved record for each pointer.");
+	for (unsigned i = 0; i < numRecords; i += 5)
+	{
+		checkRecord(rbfm, fileHandle, recordDescriptor, rids[i], i, lengths[i]);
+	}
+
+	// back home
+	for (unsigned i = 0; i < numRecords; i += 5)
+	{
+		updateRecord(rbfm, fileHandle, recordDescriptor, rids[i], i, 8);
+		lengths[i] = 8;
+	}
+	assert(countRecords(fileHandle, REC_FORWARD) == 0 && countRecords(fileHandle, REC_MOVED) == 0 && "Smaller records should be back.");
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		checkRecord(rbfm, fileHandle, recordDescriptor, rids[i], i, lengths[i]);
+	}
+
+	// both pointer and record are deleted
+	for (unsigned i = 0; i < numRecords; i += 5)
+	{
+		updateRecord(rbfm, fileHandle, recordDescriptor, rids[i], i, 300);
+		rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+		assert(rc == success && "Deleting a record should not fail.");
+		rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedData);
+		assert(rc != success && "Reading a deleted record should fail.");
+		rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[i]);
+		assert(rc != success && "Updating a deleted record should fail.");
+	}
+	assert(countRecords(fileHandle, REC_FORWARD) == 0 && countRecords(fileHandle, REC_MOVED) == 0 && "Moved records should be deleted.");
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	rc = destroyFileShouldSucceed(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	cout << "RBF Test Case Forward Finished! The result will be examined." << endl << endl;
+
+	return 0;
+}
+
+int main()
+{
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+	remove("test_forward");
+
+	RC rcmain = RBFTest_Forward(rbfm);
+	return rcmain;
+}
@@ -0,0 +1,192 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <algorithm>
+#include <set>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// one int column, the smallest records a page holds the most of
+static void createTinyDescriptor(vector<Attribute> &recordDescriptor)
+{
+	recordDescriptor.clear();
+	recordDescriptor.push_back(Attribute{"v", TypeInt, 4});
+}
+
+static unsigned prepareTinyRecord(int value, char *record)
+{
+	record[0] = 0;
+	memcpy(record + 1, &value, sizeof(int));
+	return 1 + sizeof(int);
+}
+
+// free bytes walked from the slots, as the page kept them before
+static unsigned walkFreeSize(DataPage &page, unsigned headerSize)
+{
+	unsigned free = PAGE_SIZE - DataPage::DATA_PAGE_HEADER_SIZE - page.getSlotNum() * DataPage::SLOT_SIZE;
+	for (unsigned i = 0; i < page.getSlotNum(); i++)
+	{
+		Record record = page.getRecord(i);
+		if (record.ptrFlag != REC_DELETED)
+		{
+			free -= record.sizeWithoutHeader() + headerSize;
+		}
+	}
+	return free;
+}
+
+static void testPage(PageFormat format)
+{
+	vector<Attribute> recordDescriptor;
+	createTinyDescriptor(recordDescriptor);
+	char data[PAGE_SIZE], record[PAGE_SIZE];
+	memset(data, 0, PAGE_SIZE);
+	DataPage page(data);
+	page.init(format, recordDescriptor);
+	unsigned headerSize = format == PAGE_COMPACT ? 0 : Record::REC_HEADER_SIZE;
+	RID rid = {0, 0};
+
+	// filled with tiny records, each takes a new slot
+	unsigned recordSize = prepareTinyRecord(0, record);
+	unsigned bodySize = page.getBodySize(recordDescriptor, recordSize);
+	unsigned slotNum = 0;
+	while (page.canFit(bodySize))
+	{
+		prepareTinyRecord(slotNum, record);
+		RC rc = page.insertRecord(recordDescriptor, record, recordSize, rid);
+		assert(rc == success && rid.slotNum == slotNum && "A new slot should be added.");
+		slotNum++;
+	}
+	assert(slotNum > 100 && page.getSlotNum() == slotNum && "Page should hold many tiny records.");
+	assert(page.getFreeSize() == walkFreeSize(page, headerSize) && "Free size should be kept.");
+	assert(page.insertRecord(recordDescriptor, record, recordSize, rid) != success && "Full page should refuse a record.");
+
+	// deleted slots are taken again before any new one
+	set<unsigned> deleted;
+	for (unsigned i = 1; i < slotNum; i += 3)
+	{
+		RC rc = page.deleteRecord(i);
+		assert(rc == success && "Deleting a record should not fail.");
+		deleted.insert(i);
+	}
+	assert(page.deleteRecord(1) != success && "Deleting a deleted record should fail.");
+	assert(page.getFreeSize() == walkFreeSize(page, headerSize) && "Free size should be kept.");
+	set<unsigned> taken;
+	for (unsigned i = 0; i < deleted.size(); i++)
+	{
+		assert(page.canFit(bodySize) && "A deleted slot should fit a record.");
+		prepareTinyRecord(1000 + i, record);
+		RC rc = page.insertRecord(recordDescriptor, record, recordSize, rid);
+		assert(rc == success && deleted.count(rid.slotNum) == 1 && taken.count(rid.slotNum) == 0 && "A deleted slot should be reused once.");
+		taken.insert(rid.slotNum);
+		assert(page.getFreeSize() == walkFreeSize(page, headerSize) && "Free size should be kept.");
+	}
+	assert(page.getSlotNum() == slotNum && "No slot should be added while deleted ones are left.");
+	assert(!page.canFit(bodySize) && "Page should be full again.");
+
+	// a record updated in place and moved within the page keeps the chain
+	for (unsigned i = 0; i < slotNum; i += 5)
+	{
+		page.deleteRecord(i);
+	}
+	unsigned updated = 3;
+	prepareTinyRecord(7, record);
+	RC rc = page.updateRecord(recordDescriptor, updated, record, recordSize);
+	assert(rc == success && page.getFreeSize() == walkFreeSize(page, headerSize) && "Free size should be kept by updates.");
+
+	// trailing deleted slots are dropped, the lowest deleted slot comes first
+	for (unsigned i = slotNum - 4; i < slotNum; i++)
+	{
+		page.deleteRecord(i);
+	}
+	unsigned gained = page.vacuum();
+	assert(gained > 0 && page.getSlotNum() < slotNum && "Trailing deleted slots should be dropped.");
+	assert(page.getFreeSize() == walkFreeSize(page, headerSize) && "Free size should be kept by vacuum.");
+	rc = page.insertRecord(recordDescriptor, record, recordSize, rid);
+	assert(rc == success && rid.slotNum == 0 && "Lowest deleted slot should be reused after vacuum.");
+	assert(page.getDataSize() + page.getFreeSize() == PAGE_SIZE && "Data and free sizes should add up.");
+}
+
+int RBFTest_FreeSlots(RecordBasedFileManager *rbfm)
+{
+	// Functions tested
+	// 1. Fill a page of tiny records, delete some, deleted slots are reused before new ones
+	// 2. Free size is kept by insert, delete, update and vacuum, the same as walked from the slots
+	// 3. Of PAGE_SLOTTED_FIELDS and PAGE_COMPACT pages
+	// 4. Delete and insert Records of a file, RIDs of deleted records are reused
+	cout << endl << "***** In RBF Test Case Free Slots *****" << endl;
+
+	testPage(PAGE_SLOTTED_FIELDS);
+	testPage(PAGE_COMPACT);
+
+	RC rc;
+	string fileName = "test_freeslots";
+	rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createTinyDescriptor(recordDescriptor);
+	char record[PAGE_SIZE], returnedData[PAGE_SIZE];
+	unsigned numRecords = 3000;
+	vector<RID> rids(numRecords);
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		prepareTinyRecord(i, record);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+		assert(rc == success && "Inserting a record should not fail.");
+	}
+	unsigned pages = fileHandle.getNumberOfPages();
+	for (unsigned i = 0; i < numRecords; i += 2)
+	{
+		rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+		assert(rc == success && "Deleting a record should not fail.");
+	}
+	for (unsigned i = 0; i < numRecords; i += 2)
+	{
+		RID rid;
+		unsigned recordSize = prepareTinyRecord(numRecords + i, record);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+		assert(rc == success && "Inserting a record should not fail.");
+		rc = rbfm->readRecord(fileHandle, recordDescriptor, rid, returnedData);
+		assert(rc == success && memcmp(record, returnedData, recordSize) == 0 && "Record should be read as inserted.");
+	}
+	assert(fileHandle.getNumberOfPages() == pages && "Deleted slots should be reused, no page added.");
+	for (unsigned i = 1; i < numRecords; i += 2)
+	{
+		unsigned recordSize = prepareTinyRecord(i, record);
+		rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedData);
+		assert(rc == success && memcmp(record, returnedData, recordSize) == 0 && "Records left should be kept.");
+	}
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	cout << "RBF Test Case Free Slots Finished! The result will be examined." << endl << endl;
+
+	return 0;
+}
+
+int main()
+{
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+	remove("test_freeslots");
+
+	RC rcmain = RBFTest_FreeSlots(rbfm);
+	return rcmain;
+}
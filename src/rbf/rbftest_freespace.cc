@@ -0,0 +1,155 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+int RBFTest_FreeSpace(RecordBasedFileManager *rbfm)
+{
+	// Functions tested
+	// 1. Create File
+	// 2. Insert Records
+	// 3. Delete Records of some pages
+	// 4. Close/Reopen File, free space map is read back
+	// 5. Insert Records, deleted space is reused by reading one page each
+	// 6. Insert Records into reserved pages
+	// 7. Destroy File
+	cout << endl << "***** In RBF Test Case Free Space *****" << endl;
+
+	RC rc;
+	string fileName = "test_freespace";
+
+	rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	rc = createFileShouldSucceed(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+	int nullFieldsIndicatorActualSize = getActualByteForNullsIndicator(recordDescriptor.size());
+	unsigned char *nullsIndicator = (unsigned char *)malloc(nullFieldsIndicatorActualSize);
+	memset(nullsIndicator, 0, nullFieldsIndicatorActualSize);
+	void *record = malloc(100);
+	void *returnedData = malloc(100);
+	int recordSize = 0;
+	unsigned numRecords = 2000;
+	vector<RID> rids;
+	RID rid;
+
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		prepareRecord(recordDescriptor.size(), nullsIndicator, 8, "Anteater", i, 177.8, i, record, &recordSize);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+		assert(rc == success && "Inserting a record should not fail.");
+		rids.push_back(rid);
+	}
+	unsigned numPages = fileHandle.getNumberOfPages();
+	assert(numPages > 4 && "Records should take more than four pages.");
+
+	// free the 2nd and the 4th pages
+	unsigned numDeleted = 0;
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		if (rids[i].pageNum == 1 || rids[i].pageNum == 3)
+		{
+			rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+			assert(rc == success && "Deleting a record should not fail.");
+			numDeleted++;
+		}
+	}
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	// as many as deleted fit in the freed pages, each insert reads only the page it goes to
+	for (unsigned i = 0; i < numDeleted; i++)
+	{
+		unsigned readPageCount = 0, readPageCount1 = 0, writePageCount = 0, appendPageCount = 0;
+		fileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount);
+		prepareRecord(recordDescriptor.size(), nullsIndicator, 8, "Anteater", i, 177.8, i, record, &recordSize);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+		assert(rc == success && "Inserting a record should not fail.");
+		fileHandle.collectCounterValues(readPageCount1, writePageCount, appendPageCount);
+		assert(readPageCount1 - readPageCount == 1 && "Insert should read one page only.");
+
+		rc = rbfm->readRecord(fileHandle, recordDescriptor, rid, returnedData);
+		assert(rc == success && "Reading a record should not fail.");
+		assert(memcmp(record, returnedData, recordSize) == 0 && "Returned data should be the same as inserted.");
+	}
+	assert(fileHandle.getNumberOfPages() == numPages && "Deleted space should be reused.");
+
+	// reserved pages are empty data pages, used before any page is appended
+	rc = fileHandle.reservePages(2);
+	assert(rc == success && "Reserving pages should not fail.");
+	unsigned numInserted = 0;
+	do
+	{
+		prepareRecord(recordDescriptor.size(), nullsIndicator, 8, "Anteater", numInserted, 177.8, numInserted, record, &recordSize);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+		assert(rc == success && "Inserting a record should not fail.");
+		numInserted++;
+	} while (rid.pageNum < numPages && numInserted < numRecords);
+	assert(rid.pageNum >= numPages && "Record should go to a reserved page.");
+	assert(fileHandle.getNumberOfPages() == numPages + 2 && "No page should be appended.");
+	rc = rbfm->readRecord(fileHandle, recordDescriptor, rid, returnedData);
+	assert(rc == success && "Reading a record should not fail.");
+	assert(memcmp(record, returnedData, recordSize) == 0 && "Returned data should be the same as inserted.");
+
+	// all records are scanned, reserved pages included
+	vector<string> attributeNames;
+	attributeNames.push_back("Age");
+	RBFM_ScanIterator rbfm_ScanIterator;
+	rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, rbfm_ScanIterator);
+	assert(rc == success && "Scanning a file should not fail.");
+	unsigned count = 0;
+	while (rbfm_ScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+	{
+		count++;
+	}
+	rbfm_ScanIterator.close();
+	assert(count == numRecords + numInserted && "Scan should return all records.");
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	rc = destroyFileShouldSucceed(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	free(nullsIndicator);
+	free(record);
+	free(returnedData);
+
+	cout << "RBF Test Case Free Space Finished! The result will be examined." << endl << endl;
+
+	return 0;
+}
+
+int main()
+{
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+	remove("test_freespace");
+
+	RC rcmain = RBFTest_FreeSpace(rbfm);
+	return rcmain;
+}
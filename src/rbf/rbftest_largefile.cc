@@ -0,0 +1,147 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+int RBFTest_LargeFile(PagedFileManager *pfm)
+{
+	// Functions tested
+	// 1. Create File
+	// 2. Append Pages & Reserve Pages, file grows over 8 GB sparsely
+	// 3. Write Pages around 4 GB offset
+	// 4. Close/Reopen File, header and directory pages are read back
+	// 5. Scan all Pages by readPages
+	// 6. Destroy File
+	cout << endl << "***** In RBF Test Case Large File *****" << endl;
+
+	RC rc;
+	string fileName = "test_largefile";
+	// 8 GB + 4 MB
+	unsigned numPages = (1 << 21) + DIR_PAGE_LEN;
+	// the page across 4 GB offset
+	PageNum page4G = ((1ULL << 32) - FILEHEADER_SIZE) / PAGE_SIZE - 1;
+	PageNum marked[] = {0, 1, 2, page4G, page4G + 1, numPages - 2, numPages - 1};
+	unsigned markedNum = sizeof(marked) / sizeof(PageNum);
+
+	rc = pfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	rc = createFileShouldSucceed(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	rc = pfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	char *data = (char *)malloc(PAGE_SIZE);
+	for (unsigned i = 0; i < 3; i++)
+	{
+		memset(data, i % 96 + 30, PAGE_SIZE);
+		rc = fileHandle.appendPage(data);
+		assert(rc == success && "Appending a page should not fail.");
+	}
+	rc = fileHandle.reservePages(numPages - 4);
+	assert(rc == success && "Reserving pages should not fail.");
+	memset(data, (numPages - 1) % 96 + 30, PAGE_SIZE);
+	rc = fileHandle.appendPage(data);
+	assert(rc == success && "Appending a page should not fail.");
+	assert(fileHandle.getNumberOfPages() == numPages && "The number of pages should be right.");
+
+	for (unsigned i = 3; i < markedNum - 1; i++)
+	{
+		memset(data, marked[i] % 96 + 30, PAGE_SIZE);
+		rc = fileHandle.writePage(marked[i], data);
+		assert(rc == success && "Writing a page should not fail.");
+	}
+	rc = pfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	struct stat st;
+	stat(fileName.c_str(), &st);
+	assert((size_t)st.st_size > (1ULL << 33) && "The file should be larger than 8 GB.");
+	cout << "File size: " << st.st_size << " bytes, " << st.st_blocks * 512 << " bytes on disk" << endl;
+
+	rc = pfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+	assert(fileHandle.getNumberOfPages() == numPages && "The number of pages should be read back.");
+
+	uint64_t readPageCount = 0, writePageCount = 0, appendPageCount = 0;
+	fileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount);
+	assert(appendPageCount == numPages && "Reserved pages should be counted as appended.");
+
+	// directory pages after data pages
+	unsigned size = 0;
+	rc = fileHandle.getPageSize(numPages - 1, size);
+	assert(rc == success && size == PAGE_SIZE && "Data size of the last page should be read back.");
+	rc = fileHandle.getPageSize(numPages - 3, size);
+	assert(rc == success && size == 0 && "Data size of a reserved page should be 0.");
+
+	// full scan, marked pages have their pattern, all others are zeros
+	unsigned chunkPages = SCAN_CHUNK_PAGES;
+	char *chunk = (char *)malloc(chunkPages * PAGE_SIZE);
+	char *zeros = (char *)calloc(1, PAGE_SIZE);
+	unsigned next = 0;
+	for (PageNum start = 0; start < numPages; start += chunkPages)
+	{
+		unsigned n = min(chunkPages, numPages - start);
+		rc = fileHandle.readPages(start, n, chunk);
+		assert(rc == success && "Reading pages should not fail.");
+		for (PageNum i = start; i < start + n; i++)
+		{
+			const char *expected = zeros;
+			if (next < markedNum && marked[next] == i)
+			{
+				memset(data, i % 96 + 30, PAGE_SIZE);
+				expected = data;
+				next++;
+			}
+			if (memcmp(expected, chunk + (size_t)(i - start) * PAGE_SIZE, PAGE_SIZE) != 0)
+			{
+				cout << "[FAIL] Test Case Large File Failed! Page " << i << " is wrong." << endl << endl;
+				free(data);
+				free(chunk);
+				free(zeros);
+				return -1;
+			}
+		}
+	}
+	assert(next == markedNum && "All marked pages should be scanned.");
+
+	rc = pfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = pfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	rc = destroyFileShouldSucceed(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	free(data);
+	free(chunk);
+	free(zeros);
+
+	cout << "RBF Test Case Large File Finished! The result will be examined." << endl << endl;
+
+	return 0;
+}
+
+int main()
+{
+	PagedFileManager *pfm = PagedFileManager::instance();
+
+	remove("test_largefile");
+
+	RC rcmain = RBFTest_LargeFile(pfm);
+	return rcmain;
+}
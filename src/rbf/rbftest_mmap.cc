@@ -0,0 +1,155 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+int RBFTest_Mmap(RecordBasedFileManager *rbfm)
+{
+	// Functions tested
+	// 1. Create File
+	// 2. Open File with IO_MMAP
+	// 3. Append/Write Pages & View Pages in place (remapped when grows)
+	// 4. Insert Records
+	// 5. Scan & Read Records from the mapping
+	// 6. Close File
+	// 7. Destroy File
+	cout << endl << "***** In RBF Test Case Mmap *****" << endl;
+
+	RC rc;
+	string fileName = "test_mmap";
+
+	rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	rc = createFileShouldSucceed(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle, IO_MMAP);
+	assert(rc == success && "Opening the file should not fail.");
+
+	// raw pages, every append grows the mapping
+	char *data = (char *)malloc(PAGE_SIZE);
+	const char *page = nullptr;
+	for (unsigned i = 0; i < 20; i++)
+	{
+		memset(data, i + 30, PAGE_SIZE);
+		rc = fileHandle.appendPage(data);
+		assert(rc == success && "Appending a page should not fail.");
+
+		rc = fileHandle.viewPage(i, page);
+		assert(rc == success && "Viewing a page should not fail.");
+		assert(memcmp(data, page, PAGE_SIZE) == 0 && "Appended page should be seen in place.");
+		rc = fileHandle.releasePage(i);
+		assert(rc == success && "Releasing a page should not fail.");
+	}
+
+	// dirty frame in buffer pool should be seen by the mapping
+	memset(data, 'W', PAGE_SIZE);
+	rc = fileHandle.writePage(3, data);
+	assert(rc == success && "Writing a page should not fail.");
+	rc = fileHandle.viewPage(3, page);
+	assert(rc == success && "Viewing a page should not fail.");
+	assert(memcmp(data, page, PAGE_SIZE) == 0 && "Written page should be seen in place.");
+	fileHandle.releasePage(3);
+
+	rc = fileHandle.viewPage(20, page);
+	assert(rc != success && "Viewing a page out of file should fail.");
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	// records
+	rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+	rc = rbfm->openFile(fileName, fileHandle, IO_MMAP);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+	int nullFieldsIndicatorActualSize = getActualByteForNullsIndicator(recordDescriptor.size());
+	unsigned char *nullsIndicator = (unsigned char *)malloc(nullFieldsIndicatorActualSize);
+	memset(nullsIndicator, 0, nullFieldsIndicatorActualSize);
+	void *record = malloc(100);
+	void *returnedData = malloc(100);
+	int recordSize = 0;
+	unsigned numRecords = 2000;
+	vector<RID> rids;
+	RID rid;
+
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		prepareRecord(recordDescriptor.size(), nullsIndicator, 8, "Anteater", i, 177.8, i, record, &recordSize);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+		assert(rc == success && "Inserting a record should not fail.");
+		rids.push_back(rid);
+	}
+	assert(fileHandle.getNumberOfPages() > 1 && "Records should take more than one page.");
+
+	for (unsigned i = 0; i < numRecords; i += 97)
+	{
+		prepareRecord(recordDescriptor.size(), nullsIndicator, 8, "Anteater", i, 177.8, i, record, &recordSize);
+		rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedData);
+		assert(rc == success && "Reading a record should not fail.");
+		assert(memcmp(record, returnedData, recordSize) == 0 && "Returned data should be the same as inserted.");
+	}
+
+	int threshold = 1000;
+	vector<string> attributeNames;
+	attributeNames.push_back("Age");
+	RBFM_ScanIterator rbfm_ScanIterator;
+	rc = rbfm->scan(fileHandle, recordDescriptor, "Age", GE_OP, &threshold, attributeNames, rbfm_ScanIterator);
+	assert(rc == success && "Scanning a file should not fail.");
+
+	unsigned count = 0;
+	while (rbfm_ScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+	{
+		int age = 0;
+		memcpy(&age, (char *)returnedData + nullFieldsIndicatorActualSize, sizeof(int));
+		assert(age >= threshold && "Scanned record should match the condition.");
+		count++;
+	}
+	rbfm_ScanIterator.close();
+	assert(count == numRecords - threshold && "Scan should return all matching records.");
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	rc = destroyFileShouldSucceed(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	free(data);
+	free(nullsIndicator);
+	free(record);
+	free(returnedData);
+
+	cout << "RBF Test Case Mmap Finished! The result will be examined." << endl << endl;
+
+	return 0;
+}
+
+int main()
+{
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+	remove("test_mmap");
+
+	RC rcmain = RBFTest_Mmap(rbfm);
+	return rcmain;
+}
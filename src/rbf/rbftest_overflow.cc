@@ -0,0 +1,315 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <algorithm>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+const unsigned LONG_LENGTH = 20000;
+const unsigned BUFFER_SIZE = LONG_LENGTH + PAGE_SIZE;
+
+// Id, a long Body and Score
+static void createOverflowDescriptor(vector<Attribute> &recordDescriptor)
+{
+	recordDescriptor.clear();
+	recordDescriptor.push_back(Attribute{"Id", TypeInt, 4});
+	recordDescriptor.push_back(Attribute{"Body", TypeVarChar, LONG_LENGTH});
+	recordDescriptor.push_back(Attribute{"Score", TypeInt, 4});
+}
+
+static string getBody(unsigned i, unsigned bodyLength)
+{
+	string body(bodyLength, 'a' + i % 26);
+	for (unsigned j = 0; j < bodyLength; j += 1000)
+	{
+		body[j] = 'A' + (i + j / 1000) % 26;
+	}
+	return body;
+}
+
+static unsigned prepareOverflowRecord(unsigned i, unsigned bodyLength, char *record)
+{
+	unsigned offset = 1;
+	record[0] = 0;
+	int id = i, score = i * 3;
+	memcpy(record + offset, &id, sizeof(int));
+	offset += sizeof(int);
+	string body = getBody(i, bodyLength);
+	memcpy(record + offset, &bodyLength, sizeof(unsigned));
+	offset += sizeof(unsigned);
+	memcpy(record + offset, body.data(), bodyLength);
+	offset += bodyLength;
+	memcpy(record + offset, &score, sizeof(int));
+	return offset + sizeof(int);
+}
+
+// every live record reads as prepared, by each read
+static void checkRecords(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+						 const vector<RID> &rids, const vector<bool> &live, const vector<unsigned> &bodyLengths)
+{
+	char *record = (char *)malloc(BUFFER_SIZE);
+	char *returnedData = (char *)malloc(BUFFER_SIZE);
+	vector<char *> buffers;
+	vector<void *> data;
+	for (unsigned i = 0; i < rids.size(); i++)
+	{
+		buffers.push_back((char *)malloc(BUFFER_SIZE));
+		data.push_back(buffers.back());
+	}
+	vector<RC> rcs;
+	RC rc = rbfm->readRecords(fileHandle, recordDescriptor, rids, data, rcs);
+	assert(rc == success && "Reading records should not fail.");
+
+	for (unsigned i = 0; i < rids.size(); i++)
+	{
+		rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedData);
+		if (!live[i])
+		{
+			assert(rc != success && rcs[i] != success && "Reading a deleted record should fail.");
+			continue;
+		}
+		unsigned recordSize = prepareOverflowRecord(i, bodyLengths[i], record);
+		assert(rc == success && memcmp(returnedData, record, recordSize) == 0 && "Record should be read whole.");
+		assert(rcs[i] == success && memcmp(buffers[i], record, recordSize) == 0 && "Record should be read whole in a batch.");
+
+		rc = rbfm->readAttribute(fileHandle, recordDescriptor, rids[i], "Body", returnedData);
+		assert(rc == success && memcmp(returnedData, record + 1 + sizeof(int), sizeof(unsigned) + bodyLengths[i]) == 0 &&
+			   "Attribute should be read whole.");
+		rc = rbfm->readAttribute(fileHandle, recordDescriptor, rids[i], "Score", returnedData);
+		assert(rc == success && *(int *)returnedData == (int)i * 3 && "Attribute should be kept.");
+	}
+	for (char *buffer : buffers)
+	{
+		free(buffer);
+	}
+	free(record);
+	free(returnedData);
+}
+
+// rows of a scan by Id, Body is checked if projected
+static void checkScan(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+					  const vector<bool> &live, const vector<unsigned> &bodyLengths, const vector<string> &attributeNames,
+					  const string &conditionAttribute, CompOp compOp, void *value, unsigned expected)
+{
+	RBFM_ScanIterator rbfm_ScanIterator;
+	RC rc = rbfm->scan(fileHandle, recordDescriptor, conditionAttribute, compOp, value, attributeNames, rbfm_ScanIterator);
+	assert(rc == success && "Scanning a file should not fail.");
+	bool withBody = find(attributeNames.begin(), attributeNames.end(), "Body") != attributeNames.end();
+	char *data = (char *)malloc(BUFFER_SIZE);
+	RID rid;
+	unsigned count = 0;
+	while (rbfm_ScanIterator.getNextRecord(rid, data) != RBFM_EOF)
+	{
+		int id = 0;
+		memcpy(&id, data + 1, sizeof(int));
+		assert(id >= 0 && (unsigned)id < live.size() && live[id] && "Scan should return live records.");
+		if (withBody)
+		{
+			string body = getBody(id, bodyLengths[id]);
+			unsigned bodyLength = 0;
+			memcpy(&bodyLength, data + 1 + sizeof(int), sizeof(unsigned));
+			assert(bodyLength == bodyLengths[id] && memcmp(data + 1 + sizeof(int) + sizeof(unsigned), body.data(), bodyLength) == 0 &&
+				   "Scan should return the whole Body.");
+		}
+		count++;
+	}
+	rbfm_ScanIterator.close();
+	free(data);
+	assert(count == expected && "Scan should return all matching records.");
+}
+
+// the scan ends by RBFM_SCAN_ERROR, not RBFM_EOF, and stays ended
+template <typename Iterator>
+static void checkScanError(Iterator &iterator, unsigned maxRowSize)
+{
+	char *data = (char *)malloc(maxRowSize);
+	RID rid;
+	RC rc;
+	while ((rc = iterator.getNextRecord(rid, data)) == success)
+	{
+	}
+	assert(rc == RBFM_SCAN_ERROR && "Scan should fail on a broken overflow chain.");
+	assert(iterator.getNextRecord(rid, data) == RBFM_EOF && "Scan should be ended after it fails.");
+	iterator.close();
+	free(data);
+}
+
+// a scan reading a Body of a broken chain fails, one not reading Body does not
+static void testBrokenChain(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+							const vector<bool> &live, const vector<unsigned> &bodyLengths)
+{
+	char page[PAGE_SIZE], zero[PAGE_SIZE];
+	memset(zero, 0, PAGE_SIZE);
+	unsigned broken = 0;
+	for (PageNum pageNum = 0; pageNum < fileHandle.getNumberOfPages(); pageNum++)
+	{
+		RC rc = fileHandle.readPage(pageNum, page);
+		assert(rc == success && "Reading a page should not fail.");
+		unsigned format = 0;
+		memcpy(&format, page, sizeof(unsigned));
+		if (format == PAGE_OVERFLOW)
+		{
+			rc = fileHandle.writePage(pageNum, zero);
+			assert(rc == success && "Writing a page should not fail.");
+			broken++;
+		}
+	}
+	assert(broken > 0 && "Long Bodies should be kept in overflow pages.");
+
+	unsigned liveNum = count(live.begin(), live.end(), true);
+	checkScan(rbfm, fileHandle, recordDescriptor, live, bodyLengths, {"Id", "Score"}, "", NO_OP, NULL, liveNum);
+
+	RBFM_ScanIterator rbfm_ScanIterator;
+	RC rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL, {"Id", "Body"}, rbfm_ScanIterator);
+	assert(rc == success && "Scanning a file should not fail.");
+	checkScanError(rbfm_ScanIterator, BUFFER_SIZE);
+
+	char value[sizeof(unsigned) + 4] = {0};
+	rc = rbfm->scan(fileHandle, recordDescriptor, "Body", EQ_OP, value, {"Id"}, rbfm_ScanIterator);
+	assert(rc == success && "Scanning a file should not fail.");
+	checkScanError(rbfm_ScanIterator, BUFFER_SIZE);
+
+	RBFM_ParallelScanIterator parallelIterator;
+	rc = rbfm->parallelScan(fileHandle, recordDescriptor, {}, {"Id", "Body"}, 2, true, parallelIterator);
+	assert(rc == success && "Parallel scan should not fail.");
+	checkScanError(parallelIterator, BUFFER_SIZE);
+}
+
+static void testOverflow(RecordBasedFileManager *rbfm, const string &fileName, PageFormat format)
+{
+	RC rc;
+	remove(fileName.c_str());
+	rc = rbfm->createFile(fileName, format);
+	assert(rc == success && "Creating the file should not fail.");
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createOverflowDescriptor(recordDescriptor);
+	char *record = (char *)malloc(BUFFER_SIZE);
+
+	// every third Body is longer than a page
+	unsigned numRecords = 60;
+	vector<RID> rids(numRecords);
+	vector<unsigned> bodyLengths(numRecords);
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		bodyLengths[i] = i % 3 == 0 ? 10000 + i * 30 : 10 + i;
+		prepareOverflowRecord(i, bodyLengths[i], record);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+		assert(rc == success && "Inserting a long record should not fail.");
+	}
+	vector<bool> live(numRecords, true);
+	checkRecords(rbfm, fileHandle, recordDescriptor, rids, live, bodyLengths);
+
+	// a batch of long ones
+	vector<const void *> records;
+	vector<char *> batch;
+	for (unsigned i = numRecords; i < numRecords + 6; i++)
+	{
+		bodyLengths.push_back(i % 2 ? 9000 : 20);
+		batch.push_back((char *)malloc(BUFFER_SIZE));
+		prepareOverflowRecord(i, bodyLengths[i], batch.back());
+		records.push_back(batch.back());
+		live.push_back(true);
+	}
+	vector<RID> batchRids;
+	rc = rbfm->insertRecords(fileHandle, recordDescriptor, records, batchRids);
+	assert(rc == success && "Inserting long records should not fail.");
+	rids.insert(rids.end(), batchRids.begin(), batchRids.end());
+	numRecords = rids.size();
+	checkRecords(rbfm, fileHandle, recordDescriptor, rids, live, bodyLengths);
+	for (char *buffer : batch)
+	{
+		free(buffer);
+	}
+
+	// long to short, short to long, long to long
+	for (unsigned i = 0; i < numRecords; i += 2)
+	{
+		bodyLengths[i] = bodyLengths[i] > 1000 ? (i % 4 ? 5 : 11000) : 12000;
+		prepareOverflowRecord(i, bodyLengths[i], record);
+		rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[i]);
+		assert(rc == success && "Updating a long record should not fail.");
+	}
+	checkRecords(rbfm, fileHandle, recordDescriptor, rids, live, bodyLengths);
+
+	// pages of deleted long values are taken again
+	for (unsigned i = 0; i < numRecords; i += 5)
+	{
+		rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+		assert(rc == success && "Deleting a long record should not fail.");
+		live[i] = false;
+	}
+	checkRecords(rbfm, fileHandle, recordDescriptor, rids, live, bodyLengths);
+	unsigned pages = fileHandle.getNumberOfPages();
+	for (unsigned i = 0; i < numRecords; i += 5)
+	{
+		bodyLengths[i] = 20;
+		prepareOverflowRecord(i, bodyLengths[i], record);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+		assert(rc == success && "Inserting a record should not fail.");
+		live[i] = true;
+	}
+	assert(fileHandle.getNumberOfPages() == pages && "Freed overflow pages should be reused.");
+	checkRecords(rbfm, fileHandle, recordDescriptor, rids, live, bodyLengths);
+
+	// Body is read only if projected or compared
+	unsigned liveNum = count(live.begin(), live.end(), true);
+	checkScan(rbfm, fileHandle, recordDescriptor, live, bodyLengths, {"Id", "Score"}, "", NO_OP, NULL, liveNum);
+	checkScan(rbfm, fileHandle, recordDescriptor, live, bodyLengths, {"Id", "Body", "Score"}, "", NO_OP, NULL, liveNum);
+	string body = getBody(0, bodyLengths[0]);
+	unsigned bodyLength = bodyLengths[0];
+	memcpy(record, &bodyLength, sizeof(unsigned));
+	memcpy(record + sizeof(unsigned), body.data(), bodyLength);
+	checkScan(rbfm, fileHandle, recordDescriptor, live, bodyLengths, {"Id"}, "Body", EQ_OP, record, 1);
+
+	testBrokenChain(rbfm, fileHandle, recordDescriptor, live, bodyLengths);
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+	free(record);
+}
+
+int RBFTest_Overflow(RecordBasedFileManager *rbfm)
+{
+	// Functions tested
+	// 1. Insert Records longer than a page, one by one and in a batch
+	// 2. Read Records, Read Records in a batch and Read Attributes, values are read whole
+	// 3. Update Records long to short and back, Delete Records, overflow pages are reused
+	// 4. Scan with and without the long attribute projected or compared
+	// 5. Of PAGE_SLOTTED_FIELDS, PAGE_PAX and PAGE_COMPACT files
+	// 6. Scan reading a Body of a broken overflow chain fails by RBFM_SCAN_ERROR
+	cout << endl << "***** In RBF Test Case Overflow *****" << endl;
+
+	testOverflow(rbfm, "test_overflow", PAGE_SLOTTED_FIELDS);
+	testOverflow(rbfm, "test_overflow", PAGE_PAX);
+	testOverflow(rbfm, "test_overflow", PAGE_COMPACT);
+
+	cout << "RBF Test Case Overflow Finished! The result will be examined." << endl << endl;
+
+	return 0;
+}
+
+int main()
+{
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+	remove("test_overflow");
+
+	RC rcmain = RBFTest_Overflow(rbfm);
+	return rcmain;
+}
@@ -0,0 +1,250 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <algorithm>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+struct Row
+{
+	RID rid;
+	string data;
+};
+
+bool ridLess(const Row &a, const Row &b)
+{
+	return a.rid.pageNum < b.rid.pageNum || (a.rid.pageNum == b.rid.pageNum && a.rid.slotNum < b.rid.slotNum);
+}
+
+// rows of a scan by RBFM_ScanIterator, or RBFM_ParallelScanIterator if workerNum > 0
+vector<Row> scanRows(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+					 const vector<vector<ScanCondition>> &conditions, const vector<string> &attributeNames,
+					 unsigned workerNum, bool ordered)
+{
+	RC rc;
+	const unsigned batch = 100;
+	vector<Row> res;
+	RID rids[batch];
+	unsigned rows = 0;
+	if (workerNum == 0)
+	{
+		RBFM_ScanIterator rbfm_ScanIterator;
+		rc = rbfm->scan(fileHandle, recordDescriptor, conditions, attributeNames, rbfm_ScanIterator);
+		assert(rc == success && "Scanning a file should not fail.");
+		vector<char> buf(batch * rbfm_ScanIterator.getMaxRowSize());
+		unsigned ends[batch];
+		while (rbfm_ScanIterator.getNextBatch(rids, buf.data(), batch, rows, ends) != RBFM_EOF)
+		{
+			for (unsigned i = 0; i < rows; i++)
+			{
+				unsigned start = i == 0 ? 0 : ends[i - 1];
+				res.push_back(Row{rids[i], string(buf.data() + start, ends[i] - start)});
+			}
+		}
+		rbfm_ScanIterator.close();
+		return res;
+	}
+
+	// row by row, sizes are taken from the plain scan
+	RBFM_ParallelScanIterator rbfm_ScanIterator;
+	rc = rbfm->parallelScan(fileHandle, recordDescriptor, conditions, attributeNames, workerNum, ordered, rbfm_ScanIterator);
+	assert(rc == success && "Scanning a file in parallel should not fail.");
+	vector<char> buf(batch * rbfm_ScanIterator.getMaxRowSize());
+	while (rbfm_ScanIterator.getNextBatch(rids, buf.data(), batch, rows) != RBFM_EOF)
+	{
+		assert(rows > 0 && rows <= batch && "Batch should not be empty nor overflow.");
+		for (unsigned i = 0; i < rows; i++)
+		{
+			res.push_back(Row{rids[i], string()});
+		}
+		// all rows have the same size in this test
+		unsigned size = 0;
+		for (unsigned i = 0; i < rows; i++)
+		{
+			res[res.size() - rows + i].data = string(buf.data() + size, buf.data() + size + 1 + sizeof(int) * 2);
+			size += 1 + sizeof(int) * 2;
+		}
+	}
+	rbfm_ScanIterator.close();
+	return res;
+}
+
+void parallelShouldMatch(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+						 const vector<vector<ScanCondition>> &conditions, unsigned expected)
+{
+	vector<string> attributeNames;
+	attributeNames.push_back("Age");
+	attributeNames.push_back("Salary");
+	vector<Row> serial = scanRows(rbfm, fileHandle, recordDescriptor, conditions, attributeNames, 0, false);
+	assert(serial.size() == expected && "Scan should return all records met.");
+	unsigned workerNums[] = {1, 2, 4, 7};
+	for (unsigned workerNum : workerNums)
+	{
+		vector<Row> ordered = scanRows(rbfm, fileHandle, recordDescriptor, conditions, attributeNames, workerNum, true);
+		assert(ordered.size() == serial.size() && "Parallel scan should return all records met.");
+		for (unsigned i = 0; i < serial.size(); i++)
+		{
+			assert(ordered[i].rid.pageNum == serial[i].rid.pageNum && ordered[i].rid.slotNum == serial[i].rid.slotNum &&
+				   "Ordered parallel scan should keep the order.");
+			assert(ordered[i].data == serial[i].data && "Parallel scan should project the same.");
+		}
+
+		vector<Row> unordered = scanRows(rbfm, fileHandle, recordDescriptor, conditions, attributeNames, workerNum, false);
+		assert(unordered.size() == serial.size() && "Parallel scan should return all records met.");
+		vector<Row> sorted = serial;
+		sort(sorted.begin(), sorted.end(), ridLess);
+		sort(unordered.begin(), unordered.end(), ridLess);
+		for (unsigned i = 0; i < sorted.size(); i++)
+		{
+			assert(unordered[i].rid.pageNum == sorted[i].rid.pageNum && unordered[i].rid.slotNum == sorted[i].rid.slotNum &&
+				   unordered[i].data == sorted[i].data && "Unordered parallel scan should return the same records.");
+		}
+	}
+}
+
+int RBFTest_Parallel(RecordBasedFileManager *rbfm)
+{
+	// Functions tested
+	// 1. Create File & Insert/Update/Delete Records
+	// 2. Parallel scans, ordered or not, against the scan, by POSIX & MMAP backends
+	// 3. Close a parallel scan early
+	// 4. Destroy File
+	cout << endl << "***** In RBF Test Case Parallel *****" << endl;
+
+	RC rc;
+	string fileName = "test_parallel";
+
+	rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	rc = createFileShouldSucceed(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+	unsigned char nullsIndicator[1] = {0};
+	char record[PAGE_SIZE];
+	int recordSize = 0;
+	RID rid;
+	unsigned numRecords = 40000;
+	vector<RID> rids;
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		prepareRecord(recordDescriptor.size(), nullsIndicator, 8, "Anteater", i, 177.8, i % 10, record, &recordSize);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+		assert(rc == success && "Inserting a record should not fail.");
+		rids.push_back(rid);
+	}
+	assert(fileHandle.getNumberOfPages() > 4 * MORSEL_PAGES && "File should have several morsels.");
+	// deleted, and moved by longer names
+	string longName(200, 'a');
+	unsigned deleted = 0;
+	for (unsigned i = 0; i < numRecords; i += 17)
+	{
+		rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+		assert(rc == success && "Deleting a record should not fail.");
+		deleted++;
+	}
+	for (unsigned i = 5; i < numRecords; i += 97)
+	{
+		if (i % 17 == 0)
+		{
+			continue;
+		}
+		prepareRecord(recordDescriptor.size(), nullsIndicator, longName.size(), longName, i, 177.8, i % 10, record, &recordSize);
+		rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[i]);
+		assert(rc == success && "Updating a record should not fail.");
+	}
+
+	vector<vector<ScanCondition>> conditions;
+	parallelShouldMatch(rbfm, fileHandle, recordDescriptor, conditions, numRecords - deleted);
+
+	// Salary = 3 OR Age < 1000
+	int salary = 3, age = 1000;
+	conditions.resize(2);
+	conditions[0].push_back(ScanCondition{"Salary", EQ_OP, &salary});
+	conditions[1].push_back(ScanCondition{"Age", LT_OP, &age});
+	unsigned expected = 0;
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		expected += i % 17 != 0 && (i % 10 == 3 || i < 1000) ? 1 : 0;
+	}
+	parallelShouldMatch(rbfm, fileHandle, recordDescriptor, conditions, expected);
+
+	// nothing met
+	int none = -1;
+	conditions.clear();
+	conditions.resize(1);
+	conditions[0].push_back(ScanCondition{"Age", LT_OP, &none});
+	parallelShouldMatch(rbfm, fileHandle, recordDescriptor, conditions, 0);
+
+	// closed early, workers are waiting for the morsels to be taken
+	conditions.clear();
+	for (unsigned i = 0; i < 3; i++)
+	{
+		vector<string> attributeNames(1, "Age");
+		RBFM_ParallelScanIterator rbfm_ScanIterator;
+		rc = rbfm->parallelScan(fileHandle, recordDescriptor, conditions, attributeNames, 4, i % 2 == 0, rbfm_ScanIterator);
+		assert(rc == success && "Scanning a file in parallel should not fail.");
+		char returnedData[PAGE_SIZE];
+		for (unsigned j = 0; j < i * 1000; j++)
+		{
+			rc = rbfm_ScanIterator.getNextRecord(rid, returnedData);
+			assert(rc == success && "Getting a record should not fail.");
+		}
+		rbfm_ScanIterator.close();
+		rc = rbfm_ScanIterator.getNextRecord(rid, returnedData);
+		assert(rc == RBFM_EOF && "Closed scan should return nothing.");
+	}
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	// in place pages are read one thread at a time
+	rc = rbfm->openFile(fileName, fileHandle, IO_MMAP);
+	assert(rc == success && "Opening the file should not fail.");
+	conditions.resize(1);
+	conditions[0].push_back(ScanCondition{"Salary", EQ_OP, &salary});
+	expected = 0;
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		expected += i % 17 != 0 && i % 10 == 3 ? 1 : 0;
+	}
+	parallelShouldMatch(rbfm, fileHandle, recordDescriptor, conditions, expected);
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	rc = destroyFileShouldSucceed(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	cout << "RBF Test Case Parallel Finished! The result will be examined." << endl << endl;
+
+	return 0;
+}
+
+int main()
+{
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+	remove("test_parallel");
+
+	RC rcmain = RBFTest_Parallel(rbfm);
+	return rcmain;
+}
@@ -0,0 +1,270 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <algorithm>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// i-th record, some attributes are null
+static void preparePaxRecord(const vector<Attribute> &recordDescriptor, unsigned i, unsigned nameLength, char *record, int *recordSize)
+{
+	unsigned char nullsIndicator[1] = {0};
+	if (i % 7 == 0)
+	{
+		nullsIndicator[0] = 0x40; // Age
+	}
+	else if (i % 11 == 0)
+	{
+		nullsIndicator[0] = 0x80; // EmpName
+	}
+	prepareRecord(recordDescriptor.size(), nullsIndicator, nameLength, string(nameLength, 'a' + i % 26), i % 100, i * 0.5, i, record, recordSize);
+}
+
+// projected rows of a scan, sorted
+static vector<string> scanRows(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+							   const vector<vector<ScanCondition>> &conditions, const vector<string> &attributeNames)
+{
+	RBFM_ScanIterator rbfm_ScanIterator;
+	RC rc = rbfm->scan(fileHandle, recordDescriptor, conditions, attributeNames, rbfm_ScanIterator);
+	assert(rc == success && "Scanning a file should not fail.");
+	const unsigned batch = 64;
+	RID rids[batch];
+	unsigned ends[batch];
+	unsigned rows = 0;
+	char *data = (char *)malloc(batch * rbfm_ScanIterator.getMaxRowSize());
+	char *record = (char *)malloc(PAGE_SIZE);
+	vector<string> result;
+	while (rbfm_ScanIterator.getNextBatch(rids, data, batch, rows, ends) != RBFM_EOF)
+	{
+		for (unsigned i = 0; i < rows; i++)
+		{
+			unsigned start = i == 0 ? 0 : ends[i - 1];
+			result.push_back(string(data + start, ends[i] - start));
+			// the row is of its RID
+			rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], record);
+			assert(rc == success && "Reading a scanned record should not fail.");
+		}
+	}
+	rbfm_ScanIterator.close();
+	free(data);
+	free(record);
+	sort(result.begin(), result.end());
+	return result;
+}
+
+int RBFTest_Pax(RecordBasedFileManager *rbfm)
+{
+	// Functions tested
+	// 1. Create File of PAGE_PAX, the format is kept by the file
+	// 2. Insert/Update/Delete Records, the same on a PAGE_SLOTTED_FIELDS file
+	// 3. Read Records and Attributes
+	// 4. Scan with conditions and projections, rows are the same as of the slotted file
+	// 5. Bulk insert and vacuum
+	// 6. Destroy File
+	cout << endl << "***** In RBF Test Case PAX *****" << endl;
+
+	RC rc;
+	string paxName = "test_pax";
+	string slottedName = "test_pax_slotted";
+
+	rc = rbfm->createFile(paxName, PAGE_PAX);
+	assert(rc == success && "Creating the file should not fail.");
+	rc = createFileShouldSucceed(paxName);
+	assert(rc == success && "Creating the file should not fail.");
+	rc = rbfm->createFile(slottedName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle pax, slotted;
+	rc = rbfm->openFile(paxName, pax);
+	assert(rc == success && "Opening the file should not fail.");
+	assert(pax.getPageFormat() == PAGE_PAX && "Page format should be kept by the file.");
+	rc = rbfm->openFile(slottedName, slotted);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+	char *record = (char *)malloc(PAGE_SIZE);
+	char *returnedData = (char *)malloc(PAGE_SIZE);
+	int recordSize = 0;
+	RID rid, slottedRid;
+
+	unsigned numRecords = 3000;
+	vector<RID> paxRids, slottedRids;
+	vector<unsigned> nameLengths;
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		nameLengths.push_back(5 + i % 20);
+		preparePaxRecord(recordDescriptor, i, nameLengths[i], record, &recordSize);
+		rc = rbfm->insertRecord(pax, recordDescriptor, record, rid);
+		assert(rc == success && "Inserting a record should not fail.");
+		rc = rbfm->insertRecord(slotted, recordDescriptor, record, slottedRid);
+		assert(rc == success && "Inserting a record should not fail.");
+		paxRids.push_back(rid);
+		slottedRids.push_back(slottedRid);
+	}
+
+	char page[PAGE_SIZE];
+	rc = pax.readPage(0, page);
+	assert(rc == success && "Reading a page should not fail.");
+	assert(DataPage(page).getFormat() == PAGE_PAX && "Pages should be of PAGE_PAX.");
+
+	// grown ones are forwarded, some are deleted
+	vector<bool> live(numRecords, true);
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		if (i % 5 == 0)
+		{
+			rc = rbfm->deleteRecord(pax, recordDescriptor, paxRids[i]);
+			assert(rc == success && "Deleting a record should not fail.");
+			rc = rbfm->deleteRecord(slotted, recordDescriptor, slottedRids[i]);
+			assert(rc == success && "Deleting a record should not fail.");
+			live[i] = false;
+			continue;
+		}
+		if (i % 3 == 0)
+		{
+			nameLengths[i] = i % 2 ? 30 : 1;
+			preparePaxRecord(recordDescriptor, i, nameLengths[i], record, &recordSize);
+			rc = rbfm->updateRecord(pax, recordDescriptor, record, paxRids[i]);
+			assert(rc == success && "Updating a record should not fail.");
+			rc = rbfm->updateRecord(slotted, recordDescriptor, record, slottedRids[i]);
+			assert(rc == success && "Updating a record should not fail.");
+		}
+	}
+
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		rc = rbfm->readRecord(pax, recordDescriptor, paxRids[i], returnedData);
+		if (!live[i])
+		{
+			assert(rc != success && "Reading a deleted record should fail.");
+			continue;
+		}
+		assert(rc == success && "Reading a record should not fail.");
+		preparePaxRecord(recordDescriptor, i, nameLengths[i], record, &recordSize);
+		assert(memcmp(returnedData, record, recordSize) == 0 && "Record should be kept.");
+
+		rc = rbfm->readAttribute(pax, recordDescriptor, paxRids[i], "Salary", returnedData);
+		assert(rc == success && "Reading an attribute should not fail.");
+		assert(*(int *)returnedData == (int)i && "Attribute should be kept.");
+	}
+
+	// the same rows as of the slotted file
+	int age = 50;
+	vector<vector<ScanCondition>> none;
+	vector<vector<ScanCondition>> conditions(2);
+	conditions[0].push_back(ScanCondition{"Age", GE_OP, &age});
+	string name = "bbbbbbb";
+	char value[PAGE_SIZE];
+	unsigned length = name.size();
+	memcpy(value, &length, sizeof(unsigned));
+	memcpy(value + sizeof(unsigned), name.c_str(), length);
+	conditions[1].push_back(ScanCondition{"EmpName", EQ_OP, value});
+
+	vector<string> salary(1, "Salary");
+	vector<string> nameAndHeight;
+	nameAndHeight.push_back("EmpName");
+	nameAndHeight.push_back("Height");
+	vector<string> all;
+	for (const Attribute &attr : recordDescriptor)
+	{
+		all.push_back(attr.name);
+	}
+	vector<string> rows = scanRows(rbfm, pax, recordDescriptor, none, all);
+	assert(rows == scanRows(rbfm, slotted, recordDescriptor, none, all) && "Scan should return the same rows.");
+	assert(rows.size() == (unsigned)count(live.begin(), live.end(), true) && "Scan should return all records left.");
+	rows = scanRows(rbfm, pax, recordDescriptor, conditions, salary);
+	assert(rows == scanRows(rbfm, slotted, recordDescriptor, conditions, salary) && "Scan should return the same rows.");
+	assert(!rows.empty() && "Scan should return matching records.");
+	rows = scanRows(rbfm, pax, recordDescriptor, conditions, nameAndHeight);
+	assert(rows == scanRows(rbfm, slotted, recordDescriptor, conditions, nameAndHeight) && "Scan should return the same rows.");
+
+	// bulk pages are PAX too, and vacuumed space is reused
+	unsigned pages = pax.getNumberOfPages();
+	vector<const void *> records;
+	vector<char *> buffers;
+	vector<int> sizes;
+	for (unsigned i = 0; i < 500; i++)
+	{
+		buffers.push_back((char *)malloc(PAGE_SIZE));
+		preparePaxRecord(recordDescriptor, numRecords + i, 10, buffers.back(), &recordSize);
+		records.push_back(buffers.back());
+		sizes.push_back(recordSize);
+	}
+	vector<RID> bulkRids;
+	rc = rbfm->insertRecords(pax, recordDescriptor, records, bulkRids);
+	assert(rc == success && "Inserting records should not fail.");
+	rc = pax.readPage(pages, page);
+	assert(rc == success && "Reading a page should not fail.");
+	assert(DataPage(page).getFormat() == PAGE_PAX && "Pages should be of PAGE_PAX.");
+
+	unsigned reclaimed = 0;
+	rc = rbfm->vacuumFile(pax, reclaimed);
+	assert(rc == success && "Vacuuming the file should not fail.");
+	assert(reclaimed > 0 && "Space of deleted records should be reclaimed.");
+	rc = rbfm->vacuumFile(pax, reclaimed);
+	assert(rc == success && reclaimed == 0 && "A vacuumed file should be unchanged.");
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		if (!live[i])
+		{
+			continue;
+		}
+		rc = rbfm->readRecord(pax, recordDescriptor, paxRids[i], returnedData);
+		assert(rc == success && "Reading a record should not fail.");
+		preparePaxRecord(recordDescriptor, i, nameLengths[i], record, &recordSize);
+		assert(memcmp(returnedData, record, recordSize) == 0 && "Record should be kept by vacuum.");
+	}
+	for (unsigned i = 0; i < bulkRids.size(); i++)
+	{
+		rc = rbfm->readRecord(pax, recordDescriptor, bulkRids[i], returnedData);
+		assert(rc == success && "Reading a record should not fail.");
+		assert(memcmp(returnedData, records[i], sizes[i]) == 0 && "Record should be kept.");
+		free(buffers[i]);
+	}
+
+	rc = rbfm->closeFile(pax);
+	assert(rc == success && "Closing the file should not fail.");
+	rc = rbfm->closeFile(slotted);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = rbfm->openFile(paxName, pax);
+	assert(rc == success && pax.getPageFormat() == PAGE_PAX && "Page format should be kept by the file.");
+	rc = rbfm->closeFile(pax);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = rbfm->destroyFile(paxName);
+	assert(rc == success && "Destroying the file should not fail.");
+	rc = destroyFileShouldSucceed(paxName);
+	assert(rc == success && "Destroying the file should not fail.");
+	rc = rbfm->destroyFile(slottedName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	free(record);
+	free(returnedData);
+
+	cout << "RBF Test Case PAX Finished! The result will be examined." << endl << endl;
+
+	return 0;
+}
+
+int main()
+{
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+	remove("test_pax");
+	remove("test_pax_slotted");
+
+	RC rcmain = RBFTest_Pax(rbfm);
+	return rcmain;
+}
@@ -0,0 +1,160 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <climits>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// [size][chars]
+string varChar(const string &s)
+{
+	unsigned size = s.size();
+	return string((char *)&size, sizeof(unsigned)) + s;
+}
+
+bool evalInt(CompOp compOp, int attr, int value)
+{
+	Predicate *predicate = Predicate::compile(TypeInt, compOp, &value);
+	bool res = predicate->eval((char *)&attr);
+	delete predicate;
+	return res;
+}
+
+bool evalVarChar(CompOp compOp, const string &attr, const string &value)
+{
+	string v = varChar(value), a = varChar(attr);
+	Predicate *predicate = Predicate::compile(TypeVarChar, compOp, v.data());
+	bool res = predicate->eval(a.data());
+	delete predicate;
+	return res;
+}
+
+int RBFTest_Predicate(RecordBasedFileManager *rbfm)
+{
+	// Functions tested
+	// 1. Compare Int, Real & VarChar
+	// 2. Compile & Evaluate Predicates of each CompOp
+	// 3. Create File & Insert Records
+	// 4. Scan with VarChar conditions, against the records inserted
+	// 5. Destroy File
+	cout << endl << "***** In RBF Test Case Predicate *****" << endl;
+
+	RC rc;
+	string fileName = "test_predicate";
+
+	int a = INT_MIN, b = 1;
+	assert(AttrCompare<TypeInt>::compare((char *)&a, (char *)&b) < 0 && "INT_MIN should be less than 1.");
+	assert(AttrCompare<TypeInt>::compare((char *)&b, (char *)&a) > 0 && "1 should be greater than INT_MIN.");
+	float x = 1.0, y = 1.0005, z = 1.1;
+	assert(AttrCompare<TypeReal>::compare((char *)&x, (char *)&y) == 0 && "Reals should be equal by 0.001.");
+	assert(AttrCompare<TypeReal>::compare((char *)&x, (char *)&z) < 0 && "1.0 should be less than 1.1.");
+	assert(AttrCompare<TypeVarChar>::compare(varChar("abc").data(), varChar("abcd").data()) < 0 && "Prefix should be less.");
+	assert(AttrCompare<TypeVarChar>::compare(varChar("b").data(), varChar("abcd").data()) > 0 && "Chars should be compared first.");
+	assert(AttrCompare<TypeVarChar>::compare(varChar("").data(), varChar("").data()) == 0 && "Empty strings should be equal.");
+	assert(AttrCompare<TypeVarChar>::compare(varChar("").data(), varChar("a").data()) < 0 && "Empty string should be less.");
+	assert(Predicate::getComparator(TypeVarChar) == AttrCompare<TypeVarChar>::compare && "Comparator should be by type.");
+
+	assert(evalInt(EQ_OP, 5, 5) && !evalInt(EQ_OP, 5, 6) && "EQ_OP");
+	assert(evalInt(LT_OP, 5, 6) && !evalInt(LT_OP, 6, 6) && "LT_OP");
+	assert(evalInt(LE_OP, 6, 6) && !evalInt(LE_OP, 7, 6) && "LE_OP");
+	assert(evalInt(GT_OP, 7, 6) && !evalInt(GT_OP, 6, 6) && "GT_OP");
+	assert(evalInt(GE_OP, 6, 6) && !evalInt(GE_OP, 5, 6) && "GE_OP");
+	assert(evalInt(NE_OP, 5, 6) && !evalInt(NE_OP, 6, 6) && "NE_OP");
+	assert(evalInt(LT_OP, INT_MIN, INT_MAX) && "LT_OP should not overflow.");
+	assert(evalVarChar(LT_OP, "Ant", "Anteater") && evalVarChar(GE_OP, "Anteater", "Ant") && "VarChar LT_OP & GE_OP");
+	assert(Predicate::compile(TypeVarChar, NO_OP, NULL) == nullptr && "NO_OP should not be compiled.");
+
+	rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	rc = createFileShouldSucceed(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+	unsigned char nullsIndicator[1] = {0};
+	unsigned char nullName[1] = {0x80};
+	char record[PAGE_SIZE];
+	int recordSize = 0;
+	RID rid;
+	unsigned numRecords = 3000;
+	vector<string> names;
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		// "", "a", "aa", ..., "b", "bb", ...; every 11th is null
+		string name(i % 5, 'a' + i % 7);
+		prepareRecord(recordDescriptor.size(), i % 11 == 0 ? nullName : nullsIndicator, name.size(), name, i, 177.8, i, record, &recordSize);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+		assert(rc == success && "Inserting a record should not fail.");
+		names.push_back(i % 11 == 0 ? "NULL" : name);
+	}
+
+	vector<string> attributeNames;
+	attributeNames.push_back("Age");
+	CompOp compOps[] = {EQ_OP, LT_OP, LE_OP, GT_OP, GE_OP, NE_OP};
+	string values[] = {"", "aa", "c", "ccc", "z"};
+	char returnedData[PAGE_SIZE];
+	for (CompOp compOp : compOps)
+	{
+		for (const string &value : values)
+		{
+			string v = varChar(value);
+			unsigned expected = 0;
+			for (unsigned i = 0; i < numRecords; i++)
+			{
+				expected += names[i] != "NULL" && evalVarChar(compOp, names[i], value) ? 1 : 0;
+			}
+
+			RBFM_ScanIterator rbfm_ScanIterator;
+			rc = rbfm->scan(fileHandle, recordDescriptor, "EmpName", compOp, v.data(), attributeNames, rbfm_ScanIterator);
+			assert(rc == success && "Scanning a file should not fail.");
+			unsigned count = 0;
+			while (rbfm_ScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+			{
+				int age = 0;
+				memcpy(&age, returnedData + 1, sizeof(int));
+				assert(names[age] != "NULL" && evalVarChar(compOp, names[age], value) && "Record should meet the condition.");
+				count++;
+			}
+			rbfm_ScanIterator.close();
+			assert(count == expected && "Scan should return all records met.");
+		}
+	}
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	rc = destroyFileShouldSucceed(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	cout << "RBF Test Case Predicate Finished! The result will be examined." << endl << endl;
+
+	return 0;
+}
+
+int main()
+{
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+	remove("test_predicate");
+
+	RC rcmain = RBFTest_Predicate(rbfm);
+	return rcmain;
+}
@@ -0,0 +1,133 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+int RBFTest_Prefetch(PagedFileManager *pfm)
+{
+	// Functions tested
+	// 1. Create File
+	// 2. Append Pages
+	// 3. Close/Reopen File, buffer pool is cold
+	// 4. Register Scan & Read Pages ahead by Prefetcher
+	// 5. Write Pages inside the window
+	// 6. Close File with tasks queued
+	// 7. Destroy File
+	cout << endl << "***** In RBF Test Case Prefetch *****" << endl;
+
+	RC rc;
+	string fileName = "test_prefetch";
+	unsigned numPages = 2 * BUFFER_POOL_FRAMES;
+
+	rc = pfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	rc = createFileShouldSucceed(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	rc = pfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	char *data = (char *)malloc(PAGE_SIZE);
+	char *buffer = (char *)malloc(PAGE_SIZE);
+	for (unsigned i = 0; i < numPages; i++)
+	{
+		memset(data, i % 96 + 30, PAGE_SIZE);
+		rc = fileHandle.appendPage(data);
+		assert(rc == success && "Appending a page should not fail.");
+	}
+	rc = pfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = pfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	Prefetcher *prefetcher = Prefetcher::instance();
+	BufferPoolManager *bpm = BufferPoolManager::instance();
+	unsigned prefetchCount = 0, prefetchCount1 = 0;
+	bpm->collectPrefetchCounterValues(prefetchCount);
+
+	int scanId = prefetcher->registerScan(&fileHandle, 0, numPages - 1);
+	assert(scanId >= 0 && "Registering a scan should not fail.");
+	for (unsigned i = 0; i < numPages; i++)
+	{
+		prefetcher->advance(scanId, i);
+		// the first window is read ahead before any of it is read here
+		if (i == 0)
+		{
+			prefetcher->waitIdle();
+		}
+		// a page inside the window may be loading right now
+		if (i % 50 == 0 && i + 1 < numPages)
+		{
+			memset(data, 'W', PAGE_SIZE);
+			rc = fileHandle.writePage(i + 1, data);
+			assert(rc == success && "Writing a page should not fail.");
+		}
+
+		if (i % 50 == 1)
+		{
+			memset(data, 'W', PAGE_SIZE);
+		}
+		else
+		{
+			memset(data, i % 96 + 30, PAGE_SIZE);
+		}
+		rc = fileHandle.readPage(i, buffer);
+		assert(rc == success && "Reading a page should not fail.");
+		if (memcmp(data, buffer, PAGE_SIZE) != 0)
+		{
+			cout << "[FAIL] Test Case Prefetch Failed! Page " << i << " is wrong." << endl << endl;
+			free(data);
+			free(buffer);
+			return -1;
+		}
+	}
+	prefetcher->unregisterScan(scanId);
+	prefetcher->waitIdle();
+
+	bpm->collectPrefetchCounterValues(prefetchCount1);
+	assert(prefetchCount1 > prefetchCount && "Some pages should have been prefetched.");
+
+	// queued tasks must not outlive the handle
+	scanId = prefetcher->registerScan(&fileHandle, 0, numPages - 1);
+	prefetcher->advance(scanId, 0);
+	rc = pfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+	prefetcher->unregisterScan(scanId);
+
+	rc = pfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	rc = destroyFileShouldSucceed(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	free(data);
+	free(buffer);
+
+	cout << "RBF Test Case Prefetch Finished! The result will be examined." << endl << endl;
+
+	return 0;
+}
+
+int main()
+{
+	PagedFileManager *pfm = PagedFileManager::instance();
+
+	remove("test_prefetch");
+
+	RC rcmain = RBFTest_Prefetch(pfm);
+	return rcmain;
+}
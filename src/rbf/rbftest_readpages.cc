@@ -0,0 +1,192 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+int RBFTest_ReadPages(PagedFileManager *pfm)
+{
+	// Functions tested
+	// 1. Create File
+	// 2. Append Pages
+	// 3. Write Pages, left dirty in buffer pool
+	// 4. Read Pages by chunks & Counters
+	// 5. Close File
+	// 6. Destroy File
+	cout << endl << "***** In RBF Test Case Read Pages *****" << endl;
+
+	RC rc;
+	string fileName = "test_readpages";
+	unsigned numPages = BUFFER_POOL_FRAMES + 100;
+
+	rc = pfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	rc = createFileShouldSucceed(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	rc = pfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	char *data = (char *)malloc(PAGE_SIZE);
+	for (unsigned i = 0; i < numPages; i++)
+	{
+		memset(data, i % 96 + 30, PAGE_SIZE);
+		rc = fileHandle.appendPage(data);
+		assert(rc == success && "Appending a page should not fail.");
+	}
+
+	// every 7th page is newer in buffer pool than on disk
+	for (unsigned i = numPages - 1; i < numPages; i -= 7)
+	{
+		memset(data, (i + 1) % 96 + 30, PAGE_SIZE);
+		rc = fileHandle.writePage(i, data);
+		assert(rc == success && "Writing a page should not fail.");
+	}
+
+	unsigned readPageCount = 0, readPageCount1 = 0, writePageCount = 0, appendPageCount = 0;
+	fileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount);
+
+	unsigned chunkPages = 37;
+	char *chunk = (char *)malloc(chunkPages * PAGE_SIZE);
+	for (unsigned start = 0; start < numPages; start += chunkPages)
+	{
+		unsigned n = min(chunkPages, numPages - start);
+		rc = fileHandle.readPages(start, n, chunk);
+		assert(rc == success && "Reading pages should not fail.");
+		for (unsigned i = start; i < start + n; i++)
+		{
+			unsigned shift = (numPages - 1 - i) % 7 == 0 ? 1 : 0;
+			memset(data, (i + shift) % 96 + 30, PAGE_SIZE);
+			if (memcmp(data, chunk + (i - start) * PAGE_SIZE, PAGE_SIZE) != 0)
+			{
+				cout << "[FAIL] Test Case Read Pages Failed! Page " << i << " is wrong." << endl << endl;
+				free(data);
+				free(chunk);
+				return -1;
+			}
+		}
+	}
+
+	fileHandle.collectCounterValues(readPageCount1, writePageCount, appendPageCount);
+	assert(readPageCount1 - readPageCount == numPages && "Every page read should be counted.");
+
+	rc = fileHandle.readPages(numPages - 1, 2, chunk);
+	assert(rc != success && "Reading pages out of file should fail.");
+	rc = fileHandle.readPages(0, 0, chunk);
+	assert(rc != success && "Reading no page should fail.");
+
+	rc = pfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = pfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	rc = destroyFileShouldSucceed(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	free(data);
+	free(chunk);
+
+	cout << "RBF Test Case Read Pages Finished! The result will be examined." << endl << endl;
+
+	return 0;
+}
+
+// a scan of a file cut short on disk fails by RBFM_SCAN_ERROR where its pages can't be read
+int RBFTest_ReadPagesScan(RecordBasedFileManager *rbfm)
+{
+	cout << endl << "***** In RBF Test Case Read Pages Scan *****" << endl;
+
+	RC rc;
+	string fileName = "test_readpages_scan";
+	unsigned numRecords = 2000;
+
+	rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createLargeRecordDescriptor(recordDescriptor);
+	int nullFieldsIndicatorActualSize = getActualByteForNullsIndicator(recordDescriptor.size());
+	unsigned char *nullsIndicator = (unsigned char *)malloc(nullFieldsIndicatorActualSize);
+	memset(nullsIndicator, 0, nullFieldsIndicatorActualSize);
+	char *record = (char *)malloc(PAGE_SIZE);
+	RID rid;
+	int size = 0;
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		prepareLargeRecord(recordDescriptor.size(), nullsIndicator, i, record, &size);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+		assert(rc == success && "Inserting a record should not fail.");
+	}
+	unsigned numPages = fileHandle.getNumberOfPages();
+	assert(numPages > 2 * SCAN_CHUNK_PAGES && "Records should span several chunks.");
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	// the handle still counts the pages cut off
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+	size_t fileSize = getFileSize(fileName);
+	rc = truncate(fileName.c_str(), fileSize - (size_t)(numPages / 2) * PAGE_SIZE);
+	assert(rc == success && "Truncating the file should not fail.");
+
+	vector<string> attributeNames;
+	attributeNames.push_back(recordDescriptor[0].name);
+	RBFM_ScanIterator rbfm_ScanIterator;
+	rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, rbfm_ScanIterator);
+	assert(rc == success && "Scanning a file should not fail.");
+	unsigned count = 0;
+	while ((rc = rbfm_ScanIterator.getNextRecord(rid, record)) == success)
+	{
+		count++;
+	}
+	assert(rc == RBFM_SCAN_ERROR && "Scan should fail on pages it can't read.");
+	assert(count < numRecords && "Scan should not return records of pages it can't read.");
+	assert(rbfm_ScanIterator.getNextRecord(rid, record) == RBFM_EOF && "Scan should be ended after it fails.");
+	rbfm_ScanIterator.close();
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	free(nullsIndicator);
+	free(record);
+
+	cout << "RBF Test Case Read Pages Scan Finished! The result will be examined." << endl << endl;
+
+	return 0;
+}
+
+int main()
+{
+	PagedFileManager *pfm = PagedFileManager::instance();
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+	remove("test_readpages");
+	remove("test_readpages_scan");
+
+	RC rcmain = RBFTest_ReadPages(pfm);
+	if (rcmain == 0)
+	{
+		rcmain = RBFTest_ReadPagesScan(rbfm);
+	}
+	return rcmain;
+}
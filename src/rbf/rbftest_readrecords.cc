@@ -0,0 +1,160 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <algorithm>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+static void prepareBatchRecord(const vector<Attribute> &recordDescriptor, unsigned i, unsigned nameLength, char *record, int *recordSize)
+{
+	unsigned char nullsIndicator[1] = {0};
+	if (i % 7 == 0)
+	{
+		nullsIndicator[0] = 0x40; // Age
+	}
+	prepareRecord(recordDescriptor.size(), nullsIndicator, nameLength, string(nameLength, 'a' + i % 26), i % 100, i * 0.5, i, record, recordSize);
+}
+
+static void testReadRecords(RecordBasedFileManager *rbfm, const string &fileName, PageFormat format)
+{
+	RC rc;
+	remove(fileName.c_str());
+	rc = rbfm->createFile(fileName, format);
+	assert(rc == success && "Creating the file should not fail.");
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+	char *record = (char *)malloc(PAGE_SIZE);
+	char *returnedData = (char *)malloc(PAGE_SIZE);
+	int recordSize = 0;
+
+	unsigned numRecords = 2000;
+	vector<RID> rids(numRecords);
+	vector<unsigned> nameLengths(numRecords, 10);
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		prepareBatchRecord(recordDescriptor, i, nameLengths[i], record, &recordSize);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+		assert(rc == success && "Inserting a record should not fail.");
+	}
+
+	// grown ones are forwarded to other pages, some are deleted
+	vector<bool> live(numRecords, true);
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		if (i % 9 == 0)
+		{
+			rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+			assert(rc == success && "Deleting a record should not fail.");
+			live[i] = false;
+		}
+		else if (i % 4 == 0)
+		{
+			nameLengths[i] = 200;
+			prepareBatchRecord(recordDescriptor, i, nameLengths[i], record, &recordSize);
+			rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[i]);
+			assert(rc == success && "Updating a record should not fail.");
+		}
+	}
+
+	// out of page order, with repeats and a RID of no page
+	vector<RID> batch;
+	vector<unsigned> owners;
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		unsigned j = (i * 7919) % numRecords;
+		batch.push_back(rids[j]);
+		owners.push_back(j);
+		if (i % 100 == 0)
+		{
+			batch.push_back(rids[i]);
+			owners.push_back(i);
+		}
+	}
+	batch.push_back(RID{fileHandle.getNumberOfPages() + 10, 0});
+	owners.push_back(numRecords);
+
+	vector<char *> buffers;
+	vector<void *> data;
+	for (unsigned i = 0; i < batch.size(); i++)
+	{
+		// garbage in the buffers of deleted RIDs is never parsed: no null and an overflow stub to nowhere
+		buffers.push_back((char *)malloc(PAGE_SIZE));
+		memset(buffers.back(), 0xFF, PAGE_SIZE);
+		buffers.back()[0] = 0;
+		data.push_back(buffers.back());
+	}
+	vector<RC> rcs;
+	rc = rbfm->readRecords(fileHandle, recordDescriptor, batch, data, rcs);
+	assert(rc == success && rcs.size() == batch.size() && "Reading records should not fail.");
+	for (unsigned i = 0; i < batch.size(); i++)
+	{
+		unsigned j = owners[i];
+		if (j == numRecords || !live[j])
+		{
+			assert(rcs[i] != success && "Reading a deleted record should fail.");
+			continue;
+		}
+		assert(rcs[i] == success && "Reading a record should not fail.");
+		prepareBatchRecord(recordDescriptor, j, nameLengths[j], record, &recordSize);
+		assert(memcmp(buffers[i], record, recordSize) == 0 && "Record should be read at its place.");
+		// the same as one by one
+		rc = rbfm->readRecord(fileHandle, recordDescriptor, batch[i], returnedData);
+		assert(rc == success && memcmp(buffers[i], returnedData, recordSize) == 0 && "Record should be the same as read alone.");
+	}
+
+	// nothing to read
+	rc = rbfm->readRecords(fileHandle, recordDescriptor, vector<RID>(), vector<void *>(), rcs);
+	assert(rc == success && rcs.empty() && "Reading no record should not fail.");
+
+	for (char *buffer : buffers)
+	{
+		free(buffer);
+	}
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+	free(record);
+	free(returnedData);
+}
+
+int RBFTest_ReadRecords(RecordBasedFileManager *rbfm)
+{
+	// Functions tested
+	// 1. Insert/Update/Delete Records, grown ones are forwarded
+	// 2. Read Records of RIDs out of order, deleted and forwarded ones, each as by Read Record
+	// 3. Of PAGE_SLOTTED_FIELDS, PAGE_PAX and PAGE_COMPACT files
+	cout << endl << "***** In RBF Test Case Read Records *****" << endl;
+
+	testReadRecords(rbfm, "test_readrecords", PAGE_SLOTTED_FIELDS);
+	testReadRecords(rbfm, "test_readrecords", PAGE_PAX);
+	testReadRecords(rbfm, "test_readrecords", PAGE_COMPACT);
+
+	cout << "RBF Test Case Read Records Finished! The result will be examined." << endl << endl;
+
+	return 0;
+}
+
+int main()
+{
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+	remove("test_readrecords");
+
+	RC rcmain = RBFTest_ReadRecords(rbfm);
+	return rcmain;
+}
@@ -0,0 +1,186 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+int RBFTest_SlottedPage(RecordBasedFileManager *rbfm)
+{
+	// Functions tested
+	// 1. Fill a DataPage
+	// 2. Delete Records, slots are kept
+	// 3. Insert larger Records, page is compacted with slot numbers kept
+	// 4. Create File & Insert/Delete Records
+	// 5. Scan skips deleted Records
+	// 6. Read/Update/Delete Record and Scan fail on a page of an unknown format
+	// 7. Destroy File
+	cout << endl << "***** In RBF Test Case Slotted Page *****" << endl;
+
+	RC rc;
+	string fileName = "test_slottedpage";
+
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+	int nullFieldsIndicatorActualSize = getActualByteForNullsIndicator(recordDescriptor.size());
+	unsigned char *nullsIndicator = (unsigned char *)malloc(nullFieldsIndicatorActualSize);
+	memset(nullsIndicator, 0, nullFieldsIndicatorActualSize);
+	void *record = malloc(200);
+	void *returnedData = malloc(200);
+	int recordSize = 0;
+	RID rid;
+
+	// a page alone
+	char *data = (char *)calloc(1, PAGE_SIZE);
+	DataPage page(data);
+	page.init();
+	rid.pageNum = 0;
+	vector<int> sizes;
+	while (true)
+	{
+		unsigned i = sizes.size();
+		prepareRecord(recordDescriptor.size(), nullsIndicator, 8, "Anteater", i, 177.8, i, record, &recordSize);
+		if (page.insertRecord(recordDescriptor, (char *)record, recordSize, rid) != 0)
+		{
+			break;
+		}
+		assert(rid.slotNum == i && "Slots should be added in order.");
+		sizes.push_back(recordSize);
+	}
+	unsigned slotNum = page.getSlotNum();
+	assert(slotNum == sizes.size() && slotNum > 50 && "Page should be full of records.");
+	assert(page.getDataSize() + page.getFreeSize() == PAGE_SIZE && "Data size and free size should sum up.");
+
+	// holes in the middle
+	for (unsigned i = 0; i < slotNum; i += 2)
+	{
+		rc = page.deleteRecord(i);
+		assert(rc == success && "Deleting a record should not fail.");
+	}
+	rc = page.deleteRecord(0);
+	assert(rc != success && "Deleting a deleted record should fail.");
+	assert(page.getSlotNum() == slotNum && "Slots should be kept.");
+
+	// longer records only fit after compaction, and take the deleted slots
+	string longName(30, 'a');
+	unsigned reused = 0;
+	while (true)
+	{
+		prepareRecord(recordDescriptor.size(), nullsIndicator, longName.size(), longName, reused, 177.8, reused, record, &recordSize);
+		if (page.insertRecord(recordDescriptor, (char *)record, recordSize, rid) != 0)
+		{
+			break;
+		}
+		assert(rid.slotNum % 2 == 0 && rid.slotNum < slotNum && "Deleted slots should be reused.");
+		reused++;
+	}
+	assert(reused > 0 && "Some records should fit after compaction.");
+	assert(page.getSlotNum() == slotNum && "No slot should be added.");
+
+	for (unsigned i = 1; i < slotNum; i += 2)
+	{
+		prepareRecord(recordDescriptor.size(), nullsIndicator, 8, "Anteater", i, 177.8, i, record, &recordSize);
+		Record rec = page.getRecord(i);
+		assert(rec.ptrFlag == 0 && rec.getRawData(recordDescriptor, (char *)returnedData) == (unsigned)recordSize && "Record should be kept.");
+		assert(memcmp(returnedData, record, recordSize) == 0 && "Record should be kept after compaction.");
+	}
+	free(data);
+
+	// in a file
+	rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	rc = createFileShouldSucceed(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	unsigned numRecords = 1000;
+	vector<RID> rids;
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		prepareRecord(recordDescriptor.size(), nullsIndicator, 8, "Anteater", i, 177.8, i, record, &recordSize);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+		assert(rc == success && "Inserting a record should not fail.");
+		rids.push_back(rid);
+	}
+	for (unsigned i = 0; i < numRecords; i += 3)
+	{
+		rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+		assert(rc == success && "Deleting a record should not fail.");
+		rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedData);
+		assert(rc != success && "Reading a deleted record should fail.");
+	}
+
+	vector<string> attributeNames;
+	attributeNames.push_back("Age");
+	RBFM_ScanIterator rbfm_ScanIterator;
+	rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, rbfm_ScanIterator);
+	assert(rc == success && "Scanning a file should not fail.");
+	unsigned count = 0;
+	while (rbfm_ScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+	{
+		int age = 0;
+		memcpy(&age, (char *)returnedData + nullFieldsIndicatorActualSize, sizeof(int));
+		assert(age % 3 != 0 && "Deleted record should not be scanned.");
+		count++;
+	}
+	rbfm_ScanIterator.close();
+	assert(count == numRecords - (numRecords + 2) / 3 && "Scan should return all records left.");
+
+	// a page of an unknown format fails the calls reading it
+	char *garbage = (char *)malloc(PAGE_SIZE);
+	memset(garbage, 0x5A, PAGE_SIZE);
+	rc = fileHandle.writePage(rids[1].pageNum, garbage);
+	assert(rc == success && "Writing a page should not fail.");
+	rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[1], returnedData);
+	assert(rc != success && "Reading a record of an unknown page should fail.");
+	prepareRecord(recordDescriptor.size(), nullsIndicator, 8, "Anteater", 1, 177.8, 1, record, &recordSize);
+	rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[1]);
+	assert(rc != success && "Updating a record of an unknown page should fail.");
+	rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[1]);
+	assert(rc != success && "Deleting a record of an unknown page should fail.");
+	rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, rbfm_ScanIterator);
+	assert(rc == success && "Scanning a file should not fail.");
+	assert(rbfm_ScanIterator.getNextRecord(rid, returnedData) == RBFM_SCAN_ERROR && "Scan should fail on an unknown page.");
+	rbfm_ScanIterator.close();
+	free(garbage);
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	rc = destroyFileShouldSucceed(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	free(nullsIndicator);
+	free(record);
+	free(returnedData);
+
+	cout << "RBF Test Case Slotted Page Finished! The result will be examined." << endl << endl;
+
+	return 0;
+}
+
+int main()
+{
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+	remove("test_slottedpage");
+
+	RC rcmain = RBFTest_SlottedPage(rbfm);
+	return rcmain;
+}
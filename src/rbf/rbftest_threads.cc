@@ -0,0 +1,270 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <algorithm>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+const unsigned THREAD_RECORDS = 2000;
+
+static void prepareThreadRecord(const vector<Attribute> &recordDescriptor, unsigned owner, unsigned i, char *record, int *recordSize)
+{
+	unsigned char nullsIndicator[1] = {0};
+	unsigned nameLength = 1 + (owner + i) % 30;
+	prepareRecord(recordDescriptor.size(), nullsIndicator, nameLength, string(nameLength, 'a' + owner % 26), i % 100, owner * 0.5, i, record, recordSize);
+}
+
+// each thread inserts into and reads back its own file
+static void insertAndRead(unsigned owner, atomic<unsigned> &failures)
+{
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+	string fileName = "test_threads_" + to_string(owner);
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+	char record[PAGE_SIZE], returnedData[PAGE_SIZE];
+	int recordSize = 0;
+
+	FileHandle fileHandle;
+	remove(fileName.c_str());
+	if (rbfm->createFile(fileName) != success || rbfm->openFile(fileName, fileHandle) != success)
+	{
+		failures++;
+		return;
+	}
+	vector<RID> rids(THREAD_RECORDS);
+	for (unsigned i = 0; i < THREAD_RECORDS; i++)
+	{
+		prepareThreadRecord(recordDescriptor, owner, i, record, &recordSize);
+		if (rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]) != success)
+		{
+			failures++;
+		}
+	}
+	for (unsigned i = 0; i < THREAD_RECORDS; i++)
+	{
+		prepareThreadRecord(recordDescriptor, owner, i, record, &recordSize);
+		if (rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedData) != success ||
+			memcmp(record, returnedData, recordSize) != 0)
+		{
+			failures++;
+		}
+	}
+	if (rbfm->closeFile(fileHandle) != success || rbfm->destroyFile(fileName) != success)
+	{
+		failures++;
+	}
+}
+
+// each thread reads the shared file by its own handle
+static void readShared(const string &fileName, const vector<RID> &rids, unsigned owner, atomic<unsigned> &failures)
+{
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+	char record[PAGE_SIZE], returnedData[PAGE_SIZE];
+	int recordSize = 0;
+
+	FileHandle fileHandle;
+	if (rbfm->openFile(fileName, fileHandle) != success)
+	{
+		failures++;
+		return;
+	}
+	for (unsigned n = 0; n < rids.size(); n++)
+	{
+		unsigned i = (n * 7919 + owner * 101) % rids.size();
+		prepareThreadRecord(recordDescriptor, 0, i, record, &recordSize);
+		if (rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedData) != success ||
+			memcmp(record, returnedData, recordSize) != 0)
+		{
+			failures++;
+		}
+		if (rbfm->readAttribute(fileHandle, recordDescriptor, rids[i], "Salary", returnedData) != success ||
+			*(int *)returnedData != (int)i)
+		{
+			failures++;
+		}
+	}
+	if (rbfm->closeFile(fileHandle) != success)
+	{
+		failures++;
+	}
+}
+
+// each thread pins all pages of the shared file by its own handle, several threads miss the same page at once
+static void pinShared(const string &fileName, unsigned numPages, unsigned owner, atomic<unsigned> &failures)
+{
+	PagedFileManager *pfm = PagedFileManager::instance();
+	FileHandle fileHandle;
+	if (pfm->openFile(fileName, fileHandle) != success)
+	{
+		failures++;
+		return;
+	}
+	for (unsigned n = 0; n < numPages; n++)
+	{
+		unsigned i = (n + owner % 2) % numPages;
+		char *data = nullptr;
+		if (fileHandle.pinPage(i, data) != success)
+		{
+			failures++;
+			continue;
+		}
+		if (data[0] != (char)(i % 96 + 30) || data[PAGE_SIZE - 1] != (char)(i % 96 + 30))
+		{
+			failures++;
+		}
+		if (fileHandle.unpinPage(i, false) != success)
+		{
+			failures++;
+		}
+	}
+	if (pfm->closeFile(fileHandle) != success)
+	{
+		failures++;
+	}
+}
+
+// records inserted and read back per second by threadNum threads
+static double runInsertAndRead(unsigned threadNum)
+{
+	atomic<unsigned> failures(0);
+	auto start = chrono::steady_clock::now();
+	vector<thread> threads;
+	for (unsigned owner = 0; owner < threadNum; owner++)
+	{
+		threads.push_back(thread(insertAndRead, owner, ref(failures)));
+	}
+	for (thread &t : threads)
+	{
+		t.join();
+	}
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	assert(failures == 0 && "Inserting and reading records from threads should not fail.");
+	return threadNum * THREAD_RECORDS / seconds;
+}
+
+int RBFTest_Threads(unsigned threadNum)
+{
+	// Functions tested
+	// 1. Get the instance from threads at once, all get the same one
+	// 2. Insert/Read Records of a file per thread, from 1 and from threadNum threads
+	// 3. Read Records and Attributes of a shared file from threadNum threads, each by its own handle
+	// 4. Pin Pages of a shared file not in the buffer pool from threadNum threads, each by its own handle
+	cout << endl << "***** In RBF Test Case Threads *****" << endl;
+
+	vector<RecordBasedFileManager *> instances(threadNum);
+	vector<thread> threads;
+	for (unsigned i = 0; i < threadNum; i++)
+	{
+		threads.push_back(thread([&instances, i]() { instances[i] = RecordBasedFileManager::instance(); }));
+	}
+	for (thread &t : threads)
+	{
+		t.join();
+	}
+	threads.clear();
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+	assert(count(instances.begin(), instances.end(), rbfm) == (int)threadNum && "All threads should get the same instance.");
+
+	double single = runInsertAndRead(1);
+	double parallel = runInsertAndRead(threadNum);
+	cout << "insert and read, 1 thread: " << (unsigned)single << " records/s, " << threadNum << " threads: "
+		 << (unsigned)parallel << " records/s, on " << thread::hardware_concurrency() << " cores" << endl;
+
+	RC rc;
+	string fileName = "test_threads_shared";
+	remove(fileName.c_str());
+	rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+	char record[PAGE_SIZE];
+	int recordSize = 0;
+	vector<RID> rids(THREAD_RECORDS);
+	for (unsigned i = 0; i < THREAD_RECORDS; i++)
+	{
+		prepareThreadRecord(recordDescriptor, 0, i, record, &recordSize);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+		assert(rc == success && "Inserting a record should not fail.");
+	}
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	atomic<unsigned> failures(0);
+	auto start = chrono::steady_clock::now();
+	for (unsigned owner = 0; owner < threadNum; owner++)
+	{
+		threads.push_back(thread(readShared, cref(fileName), cref(rids), owner, ref(failures)));
+	}
+	for (thread &t : threads)
+	{
+		t.join();
+	}
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	assert(failures == 0 && "Reading a shared file from threads should not fail.");
+	cout << "read shared, " << threadNum << " threads: " << (unsigned)(threadNum * THREAD_RECORDS / seconds) << " records/s" << endl;
+
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	PagedFileManager *pfm = PagedFileManager::instance();
+	fileName = "test_threads_pages";
+	remove(fileName.c_str());
+	rc = pfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+	rc = pfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+	unsigned numPages = 256;
+	for (unsigned i = 0; i < numPages; i++)
+	{
+		memset(record, i % 96 + 30, PAGE_SIZE);
+		rc = fileHandle.appendPage(record);
+		assert(rc == success && "Appending a page should not fail.");
+	}
+	rc = pfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	threads.clear();
+	for (unsigned owner = 0; owner < threadNum; owner++)
+	{
+		threads.push_back(thread(pinShared, cref(fileName), numPages, owner, ref(failures)));
+	}
+	for (thread &t : threads)
+	{
+		t.join();
+	}
+	assert(failures == 0 && "Pinning pages of a shared file from threads should not fail.");
+
+	rc = pfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	cout << "RBF Test Case Threads Finished! The result will be examined." << endl << endl;
+
+	return 0;
+}
+
+int main()
+{
+	// at least 8, more if the machine has more cores
+	unsigned threadNum = max(8u, thread::hardware_concurrency());
+
+	RC rcmain = RBFTest_Threads(threadNum);
+	return rcmain;
+}
@@ -0,0 +1,339 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <algorithm>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// as version 1 wrote it: [read][write][append counter][page count][directory count] of 32 bits,
+// the 1st directory page, the data pages, then the other directory pages. Every data size is PAGE_SIZE
+static void writeV1File(const string &fileName, const vector<vector<char>> &pages, unsigned readCount, unsigned writeCount)
+{
+	FILE *file = fopen(fileName.c_str(), "wb");
+	assert(file != NULL && "Creating the file should not fail.");
+	unsigned pageCount = pages.size();
+	unsigned dirCount = pageCount == 0 ? 1 : (pageCount + DIR_PAGE_LEN - 1) / DIR_PAGE_LEN;
+	uint32_t header[FILEHEADER_V1_LEN] = {readCount, writeCount, pageCount, pageCount, dirCount};
+	fwrite(header, sizeof(header), 1, file);
+	vector<unsigned> dataSizes(DIR_PAGE_LEN, PAGE_SIZE);
+	fwrite(dataSizes.data(), PAGE_SIZE, 1, file);
+	for (const vector<char> &page : pages)
+	{
+		fwrite(page.data(), PAGE_SIZE, 1, file);
+	}
+	for (unsigned i = 1; i < dirCount; i++)
+	{
+		fwrite(dataSizes.data(), PAGE_SIZE, 1, file);
+	}
+	fclose(file);
+}
+
+static uint32_t readMagic(const string &fileName)
+{
+	uint32_t magic = 0;
+	FILE *file = fopen(fileName.c_str(), "rb");
+	assert(file != NULL && fread(&magic, sizeof(magic), 1, file) == 1 && "Reading the header should not fail.");
+	fclose(file);
+	return magic;
+}
+
+static bool checkPage(FileHandle &fileHandle, PageNum pageNum, char fill)
+{
+	char data[PAGE_SIZE], expected[PAGE_SIZE];
+	memset(expected, fill, PAGE_SIZE);
+	return fileHandle.readPage(pageNum, data) == success && memcmp(data, expected, PAGE_SIZE) == 0;
+}
+
+// a version 1 file of numPages pages is widened by its first open, pages and counters are kept
+static void testPagedFile(PagedFileManager *pfm, const string &fileName, unsigned numPages)
+{
+	vector<vector<char>> pages;
+	for (unsigned i = 0; i < numPages; i++)
+	{
+		pages.push_back(vector<char>(PAGE_SIZE, i % 96 + 30));
+	}
+	writeV1File(fileName, pages, 7, 3);
+
+	FileHandle fileHandle;
+	RC rc = pfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening a version 1 file should not fail.");
+	assert(readMagic(fileName) == PFM_MAGIC && "The header should be upgraded on disk.");
+	assert(fileHandle.getNumberOfPages() == numPages && "Pages should be kept.");
+	unsigned readPageCount = 0, writePageCount = 0, appendPageCount = 0;
+	fileHandle.collectCounterValues(readPageCount, writePageCount, appendPageCount);
+	assert(readPageCount == 7 && writePageCount == 3 && appendPageCount == numPages && "Counters should be kept.");
+	for (unsigned i = 0; i < numPages; i++)
+	{
+		assert(checkPage(fileHandle, i, i % 96 + 30) && "Pages should read as version 1 wrote them.");
+		unsigned size = 0;
+		rc = fileHandle.getPageSize(i, size);
+		assert(rc == success && size == PAGE_SIZE && "Data sizes should be kept.");
+	}
+	char data[PAGE_SIZE];
+	memset(data, 'N', PAGE_SIZE);
+	rc = fileHandle.appendPage(data);
+	assert(rc == success && "Appending a page should not fail.");
+	rc = pfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	// opened as it is the second time
+	rc = pfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+	assert(fileHandle.getNumberOfPages() == numPages + 1 && "Pages should be kept.");
+	assert(checkPage(fileHandle, 0, 30) && checkPage(fileHandle, numPages - 1, (numPages - 1) % 96 + 30) &&
+		   checkPage(fileHandle, numPages, 'N') && "Pages should be kept.");
+	rc = pfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = pfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+}
+
+// a page as version 1 wrote it: [size][record count], then "Rec:", ptrFlag, RID and raw data of each record,
+// a deleted one has its header only. records[i] is empty if deleted
+static vector<char> makeV1Page(PageNum pageNum, const vector<string> &records)
+{
+	vector<char> page(PAGE_SIZE, 0);
+	unsigned offset = 2 * sizeof(unsigned);
+	for (unsigned i = 0; i < records.size(); i++)
+	{
+		int ptrFlag = records[i].empty() ? REC_DELETED : REC_HOME;
+		RID rid = {pageNum, i};
+		memcpy(&page[offset], "Rec:", 4);
+		memcpy(&page[offset + 4], &ptrFlag, sizeof(int));
+		memcpy(&page[offset + 4 + sizeof(int)], &rid, sizeof(RID));
+		offset += Record::REC_HEADER_SIZE;
+		memcpy(&page[offset], records[i].data(), records[i].size());
+		offset += records[i].size();
+	}
+	unsigned recordNum = records.size();
+	memcpy(&page[0], &offset, sizeof(unsigned));
+	memcpy(&page[sizeof(unsigned)], &recordNum, sizeof(unsigned));
+	return page;
+}
+
+// records of page as full as version 1 filled it, every 5th and the last are deleted
+static vector<string> fillV1Page(const vector<Attribute> &recordDescriptor, PageNum pageNum, unsigned maxNameLength)
+{
+	vector<string> records;
+	char record[PAGE_SIZE];
+	int recordSize = 0;
+	unsigned char nullsIndicator[1] = {0};
+	unsigned size = 2 * sizeof(unsigned);
+	for (unsigned i = 0;; i++)
+	{
+		unsigned nameLength = 1 + (pageNum + i) % maxNameLength;
+		prepareRecord(recordDescriptor.size(), nullsIndicator, nameLength, string(nameLength, 'a' + i % 26), i, i * 0.5, pageNum, record, &recordSize);
+		if (size + Record::REC_HEADER_SIZE + recordSize > PAGE_SIZE)
+		{
+			break;
+		}
+		records.push_back(string(record, recordSize));
+		size += Record::REC_HEADER_SIZE + recordSize;
+	}
+	for (unsigned i = 0; i < records.size(); i += 5)
+	{
+		records[i].clear();
+	}
+	records.back().clear();
+	return records;
+}
+
+// all records are kept at their RIDs, deleted ones can't be read
+static void checkRecords(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+						 const vector<vector<string>> &pages)
+{
+	char data[PAGE_SIZE];
+	for (PageNum pageNum = 0; pageNum < pages.size(); pageNum++)
+	{
+		for (unsigned i = 0; i < pages[pageNum].size(); i++)
+		{
+			RID rid = {pageNum, i};
+			RC rc = rbfm->readRecord(fileHandle, recordDescriptor, rid, data);
+			if (pages[pageNum][i].empty())
+			{
+				assert(rc != success && "Reading a deleted record should fail.");
+				continue;
+			}
+			assert(rc == success && "Reading a record should not fail.");
+			assert(memcmp(data, pages[pageNum][i].data(), pages[pageNum][i].size()) == 0 && "Records should be kept at their RIDs.");
+		}
+	}
+}
+
+// records of a version 1 file are converted in place, or migrated to PAGE_COMPACT, RIDs are kept
+static void testRecordFile(RecordBasedFileManager *rbfm, const string &fileName, bool migrate)
+{
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+	// full pages of short and long names, every record grows by its field ends and some are moved out
+	vector<vector<string>> pages;
+	pages.push_back(fillV1Page(recordDescriptor, 0, 8));
+	pages.push_back(fillV1Page(recordDescriptor, 1, 30));
+	pages.push_back(vector<string>());
+	pages.push_back(vector<string>(pages[0].begin(), pages[0].begin() + 3));
+	vector<vector<char>> v1Pages;
+	unsigned live = 0;
+	for (PageNum pageNum = 0; pageNum < pages.size(); pageNum++)
+	{
+		v1Pages.push_back(makeV1Page(pageNum, pages[pageNum]));
+		live += count_if(pages[pageNum].begin(), pages[pageNum].end(), [](const string &record) { return !record.empty(); });
+	}
+	writeV1File(fileName, v1Pages, 0, 0);
+
+	FileHandle fileHandle;
+	RC rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening a version 1 file should not fail.");
+	unsigned unconverted = 0;
+	char data[PAGE_SIZE];
+	if (migrate)
+	{
+		rc = rbfm->migrateFile(fileHandle, recordDescriptor, unconverted);
+		assert(rc == success && unconverted == 0 && "Migrating the file should not fail.");
+		// compact records are smaller than version 1 ones
+		assert(fileHandle.getNumberOfPages() == pages.size() && "No record should be moved out.");
+		unsigned format = 0;
+		rc = fileHandle.readPage(0, data);
+		memcpy(&format, data, sizeof(unsigned));
+		assert(rc == success && format == PAGE_COMPACT && "Pages should be converted to PAGE_COMPACT.");
+	}
+	else
+	{
+		rc = rbfm->convertFile(fileHandle, recordDescriptor, unconverted);
+		assert(rc == success && unconverted == 0 && "Converting the file should not fail.");
+		assert(fileHandle.getNumberOfPages() > pages.size() && "Records that can't fit anymore should be moved out.");
+	}
+	checkRecords(rbfm, fileHandle, recordDescriptor, pages);
+
+	vector<string> attributeNames;
+	for (const Attribute &attr : recordDescriptor)
+	{
+		attributeNames.push_back(attr.name);
+	}
+	RBFM_ScanIterator rbfm_ScanIterator;
+	rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, rbfm_ScanIterator);
+	assert(rc == success && "Scanning the file should not fail.");
+	RID rid;
+	unsigned scanned = 0;
+	while ((rc = rbfm_ScanIterator.getNextRecord(rid, data)) == success)
+	{
+		assert(memcmp(data, pages[rid.pageNum][rid.slotNum].data(), pages[rid.pageNum][rid.slotNum].size()) == 0 &&
+			   "Scanned records should be kept at their RIDs.");
+		scanned++;
+	}
+	rbfm_ScanIterator.close();
+	assert(rc == RBFM_EOF && scanned == live && "Every record should be scanned once.");
+
+	// the converted pages take updates and inserts
+	rid = {1, 1};
+	rc = rbfm->updateRecord(fileHandle, recordDescriptor, pages[3][1].data(), rid);
+	assert(rc == success && "Updating a record should not fail.");
+	pages[1][1] = pages[3][1];
+	RID inserted;
+	rc = rbfm->insertRecord(fileHandle, recordDescriptor, pages[0][1].data(), inserted);
+	assert(rc == success && "Inserting a record should not fail.");
+	if (inserted.pageNum < pages.size())
+	{
+		// a deleted slot or a new one of a converted page
+		assert((inserted.slotNum >= pages[inserted.pageNum].size() || pages[inserted.pageNum][inserted.slotNum].empty()) &&
+			   "A record should not be overwritten.");
+		pages[inserted.pageNum].resize(max<size_t>(pages[inserted.pageNum].size(), inserted.slotNum + 1));
+		pages[inserted.pageNum][inserted.slotNum] = pages[0][1];
+	}
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+	checkRecords(rbfm, fileHandle, recordDescriptor, pages);
+	rc = rbfm->readRecord(fileHandle, recordDescriptor, inserted, data);
+	assert(rc == success && memcmp(data, pages[0][1].data(), pages[0][1].size()) == 0 && "Reading the inserted record should not fail.");
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+}
+
+int RBFTest_Upgrade(PagedFileManager *pfm)
+{
+	// Functions tested
+	// 1. Open a version 1 file, its header is widened and pages are kept
+	// 2. Same with several directory pages
+	// 3. A file of neither version is refused, and left as it is
+	// 4. Convert the records of a version 1 file, read, scan, update and insert them
+	// 5. Same with the file migrated to PAGE_COMPACT
+	// 6. A page that is no version 1 page of the descriptor is left as it is
+	cout << endl << "***** In RBF Test Case Upgrade *****" << endl;
+
+	testPagedFile(pfm, "test_upgrade", 100);
+	testPagedFile(pfm, "test_upgrade_dirs", DIR_PAGE_LEN + 10);
+
+	// counts that don't match the size
+	string fileName = "test_upgrade_bad";
+	writeV1File(fileName, vector<vector<char>>(3, vector<char>(PAGE_SIZE, 'B')), 0, 0);
+	FILE *file = fopen(fileName.c_str(), "r+b");
+	uint32_t pageCount = 4;
+	fseek(file, 3 * sizeof(uint32_t), SEEK_SET);
+	fwrite(&pageCount, sizeof(pageCount), 1, file);
+	fclose(file);
+	size_t size = getFileSize(fileName);
+	FileHandle fileHandle;
+	RC rc = pfm->openFile(fileName, fileHandle);
+	assert(rc != success && "Opening a file of no known version should fail.");
+	assert((size_t)getFileSize(fileName) == size && "A refused file should be left as it is.");
+	rc = pfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+	testRecordFile(rbfm, "test_upgrade_records", false);
+	testRecordFile(rbfm, "test_upgrade_migrate", true);
+
+	// a record header that is not "Rec:"
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+	fileName = "test_upgrade_bad_page";
+	vector<vector<char>> pages(1, makeV1Page(0, fillV1Page(recordDescriptor, 0, 8)));
+	pages[0][2 * sizeof(unsigned)] = 'r';
+	writeV1File(fileName, pages, 0, 0);
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening a version 1 file should not fail.");
+	unsigned unconverted = 0;
+	rc = rbfm->convertFile(fileHandle, recordDescriptor, unconverted);
+	assert(rc == success && unconverted == 1 && "A page that can't be read should be counted.");
+	char data[PAGE_SIZE];
+	rc = fileHandle.readPage(0, data);
+	assert(rc == success && memcmp(data, pages[0].data(), PAGE_SIZE) == 0 && "A page that can't be read should be left as it is.");
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	cout << "RBF Test Case Upgrade Finished! The result will be examined." << endl << endl;
+
+	return 0;
+}
+
+int main()
+{
+	PagedFileManager *pfm = PagedFileManager::instance();
+
+	remove("test_upgrade");
+	remove("test_upgrade_dirs");
+	remove("test_upgrade_bad");
+	remove("test_upgrade_records");
+	remove("test_upgrade_migrate");
+	remove("test_upgrade_bad_page");
+
+	RC rcmain = RBFTest_Upgrade(pfm);
+	return rcmain;
+}
@@ -0,0 +1,213 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <set>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+int RBFTest_Vacuum(RecordBasedFileManager *rbfm)
+{
+	// Functions tested
+	// 1. Vacuum a DataPage, holes are closed & trailing deleted slots dropped
+	// 2. Create File & Insert/Update/Delete Records
+	// 3. Vacuum in batches of pages, with inserts between them
+	// 4. Read Records by their RIDs, Scan
+	// 5. Destroy File
+	cout << endl << "***** In RBF Test Case Vacuum *****" << endl;
+
+	RC rc;
+	string fileName = "test_vacuum";
+
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+	unsigned char nullsIndicator[1] = {0};
+	char record[PAGE_SIZE];
+	char returnedData[PAGE_SIZE];
+	int recordSize = 0;
+	RID rid;
+
+	// a page alone
+	char *data = (char *)calloc(1, PAGE_SIZE);
+	DataPage page(data);
+	page.init();
+	rid.pageNum = 0;
+	while (true)
+	{
+		unsigned i = page.getSlotNum();
+		prepareRecord(recordDescriptor.size(), nullsIndicator, 8, "Anteater", i, 177.8, i, record, &recordSize);
+		if (page.insertRecord(recordDescriptor, record, recordSize, rid) != 0)
+		{
+			break;
+		}
+	}
+	unsigned slotNum = page.getSlotNum();
+	assert(page.vacuum() == 0 && "A full page should be unchanged.");
+	for (unsigned i = 0; i < slotNum; i++)
+	{
+		// every 3rd, and the last 5
+		if (i % 3 == 0 || i + 5 >= slotNum)
+		{
+			rc = page.deleteRecord(i);
+			assert(rc == success && "Deleting a record should not fail.");
+		}
+	}
+	unsigned dataSize = page.getDataSize();
+	unsigned gained = page.vacuum();
+	assert(gained > 0 && "Space should be reclaimed.");
+	unsigned lastLive = slotNum - 6;
+	while (lastLive % 3 == 0)
+	{
+		lastLive--;
+	}
+	assert(page.getSlotNum() == lastLive + 1 && "Trailing deleted slots should be dropped.");
+	assert(page.getDataSize() == dataSize - (slotNum - page.getSlotNum()) * DataPage::SLOT_SIZE && "Only dropped slots should change the data size.");
+	assert(page.vacuum() == 0 && "A vacuumed page should be unchanged.");
+	for (unsigned i = 0; i < page.getSlotNum(); i++)
+	{
+		Record rec = page.getRecord(i);
+		if (i % 3 == 0)
+		{
+			assert(rec.ptrFlag == REC_DELETED && "Deleted slot should be kept.");
+			continue;
+		}
+		prepareRecord(recordDescriptor.size(), nullsIndicator, 8, "Anteater", i, 177.8, i, record, &recordSize);
+		assert(rec.getRawData(recordDescriptor, returnedData) == (unsigned)recordSize && memcmp(returnedData, record, recordSize) == 0 &&
+			   "Record should keep its slot.");
+	}
+	free(data);
+
+	// in a file
+	rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	rc = createFileShouldSucceed(fileName);
+	assert(rc == success && "Creating the file should not fail.");
+
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	unsigned numRecords = 6000;
+	vector<RID> rids;
+	vector<string> names;
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		names.push_back(string(10 + i % 20, 'a' + i % 26));
+		prepareRecord(recordDescriptor.size(), nullsIndicator, names[i].size(), names[i], i, 177.8, i, record, &recordSize);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+		assert(rc == success && "Inserting a record should not fail.");
+		rids.push_back(rid);
+	}
+	vector<bool> live(numRecords, true);
+	for (unsigned i = 0; i < numRecords; i++)
+	{
+		if (i % 4 != 0)
+		{
+			rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+			assert(rc == success && "Deleting a record should not fail.");
+			live[i] = false;
+		}
+		else if (i % 40 == 0)
+		{
+			// some are forwarded
+			names[i] = string(300, 'z');
+			prepareRecord(recordDescriptor.size(), nullsIndicator, names[i].size(), names[i], i, 177.8, i, record, &recordSize);
+			rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[i]);
+			assert(rc == success && "Updating a record should not fail.");
+		}
+	}
+
+	// 7 pages at a time, a record inserted between batches
+	unsigned reclaimed = 0, batches = 0;
+	PageNum pageNum = 0;
+	while (pageNum < fileHandle.getNumberOfPages())
+	{
+		PageNum before = pageNum;
+		rc = rbfm->vacuumPages(fileHandle, pageNum, 7, reclaimed);
+		assert(rc == success && "Vacuuming pages should not fail.");
+		assert(pageNum > before && pageNum - before <= 7 && "Batch should be bounded.");
+		batches++;
+
+		names.push_back("foreground");
+		prepareRecord(recordDescriptor.size(), nullsIndicator, names.back().size(), names.back(), rids.size(), 177.8, rids.size(), record, &recordSize);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+		assert(rc == success && "Inserting a record should not fail.");
+		rids.push_back(rid);
+		live.push_back(true);
+	}
+	assert(batches > 1 && reclaimed > 0 && "Space should be reclaimed in batches.");
+
+	unsigned again = 0;
+	rc = rbfm->vacuumFile(fileHandle, again);
+	assert(rc == success && "Vacuuming the file should not fail.");
+	assert(again < reclaimed && "Little should be left to reclaim.");
+
+	// deleted slots may be reused by the inserts
+	set<pair<unsigned, unsigned>> liveRids;
+	for (unsigned i = 0; i < rids.size(); i++)
+	{
+		if (live[i])
+		{
+			liveRids.insert(make_pair(rids[i].pageNum, rids[i].slotNum));
+		}
+	}
+	unsigned liveNum = 0;
+	for (unsigned i = 0; i < rids.size(); i++)
+	{
+		rc = rbfm->readRecord(fileHandle, recordDescriptor, rids[i], returnedData);
+		if (!live[i])
+		{
+			assert((rc != success || liveRids.count(make_pair(rids[i].pageNum, rids[i].slotNum))) && "Reading a deleted record should fail.");
+			continue;
+		}
+		liveNum++;
+		assert(rc == success && "Reading a record should not fail.");
+		prepareRecord(recordDescriptor.size(), nullsIndicator, names[i].size(), names[i], i, 177.8, i, record, &recordSize);
+		assert(memcmp(returnedData, record, recordSize) == 0 && "Record should be kept by its RID.");
+	}
+
+	vector<string> attributeNames(1, "Age");
+	RBFM_ScanIterator rbfm_ScanIterator;
+	rc = rbfm->scan(fileHandle, recordDescriptor, "", NO_OP, NULL, attributeNames, rbfm_ScanIterator);
+	assert(rc == success && "Scanning a file should not fail.");
+	unsigned count = 0;
+	while (rbfm_ScanIterator.getNextRecord(rid, returnedData) != RBFM_EOF)
+	{
+		count++;
+	}
+	rbfm_ScanIterator.close();
+	assert(count == liveNum && "Scan should return all records left.");
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	rc = destroyFileShouldSucceed(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+
+	cout << "RBF Test Case Vacuum Finished! The result will be examined." << endl << endl;
+
+	return 0;
+}
+
+int main()
+{
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+	remove("test_vacuum");
+
+	RC rcmain = RBFTest_Vacuum(rbfm);
+	return rcmain;
+}
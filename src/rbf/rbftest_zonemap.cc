@@ -0,0 +1,251 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <thread>
+#include <atomic>
+
+#include "pfm.h"
+#include "rbfm.h"
+#include "test_util.h"
+
+using namespace std;
+
+// rows of a scan of conditions, stats of the scan in stats
+static unsigned scanCount(RecordBasedFileManager *rbfm, FileHandle &fileHandle, const vector<Attribute> &recordDescriptor,
+						  const vector<vector<ScanCondition>> &conditions, RBFM_ScanIterator::Stats &stats)
+{
+	RBFM_ScanIterator rbfm_ScanIterator;
+	vector<string> attributeNames = {"Salary"};
+	RC rc = rbfm->scan(fileHandle, recordDescriptor, conditions, attributeNames, rbfm_ScanIterator);
+	assert(rc == success && "Scanning a file should not fail.");
+	RID rid;
+	char *data = (char *)malloc(PAGE_SIZE);
+	unsigned count = 0;
+	while (rbfm_ScanIterator.getNextRecord(rid, data) != RBFM_EOF)
+	{
+		count++;
+	}
+	stats = rbfm_ScanIterator.getStats();
+	rbfm_ScanIterator.close();
+	free(data);
+	return count;
+}
+
+// zones refreshed by one thread while another asks them, pages of salaries [100 * p, 100 * p + 100)
+static void testThreads(const vector<Attribute> &recordDescriptor)
+{
+	string fileName = "test_zonemap_threads";
+	RC rc = ZoneMap::create(fileName, 0);
+	assert(rc == success && "Creating a zone file should not fail.");
+	shared_ptr<ZoneMap> zoneMap = ZoneMap::load(fileName, 0);
+	assert(zoneMap && "Loading a zone file should not fail.");
+
+	const unsigned numPages = 64;
+	vector<vector<char>> pages(numPages, vector<char>(PAGE_SIZE, 0));
+	unsigned char nullsIndicator[1] = {0};
+	char record[PAGE_SIZE];
+	int recordSize = 0;
+	for (unsigned p = 0; p < numPages; p++)
+	{
+		DataPage page(pages[p].data());
+		page.init(PAGE_SLOTTED_FIELDS, recordDescriptor);
+		for (unsigned i = 0; i < 100; i += 10)
+		{
+			prepareRecord(recordDescriptor.size(), nullsIndicator, 8, "zonezone", 20, 0.5, p * 100 + i, record, &recordSize);
+			RID rid;
+			rc = page.insertRecord(recordDescriptor, record, recordSize, rid);
+			assert(rc == success && "Inserting a record should not fail.");
+		}
+	}
+
+	int high = (numPages - 4) * 100;
+	vector<vector<RBFM_ScanIterator::BoundPredicate>> groups =
+		RBFM_ScanIterator::bindConditions(recordDescriptor, {{{"Salary", GE_OP, &high}}});
+	atomic<bool> done(false);
+	atomic<unsigned> failures(0);
+	thread writer([&]() {
+		for (unsigned round = 0; round < 50; round++)
+		{
+			for (unsigned p = 0; p < numPages; p++)
+			{
+				zoneMap->refresh(p, recordDescriptor, pages[p].data());
+			}
+		}
+		done = true;
+	});
+	// a page of high salaries is never excluded, whether its zone is known yet or not
+	while (!done)
+	{
+		for (unsigned p = numPages - 4; p < numPages; p++)
+		{
+			failures += zoneMap->excludes(p, groups);
+		}
+	}
+	writer.join();
+	assert(failures == 0 && "Pages meeting the condition should not be excluded.");
+	for (unsigned p = 0; p < numPages; p++)
+	{
+		assert(zoneMap->excludes(p, groups) == (p < numPages - 4) && "Pages of low salaries should be excluded.");
+	}
+	zoneMap.reset();
+	remove(fileName.c_str());
+}
+
+int RBFTest_ZoneMap(RecordBasedFileManager *rbfm)
+{
+	// Functions tested
+	// 1. Create File, its zone file is made
+	// 2. Insert Records in Salary order, scans of Salary skip pages and still find all rows
+	// 3. Delete and Update Records, zones follow
+	// 4. Close and Open File, the zones are kept
+	// 5. Change the file without RecordBasedFileManager, the zones are dropped
+	// 6. Destroy File, the zone file is gone
+	// 7. Refresh zones from one thread while another asks them
+	cout << endl << "***** In RBF Test Case Zone Map *****" << endl;
+
+	RC rc;
+	string fileName = "test_zonemap";
+	string zoneFileName = ZoneMap::getZoneFileName(fileName);
+	const int numRecords = 3000;
+
+	rc = rbfm->createFile(fileName);
+	assert(rc == success && "Creating a file should not fail.");
+	rc = createFileShouldSucceed(zoneFileName);
+	assert(rc == success && "Creating a file should make its zone file.");
+
+	FileHandle fileHandle;
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+
+	vector<Attribute> recordDescriptor;
+	createRecordDescriptor(recordDescriptor);
+	int nullFieldsIndicatorActualSize = getActualByteForNullsIndicator(recordDescriptor.size());
+	unsigned char *nullsIndicator = (unsigned char *)malloc(nullFieldsIndicatorActualSize);
+	memset(nullsIndicator, 0, nullFieldsIndicatorActualSize);
+	char *record = (char *)malloc(PAGE_SIZE);
+	int recordSize = 0;
+
+	vector<RID> rids(numRecords);
+	for (int i = 0; i < numRecords; i++)
+	{
+		prepareRecord(recordDescriptor.size(), nullsIndicator, 8, "zonezone", i % 100, i * 0.5, i, record, &recordSize);
+		rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rids[i]);
+		assert(rc == success && "Inserting a record should not fail.");
+	}
+	unsigned pageNum = fileHandle.getNumberOfPages();
+	assert(pageNum > 10 && "The records should take many pages.");
+
+	int high = numRecords - 100, low = 10, huge = 99999, age = 5;
+	vector<vector<ScanCondition>> highSalary = {{{"Salary", GE_OP, &high}}};
+	vector<vector<ScanCondition>> lowOrHigh = {{{"Salary", LT_OP, &low}}, {{"Salary", GE_OP, &high}}};
+	vector<vector<ScanCondition>> ageEq = {{{"Age", EQ_OP, &age}}};
+	vector<vector<ScanCondition>> hugeSalary = {{{"Salary", GT_OP, &huge}}};
+	RBFM_ScanIterator::Stats stats;
+
+	// pages of lower salaries are not read
+	assert(scanCount(rbfm, fileHandle, recordDescriptor, highSalary, stats) == 100 && "Scan should find all high salaries.");
+	assert(stats.pagesSkipped > 0 && stats.pagesScanned < pageNum && "Scan should skip pages of low salaries.");
+	assert(stats.pagesScanned + stats.pagesSkipped == pageNum && "Scan should pass every page.");
+
+	assert(scanCount(rbfm, fileHandle, recordDescriptor, lowOrHigh, stats) == 110 && "Scan should find rows of either group.");
+	assert(stats.pagesSkipped > 0 && "Scan should skip pages meeting no group.");
+
+	// ages of a page are of a wide range, few pages are skipped
+	assert(scanCount(rbfm, fileHandle, recordDescriptor, ageEq, stats) == numRecords / 100 && "Scan should find all ages.");
+	assert(stats.pagesScanned > pageNum / 2 && "Scan should read pages that may meet the condition.");
+
+	// a parallel scan adds up the stats of its workers
+	RBFM_ParallelScanIterator parallelIterator;
+	vector<string> attributeNames = {"Salary"};
+	rc = rbfm->parallelScan(fileHandle, recordDescriptor, highSalary, attributeNames, 4, false, parallelIterator);
+	assert(rc == success && "Parallel scan should not fail.");
+	RID rid;
+	unsigned count = 0;
+	while (parallelIterator.getNextRecord(rid, record) != RBFM_EOF)
+	{
+		count++;
+	}
+	parallelIterator.close();
+	stats = parallelIterator.getStats();
+	assert(count == 100 && stats.pagesSkipped > 0 && "Parallel scan should skip pages too.");
+
+	// pages of deleted records are passed without reading
+	for (int i = 0; i < numRecords / 2; i++)
+	{
+		rc = rbfm->deleteRecord(fileHandle, recordDescriptor, rids[i]);
+		assert(rc == success && "Deleting a record should not fail.");
+	}
+	assert(scanCount(rbfm, fileHandle, recordDescriptor, vector<vector<ScanCondition>>(), stats) == numRecords / 2 && "Scan should find records left.");
+	assert(stats.pagesSkipped > 0 && "Scan should skip pages of no record.");
+
+	// an update out of the zone of its page is found
+	prepareRecord(recordDescriptor.size(), nullsIndicator, 8, "zonezone", 0, 0.0, huge + 1, record, &recordSize);
+	rc = rbfm->updateRecord(fileHandle, recordDescriptor, record, rids[numRecords - 1]);
+	assert(rc == success && "Updating a record should not fail.");
+	assert(scanCount(rbfm, fileHandle, recordDescriptor, hugeSalary, stats) == 1 && "Scan should find the updated record.");
+	assert(stats.pagesScanned == 1 && "Scan should read the page of the updated record only.");
+
+	// an insert into a freed page widens its zone
+	prepareRecord(recordDescriptor.size(), nullsIndicator, 8, "zonezone", 0, 0.0, huge + 2, record, &recordSize);
+	rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+	assert(rc == success && "Inserting a record should not fail.");
+	assert(scanCount(rbfm, fileHandle, recordDescriptor, hugeSalary, stats) == 2 && "Scan should find the inserted record.");
+
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	// zones are kept by the zone file
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+	assert(scanCount(rbfm, fileHandle, recordDescriptor, highSalary, stats) == 99 + 2 && "Scan should find high salaries left and the huge ones.");
+	assert(stats.pagesSkipped > 0 && "Scan should skip pages by the saved zones.");
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	// written without the zone map, a record out of any zone
+	rc = PagedFileManager::instance()->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+	prepareRecord(recordDescriptor.size(), nullsIndicator, 8, "zonezone", 0, 0.0, huge + 3, record, &recordSize);
+	rc = rbfm->insertRecord(fileHandle, recordDescriptor, record, rid);
+	assert(rc == success && "Inserting a record should not fail.");
+	rc = PagedFileManager::instance()->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = rbfm->openFile(fileName, fileHandle);
+	assert(rc == success && "Opening the file should not fail.");
+	assert(scanCount(rbfm, fileHandle, recordDescriptor, hugeSalary, stats) == 3 && "Scan should find the record written without zones.");
+	assert(stats.pagesSkipped == 0 && "Stale zones should be dropped.");
+	rc = rbfm->closeFile(fileHandle);
+	assert(rc == success && "Closing the file should not fail.");
+
+	rc = rbfm->destroyFile(fileName);
+	assert(rc == success && "Destroying the file should not fail.");
+	rc = destroyFileShouldSucceed(zoneFileName);
+	assert(rc == success && "Destroying the file should remove its zone file.");
+
+	testThreads(recordDescriptor);
+
+	free(nullsIndicator);
+	free(record);
+
+	cout << "RBF Test Case Zone Map Finished! The result will be examined." << endl << endl;
+
+	return 0;
+}
+
+int main()
+{
+	RecordBasedFileManager *rbfm = RecordBasedFileManager::instance();
+
+	remove("test_zonemap");
+	remove("test_zonemap.zone");
+
+	RC rcmain = RBFTest_ZoneMap(rbfm);
+	return rcmain;
+}
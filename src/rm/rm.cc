@@ -7,34 +7,73 @@ RM_ScanIterator::RM_ScanIterator()
 }
 
 RM_ScanIterator::~RM_ScanIterator()
+{
+    release();
+}
+
+RM_ScanIterator::RM_ScanIterator(
+    FileHandle *fileHandle,
+    const vector<Attribute> recordDescriptor,
+    const string conditionAttribute,
+    const CompOp compOp,
+    const char *value,
+    const vector<string> attributeNames)
+    : it(nullptr),
+      fileHandle(nullptr)
+{
+    open(fileHandle, recordDescriptor, conditionAttribute, compOp, value, attributeNames);
+}
+
+RM_ScanIterator::RM_ScanIterator(
+    FileHandle *fileHandle,
+    const vector<Attribute> recordDescriptor,
+    const vector<vector<ScanCondition>> &conditions,
+    const vector<string> attributeNames)
+    : it(nullptr),
+      fileHandle(nullptr)
+{
+    open(fileHandle, recordDescriptor, conditions, attributeNames);
+}
+
+void RM_ScanIterator::release()
 {
     if (it)
     {
         delete it;
+        it = nullptr;
     }
     if (fileHandle)
     {
         RecordBasedFileManager::instance()->closeFile(*fileHandle);
+        delete fileHandle;
+        fileHandle = nullptr;
     }
 }
 
-RM_ScanIterator::RM_ScanIterator(
+RC RM_ScanIterator::open(
     FileHandle *fileHandle,
-    const vector<Attribute> recordDescriptor,
-    const string conditionAttribute,
+    const vector<Attribute> &recordDescriptor,
+    const string &conditionAttribute,
     const CompOp compOp,
     const char *value,
-    const vector<string> attributeNames)
-    : it(nullptr),
-      fileHandle(fileHandle)
+    const vector<string> &attributeNames)
 {
-    it = new RBFM_ScanIterator(
-        fileHandle,
-        recordDescriptor,
-        conditionAttribute,
-        compOp,
-        value,
-        attributeNames);
+    release();
+    this->fileHandle = fileHandle;
+    it = new RBFM_ScanIterator();
+    return RecordBasedFileManager::instance()->scan(*fileHandle, recordDescriptor, conditionAttribute, compOp, value, attributeNames, *it);
+}
+
+RC RM_ScanIterator::open(
+    FileHandle *fileHandle,
+    const vector<Attribute> &recordDescriptor,
+    const vector<vector<ScanCondition>> &conditions,
+    const vector<string> &attributeNames)
+{
+    release();
+    this->fileHandle = fileHandle;
+    it = new RBFM_ScanIterator();
+    return RecordBasedFileManager::instance()->scan(*fileHandle, recordDescriptor, conditions, attributeNames, *it);
 }
 
 RC RM_ScanIterator::getNextTuple(RID &rid, void *data)
@@ -42,6 +81,16 @@ RC RM_ScanIterator::getNextTuple(RID &rid, void *data)
     return it->getNextRecord(rid, data);
 }
 
+RC RM_ScanIterator::getNextBatch(RID *rids, void *data, unsigned maxRows, unsigned &rows)
+{
+    return it->getNextBatch(rids, data, maxRows, rows);
+}
+
+unsigned RM_ScanIterator::getMaxRowSize()
+{
+    return it->getMaxRowSize();
+}
+
 RC RM_ScanIterator::close()
 {
     return it->close();
@@ -65,6 +114,7 @@ RelationManager::~RelationManager()
 
 RC RelationManager::createCatalog()
 {
+    char buffer[PAGE_SIZE];
     // can't use this! since catalog haven't create!
     // createTable(TABLES_TBL, TABLES_ATTRS, TABLES_ID);
     // createTable(COLUMNS_TBL, COLUMNS_ATTRS, COLUMNS_ID);
@@ -89,11 +139,11 @@ RC RelationManager::createCatalog()
     FileHandle fileHandle;
     rbfm->openFile(tableFileName, fileHandle);
 
-    prepareTableRecordInBuf(TABLES_ID, TABLES_TBL);
+    prepareTableRecordInBuf(buffer, TABLES_ID, TABLES_TBL);
     // rbfm->printRecord(TABLES_ATTRS, buffer);
     rbfm->insertRecord(fileHandle, TABLES_ATTRS, buffer, rid);
 
-    prepareTableRecordInBuf(COLUMNS_ID, COLUMNS_TBL);
+    prepareTableRecordInBuf(buffer, COLUMNS_ID, COLUMNS_TBL);
     // rbfm->printRecord(TABLES_ATTRS, buffer);
     rbfm->insertRecord(fileHandle, TABLES_ATTRS, buffer, rid);
 
@@ -105,14 +155,14 @@ RC RelationManager::createCatalog()
 
     for (unsigned i = 0; i < TABLES_ATTRS.size(); i++)
     {
-        prepareColumnRecordInBuf(TABLES_ID, TABLES_ATTRS[i].name, TABLES_ATTRS[i].type, TABLES_ATTRS[i].length, i);
+        prepareColumnRecordInBuf(buffer, TABLES_ID, TABLES_ATTRS[i].name, TABLES_ATTRS[i].type, TABLES_ATTRS[i].length, i);
         // rbfm->printRecord(COLUMNS_ATTRS, buffer);
         rbfm->insertRecord(fileHandle2, COLUMNS_ATTRS, buffer, rid);
     }
 
     for (unsigned i = 0; i < COLUMNS_ATTRS.size(); i++)
     {
-        prepareColumnRecordInBuf(COLUMNS_ID, COLUMNS_ATTRS[i].name, COLUMNS_ATTRS[i].type, COLUMNS_ATTRS[i].length, i);
+        prepareColumnRecordInBuf(buffer, COLUMNS_ID, COLUMNS_ATTRS[i].name, COLUMNS_ATTRS[i].type, COLUMNS_ATTRS[i].length, i);
         // rbfm->printRecord(COLUMNS_ATTRS, buffer);
         rbfm->insertRecord(fileHandle2, COLUMNS_ATTRS, buffer, rid);
     }
@@ -127,8 +177,9 @@ RC RelationManager::deleteCatalog()
     return 0;
 }
 
-RC RelationManager::createTable(const string &tableName, const vector<Attribute> &attrs, int tableId)
+RC RelationManager::createTable(const string &tableName, const vector<Attribute> &attrs, int tableId, PageFormat format)
 {
+    char buffer[PAGE_SIZE];
     RID rid;
 
     // no default table ID given, get tableId
@@ -161,7 +212,7 @@ RC RelationManager::createTable(const string &tableName, const vector<Attribute>
         // cerr << "new TableId=" << tableId << endl;
     }
 
-    if (rbfm->createFile(tableName + PREFIX) != 0)
+    if (rbfm->createFile(tableName + PREFIX, format) != 0)
     {
         cerr << "create file " << tableName << PREFIX << "failed." << endl;
         exit(-1);
@@ -170,7 +221,7 @@ RC RelationManager::createTable(const string &tableName, const vector<Attribute>
     // insert to Tables.tbl
     FileHandle fileHandle;
     rbfm->openFile(TABLES_TBL + PREFIX, fileHandle);
-    prepareTableRecordInBuf(tableId, tableName);
+    prepareTableRecordInBuf(buffer, tableId, tableName);
     // rbfm->printRecord(TABLES_ATTRS, buffer);
     rbfm->insertRecord(fileHandle, TABLES_ATTRS, buffer, rid);
 
@@ -182,7 +233,7 @@ RC RelationManager::createTable(const string &tableName, const vector<Attribute>
 
     for (unsigned i = 0; i < attrs.size(); i++)
     {
-        prepareColumnRecordInBuf(tableId, attrs[i].name, attrs[i].type, attrs[i].length, i);
+        prepareColumnRecordInBuf(buffer, tableId, attrs[i].name, attrs[i].type, attrs[i].length, i);
         // rbfm->printRecord(COLUMNS_ATTRS, buffer);
         rbfm->insertRecord(fileHandle3, COLUMNS_ATTRS, buffer, rid);
     }
@@ -198,6 +249,7 @@ RC RelationManager::deleteTable(const string &tableName)
 
 RC RelationManager::getAttributes(const string &tableName, vector<Attribute> &attrs)
 {
+    char buffer[PAGE_SIZE];
     // get tableId
     int tableId = 0;
     RID rid = {0, 0};
@@ -245,7 +297,7 @@ RC RelationManager::getAttributes(const string &tableName, vector<Attribute> &at
     int pos = 0;
     while (colIt.getNextRecord(rid, buffer) != RBFM_EOF)
     {
-        readColumnRecordInBuf(tableId, name, type, len, pos);
+        readColumnRecordInBuf(buffer, tableId, name, type, len, pos);
         // rbfm->printRecord(COLUMNS_ATTRS, buffer);
         // cerr << name << ", " << type << ", " << len << ", " << pos << endl;
         Utils::assertExit("column position unordered.", static_cast<unsigned>(pos) != attrs.size());
@@ -257,6 +309,7 @@ RC RelationManager::getAttributes(const string &tableName, vector<Attribute> &at
 
 RC RelationManager::insertTuple(const string &tableName, const void *data, RID &rid)
 {
+    char buffer[PAGE_SIZE];
     vector<Attribute> recordDescriptor;
     if (getAttributes(tableName, recordDescriptor) != 0)
     {
@@ -278,7 +331,7 @@ RC RelationManager::insertTuple(const string &tableName, const void *data, RID &
         // index exist
         if (ix->openFile(getIdxFileName(tableName, recordDescriptor[i].name), ixfileHandle) == 0)
         {
-            Record record(recordDescriptor, static_cast<const char *>(data));
+            Record record(static_cast<const char *>(data), Record::getRecordSize(recordDescriptor, data));
             record.getAttribute(recordDescriptor, recordDescriptor[i].name, buffer);
             ix->insertEntry(ixfileHandle, recordDescriptor[i], buffer, rid);
             // ix->printBtree(ixfileHandle, recordDescriptor[i]);
@@ -290,6 +343,108 @@ RC RelationManager::insertTuple(const string &tableName, const void *data, RID &
     return 0;
 }
 
+RC RelationManager::insertTuples(const string &tableName, const vector<const void *> &tuples, vector<RID> &rids)
+{
+    char buffer[PAGE_SIZE];
+    vector<Attribute> recordDescriptor;
+    if (getAttributes(tableName, recordDescriptor) != 0)
+    {
+        cerr << "get Attribute at " << tableName << "failed" << endl;
+        return -1;
+    }
+    FileHandle fileHandle;
+    if (rbfm->openFile(tableName + PREFIX, fileHandle) != 0)
+    {
+        cerr << "can't open .tbl" + tableName << endl;
+        return -1;
+    }
+    RC rc = rbfm->insertRecords(fileHandle, recordDescriptor, tuples, rids);
+    rbfm->closeFile(fileHandle);
+    if (rc != 0)
+    {
+        return -1;
+    }
+
+    // insert to index, each opened once
+    for (unsigned i = 0; i < recordDescriptor.size(); i++)
+    {
+        IXFileHandle ixfileHandle;
+        if (ix->openFile(getIdxFileName(tableName, recordDescriptor[i].name), ixfileHandle) != 0)
+        {
+            continue;
+        }
+        for (unsigned j = 0; j < tuples.size(); j++)
+        {
+            Record record(static_cast<const char *>(tuples[j]), Record::getRecordSize(recordDescriptor, tuples[j]));
+            record.getAttribute(recordDescriptor, recordDescriptor[i].name, buffer);
+            ix->insertEntry(ixfileHandle, recordDescriptor[i], buffer, rids[j]);
+        }
+        ix->closeFile(ixfileHandle);
+    }
+    return 0;
+}
+
+RC RelationManager::vacuumTable(const string &tableName, unsigned &reclaimed)
+{
+    FileHandle fileHandle;
+    if (rbfm->openFile(tableName + PREFIX, fileHandle) != 0)
+    {
+        cerr << "can't open .tbl" + tableName << endl;
+        return -1;
+    }
+    RC rc = rbfm->vacuumFile(fileHandle, reclaimed);
+    rbfm->closeFile(fileHandle);
+    return rc;
+}
+
+RC RelationManager::convertCatalog()
+{
+    const string fileNames[] = {TABLES_TBL + PREFIX, COLUMNS_TBL + PREFIX};
+    const vector<Attribute> *descriptors[] = {&TABLES_ATTRS, &COLUMNS_ATTRS};
+    for (unsigned i = 0; i < 2; i++)
+    {
+        FileHandle fileHandle;
+        if (rbfm->openFile(fileNames[i], fileHandle) != 0)
+        {
+            cerr << "can't open " << fileNames[i] << endl;
+            return -1;
+        }
+        unsigned unconverted = 0;
+        RC rc = rbfm->convertFile(fileHandle, *descriptors[i], unconverted);
+        rbfm->closeFile(fileHandle);
+        if (rc != 0 || unconverted > 0)
+        {
+            cerr << fileNames[i] << " can't be converted" << endl;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+RC RelationManager::migrateTable(const string &tableName, unsigned &unconverted)
+{
+    // the catalog of a version 1 database is read first
+    if (convertCatalog() != 0)
+    {
+        return -1;
+    }
+    vector<Attribute> recordDescriptor;
+    if (getAttributes(tableName, recordDescriptor) != 0)
+    {
+        cerr << "get Attribute at " << tableName << "failed" << endl;
+        return -1;
+    }
+    FileHandle fileHandle;
+    if (rbfm->openFile(tableName + PREFIX, fileHandle) != 0)
+    {
+        cerr << "can't open .tbl" + tableName << endl;
+        return -1;
+    }
+    RC rc = rbfm->migrateFile(fileHandle, recordDescriptor, unconverted);
+    rbfm->closeFile(fileHandle);
+    return rc;
+}
+
 RC RelationManager::deleteTuple(const string &tableName, const RID &rid)
 {
     return -1;
@@ -319,6 +474,25 @@ RC RelationManager::readTuple(const string &tableName, const RID &rid, void *dat
     return 0;
 }
 
+RC RelationManager::readTuples(const string &tableName, const vector<RID> &rids, const vector<void *> &data, vector<RC> &rcs)
+{
+    vector<Attribute> recordDescriptor;
+    if (getAttributes(tableName, recordDescriptor) != 0)
+    {
+        cerr << "get Attribute at " << tableName << "failed" << endl;
+        return -1;
+    }
+    FileHandle fileHandle;
+    if (rbfm->openFile(tableName + PREFIX, fileHandle) != 0)
+    {
+        cerr << "can't open .tbl" + tableName << endl;
+        return -1;
+    }
+    RC rc = rbfm->readRecords(fileHandle, recordDescriptor, rids, data, rcs);
+    rbfm->closeFile(fileHandle);
+    return rc;
+}
+
 RC RelationManager::printTuple(const vector<Attribute> &attrs, const void *data)
 {
     return rbfm->printRecord(attrs, data);
@@ -373,19 +547,43 @@ RC RelationManager::scan(const string &tableName,
     if (rbfm->openFile(tableName + PREFIX, *fileHandle) != 0)
     {
         cerr << "can't open .tbl" + tableName << endl;
+        delete fileHandle;
         return -1;
     }
 
-    RM_ScanIterator *it = new RM_ScanIterator(
+    return rm_ScanIterator.open(
         fileHandle,
         recordDescriptor,
         conditionAttribute,
         compOp,
         static_cast<const char *>(value),
         attributeNames);
+}
 
-    rm_ScanIterator = *it;
-    return 0;
+RC RelationManager::scan(const string &tableName,
+                         const vector<vector<ScanCondition>> &conditions,
+                         const vector<string> &attributeNames,
+                         RM_ScanIterator &rm_ScanIterator)
+{
+    vector<Attribute> recordDescriptor;
+    if (getAttributes(tableName, recordDescriptor) != 0)
+    {
+        cerr << "get Attribute at " << tableName << "failed" << endl;
+        return -1;
+    }
+    FileHandle *fileHandle = new FileHandle();
+    if (rbfm->openFile(tableName + PREFIX, *fileHandle) != 0)
+    {
+        cerr << "can't open .tbl" + tableName << endl;
+        delete fileHandle;
+        return -1;
+    }
+
+    return rm_ScanIterator.open(
+        fileHandle,
+        recordDescriptor,
+        conditions,
+        attributeNames);
 }
 
 void RelationManager::cpyAndInc(char des[], unsigned &offset, const void *src, unsigned len)
@@ -401,7 +599,7 @@ void RelationManager::readAndInc(void *des, unsigned &offset, const void *src, u
     offset += len;
 }
 
-void RelationManager::prepareTableRecordInBuf(const unsigned tableId, const string tableName)
+void RelationManager::prepareTableRecordInBuf(char *buffer, const unsigned tableId, const string tableName)
 {
     memset(buffer, 0, PAGE_SIZE);
     // jump nullindicator size = 1, all not NULL
@@ -418,7 +616,7 @@ void RelationManager::prepareTableRecordInBuf(const unsigned tableId, const stri
     cpyAndInc(buffer, offset, fileName.c_str(), fileName.length());
 }
 
-void RelationManager::prepareColumnRecordInBuf(const unsigned tableId, const string name, const AttrType type, const unsigned len, const unsigned pos)
+void RelationManager::prepareColumnRecordInBuf(char *buffer, const unsigned tableId, const string name, const AttrType type, const unsigned len, const unsigned pos)
 {
     memset(buffer, 0, PAGE_SIZE);
     unsigned offset = 1;
@@ -434,7 +632,7 @@ void RelationManager::prepareColumnRecordInBuf(const unsigned tableId, const str
     cpyAndInc(buffer, offset, &pos);
 }
 
-void RelationManager::readColumnRecordInBuf(int &tableId, string &name, AttrType &type, int &len, int &pos)
+void RelationManager::readColumnRecordInBuf(const char *buffer, int &tableId, string &name, AttrType &type, int &len, int &pos)
 {
     unsigned offset = 1;
     unsigned strSize = 0;
@@ -453,6 +651,7 @@ void RelationManager::readColumnRecordInBuf(int &tableId, string &name, AttrType
 
 RC RelationManager::createIndex(const string &tableName, const string &attributeName)
 {
+    char buffer[PAGE_SIZE];
     if (ix->createFile(getIdxFileName(tableName, attributeName)) != 0)
     {
         return -1;
@@ -484,7 +683,7 @@ RC RelationManager::createIndex(const string &tableName, const string &attribute
 
         while (it.getNextRecord(rid, buffer) != RBFM_EOF)
         {
-            Record record(recordDescriptor, static_cast<const char *>(buffer));
+            Record record(static_cast<const char *>(buffer), Record::getRecordSize(recordDescriptor, buffer));
             record.getAttribute(recordDescriptor, attributeName, buffer);
             ix->insertEntry(ixfileHandle, attribute, buffer, rid);
             // rbfm->readAttribute(fileHandle, rid, attributeName, buffer);
@@ -16,8 +16,11 @@ class RM_ScanIterator
 {
   private:
     RBFM_ScanIterator *it;
+    // opened by RelationManager::scan(), closed and deleted with the iterator
     FileHandle *fileHandle;
 
+    void release();
+
   public:
     RM_ScanIterator();
     RM_ScanIterator(
@@ -27,9 +30,31 @@ class RM_ScanIterator
         const CompOp compOp,
         const char *value,
         const vector<string> attributeNames);
+    RM_ScanIterator(
+        FileHandle *fileHandle,
+        const vector<Attribute> recordDescriptor,
+        const vector<vector<ScanCondition>> &conditions,
+        const vector<string> attributeNames);
     ~RM_ScanIterator();
 
+    // scan of fileHandle, the iterator takes it over; a scan opened before is released
+    RC open(
+        FileHandle *fileHandle,
+        const vector<Attribute> &recordDescriptor,
+        const string &conditionAttribute,
+        const CompOp compOp,
+        const char *value,
+        const vector<string> &attributeNames);
+    RC open(
+        FileHandle *fileHandle,
+        const vector<Attribute> &recordDescriptor,
+        const vector<vector<ScanCondition>> &conditions,
+        const vector<string> &attributeNames);
+
     RC getNextTuple(RID &rid, void *data);
+    // see RBFM_ScanIterator::getNextBatch()
+    RC getNextBatch(RID *rids, void *data, unsigned maxRows, unsigned &rows);
+    unsigned getMaxRowSize();
     RC close();
 };
 
@@ -72,15 +97,20 @@ class RelationManager
     RC createCatalog();
     RC deleteCatalog();
 
-    RC createTable(const string &tableName, const vector<Attribute> &attrs, int tableId = -1);
+    // pages of the table are of format, PAGE_PAX stores attributes in column minipages for scans of few attributes
+    RC createTable(const string &tableName, const vector<Attribute> &attrs, int tableId = -1, PageFormat format = PAGE_SLOTTED_FIELDS);
     RC deleteTable(const string &tableName);
 
     RC getAttributes(const string &tableName, vector<Attribute> &attrs);
 
     RC insertTuple(const string &tableName, const void *data, RID &rid);
+    // see RecordBasedFileManager::insertRecords(), index entries are inserted as well
+    RC insertTuples(const string &tableName, const vector<const void *> &tuples, vector<RID> &rids);
     RC deleteTuple(const string &tableName, const RID &rid);
     RC updateTuple(const string &tableName, const void *data, const RID &rid);
     RC readTuple(const string &tableName, const RID &rid, void *data);
+    // see RecordBasedFileManager::readRecords(), the table is opened once
+    RC readTuples(const string &tableName, const vector<RID> &rids, const vector<void *> &data, vector<RC> &rcs);
     RC printTuple(const vector<Attribute> &attrs, const void *data);
 
     // with NULL indicator
@@ -92,6 +122,11 @@ class RelationManager
             const void *value,
             const vector<string> &attributeNames,
             RM_ScanIterator &rm_ScanIterator);
+    // see RecordBasedFileManager::scan() of conditions
+    RC scan(const string &tableName,
+            const vector<vector<ScanCondition>> &conditions,
+            const vector<string> &attributeNames,
+            RM_ScanIterator &rm_ScanIterator);
 
     RC createIndex(const string &tableName, const string &attributeName);
     RC destroyIndex(const string &tableName, const string &attributeName);
@@ -106,22 +141,29 @@ class RelationManager
                  RM_IndexScanIterator &rm_IndexScanIterator);
 
 
+    // see RecordBasedFileManager::vacuumFile()
+    RC vacuumTable(const string &tableName, unsigned &reclaimed);
+    // see RecordBasedFileManager::migrateFile(), the catalog of a version 1 database is converted first
+    RC migrateTable(const string &tableName, unsigned &unconverted);
+
     RC addAttribute(const string &tableName, const Attribute &attr);
     RC dropAttribute(const string &tableName, const string &attributeName);
 
   protected:
     RecordBasedFileManager *rbfm;
     IndexManager *ix;
-    char buffer[PAGE_SIZE];
 
     RelationManager();
     ~RelationManager();
 
     void cpyAndInc(char des[], unsigned &offset, const void *src, unsigned len = 4);
     void readAndInc(void *des, unsigned &offset, const void *src, unsigned len = 4);
-    void prepareTableRecordInBuf(const unsigned tableId, const string tableName);
-    void prepareColumnRecordInBuf(const unsigned tableId, const string name, const AttrType type, const unsigned len, const unsigned pos);
-    void readColumnRecordInBuf(int &tableId, string &name, AttrType &type, int &len, int &pos);
+    void prepareTableRecordInBuf(char *buffer, const unsigned tableId, const string tableName);
+    void prepareColumnRecordInBuf(char *buffer, const unsigned tableId, const string name, const AttrType type, const unsigned len, const unsigned pos);
+    void readColumnRecordInBuf(const char *buffer, int &tableId, string &name, AttrType &type, int &len, int &pos);
+    // pages of the catalog files left by version 1 are converted, see RecordBasedFileManager::convertFile();
+    // -1 if a page is left
+    RC convertCatalog();
 };
 
 #endif